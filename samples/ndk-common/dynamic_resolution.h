@@ -0,0 +1,195 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDK_COMMON_DYNAMIC_RESOLUTION_H_  // NOLINT
+#define NDK_COMMON_DYNAMIC_RESOLUTION_H_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "vr/gvr/capi/include/gvr_types.h"
+
+// Dynamic resolution for the NDK samples.
+//
+// The eyes are rendered at a scale of the render target size that a
+// ScaleController adjusts from the measured frame times: down as soon as
+// frames take longer than the target, and back up only once there is clear
+// headroom, so the scale does not flip between two levels.
+//
+// Changing the size of a swap chain buffer reallocates it, so the buffer is
+// allocated once at the largest scale and the eyes are rendered into a
+// corner of it that is scaled with ScaleUv(). GVR only samples that corner.
+namespace dynamic_resolution {
+
+struct ScaleControllerOptions {
+  ScaleControllerOptions()
+      : min_scale(0.5f),
+        max_scale(1.0f),
+        scale_step(0.05f),
+        target_nanos(12500000),
+        increase_headroom(0.85f),
+        window_size(16),
+        settle_frame_count(4),
+        increase_window_count(2) {}
+
+  // Bounds of the scale of each dimension. The scale starts at |max_scale|,
+  // and only takes the values |max_scale| - k * |scale_step| that are at
+  // least |min_scale|.
+  float min_scale;
+  float max_scale;
+  float scale_step;
+
+  // Frame time to stay under, in nanoseconds.
+  int64_t target_nanos;
+
+  // The scale only goes up when the frame time expected at the next level
+  // is under this fraction of |target_nanos|.
+  float increase_headroom;
+
+  // Number of frames each decision is taken over. Their 90th percentile is
+  // compared to the target, so that a single slow frame changes nothing.
+  int window_size;
+
+  // Number of frames ignored after a change, whose times may have been
+  // measured before it took effect (GPU timings come in a few frames late).
+  int settle_frame_count;
+
+  // Number of windows in a row that must have headroom for the scale to go
+  // up, which makes going up slower than going down.
+  int increase_window_count;
+};
+
+// Picks the render scale from the frame times. It is fed one time per frame,
+// of the GPU work that depends on the scale where timer queries are
+// available, or of the frame on the CPU otherwise, which also goes up when
+// the GPU falls behind since acquiring a frame then blocks.
+class ScaleController {
+ public:
+  explicit ScaleController(const ScaleControllerOptions& options)
+      : options_(options),
+        max_level_(static_cast<int>((options.max_scale - options.min_scale) /
+                                        options.scale_step +
+                                    1e-3f)),
+        level_(0),
+        window_(std::max(options.window_size, 1)),
+        count_(0),
+        settle_remaining_(0),
+        increase_streak_(0) {}
+
+  // Adds the time a frame took, in nanoseconds. Returns whether the scale
+  // changed.
+  bool AddFrameTime(int64_t nanos) {
+    if (settle_remaining_ > 0) {
+      --settle_remaining_;
+      return false;
+    }
+    window_[count_++] = nanos;
+    if (count_ < static_cast<int>(window_.size())) return false;
+    count_ = 0;
+    const int index = static_cast<int>(window_.size()) * 9 / 10;
+    std::nth_element(window_.begin(), window_.begin() + index, window_.end());
+    const double load = static_cast<double>(window_[index]);
+    const double target = static_cast<double>(options_.target_nanos);
+
+    // The cost of a frame is taken to grow with its pixel count, the square
+    // of the scale. The part of it that does not grow makes these estimates
+    // conservative: going down then takes another window, going up waits.
+    if (load > target) {
+      increase_streak_ = 0;
+      if (level_ == max_level_) return false;
+      // Aim at the middle of the band where the scale stays put.
+      const double wanted = scale() * std::sqrt(
+          target * (1.0 + options_.increase_headroom) / 2.0 / load);
+      int level = level_ + 1;
+      while (level < max_level_ && ScaleOf(level) > wanted) ++level;
+      SetLevel(level);
+      return true;
+    }
+    if (level_ == 0) return false;
+    const double ratio = ScaleOf(level_ - 1) / scale();
+    if (load * ratio * ratio >= target * options_.increase_headroom) {
+      increase_streak_ = 0;
+      return false;
+    }
+    if (++increase_streak_ < options_.increase_window_count) return false;
+    SetLevel(level_ - 1);
+    return true;
+  }
+
+  // Forgets the frame times measured so far, keeping the scale. Call when
+  // rendering restarts, after a pause or a new GL context.
+  void Reset() {
+    count_ = 0;
+    settle_remaining_ = options_.settle_frame_count;
+    increase_streak_ = 0;
+  }
+
+  // The current scale of each dimension.
+  float scale() const { return ScaleOf(level_); }
+
+  float max_scale() const { return options_.max_scale; }
+
+ private:
+  float ScaleOf(int level) const {
+    return options_.max_scale - level * options_.scale_step;
+  }
+
+  void SetLevel(int level) {
+    level_ = level;
+    increase_streak_ = 0;
+    settle_remaining_ = options_.settle_frame_count;
+  }
+
+  const ScaleControllerOptions options_;
+  // Levels go from 0, |max_scale|, to |max_level_|, the lowest scale.
+  const int max_level_;
+  int level_;
+
+  // Frame times of the current window, the first |count_| of which are
+  // filled.
+  std::vector<int64_t> window_;
+  int count_;
+  int settle_remaining_;
+  int increase_streak_;
+};
+
+// Returns |size| scaled by |scale| in each dimension.
+inline gvr::Sizei ScaleSize(const gvr::Sizei& size, float scale) {
+  gvr::Sizei scaled;
+  scaled.width = static_cast<int32_t>(size.width * scale);
+  scaled.height = static_cast<int32_t>(size.height * scale);
+  return scaled;
+}
+
+// Returns the part of a buffer that |uv| covers at the largest scale, when
+// rendering at |scale| into the corner of the buffer at its origin.
+inline gvr::Rectf ScaleUv(const gvr::Rectf& uv, float scale,
+                          float max_scale) {
+  const float ratio = scale / max_scale;
+  gvr::Rectf scaled;
+  scaled.left = uv.left * ratio;
+  scaled.right = uv.right * ratio;
+  scaled.bottom = uv.bottom * ratio;
+  scaled.top = uv.top * ratio;
+  return scaled;
+}
+
+}  // namespace dynamic_resolution
+
+#endif  // NDK_COMMON_DYNAMIC_RESOLUTION_H_  // NOLINT
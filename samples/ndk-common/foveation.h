@@ -0,0 +1,152 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDK_COMMON_FOVEATION_H_  // NOLINT
+#define NDK_COMMON_FOVEATION_H_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "vr/gvr/capi/include/gvr_types.h"
+
+// Fixed foveated rendering for the NDK samples.
+//
+// The lenses blur the edges of the field of view, so rendering them at the
+// resolution of its center is wasted. With foveation, each eye is rendered
+// twice: its whole field of view into a low resolution periphery buffer,
+// and the part of it around the optical axis into a small inset buffer at
+// full resolution. GVR composites the two, since the viewport of the inset
+// comes after that of the periphery and has a narrower source field of
+// view. The part of the periphery the inset covers is masked out of the
+// depth buffer first, so it is not shaded twice.
+//
+// Fields of view are gvr::Rectf angles in degrees from the optical axis, as
+// gvr::BufferViewport::GetSourceFov() returns them.
+namespace foveation {
+
+struct Config {
+  Config()
+      : enabled(false), inset_half_angle_degrees(20.0f),
+        periphery_scale(0.5f) {}
+
+  bool enabled;
+
+  // The inset covers at most this angle from the optical axis on each side.
+  float inset_half_angle_degrees;
+
+  // Resolution of the periphery relative to that of the inset, in each
+  // dimension.
+  float periphery_scale;
+};
+
+// Pixels of the periphery still rendered inside the edges of the inset, so
+// that rounding and filtering along them never show a masked pixel.
+static const int kMaskMarginPixels = 2;
+
+// Returns the part of |eye_fov| the inset covers.
+inline gvr::Rectf InsetFov(const gvr::Rectf& eye_fov,
+                           float half_angle_degrees) {
+  gvr::Rectf inset;
+  inset.left = std::min(eye_fov.left, half_angle_degrees);
+  inset.right = std::min(eye_fov.right, half_angle_degrees);
+  inset.bottom = std::min(eye_fov.bottom, half_angle_degrees);
+  inset.top = std::min(eye_fov.top, half_angle_degrees);
+  return inset;
+}
+
+namespace internal {
+
+inline float Tan(float degrees) {
+  return std::tan(degrees * static_cast<float>(M_PI) / 180.0f);
+}
+
+}  // namespace internal
+
+// Returns where |inset_fov| lies in an image of |eye_fov|, in the UV
+// coordinates of that image. Images are planar, so this goes by the tangents
+// of the angles.
+inline gvr::Rectf InsetUv(const gvr::Rectf& eye_fov,
+                          const gvr::Rectf& inset_fov) {
+  using internal::Tan;
+  const float width = Tan(eye_fov.left) + Tan(eye_fov.right);
+  const float height = Tan(eye_fov.bottom) + Tan(eye_fov.top);
+  gvr::Rectf uv;
+  uv.left = (Tan(eye_fov.left) - Tan(inset_fov.left)) / width;
+  uv.right = (Tan(eye_fov.left) + Tan(inset_fov.right)) / width;
+  uv.bottom = (Tan(eye_fov.bottom) - Tan(inset_fov.bottom)) / height;
+  uv.top = (Tan(eye_fov.bottom) + Tan(inset_fov.top)) / height;
+  return uv;
+}
+
+// Returns the size of an image of |inset_fov| with the pixel density of an
+// image of |eye_fov| that is |eye_size| pixels.
+inline gvr::Sizei InsetSize(const gvr::Sizei& eye_size,
+                            const gvr::Rectf& eye_fov,
+                            const gvr::Rectf& inset_fov) {
+  const gvr::Rectf uv = InsetUv(eye_fov, inset_fov);
+  gvr::Sizei size;
+  size.width =
+      static_cast<int32_t>(std::ceil(eye_size.width * (uv.right - uv.left)));
+  size.height =
+      static_cast<int32_t>(std::ceil(eye_size.height * (uv.top - uv.bottom)));
+  return size;
+}
+
+// Returns the pixels of the periphery image of an eye, drawn to |eye_rect|,
+// that the inset hides: those that |inset_uv| covers entirely, less
+// kMaskMarginPixels on each side. The result may be empty.
+inline gvr::Recti MaskRect(const gvr::Recti& eye_rect,
+                           const gvr::Rectf& inset_uv) {
+  const float width = static_cast<float>(eye_rect.right - eye_rect.left);
+  const float height = static_cast<float>(eye_rect.top - eye_rect.bottom);
+  gvr::Recti mask;
+  mask.left = eye_rect.left +
+              static_cast<int>(std::ceil(inset_uv.left * width)) +
+              kMaskMarginPixels;
+  mask.right = eye_rect.left +
+               static_cast<int>(std::floor(inset_uv.right * width)) -
+               kMaskMarginPixels;
+  mask.bottom = eye_rect.bottom +
+                static_cast<int>(std::ceil(inset_uv.bottom * height)) +
+                kMaskMarginPixels;
+  mask.top = eye_rect.bottom +
+             static_cast<int>(std::floor(inset_uv.top * height)) -
+             kMaskMarginPixels;
+  mask.right = std::max(mask.left, mask.right);
+  mask.top = std::max(mask.bottom, mask.top);
+  return mask;
+}
+
+// Returns the intersection of two rectangles, which may be empty.
+inline gvr::Recti IntersectRects(const gvr::Recti& a, const gvr::Recti& b) {
+  gvr::Recti result;
+  result.left = std::max(a.left, b.left);
+  result.right = std::max(result.left, std::min(a.right, b.right));
+  result.bottom = std::max(a.bottom, b.bottom);
+  result.top = std::max(result.bottom, std::min(a.top, b.top));
+  return result;
+}
+
+inline int64_t PixelCount(const gvr::Recti& rect) {
+  return static_cast<int64_t>(rect.right - rect.left) *
+         (rect.top - rect.bottom);
+}
+
+}  // namespace foveation
+
+#endif  // NDK_COMMON_FOVEATION_H_  // NOLINT
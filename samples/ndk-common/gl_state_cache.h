@@ -0,0 +1,337 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDK_COMMON_GL_STATE_CACHE_H_  // NOLINT
+#define NDK_COMMON_GL_STATE_CACHE_H_
+
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+// Shadow copy of the GL state the NDK samples change between draws, so that
+// calls which would not change anything are never issued.
+//
+// The cache assumes it sees every change to the state it tracks. Code that
+// changes it behind the cache's back (buffer uploads, GVR's distortion pass)
+// must be followed by Invalidate().
+namespace gl_state {
+
+// The GL entry points the cache issues. They go through this table so that
+// the extension entry points can be loaded at run time, and so that tests
+// can substitute their own.
+struct GlFunctions {
+  void (GL_APIENTRYP UseProgram)(GLuint program);
+  void (GL_APIENTRYP BindBuffer)(GLenum target, GLuint buffer);
+  void (GL_APIENTRYP ActiveTexture)(GLenum texture);
+  void (GL_APIENTRYP BindTexture)(GLenum target, GLuint texture);
+  void (GL_APIENTRYP EnableVertexAttribArray)(GLuint index);
+  void (GL_APIENTRYP DisableVertexAttribArray)(GLuint index);
+  void (GL_APIENTRYP Enable)(GLenum cap);
+  void (GL_APIENTRYP Disable)(GLenum cap);
+  void (GL_APIENTRYP BlendFunc)(GLenum sfactor, GLenum dfactor);
+  // Vertex array objects and instancing. These are only set on ES 3.0
+  // contexts.
+  void (GL_APIENTRYP GenVertexArrays)(GLsizei n, GLuint* arrays);
+  void (GL_APIENTRYP BindVertexArray)(GLuint array);
+  void (GL_APIENTRYP DeleteVertexArrays)(GLsizei n, const GLuint* arrays);
+  void (GL_APIENTRYP VertexAttribDivisor)(GLuint index, GLuint divisor);
+  void (GL_APIENTRYP DrawArraysInstanced)(GLenum mode, GLint first,
+                                          GLsizei count, GLsizei instances);
+};
+
+// Returns the real GL entry points. Must be called on the rendering thread
+// with the context current, since VAO support depends on the context version.
+inline GlFunctions LoadGlFunctions() {
+  GlFunctions gl;
+  gl.UseProgram = glUseProgram;
+  gl.BindBuffer = glBindBuffer;
+  gl.ActiveTexture = glActiveTexture;
+  gl.BindTexture = glBindTexture;
+  gl.EnableVertexAttribArray = glEnableVertexAttribArray;
+  gl.DisableVertexAttribArray = glDisableVertexAttribArray;
+  gl.Enable = glEnable;
+  gl.Disable = glDisable;
+  gl.BlendFunc = glBlendFunc;
+  gl.GenVertexArrays = nullptr;
+  gl.BindVertexArray = nullptr;
+  gl.DeleteVertexArrays = nullptr;
+  gl.VertexAttribDivisor = nullptr;
+  gl.DrawArraysInstanced = nullptr;
+  const char* version =
+      reinterpret_cast<const char*>(glGetString(GL_VERSION));
+  // The version string is "OpenGL ES N.M ...".
+  if (version && strncmp(version, "OpenGL ES ", 10) == 0 &&
+      version[10] >= '3') {
+    gl.GenVertexArrays = reinterpret_cast<void (GL_APIENTRYP)(GLsizei,
+        GLuint*)>(eglGetProcAddress("glGenVertexArrays"));
+    gl.BindVertexArray = reinterpret_cast<void (GL_APIENTRYP)(GLuint)>(
+        eglGetProcAddress("glBindVertexArray"));
+    gl.DeleteVertexArrays = reinterpret_cast<void (GL_APIENTRYP)(GLsizei,
+        const GLuint*)>(eglGetProcAddress("glDeleteVertexArrays"));
+    gl.VertexAttribDivisor = reinterpret_cast<void (GL_APIENTRYP)(GLuint,
+        GLuint)>(eglGetProcAddress("glVertexAttribDivisor"));
+    gl.DrawArraysInstanced = reinterpret_cast<void (GL_APIENTRYP)(GLenum,
+        GLint, GLsizei, GLsizei)>(eglGetProcAddress("glDrawArraysInstanced"));
+    if (!gl.GenVertexArrays || !gl.BindVertexArray ||
+        !gl.DeleteVertexArrays || !gl.VertexAttribDivisor ||
+        !gl.DrawArraysInstanced) {
+      gl.GenVertexArrays = nullptr;
+      gl.BindVertexArray = nullptr;
+      gl.DeleteVertexArrays = nullptr;
+      gl.VertexAttribDivisor = nullptr;
+      gl.DrawArraysInstanced = nullptr;
+    }
+  }
+  return gl;
+}
+
+class StateCache {
+ public:
+  // Number of texture units tracked. Changes to other units are always
+  // issued.
+  static const int kMaxTextureUnits = 4;
+  // Number of vertex attributes SetVertexAttribArrays() manages. This is the
+  // minimum ES 2.0 guarantees, and more than the samples' shaders use.
+  static const int kMaxVertexAttribs = 8;
+
+  StateCache() : issued_calls_(0), elided_calls_(0) {
+    memset(&gl_, 0, sizeof(gl_));
+    Invalidate();
+  }
+
+  // Sets the entry points to issue calls through and forgets all state. Must
+  // be called before any other method, and again whenever the GL context is
+  // recreated.
+  void Initialize(const GlFunctions& gl) {
+    gl_ = gl;
+    Invalidate();
+  }
+
+  // Forgets all state, so that the next change to each piece of state is
+  // issued unconditionally.
+  void Invalidate() {
+    program_ = kUnknown;
+    array_buffer_ = kUnknown;
+    vertex_array_ = kUnknown;
+    active_texture_ = kUnknown;
+    for (int i = 0; i < kMaxTextureUnits; ++i) texture_2d_[i] = kUnknown;
+    InvalidateVertexArrayState();
+    for (int i = 0; i < kCapabilityCount; ++i) capabilities_[i] = kUnknown;
+    blend_src_ = kUnknown;
+    blend_dst_ = kUnknown;
+  }
+
+  void UseProgram(GLuint program) {
+    if (Elide(program_ == program)) return;
+    gl_.UseProgram(program);
+    program_ = program;
+  }
+
+  // Binds |buffer| to GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER. The latter
+  // is part of the bound vertex array object.
+  void BindBuffer(GLenum target, GLuint buffer) {
+    GLuint* cached =
+        target == GL_ARRAY_BUFFER ? &array_buffer_ : &element_array_buffer_;
+    if (Elide(*cached == buffer)) return;
+    gl_.BindBuffer(target, buffer);
+    *cached = buffer;
+  }
+
+  // Binds |texture| to GL_TEXTURE_2D on texture unit |unit| (GL_TEXTURE0 +
+  // n), making that unit active.
+  void BindTexture2D(GLenum unit, GLuint texture) {
+    if (!Elide(active_texture_ == unit)) {
+      gl_.ActiveTexture(unit);
+      active_texture_ = unit;
+    }
+    const GLuint index = unit - GL_TEXTURE0;
+    if (index < kMaxTextureUnits) {
+      if (Elide(texture_2d_[index] == texture)) return;
+      texture_2d_[index] = texture;
+    } else {
+      ++issued_calls_;
+    }
+    gl_.BindTexture(GL_TEXTURE_2D, texture);
+  }
+
+  // Enables exactly the vertex attribute arrays whose bit is set in |mask|
+  // (bit N is attribute location N) and disables the others. This state is
+  // part of the bound vertex array object.
+  void SetVertexAttribArrays(uint32_t mask) {
+    assert((mask >> kMaxVertexAttribs) == 0);
+    const uint32_t changed = attrib_mask_known_ ? mask ^ attrib_mask_ : ~0u;
+    for (int i = 0; i < kMaxVertexAttribs; ++i) {
+      const uint32_t bit = 1u << i;
+      if (!(changed & bit)) {
+        ++elided_calls_;
+        continue;
+      }
+      if (mask & bit) {
+        gl_.EnableVertexAttribArray(i);
+      } else {
+        gl_.DisableVertexAttribArray(i);
+      }
+      ++issued_calls_;
+    }
+    attrib_mask_ = mask;
+    attrib_mask_known_ = true;
+  }
+
+  // Enables or disables GL_BLEND, GL_CULL_FACE, GL_DEPTH_TEST or
+  // GL_SCISSOR_TEST.
+  void SetCapability(GLenum cap, bool enabled) {
+    const int index = CapabilityIndex(cap);
+    const GLuint value = enabled ? 1 : 0;
+    if (index >= 0) {
+      if (Elide(capabilities_[index] == value)) return;
+      capabilities_[index] = value;
+    } else {
+      ++issued_calls_;
+    }
+    if (enabled) {
+      gl_.Enable(cap);
+    } else {
+      gl_.Disable(cap);
+    }
+  }
+
+  void BlendFunc(GLenum src, GLenum dst) {
+    if (Elide(blend_src_ == src && blend_dst_ == dst)) return;
+    gl_.BlendFunc(src, dst);
+    blend_src_ = src;
+    blend_dst_ = dst;
+  }
+
+  // Whether vertex array objects and instancing can be used. If false, the
+  // methods below must not be called.
+  bool vertex_arrays_supported() const {
+    return gl_.BindVertexArray != nullptr;
+  }
+
+  GLuint CreateVertexArray() {
+    GLuint vertex_array = 0;
+    gl_.GenVertexArrays(1, &vertex_array);
+    ++issued_calls_;
+    return vertex_array;
+  }
+
+  void DeleteVertexArray(GLuint vertex_array) {
+    gl_.DeleteVertexArrays(1, &vertex_array);
+    ++issued_calls_;
+    // Deleting the bound vertex array binds array 0.
+    if (vertex_array == vertex_array_) {
+      vertex_array_ = 0;
+      InvalidateVertexArrayState();
+    }
+  }
+
+  // Binds |vertex_array|. Since the element array buffer binding and the
+  // enabled attributes are part of it, they are forgotten when it changes.
+  void BindVertexArray(GLuint vertex_array) {
+    if (Elide(vertex_array_ == vertex_array)) return;
+    gl_.BindVertexArray(vertex_array);
+    vertex_array_ = vertex_array;
+    InvalidateVertexArrayState();
+  }
+
+  // Sets the divisor of attribute |index| in the bound vertex array object.
+  // This is not cached, since it is only set up once per vertex array.
+  void VertexAttribDivisor(GLuint index, GLuint divisor) {
+    gl_.VertexAttribDivisor(index, divisor);
+    ++issued_calls_;
+  }
+
+  // Draws |instances| instances of the given vertices. Draw calls are not
+  // counted.
+  void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count,
+                           GLsizei instances) {
+    gl_.DrawArraysInstanced(mode, first, count, instances);
+  }
+
+  // Number of calls issued and elided since the last ResetCounters(), for
+  // instrumentation.
+  int issued_calls() const { return issued_calls_; }
+  int elided_calls() const { return elided_calls_; }
+  void ResetCounters() {
+    issued_calls_ = 0;
+    elided_calls_ = 0;
+  }
+
+ private:
+  // Value of cached state that is not known.
+  static const GLuint kUnknown = 0xffffffffu;
+
+  enum {
+    kBlend,
+    kCullFace,
+    kDepthTest,
+    kScissorTest,
+    kCapabilityCount
+  };
+
+  static int CapabilityIndex(GLenum cap) {
+    switch (cap) {
+      case GL_BLEND: return kBlend;
+      case GL_CULL_FACE: return kCullFace;
+      case GL_DEPTH_TEST: return kDepthTest;
+      case GL_SCISSOR_TEST: return kScissorTest;
+      default: return -1;
+    }
+  }
+
+  // Counts a call that is elided if |unchanged|, or that the caller issues
+  // otherwise. Returns |unchanged|.
+  bool Elide(bool unchanged) {
+    if (unchanged) {
+      ++elided_calls_;
+    } else {
+      ++issued_calls_;
+    }
+    return unchanged;
+  }
+
+  void InvalidateVertexArrayState() {
+    element_array_buffer_ = kUnknown;
+    attrib_mask_ = 0;
+    attrib_mask_known_ = false;
+  }
+
+  GlFunctions gl_;
+
+  GLuint program_;
+  GLuint array_buffer_;
+  GLuint element_array_buffer_;
+  GLuint vertex_array_;
+  GLuint active_texture_;
+  GLuint texture_2d_[kMaxTextureUnits];
+  uint32_t attrib_mask_;
+  bool attrib_mask_known_;
+  GLuint capabilities_[kCapabilityCount];
+  GLuint blend_src_;
+  GLuint blend_dst_;
+
+  int issued_calls_;
+  int elided_calls_;
+
+  StateCache(const StateCache& other) = delete;
+  StateCache& operator=(const StateCache& other) = delete;
+};
+
+}  // namespace gl_state
+
+#endif  // NDK_COMMON_GL_STATE_CACHE_H_  // NOLINT
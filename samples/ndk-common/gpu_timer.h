@@ -0,0 +1,231 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDK_COMMON_GPU_TIMER_H_  // NOLINT
+#define NDK_COMMON_GPU_TIMER_H_
+
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <array>
+#include <functional>
+#include <utility>
+
+#include "trace.h"  // NOLINT
+
+#ifndef GL_TIME_ELAPSED_EXT
+#define GL_TIME_ELAPSED_EXT 0x88BF
+#endif
+#ifndef GL_GPU_DISJOINT_EXT
+#define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+#ifndef GL_QUERY_RESULT_EXT
+#define GL_QUERY_RESULT_EXT 0x8866
+#endif
+#ifndef GL_QUERY_RESULT_AVAILABLE_EXT
+#define GL_QUERY_RESULT_AVAILABLE_EXT 0x8867
+#endif
+
+namespace trace {
+
+// Number of GPU timings that can be in flight at once. The GPU runs a frame
+// or two behind, so this covers a few zones per frame.
+static const size_t kGpuQueryCount = 16;
+
+// Times GPU work with GL_EXT_disjoint_timer_query, and adds the timings to a
+// Track of their own once the GPU has them. It can also report the total
+// GPU time of each frame, for code that adapts to the load. Where the
+// extension is missing, or while neither is wanted, it does nothing.
+//
+// The GPU only reports how long the work took, so each event is placed at
+// the time its commands were issued: the durations are exact, but the GPU
+// events start earlier on the timeline than the work really did.
+//
+// Timed sections cannot nest. All methods must be called on the rendering
+// thread.
+class GpuTimer {
+ public:
+  explicit GpuTimer(const char* track_name)
+      : track_(track_name), supported_(false), first_pending_(0), next_(0),
+        active_(false), frame_(0), incomplete_frame_(0), has_sum_(false) {}
+
+  // Calls |listener| with the total GPU time of the sections timed in each
+  // frame, once the GPU finished all of them, whether or not tracing is
+  // enabled. Frames are delimited by the calls to Collect(). Frames where a
+  // section could not be timed, or with no section, are not reported.
+  void set_frame_listener(std::function<void(int64_t gpu_nanos)> listener) {
+    frame_listener_ = std::move(listener);
+  }
+
+  // Loads the extension and creates the queries. Must be called with the
+  // context current, every time a context is created; the queries of a
+  // previous context are forgotten, not deleted.
+  void Initialize() {
+    const char* extensions =
+        reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    supported_ = extensions &&
+                 strstr(extensions, "GL_EXT_disjoint_timer_query") != nullptr;
+    first_pending_ = next_ = 0;
+    active_ = false;
+    has_sum_ = false;
+    if (!supported_) return;
+    GenQueries_ = reinterpret_cast<void (GL_APIENTRYP)(GLsizei, GLuint*)>(
+        eglGetProcAddress("glGenQueriesEXT"));
+    BeginQuery_ = reinterpret_cast<void (GL_APIENTRYP)(GLenum, GLuint)>(
+        eglGetProcAddress("glBeginQueryEXT"));
+    EndQuery_ = reinterpret_cast<void (GL_APIENTRYP)(GLenum)>(
+        eglGetProcAddress("glEndQueryEXT"));
+    GetQueryObjectuiv_ = reinterpret_cast<void (GL_APIENTRYP)(GLuint, GLenum,
+        GLuint*)>(eglGetProcAddress("glGetQueryObjectuivEXT"));
+    GetQueryObjectui64v_ = reinterpret_cast<void (GL_APIENTRYP)(GLuint,
+        GLenum, uint64_t*)>(eglGetProcAddress("glGetQueryObjectui64vEXT"));
+    supported_ = GenQueries_ && BeginQuery_ && EndQuery_ &&
+                 GetQueryObjectuiv_ && GetQueryObjectui64v_;
+    if (!supported_) return;
+    GLuint ids[kGpuQueryCount];
+    GenQueries_(kGpuQueryCount, ids);
+    for (size_t i = 0; i < kGpuQueryCount; ++i) queries_[i].id = ids[i];
+  }
+
+  bool supported() const { return supported_; }
+
+  // Starts timing the GPU work issued from now on as |name|, which must be a
+  // string literal. If all queries are in flight, the work is not timed.
+  void Begin(const char* name) {
+    if (!supported_ || active_ || (!IsEnabled() && !frame_listener_)) return;
+    if (next_ - first_pending_ == kGpuQueryCount) {
+      incomplete_frame_ = frame_;
+      return;
+    }
+    Query& query = queries_[next_ % kGpuQueryCount];
+    query.name = name;
+    query.frame = frame_;
+    query.begin_nanos = NowNanos();
+    BeginQuery_(GL_TIME_ELAPSED_EXT, query.id);
+    active_ = true;
+  }
+
+  // Stops timing the work started by the last Begin().
+  void End() {
+    if (!active_) return;
+    EndQuery_(GL_TIME_ELAPSED_EXT);
+    ++next_;
+    active_ = false;
+  }
+
+  // Adds the timings the GPU finished to the track, and reports the frames
+  // it finished. Call once per frame, before timing anything in it.
+  void Collect() {
+    ++frame_;
+    if (!supported_ || first_pending_ == next_) return;
+    // Timings taken while the GPU was disjoint (for instance because its
+    // clock changed) are meaningless. Reading the flag also clears it.
+    GLint disjoint = 0;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+    while (first_pending_ != next_) {
+      const Query& query = queries_[first_pending_ % kGpuQueryCount];
+      // Queries finish in order, so the first pending one is checked first.
+      GLuint available = 0;
+      GetQueryObjectuiv_(query.id, GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+      if (!available) break;
+      uint64_t elapsed_nanos = 0;
+      GetQueryObjectui64v_(query.id, GL_QUERY_RESULT_EXT, &elapsed_nanos);
+      if (!disjoint) {
+        track_.AddEvent(query.name, query.begin_nanos,
+                        static_cast<int64_t>(elapsed_nanos));
+      }
+      AddToFrameSum(query.frame, static_cast<int64_t>(elapsed_nanos),
+                    disjoint == 0);
+      ++first_pending_;
+    }
+    // The frame summed last is complete once none of its sections is
+    // pending anymore, and no more can be started.
+    if (has_sum_ && sum_frame_ != frame_ &&
+        (first_pending_ == next_ ||
+         queries_[first_pending_ % kGpuQueryCount].frame != sum_frame_)) {
+      ReportFrameSum();
+    }
+  }
+
+ private:
+  struct Query {
+    GLuint id;
+    const char* name;
+    int64_t begin_nanos;
+    // Number of the frame the query was issued in.
+    size_t frame;
+  };
+
+  // Adds a finished section of |frame| to its frame's sum. Sections finish
+  // in order, so the sum of the previous frame is complete when one of a
+  // later frame comes in.
+  void AddToFrameSum(size_t frame, int64_t elapsed_nanos, bool valid) {
+    if (has_sum_ && frame != sum_frame_) ReportFrameSum();
+    if (!has_sum_) {
+      has_sum_ = true;
+      sum_frame_ = frame;
+      sum_nanos_ = 0;
+      sum_valid_ = frame != incomplete_frame_;
+    }
+    sum_nanos_ += elapsed_nanos;
+    sum_valid_ = sum_valid_ && valid;
+  }
+
+  void ReportFrameSum() {
+    if (sum_valid_ && frame_listener_) frame_listener_(sum_nanos_);
+    has_sum_ = false;
+  }
+
+  Track track_;
+  bool supported_;
+
+  void (GL_APIENTRYP GenQueries_)(GLsizei n, GLuint* ids);
+  void (GL_APIENTRYP BeginQuery_)(GLenum target, GLuint id);
+  void (GL_APIENTRYP EndQuery_)(GLenum target);
+  void (GL_APIENTRYP GetQueryObjectuiv_)(GLuint id, GLenum pname,
+                                         GLuint* params);
+  void (GL_APIENTRYP GetQueryObjectui64v_)(GLuint id, GLenum pname,
+                                           uint64_t* params);
+
+  // Ring of queries. Indices only ever grow; those from |first_pending_| to
+  // |next_| are in flight.
+  std::array<Query, kGpuQueryCount> queries_;
+  size_t first_pending_;
+  size_t next_;
+  // Whether a query was begun and not ended yet.
+  bool active_;
+
+  // Number of the current frame, and of the last frame where a section was
+  // not timed because all queries were in flight.
+  size_t frame_;
+  size_t incomplete_frame_;
+  std::function<void(int64_t gpu_nanos)> frame_listener_;
+  // Sum of the finished sections of frame |sum_frame_|, if |has_sum_|.
+  bool has_sum_;
+  size_t sum_frame_;
+  int64_t sum_nanos_;
+  bool sum_valid_;
+
+  GpuTimer(const GpuTimer& other) = delete;
+  GpuTimer& operator=(const GpuTimer& other) = delete;
+};
+
+}  // namespace trace
+
+#endif  // NDK_COMMON_GPU_TIMER_H_  // NOLINT
@@ -0,0 +1,306 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDK_COMMON_HIDDEN_AREA_H_  // NOLINT
+#define NDK_COMMON_HIDDEN_AREA_H_
+
+#include <GLES2/gl2.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+#include "gl_state_cache.h"  // NOLINT
+#include "vr/gvr/capi/include/gvr_types.h"
+
+// Lens visibility masks for the NDK samples.
+//
+// GVR's distortion pass only samples the part of each eye's render texture
+// that the lens shows on the screen, which leaves its corners unseen. A
+// hidden area mesh covers those parts of an eye's viewport; drawn into the
+// depth buffer at the near plane before the scene, it makes the depth test
+// reject every fragment there before it is shaded.
+//
+// The mesh is built from the distortion GVR applies, which depends on the
+// viewer, so it must be rebuilt when the viewer profile is refreshed.
+namespace hidden_area {
+
+// Returns where the distortion samples the render texture for a point of an
+// eye's viewport on the screen, for the red, green and blue channels. Both
+// are in the UV coordinates of the viewport, as with
+// gvr::GvrApi::ComputeDistortedPoint(), which this wraps for a given eye.
+typedef std::function<std::array<gvr::Vec2f, 3>(const gvr::Vec2f& screen_uv)>
+    DistortionFunction;
+
+// Points sampled along each edge of the screen viewport.
+static const int kSamplesPerEdge = 16;
+
+// Vertices of a mesh: two triangles per sample.
+static const int kVertexCount = 4 * kSamplesPerEdge * 6;
+
+// Distance the edge of the mesh is kept from the edge of the visible area,
+// in UV units, so that the straight segments between the samples never cut
+// into the visible area.
+static const float kMarginUv = 0.01f;
+
+// Distance of the outer vertices of the mesh from its center, in normalized
+// device coordinates. The viewport clips them.
+static const float kOuterRadius = 4.0f;
+
+struct Mesh {
+  // kVertexCount vertices of counterclockwise triangles, as x, y pairs in
+  // normalized device coordinates of the eye's viewport.
+  std::vector<float> positions;
+  // Fraction of the viewport the mesh covers.
+  float hidden_fraction;
+};
+
+// Builds the hidden area mesh of an eye. The visible area is the image of
+// the screen viewport by |distortion|, whose boundary is that of the screen
+// viewport, sampled. The mesh is the ring between that boundary and a
+// polygon around the viewport.
+inline Mesh BuildMesh(const DistortionFunction& distortion) {
+  const gvr::Vec2f center = distortion({0.5f, 0.5f})[1];
+
+  // The boundary, counterclockwise from the lower left corner. Each point is
+  // the channel that is sampled furthest out, pushed out by the margin.
+  std::vector<gvr::Vec2f> inner;
+  inner.reserve(4 * kSamplesPerEdge);
+  for (int edge = 0; edge < 4; ++edge) {
+    for (int i = 0; i < kSamplesPerEdge; ++i) {
+      const float t = static_cast<float>(i) / kSamplesPerEdge;
+      static const float kStarts[4][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+      static const float kSteps[4][2] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};
+      const gvr::Vec2f screen_uv = {kStarts[edge][0] + t * kSteps[edge][0],
+                                    kStarts[edge][1] + t * kSteps[edge][1]};
+      const std::array<gvr::Vec2f, 3> sampled = distortion(screen_uv);
+      float best_distance = -1.0f;
+      gvr::Vec2f point = center;
+      for (const gvr::Vec2f& channel : sampled) {
+        const float distance = std::hypot(channel.x - center.x,
+                                          channel.y - center.y);
+        if (distance > best_distance) {
+          best_distance = distance;
+          point = channel;
+        }
+      }
+      if (best_distance > 0.0f) {
+        const float push = kMarginUv / best_distance;
+        point.x += (point.x - center.x) * push;
+        point.y += (point.y - center.y) * push;
+      }
+      point.x = std::max(0.0f, std::min(1.0f, point.x));
+      point.y = std::max(0.0f, std::min(1.0f, point.y));
+      inner.push_back(point);
+    }
+  }
+
+  Mesh mesh;
+  mesh.positions.reserve(2 * kVertexCount);
+  const float center_x = 2.0f * center.x - 1.0f;
+  const float center_y = 2.0f * center.y - 1.0f;
+  float area = 0.0f;
+  const int count = static_cast<int>(inner.size());
+  for (int i = 0; i < count; ++i) {
+    const gvr::Vec2f* points[2] = {&inner[i], &inner[(i + 1) % count]};
+    float inner_ndc[2][2];
+    float outer_ndc[2][2];
+    for (int k = 0; k < 2; ++k) {
+      inner_ndc[k][0] = 2.0f * points[k]->x - 1.0f;
+      inner_ndc[k][1] = 2.0f * points[k]->y - 1.0f;
+      const float dx = inner_ndc[k][0] - center_x;
+      const float dy = inner_ndc[k][1] - center_y;
+      const float length = std::max(std::hypot(dx, dy), 1e-6f);
+      outer_ndc[k][0] = center_x + dx / length * kOuterRadius;
+      outer_ndc[k][1] = center_y + dy / length * kOuterRadius;
+    }
+    const float* quad[6] = {inner_ndc[0], outer_ndc[0], outer_ndc[1],
+                            inner_ndc[0], outer_ndc[1], inner_ndc[1]};
+    for (const float* vertex : quad) {
+      mesh.positions.push_back(vertex[0]);
+      mesh.positions.push_back(vertex[1]);
+    }
+    // Shoelace formula, for the area of the visible polygon.
+    area += points[0]->x * points[1]->y - points[1]->x * points[0]->y;
+  }
+  mesh.hidden_fraction = std::max(0.0f, 1.0f - 0.5f * area);
+  return mesh;
+}
+
+// Vertex shaders, single eye and multiview. Vertices are placed on the
+// near plane.
+static const char* kMaskVertexShaders[] = {
+    "attribute vec2 a_Position;\n"
+    "void main() {\n"
+    "  gl_Position = vec4(a_Position, -1.0, 1.0);\n"
+    "}\n",
+
+    "#version 300 es\n"
+    "#extension GL_OVR_multiview2 : enable\n"
+    "layout(num_views=2) in;\n"
+    "in vec2 a_Position;\n"
+    "in vec2 a_RightPosition;\n"
+    "void main() {\n"
+    "  vec2 position =\n"
+    "      gl_ViewID_OVR == 0u ? a_Position : a_RightPosition;\n"
+    "  gl_Position = vec4(position, -1.0, 1.0);\n"
+    "}\n",
+};
+
+// Fragment shaders. Nothing is written but depth.
+static const char* kMaskFragmentShaders[] = {
+    "precision mediump float;\n"
+    "void main() {\n"
+    "  gl_FragColor = vec4(0.0);\n"
+    "}\n",
+
+    "#version 300 es\n"
+    "precision mediump float;\n"
+    "out vec4 FragColor;\n"
+    "void main() {\n"
+    "  FragColor = vec4(0.0);\n"
+    "}\n",
+};
+
+// Draws the hidden area meshes of both eyes. The ES 2.0 variant draws one
+// eye into the current viewport; the multiview ES 3.0 variant draws both
+// layers at once, picking each eye's mesh with gl_ViewID_OVR.
+class Mask {
+ public:
+  Mask()
+      : gl_state_(nullptr), multiview_(false), program_(0), vbo_(0),
+        vertex_array_(0), position_param_(-1), right_position_param_(-1),
+        hidden_fractions_() {}
+
+  // Creates the program and the buffer, which Update() must fill before the
+  // first Draw(). Must be called with the context current, every time a
+  // context is created; the objects of a previous context are forgotten, not
+  // deleted. Returns false if the program does not build.
+  bool Initialize(gl_state::StateCache* gl_state, bool multiview) {
+    gl_state_ = gl_state;
+    multiview_ = multiview;
+    hidden_fractions_ = {};
+    const int index = multiview ? 1 : 0;
+    program_ = glCreateProgram();
+    const GLuint vertex_shader =
+        LoadShader(GL_VERTEX_SHADER, kMaskVertexShaders[index]);
+    const GLuint fragment_shader =
+        LoadShader(GL_FRAGMENT_SHADER, kMaskFragmentShaders[index]);
+    glAttachShader(program_, vertex_shader);
+    glAttachShader(program_, fragment_shader);
+    glLinkProgram(program_);
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program_, GL_LINK_STATUS, &linked);
+    if (!linked) return false;
+    position_param_ = glGetAttribLocation(program_, "a_Position");
+    right_position_param_ = glGetAttribLocation(program_, "a_RightPosition");
+
+    glGenBuffers(1, &vbo_);
+    gl_state_->BindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glBufferData(GL_ARRAY_BUFFER, 2 * 2 * kVertexCount * sizeof(float),
+                 nullptr, GL_STATIC_DRAW);
+    // With vertex array objects, the attribute setup is recorded once.
+    vertex_array_ = 0;
+    if (gl_state_->vertex_arrays_supported()) {
+      vertex_array_ = gl_state_->CreateVertexArray();
+      gl_state_->BindVertexArray(vertex_array_);
+      SetAttribPointers();
+      gl_state_->BindVertexArray(0);
+    }
+    gl_state_->BindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+  }
+
+  // Rebuilds the meshes from the distortion of each eye. Requires
+  // Initialize().
+  void Update(const DistortionFunction& left_distortion,
+              const DistortionFunction& right_distortion) {
+    const Mesh meshes[2] = {BuildMesh(left_distortion),
+                            BuildMesh(right_distortion)};
+    gl_state_->BindBuffer(GL_ARRAY_BUFFER, vbo_);
+    for (int eye = 0; eye < 2; ++eye) {
+      glBufferSubData(GL_ARRAY_BUFFER, eye * 2 * kVertexCount * sizeof(float),
+                      2 * kVertexCount * sizeof(float),
+                      meshes[eye].positions.data());
+      hidden_fractions_[eye] = meshes[eye].hidden_fraction;
+    }
+    gl_state_->BindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+
+  // Writes the near plane into the depth buffer under the mesh of |eye|, 0
+  // for the left one, or of both eyes with multiview, in the current
+  // viewport. The depth test must be enabled with the GL_LESS function, and
+  // depth writes too; color writes are turned off for the draw. Without
+  // vertex array objects, this changes the vertex attribute pointers.
+  void Draw(int eye) {
+    gl_state_->UseProgram(program_);
+    if (vertex_array_) {
+      gl_state_->BindVertexArray(vertex_array_);
+    } else {
+      SetAttribPointers();
+    }
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDrawArrays(GL_TRIANGLES, multiview_ ? 0 : eye * kVertexCount,
+                 kVertexCount);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  }
+
+  // The fraction of the viewport of |eye| that the mask covers, or 0 before
+  // the first Update().
+  float hidden_fraction(int eye) const { return hidden_fractions_[eye]; }
+
+ private:
+  static GLuint LoadShader(GLenum type, const char* source) {
+    const GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    return shader;
+  }
+
+  void SetAttribPointers() {
+    gl_state_->BindBuffer(GL_ARRAY_BUFFER, vbo_);
+    uint32_t mask = 1u << position_param_;
+    glVertexAttribPointer(position_param_, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+    if (right_position_param_ >= 0) {
+      mask |= 1u << right_position_param_;
+      glVertexAttribPointer(
+          right_position_param_, 2, GL_FLOAT, GL_FALSE, 0,
+          reinterpret_cast<const GLvoid*>(2 * kVertexCount * sizeof(float)));
+    }
+    gl_state_->SetVertexAttribArrays(mask);
+  }
+
+  gl_state::StateCache* gl_state_;
+  bool multiview_;
+  GLuint program_;
+  GLuint vbo_;
+  GLuint vertex_array_;
+  GLint position_param_;
+  GLint right_position_param_;
+  std::array<float, 2> hidden_fractions_;
+
+  Mask(const Mask& other) = delete;
+  Mask& operator=(const Mask& other) = delete;
+};
+
+}  // namespace hidden_area
+
+#endif  // NDK_COMMON_HIDDEN_AREA_H_  // NOLINT
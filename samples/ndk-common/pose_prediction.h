@@ -0,0 +1,266 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDK_COMMON_POSE_PREDICTION_H_  // NOLINT
+#define NDK_COMMON_POSE_PREDICTION_H_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <utility>
+
+#include "vr/gvr/capi/include/gvr_types.h"
+
+// Head pose prediction for the NDK samples.
+//
+// A frame is rendered with the head pose predicted for when it will be on
+// the display. Rather than a fixed guess, FrameTimer measures how long
+// frames take from the start of their update to their submission, and how
+// often the display refreshes, and PosePredictor asks for the pose that far
+// ahead. Where the pose comes from is pluggable: the samples ask GVR, but a
+// recorded trace works just as well. If the source ever returns something
+// that is not a rigid transform, the pose is extrapolated from the previous
+// ones instead.
+namespace pose_prediction {
+
+// Horizon used until enough frames were measured, and bounds of the
+// horizon.
+static const int64_t kDefaultPredictionNanos = 50000000;
+static const int64_t kMinPredictionNanos = 10000000;
+static const int64_t kMaxPredictionNanos = 100000000;
+
+// Number of frames the timing statistics are taken over, and the number
+// needed before they are used.
+static const int kTimingWindowSize = 32;
+static const int kMinTimedFrameCount = 8;
+
+// Extrapolation never goes further than this past the last known pose, so a
+// source that stays unusable leaves the view still rather than spinning.
+static const int64_t kMaxExtrapolationNanos = 100000000;
+
+// Rolling statistics of the frame timings, from which the prediction
+// horizon is picked.
+class FrameTimer {
+ public:
+  FrameTimer()
+      : count_(0), next_(0), frame_start_(-1), last_frame_start_(-1) {}
+
+  // Call at the start of each frame, before predicting the pose. Times are
+  // in nanoseconds on the monotonic clock.
+  void BeginFrame(int64_t now) {
+    last_frame_start_ = frame_start_;
+    frame_start_ = now;
+  }
+
+  // Call right after the frame was submitted.
+  void EndFrame(int64_t now) {
+    if (frame_start_ < 0 || last_frame_start_ < 0) return;
+    render_nanos_[next_] = now - frame_start_;
+    interval_nanos_[next_] = frame_start_ - last_frame_start_;
+    next_ = (next_ + 1) % kTimingWindowSize;
+    count_ = std::min(count_ + 1, kTimingWindowSize);
+  }
+
+  // Time from the start of a frame until it is on the display. A frame is
+  // shown at the first refresh after it is submitted, then takes a refresh
+  // to scan out, so this is a slow render time of the recent frames plus
+  // a refresh interval. The shortest recent interval between frames is
+  // taken as the refresh interval, since frames are paced by the display.
+  int64_t PredictionNanos() const {
+    if (count_ < kMinTimedFrameCount) return kDefaultPredictionNanos;
+    std::array<int64_t, kTimingWindowSize> scratch;
+    std::copy(render_nanos_.begin(), render_nanos_.begin() + count_,
+              scratch.begin());
+    const int slow = count_ * 9 / 10;
+    std::nth_element(scratch.begin(), scratch.begin() + slow,
+                     scratch.begin() + count_);
+    const int64_t refresh_nanos = *std::min_element(
+        interval_nanos_.begin(), interval_nanos_.begin() + count_);
+    return std::max(kMinPredictionNanos,
+                    std::min(kMaxPredictionNanos,
+                             scratch[slow] + refresh_nanos));
+  }
+
+ private:
+  // Ring of the last measurements, oldest at |next_| once full.
+  std::array<int64_t, kTimingWindowSize> render_nanos_;
+  std::array<int64_t, kTimingWindowSize> interval_nanos_;
+  int count_;
+  int next_;
+
+  int64_t frame_start_;
+  int64_t last_frame_start_;
+};
+
+// Returns whether |m| is a rigid transform: finite, with an orthonormal
+// rotation part and an affine last row.
+inline bool IsRigidTransform(const gvr::Mat4f& m) {
+  const float kTolerance = 1e-3f;
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      if (!std::isfinite(m.m[i][j])) return false;
+    }
+  }
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      float dot = 0.0f;
+      for (int k = 0; k < 3; ++k) dot += m.m[i][k] * m.m[j][k];
+      if (std::fabs(dot - (i == j ? 1.0f : 0.0f)) > kTolerance) return false;
+    }
+  }
+  return m.m[3][0] == 0.0f && m.m[3][1] == 0.0f && m.m[3][2] == 0.0f &&
+         std::fabs(m.m[3][3] - 1.0f) <= kTolerance;
+}
+
+// Predicts head poses by assuming the head keeps turning at the angular
+// velocity between the last two poses it was given. The translation, which
+// for a rotating head mostly comes from the neck model, is kept as is.
+class AngularExtrapolator {
+ public:
+  AngularExtrapolator() : count_(0) {}
+
+  // Records that the head view was |head_view| at |time|. Times must
+  // increase.
+  void AddPose(int64_t time, const gvr::Mat4f& head_view) {
+    if (count_ > 0 && time <= poses_[1].first) return;
+    poses_[0] = poses_[1];
+    poses_[1] = std::make_pair(time, head_view);
+    count_ = std::min(count_ + 1, 2);
+  }
+
+  bool CanPredict() const { return count_ == 2; }
+
+  // Returns the head view expected at |time|. Requires CanPredict().
+  gvr::Mat4f Predict(int64_t time) const {
+    time = std::min(time, poses_[1].first + kMaxExtrapolationNanos);
+    const gvr::Mat4f& m0 = poses_[0].second;
+    const gvr::Mat4f& m1 = poses_[1].second;
+    // The rotation from the first pose to the second: d = r1 * r0^T.
+    float d[3][3];
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        d[i][j] = 0.0f;
+        for (int k = 0; k < 3; ++k) d[i][j] += m1.m[i][k] * m0.m[j][k];
+      }
+    }
+    const float cos_angle =
+        std::max(-1.0f, std::min(1.0f, (d[0][0] + d[1][1] + d[2][2] - 1) / 2));
+    const float angle = std::acos(cos_angle);
+    gvr::Mat4f result = m1;
+    if (angle < 1e-6f) return result;
+    float axis[3] = {d[2][1] - d[1][2], d[0][2] - d[2][0], d[1][0] - d[0][1]};
+    const float axis_length =
+        std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    if (axis_length < 1e-6f) return result;
+    for (int k = 0; k < 3; ++k) axis[k] /= axis_length;
+
+    // Turn by the same angle per unit of time, about the same axis, with
+    // Rodrigues' formula: r = I + sin(a) K + (1 - cos(a)) K^2.
+    const float scale = static_cast<float>(time - poses_[1].first) /
+                        static_cast<float>(poses_[1].first - poses_[0].first);
+    const float a = angle * scale;
+    const float s = std::sin(a);
+    const float c = 1.0f - std::cos(a);
+    const float k[3][3] = {{0.0f, -axis[2], axis[1]},
+                           {axis[2], 0.0f, -axis[0]},
+                           {-axis[1], axis[0], 0.0f}};
+    float r[3][3];
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        float k2 = 0.0f;
+        for (int n = 0; n < 3; ++n) k2 += k[i][n] * k[n][j];
+        r[i][j] = (i == j ? 1.0f : 0.0f) + s * k[i][j] + c * k2;
+      }
+    }
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        result.m[i][j] = r[i][0] * m1.m[0][j] + r[i][1] * m1.m[1][j] +
+                         r[i][2] * m1.m[2][j];
+      }
+    }
+    return result;
+  }
+
+ private:
+  // The last two poses, oldest first, and how many there are.
+  std::array<std::pair<int64_t, gvr::Mat4f>, 2> poses_;
+  int count_;
+};
+
+// Returns the head view at a time in nanoseconds on the monotonic clock,
+// which may be in the future.
+typedef std::function<gvr::Mat4f(int64_t time)> HeadPoseSource;
+
+// Picks the prediction horizon of each frame with a FrameTimer, and gets the
+// head pose for it from a HeadPoseSource, falling back to an
+// AngularExtrapolator when the source has no usable pose.
+class PosePredictor {
+ public:
+  explicit PosePredictor(HeadPoseSource source)
+      : source_(std::move(source)),
+        prediction_nanos_(kDefaultPredictionNanos),
+        extrapolating_(false) {
+    last_head_view_ = {{{1.0f, 0.0f, 0.0f, 0.0f},
+                        {0.0f, 1.0f, 0.0f, 0.0f},
+                        {0.0f, 0.0f, 1.0f, 0.0f},
+                        {0.0f, 0.0f, 0.0f, 1.0f}}};
+  }
+
+  // Call at the start of each frame. Returns the head view to render the
+  // frame with.
+  gvr::Mat4f BeginFrame(int64_t now) {
+    timer_.BeginFrame(now);
+    prediction_nanos_ = timer_.PredictionNanos();
+    const int64_t time = now + prediction_nanos_;
+    const gvr::Mat4f head_view = source_(time);
+    extrapolating_ = !IsRigidTransform(head_view);
+    if (!extrapolating_) {
+      extrapolator_.AddPose(time, head_view);
+      last_head_view_ = head_view;
+    } else if (extrapolator_.CanPredict()) {
+      last_head_view_ = extrapolator_.Predict(time);
+    }
+    return last_head_view_;
+  }
+
+  // Call right after the frame was submitted.
+  void EndFrame(int64_t now) { timer_.EndFrame(now); }
+
+  // The prediction horizon of the current frame.
+  int64_t prediction_nanos() const { return prediction_nanos_; }
+
+  // Whether the current pose was extrapolated rather than taken from the
+  // source.
+  bool extrapolating() const { return extrapolating_; }
+
+ private:
+  HeadPoseSource source_;
+  FrameTimer timer_;
+  AngularExtrapolator extrapolator_;
+  gvr::Mat4f last_head_view_;
+  int64_t prediction_nanos_;
+  bool extrapolating_;
+
+  PosePredictor(const PosePredictor& other) = delete;
+  PosePredictor& operator=(const PosePredictor& other) = delete;
+};
+
+}  // namespace pose_prediction
+
+#endif  // NDK_COMMON_POSE_PREDICTION_H_  // NOLINT
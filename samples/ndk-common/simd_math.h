@@ -0,0 +1,425 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDK_COMMON_SIMD_MATH_H_  // NOLINT
+#define NDK_COMMON_SIMD_MATH_H_
+
+#include <assert.h>
+#include <math.h>
+#include <stddef.h>
+
+#include <array>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SIMD_MATH_USE_NEON 1
+#elif defined(__SSE__) || defined(__x86_64__)
+#include <xmmintrin.h>
+#define SIMD_MATH_USE_SSE 1
+#endif
+
+#include "vr/gvr/capi/include/gvr_types.h"
+
+// Small matrix/vector library shared by the NDK samples.
+//
+// All matrices are gvr::Mat4f, i.e. row-major, so results can be handed to the
+// GVR API directly. On arm64 and armv7 (with NEON) and on x86 the matrix
+// products are computed four lanes at a time; other targets use the scalar
+// loops the samples originally shipped with. The vector paths multiply and add
+// in the same order as the scalar code, rounding after each multiply and each
+// add: vmlaq_f32 is a separate multiply and add, on arm64 too, unlike the
+// fused vfmaq_f32. Results can still differ from the scalar path in the last
+// bit where the compiler contracts the scalar loops into fused multiply-adds.
+//
+// The batch functions apply the same matrix to several matrices or points,
+// such as the head pose to both eyes, loading it into registers once.
+namespace simd_math {
+
+typedef std::array<float, 4> Vec4;
+
+// Multiplies two matrices: returns |m1| * |m2|.
+inline gvr::Mat4f MatrixMul(const gvr::Mat4f& m1, const gvr::Mat4f& m2) {
+  gvr::Mat4f result;
+#if defined(SIMD_MATH_USE_NEON)
+  // Each result row is a linear combination of the rows of m2.
+  const float32x4_t b0 = vld1q_f32(m2.m[0]);
+  const float32x4_t b1 = vld1q_f32(m2.m[1]);
+  const float32x4_t b2 = vld1q_f32(m2.m[2]);
+  const float32x4_t b3 = vld1q_f32(m2.m[3]);
+  for (int i = 0; i < 4; ++i) {
+    float32x4_t row = vmulq_n_f32(b0, m1.m[i][0]);
+    row = vmlaq_n_f32(row, b1, m1.m[i][1]);
+    row = vmlaq_n_f32(row, b2, m1.m[i][2]);
+    row = vmlaq_n_f32(row, b3, m1.m[i][3]);
+    vst1q_f32(result.m[i], row);
+  }
+#elif defined(SIMD_MATH_USE_SSE)
+  const __m128 b0 = _mm_loadu_ps(m2.m[0]);
+  const __m128 b1 = _mm_loadu_ps(m2.m[1]);
+  const __m128 b2 = _mm_loadu_ps(m2.m[2]);
+  const __m128 b3 = _mm_loadu_ps(m2.m[3]);
+  for (int i = 0; i < 4; ++i) {
+    __m128 row = _mm_mul_ps(b0, _mm_set1_ps(m1.m[i][0]));
+    row = _mm_add_ps(row, _mm_mul_ps(b1, _mm_set1_ps(m1.m[i][1])));
+    row = _mm_add_ps(row, _mm_mul_ps(b2, _mm_set1_ps(m1.m[i][2])));
+    row = _mm_add_ps(row, _mm_mul_ps(b3, _mm_set1_ps(m1.m[i][3])));
+    _mm_storeu_ps(result.m[i], row);
+  }
+#else
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      result.m[i][j] = 0.0f;
+      for (int k = 0; k < 4; ++k) {
+        result.m[i][j] += m1.m[i][k] * m2.m[k][j];
+      }
+    }
+  }
+#endif
+  return result;
+}
+
+// Multiplies a matrix by a homogeneous vector: returns |matrix| * |vec|.
+inline Vec4 MatrixVectorMul(const gvr::Mat4f& matrix, const Vec4& vec) {
+  Vec4 result;
+#if defined(SIMD_MATH_USE_NEON)
+  // vld4q de-interleaves the rows, so each val[k] holds column k.
+  const float32x4x4_t cols = vld4q_f32(&matrix.m[0][0]);
+  float32x4_t acc = vmulq_n_f32(cols.val[0], vec[0]);
+  acc = vmlaq_n_f32(acc, cols.val[1], vec[1]);
+  acc = vmlaq_n_f32(acc, cols.val[2], vec[2]);
+  acc = vmlaq_n_f32(acc, cols.val[3], vec[3]);
+  vst1q_f32(result.data(), acc);
+#elif defined(SIMD_MATH_USE_SSE)
+  __m128 c0 = _mm_loadu_ps(matrix.m[0]);
+  __m128 c1 = _mm_loadu_ps(matrix.m[1]);
+  __m128 c2 = _mm_loadu_ps(matrix.m[2]);
+  __m128 c3 = _mm_loadu_ps(matrix.m[3]);
+  _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+  __m128 acc = _mm_mul_ps(c0, _mm_set1_ps(vec[0]));
+  acc = _mm_add_ps(acc, _mm_mul_ps(c1, _mm_set1_ps(vec[1])));
+  acc = _mm_add_ps(acc, _mm_mul_ps(c2, _mm_set1_ps(vec[2])));
+  acc = _mm_add_ps(acc, _mm_mul_ps(c3, _mm_set1_ps(vec[3])));
+  _mm_storeu_ps(result.data(), acc);
+#else
+  for (int i = 0; i < 4; ++i) {
+    result[i] = 0.0f;
+    for (int k = 0; k < 4; ++k) {
+      result[i] += matrix.m[i][k] * vec[k];
+    }
+  }
+#endif
+  return result;
+}
+
+// Computes out[n] = lhs[n] * |rhs| for |count| matrices, e.g. each eye's view
+// from its eye-from-head matrix and the head pose. The rows of |rhs| stay in
+// registers across the whole batch. |out| may alias |lhs|.
+inline void MatrixMulBatch(const gvr::Mat4f* lhs, const gvr::Mat4f& rhs,
+                           gvr::Mat4f* out, size_t count) {
+#if defined(SIMD_MATH_USE_NEON)
+  const float32x4_t b0 = vld1q_f32(rhs.m[0]);
+  const float32x4_t b1 = vld1q_f32(rhs.m[1]);
+  const float32x4_t b2 = vld1q_f32(rhs.m[2]);
+  const float32x4_t b3 = vld1q_f32(rhs.m[3]);
+  for (size_t n = 0; n < count; ++n) {
+    // Row i of the product only reads row i of lhs[n], so |out| can alias.
+    for (int i = 0; i < 4; ++i) {
+      float32x4_t row = vmulq_n_f32(b0, lhs[n].m[i][0]);
+      row = vmlaq_n_f32(row, b1, lhs[n].m[i][1]);
+      row = vmlaq_n_f32(row, b2, lhs[n].m[i][2]);
+      row = vmlaq_n_f32(row, b3, lhs[n].m[i][3]);
+      vst1q_f32(out[n].m[i], row);
+    }
+  }
+#elif defined(SIMD_MATH_USE_SSE)
+  const __m128 b0 = _mm_loadu_ps(rhs.m[0]);
+  const __m128 b1 = _mm_loadu_ps(rhs.m[1]);
+  const __m128 b2 = _mm_loadu_ps(rhs.m[2]);
+  const __m128 b3 = _mm_loadu_ps(rhs.m[3]);
+  for (size_t n = 0; n < count; ++n) {
+    for (int i = 0; i < 4; ++i) {
+      __m128 row = _mm_mul_ps(b0, _mm_set1_ps(lhs[n].m[i][0]));
+      row = _mm_add_ps(row, _mm_mul_ps(b1, _mm_set1_ps(lhs[n].m[i][1])));
+      row = _mm_add_ps(row, _mm_mul_ps(b2, _mm_set1_ps(lhs[n].m[i][2])));
+      row = _mm_add_ps(row, _mm_mul_ps(b3, _mm_set1_ps(lhs[n].m[i][3])));
+      _mm_storeu_ps(out[n].m[i], row);
+    }
+  }
+#else
+  for (size_t n = 0; n < count; ++n) {
+    out[n] = MatrixMul(lhs[n], rhs);
+  }
+#endif
+}
+
+// Computes out[n] = |matrix| * in[n] for |count| homogeneous points. |in| and
+// |out| may alias.
+inline void TransformPoints(const gvr::Mat4f& matrix, const Vec4* in,
+                            Vec4* out, size_t count) {
+#if defined(SIMD_MATH_USE_NEON)
+  const float32x4x4_t cols = vld4q_f32(&matrix.m[0][0]);
+  for (size_t n = 0; n < count; ++n) {
+    const float32x4_t v = vld1q_f32(in[n].data());
+    float32x4_t acc = vmulq_lane_f32(cols.val[0], vget_low_f32(v), 0);
+    acc = vmlaq_lane_f32(acc, cols.val[1], vget_low_f32(v), 1);
+    acc = vmlaq_lane_f32(acc, cols.val[2], vget_high_f32(v), 0);
+    acc = vmlaq_lane_f32(acc, cols.val[3], vget_high_f32(v), 1);
+    vst1q_f32(out[n].data(), acc);
+  }
+#elif defined(SIMD_MATH_USE_SSE)
+  __m128 c0 = _mm_loadu_ps(matrix.m[0]);
+  __m128 c1 = _mm_loadu_ps(matrix.m[1]);
+  __m128 c2 = _mm_loadu_ps(matrix.m[2]);
+  __m128 c3 = _mm_loadu_ps(matrix.m[3]);
+  _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+  for (size_t n = 0; n < count; ++n) {
+    const __m128 v = _mm_loadu_ps(in[n].data());
+    __m128 acc = _mm_mul_ps(c0, _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)));
+    acc = _mm_add_ps(
+        acc, _mm_mul_ps(c1, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))));
+    acc = _mm_add_ps(
+        acc, _mm_mul_ps(c2, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))));
+    acc = _mm_add_ps(
+        acc, _mm_mul_ps(c3, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))));
+    _mm_storeu_ps(out[n].data(), acc);
+  }
+#else
+  for (size_t n = 0; n < count; ++n) {
+    out[n] = MatrixVectorMul(matrix, in[n]);
+  }
+#endif
+}
+
+// A 4x4 matrix in column-major order, ready to be passed to
+// glUniformMatrix4fv() with transpose set to GL_FALSE.
+typedef std::array<float, 16> GLMat4;
+
+// Transposes |matrix| into the column-major array |out| (16 floats).
+inline void MatrixToGL(const gvr::Mat4f& matrix, float* out) {
+#if defined(SIMD_MATH_USE_NEON)
+  float32x4x4_t rows;
+  rows.val[0] = vld1q_f32(matrix.m[0]);
+  rows.val[1] = vld1q_f32(matrix.m[1]);
+  rows.val[2] = vld1q_f32(matrix.m[2]);
+  rows.val[3] = vld1q_f32(matrix.m[3]);
+  // vst4q interleaves the four rows, which writes them out as columns.
+  vst4q_f32(out, rows);
+#elif defined(SIMD_MATH_USE_SSE)
+  __m128 r0 = _mm_loadu_ps(matrix.m[0]);
+  __m128 r1 = _mm_loadu_ps(matrix.m[1]);
+  __m128 r2 = _mm_loadu_ps(matrix.m[2]);
+  __m128 r3 = _mm_loadu_ps(matrix.m[3]);
+  _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+  _mm_storeu_ps(out, r0);
+  _mm_storeu_ps(out + 4, r1);
+  _mm_storeu_ps(out + 8, r2);
+  _mm_storeu_ps(out + 12, r3);
+#else
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      out[j * 4 + i] = matrix.m[i][j];
+    }
+  }
+#endif
+}
+
+inline GLMat4 MatrixToGL(const gvr::Mat4f& matrix) {
+  GLMat4 result;
+  MatrixToGL(matrix, result.data());
+  return result;
+}
+
+// Computes |m1| * |m2| and writes it to |out| (16 floats) in column-major
+// order. This is the same as MatrixToGL(MatrixMul(m1, m2), out), but the
+// product rows are transposed in registers instead of going through an
+// intermediate row-major matrix.
+inline void MatrixMulToGL(const gvr::Mat4f& m1, const gvr::Mat4f& m2,
+                          float* out) {
+#if defined(SIMD_MATH_USE_NEON)
+  const float32x4_t b0 = vld1q_f32(m2.m[0]);
+  const float32x4_t b1 = vld1q_f32(m2.m[1]);
+  const float32x4_t b2 = vld1q_f32(m2.m[2]);
+  const float32x4_t b3 = vld1q_f32(m2.m[3]);
+  float32x4x4_t rows;
+  for (int i = 0; i < 4; ++i) {
+    float32x4_t row = vmulq_n_f32(b0, m1.m[i][0]);
+    row = vmlaq_n_f32(row, b1, m1.m[i][1]);
+    row = vmlaq_n_f32(row, b2, m1.m[i][2]);
+    rows.val[i] = vmlaq_n_f32(row, b3, m1.m[i][3]);
+  }
+  vst4q_f32(out, rows);
+#elif defined(SIMD_MATH_USE_SSE)
+  const __m128 b0 = _mm_loadu_ps(m2.m[0]);
+  const __m128 b1 = _mm_loadu_ps(m2.m[1]);
+  const __m128 b2 = _mm_loadu_ps(m2.m[2]);
+  const __m128 b3 = _mm_loadu_ps(m2.m[3]);
+  __m128 rows[4];
+  for (int i = 0; i < 4; ++i) {
+    __m128 row = _mm_mul_ps(b0, _mm_set1_ps(m1.m[i][0]));
+    row = _mm_add_ps(row, _mm_mul_ps(b1, _mm_set1_ps(m1.m[i][1])));
+    row = _mm_add_ps(row, _mm_mul_ps(b2, _mm_set1_ps(m1.m[i][2])));
+    rows[i] = _mm_add_ps(row, _mm_mul_ps(b3, _mm_set1_ps(m1.m[i][3])));
+  }
+  _MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+  _mm_storeu_ps(out, rows[0]);
+  _mm_storeu_ps(out + 4, rows[1]);
+  _mm_storeu_ps(out + 8, rows[2]);
+  _mm_storeu_ps(out + 12, rows[3]);
+#else
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      float sum = 0.0f;
+      for (int k = 0; k < 4; ++k) {
+        sum += m1.m[i][k] * m2.m[k][j];
+      }
+      out[j * 4 + i] = sum;
+    }
+  }
+#endif
+}
+
+inline GLMat4 MatrixMulToGL(const gvr::Mat4f& m1, const gvr::Mat4f& m2) {
+  GLMat4 result;
+  MatrixMulToGL(m1, m2, result.data());
+  return result;
+}
+
+// Computes |m1[eye]| * |m2[eye]| for both eyes and writes the two products
+// back to back to |out| (32 floats) in column-major order, which is the layout
+// glUniformMatrix4fv() expects for the mat4[2] uniforms of multiview shaders.
+inline void MatrixPairMulToGL(const gvr::Mat4f m1[2], const gvr::Mat4f m2[2],
+                              float* out) {
+  MatrixMulToGL(m1[0], m2[0], out);
+  MatrixMulToGL(m1[1], m2[1], out + 16);
+}
+
+// Computes lhs[n] * |rhs| for |count| matrices and writes the products back
+// to back to |out| (16 * count floats) in column-major order, e.g. the MVPs
+// of an object from the view-projection matrices of both eyes, for the
+// mat4[2] uniforms of multiview shaders. The rows of |rhs| stay in registers
+// across the whole batch.
+inline void MatrixMulBatchToGL(const gvr::Mat4f* lhs, const gvr::Mat4f& rhs,
+                               float* out, size_t count) {
+#if defined(SIMD_MATH_USE_NEON)
+  const float32x4_t b0 = vld1q_f32(rhs.m[0]);
+  const float32x4_t b1 = vld1q_f32(rhs.m[1]);
+  const float32x4_t b2 = vld1q_f32(rhs.m[2]);
+  const float32x4_t b3 = vld1q_f32(rhs.m[3]);
+  for (size_t n = 0; n < count; ++n) {
+    float32x4x4_t rows;
+    for (int i = 0; i < 4; ++i) {
+      float32x4_t row = vmulq_n_f32(b0, lhs[n].m[i][0]);
+      row = vmlaq_n_f32(row, b1, lhs[n].m[i][1]);
+      row = vmlaq_n_f32(row, b2, lhs[n].m[i][2]);
+      rows.val[i] = vmlaq_n_f32(row, b3, lhs[n].m[i][3]);
+    }
+    vst4q_f32(out + 16 * n, rows);
+  }
+#elif defined(SIMD_MATH_USE_SSE)
+  const __m128 b0 = _mm_loadu_ps(rhs.m[0]);
+  const __m128 b1 = _mm_loadu_ps(rhs.m[1]);
+  const __m128 b2 = _mm_loadu_ps(rhs.m[2]);
+  const __m128 b3 = _mm_loadu_ps(rhs.m[3]);
+  for (size_t n = 0; n < count; ++n) {
+    __m128 rows[4];
+    for (int i = 0; i < 4; ++i) {
+      __m128 row = _mm_mul_ps(b0, _mm_set1_ps(lhs[n].m[i][0]));
+      row = _mm_add_ps(row, _mm_mul_ps(b1, _mm_set1_ps(lhs[n].m[i][1])));
+      row = _mm_add_ps(row, _mm_mul_ps(b2, _mm_set1_ps(lhs[n].m[i][2])));
+      rows[i] = _mm_add_ps(row, _mm_mul_ps(b3, _mm_set1_ps(lhs[n].m[i][3])));
+    }
+    _MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+    float* column = out + 16 * n;
+    _mm_storeu_ps(column, rows[0]);
+    _mm_storeu_ps(column + 4, rows[1]);
+    _mm_storeu_ps(column + 8, rows[2]);
+    _mm_storeu_ps(column + 12, rows[3]);
+  }
+#else
+  for (size_t n = 0; n < count; ++n) {
+    MatrixMulToGL(lhs[n], rhs, out + 16 * n);
+  }
+#endif
+}
+
+// Converts a rotation quaternion (JPL format, as reported by the controller)
+// to a rotation matrix. This is a handful of scalar multiplies, so there is no
+// vector path.
+inline gvr::Mat4f QuatToMatrix(const gvr::Quatf& quat) {
+  const float x2 = quat.qx * quat.qx;
+  const float y2 = quat.qy * quat.qy;
+  const float z2 = quat.qz * quat.qz;
+  const float xy = quat.qx * quat.qy;
+  const float xz = quat.qx * quat.qz;
+  const float xw = quat.qx * quat.qw;
+  const float yz = quat.qy * quat.qz;
+  const float yw = quat.qy * quat.qw;
+  const float zw = quat.qz * quat.qw;
+
+  const float m11 = 1.0f - 2.0f * y2 - 2.0f * z2;
+  const float m12 = 2.0f * (xy - zw);
+  const float m13 = 2.0f * (xz + yw);
+  const float m21 = 2.0f * (xy + zw);
+  const float m22 = 1.0f - 2.0f * x2 - 2.0f * z2;
+  const float m23 = 2.0f * (yz - xw);
+  const float m31 = 2.0f * (xz - yw);
+  const float m32 = 2.0f * (yz + xw);
+  const float m33 = 1.0f - 2.0f * x2 - 2.0f * y2;
+
+  return {{{m11, m12, m13, 0.0f},
+           {m21, m22, m23, 0.0f},
+           {m31, m32, m33, 0.0f},
+           {0.0f, 0.0f, 0.0f, 1.0f}}};
+}
+
+// Returns whether a field of view in degrees and clip distances make a
+// frustum PerspectiveMatrixFromView() can build a projection for: one with
+// a nonempty extent along each axis, in front of the eye.
+inline bool IsValidFrustum(const gvr::Rectf& fov, float z_near, float z_far) {
+  const float x_left = -tan(fov.left * M_PI / 180.0f) * z_near;
+  const float x_right = tan(fov.right * M_PI / 180.0f) * z_near;
+  const float y_bottom = -tan(fov.bottom * M_PI / 180.0f) * z_near;
+  const float y_top = tan(fov.top * M_PI / 180.0f) * z_near;
+  return x_left < x_right && y_bottom < y_top && z_near < z_far &&
+         z_near > 0.0f && z_far > 0.0f;
+}
+
+// Given a field of view in degrees, computes the corresponding projection
+// matrix.
+inline gvr::Mat4f PerspectiveMatrixFromView(const gvr::Rectf& fov,
+                                            float z_near, float z_far) {
+  const float x_left = -tan(fov.left * M_PI / 180.0f) * z_near;
+  const float x_right = tan(fov.right * M_PI / 180.0f) * z_near;
+  const float y_bottom = -tan(fov.bottom * M_PI / 180.0f) * z_near;
+  const float y_top = tan(fov.top * M_PI / 180.0f) * z_near;
+
+  assert(IsValidFrustum(fov, z_near, z_far));
+  const float X = (2 * z_near) / (x_right - x_left);
+  const float Y = (2 * z_near) / (y_top - y_bottom);
+  const float A = (x_right + x_left) / (x_right - x_left);
+  const float B = (y_top + y_bottom) / (y_top - y_bottom);
+  const float C = (z_near + z_far) / (z_near - z_far);
+  const float D = (2 * z_near * z_far) / (z_near - z_far);
+
+  return {{{X, 0.0f, A, 0.0f},
+           {0.0f, Y, B, 0.0f},
+           {0.0f, 0.0f, C, D},
+           {0.0f, 0.0f, -1.0f, 0.0f}}};
+}
+
+}  // namespace simd_math
+
+#endif  // NDK_COMMON_SIMD_MATH_H_  // NOLINT
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDK_COMMON_SPSC_RING_H_  // NOLINT
+#define NDK_COMMON_SPSC_RING_H_
+
+#include <assert.h>
+#include <stddef.h>
+
+#include <atomic>
+#include <memory>
+
+// Lock-free queue between exactly one producer thread and one consumer
+// thread, for handing small values (input samples, events) to the rendering
+// thread without ever blocking either side.
+namespace spsc {
+
+template <typename T>
+class Ring {
+ public:
+  // |capacity| must be a power of two. T must be default constructible and
+  // copy assignable.
+  explicit Ring(size_t capacity)
+      : slots_(new T[capacity]),
+        mask_(capacity - 1),
+        head_(0),
+        cached_tail_(0),
+        tail_(0),
+        cached_head_(0) {
+    assert(capacity > 0 && (capacity & mask_) == 0);
+  }
+
+  // Producer side. Appends |value|, or returns false if the ring is full.
+  bool TryPush(const T& value) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ > mask_) {
+      // Looks full: see how far the consumer got.
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ > mask_) return false;
+    }
+    slots_[tail & mask_] = value;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Removes the oldest value into |value|, or returns false if
+  // the ring is empty.
+  bool TryPop(T* value) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      // Looks empty: see how far the producer got.
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) return false;
+    }
+    *value = slots_[head & mask_];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+ private:
+  // Bytes that keep the state of each side on its own cache line. Padding is
+  // used rather than alignas, since C++11 operator new ignores alignments
+  // above that of max_align_t.
+  static const size_t kCacheLineSize = 64;
+
+  // Indices only ever grow, and are wrapped with |mask_| when used. Each side
+  // keeps a copy of the other side's index, which it only refreshes when the
+  // ring looks full or empty, so the two rarely touch each other's cache
+  // line.
+  const std::unique_ptr<T[]> slots_;
+  const size_t mask_;
+  char padding0_[kCacheLineSize];
+
+  // Consumer state.
+  std::atomic<size_t> head_;
+  size_t cached_tail_;
+  char padding1_[kCacheLineSize];
+
+  // Producer state.
+  std::atomic<size_t> tail_;
+  size_t cached_head_;
+
+  Ring(const Ring& other) = delete;
+  Ring& operator=(const Ring& other) = delete;
+};
+
+}  // namespace spsc
+
+#endif  // NDK_COMMON_SPSC_RING_H_  // NOLINT
@@ -0,0 +1,276 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDK_COMMON_TRACE_H_  // NOLINT
+#define NDK_COMMON_TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+// Lightweight frame tracing for the NDK samples.
+//
+// Code is instrumented with scoped zones:
+//
+//   void Renderer::DrawFrame() {
+//     TRACE_ZONE("DrawFrame");
+//     ...
+//   }
+//
+// Each thread records its zones into its own fixed-size buffer, which only
+// that thread writes, so recording takes no lock. Tracing is off until
+// trace::SetEnabled(true) is called; until then a zone costs one relaxed
+// atomic load, and no buffer is allocated. Defining
+// NDK_SAMPLES_DISABLE_TRACING compiles the TRACE_ZONE macros out altogether.
+//
+// A zone that cannot be a scope of its own is opened and closed by name:
+//
+//   TRACE_ZONE_BEGIN(acquire_zone, "AcquireFrame");
+//   gvr::Frame frame = swap_chain_->AcquireFrame();
+//   TRACE_ZONE_END(acquire_zone);
+//
+// WriteChromeTrace() exports everything recorded so far in the Chrome trace
+// event format, which chrome://tracing and the Perfetto UI both open. GPU
+// timings go to a Track of their own (see gpu_timer.h).
+//
+// This header never touches GL or Android APIs, so it runs on any host.
+namespace trace {
+
+// A completed zone. |name| must be a string literal, or otherwise outlive
+// the trace.
+struct Event {
+  const char* name;
+  int64_t begin_nanos;
+  int64_t duration_nanos;
+};
+
+// Events each thread can record. Once a thread's buffer is full, its
+// further events are counted and dropped: a trace covers the start of a
+// session, about two minutes of a sample at 60 frames per second.
+static const size_t kEventsPerThread = 65536;
+
+// Returns the current time on the clock zones are timed with, in
+// nanoseconds.
+inline int64_t NowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+namespace internal {
+
+// The events of one thread (or of one GPU timeline). Only the owner
+// appends; |count| is published with release semantics so the exporter can
+// read the events below it from any thread. The events are allocated with
+// the first one, so threads and tracks that never record cost no memory.
+struct ThreadBuffer {
+  explicit ThreadBuffer(int thread_id) : tid(thread_id), count(0), dropped(0) {}
+
+  void Add(const char* name, int64_t begin_nanos, int64_t duration_nanos) {
+    const size_t index = count.load(std::memory_order_relaxed);
+    if (index == kEventsPerThread) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    // The exporter only reads |events| below |count|, so it never sees the
+    // pointer before it is set.
+    if (!events) events.reset(new Event[kEventsPerThread]);
+    events[index].name = name;
+    events[index].begin_nanos = begin_nanos;
+    events[index].duration_nanos = duration_nanos;
+    count.store(index + 1, std::memory_order_release);
+  }
+
+  const int tid;
+  std::string name;
+  std::unique_ptr<Event[]> events;
+  std::atomic<size_t> count;
+  std::atomic<size_t> dropped;
+};
+
+// The global state. Buffers are never freed, since zones may still be
+// recorded on threads that outlive whatever enabled tracing.
+struct Registry {
+  std::atomic<bool> enabled{false};
+  std::mutex mutex;
+  std::vector<ThreadBuffer*> buffers;
+};
+
+inline Registry& GetRegistry() {
+  static Registry* registry = new Registry;
+  return *registry;
+}
+
+// Registers a new buffer, under a mutex. This happens once per thread.
+inline ThreadBuffer* NewBuffer(const char* name) {
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  ThreadBuffer* buffer =
+      new ThreadBuffer(static_cast<int>(registry.buffers.size()) + 1);
+  if (name) buffer->name = name;
+  registry.buffers.push_back(buffer);
+  return buffer;
+}
+
+inline ThreadBuffer* GetThreadBuffer() {
+  static thread_local ThreadBuffer* buffer = nullptr;
+  if (!buffer) buffer = NewBuffer(nullptr);
+  return buffer;
+}
+
+}  // namespace internal
+
+inline void SetEnabled(bool enabled) {
+  internal::GetRegistry().enabled.store(enabled, std::memory_order_relaxed);
+}
+
+inline bool IsEnabled() {
+  return internal::GetRegistry().enabled.load(std::memory_order_relaxed);
+}
+
+// Names the calling thread in exported traces.
+inline void SetThreadName(const char* name) {
+  internal::ThreadBuffer* buffer = internal::GetThreadBuffer();
+  internal::Registry& registry = internal::GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  buffer->name = name;
+}
+
+// A timeline of its own, for events that are not timed on a CPU thread,
+// such as GPU work. It must only be added to from one thread at a time. The
+// timeline is registered with its first event, so a track that never
+// records, because tracing stayed disabled, costs nothing; once registered
+// it stays in the trace after the track is destroyed.
+class Track {
+ public:
+  explicit Track(const char* name) : name_(name), buffer_(nullptr) {}
+
+  // Records |name| as having taken |duration_nanos| from |begin_nanos|, on
+  // the NowNanos() clock. Does nothing while tracing is disabled.
+  void AddEvent(const char* name, int64_t begin_nanos,
+                int64_t duration_nanos) {
+    if (!IsEnabled()) return;
+    if (!buffer_) buffer_ = internal::NewBuffer(name_);
+    buffer_->Add(name, begin_nanos, duration_nanos);
+  }
+
+ private:
+  const char* name_;
+  internal::ThreadBuffer* buffer_;
+
+  Track(const Track& other) = delete;
+  Track& operator=(const Track& other) = delete;
+};
+
+// Records the time from its construction to its destruction as an event of
+// the calling thread, if tracing was enabled when it was constructed.
+class Zone {
+ public:
+  explicit Zone(const char* name)
+      : name_(name), begin_nanos_(IsEnabled() ? NowNanos() : -1) {}
+
+  ~Zone() { End(); }
+
+  // Ends the zone before the end of its scope, for zones that cannot be a
+  // scope of their own.
+  void End() {
+    if (begin_nanos_ < 0) return;
+    internal::GetThreadBuffer()->Add(name_, begin_nanos_,
+                                     NowNanos() - begin_nanos_);
+    begin_nanos_ = -1;
+  }
+
+ private:
+  const char* name_;
+  int64_t begin_nanos_;
+
+  Zone(const Zone& other) = delete;
+  Zone& operator=(const Zone& other) = delete;
+};
+
+// Writes the events recorded so far to |path| in the Chrome trace event
+// format. Events keep being recorded while this runs; those that come in
+// too late are left out. Returns false on failure.
+inline bool WriteChromeTrace(const std::string& path) {
+  FILE* file = fopen(path.c_str(), "w");
+  if (!file) return false;
+  internal::Registry& registry = internal::GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  bool first = true;
+  for (const internal::ThreadBuffer* buffer : registry.buffers) {
+    if (!buffer->name.empty()) {
+      // Names are set by the samples and never need escaping.
+      fprintf(file,
+              "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+              "\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+              first ? "" : ",", buffer->tid, buffer->name.c_str());
+      first = false;
+    }
+    const size_t count = buffer->count.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; ++i) {
+      const Event& event = buffer->events[i];
+      // Timestamps are in microseconds.
+      fprintf(file,
+              "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+              "\"ts\":%.3f,\"dur\":%.3f}",
+              first ? "" : ",", event.name, buffer->tid,
+              event.begin_nanos / 1000.0, event.duration_nanos / 1000.0);
+      first = false;
+    }
+  }
+  fprintf(file, "\n]}\n");
+  return fclose(file) == 0;
+}
+
+// Number of events dropped because a buffer was full.
+inline size_t DroppedEventCount() {
+  internal::Registry& registry = internal::GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  size_t dropped = 0;
+  for (const internal::ThreadBuffer* buffer : registry.buffers) {
+    dropped += buffer->dropped.load(std::memory_order_relaxed);
+  }
+  return dropped;
+}
+
+}  // namespace trace
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef NDK_SAMPLES_DISABLE_TRACING
+#define TRACE_ZONE(name)
+#define TRACE_ZONE_BEGIN(zone, name)
+#define TRACE_ZONE_END(zone)
+#else
+// Records the rest of the enclosing scope as a zone called |name|.
+#define TRACE_ZONE(name) \
+  ::trace::Zone TRACE_CONCAT(trace_zone_, __LINE__)(name)
+// Opens a zone called |name| in a local variable |zone|, which
+// TRACE_ZONE_END(zone) closes, or else the end of the enclosing scope.
+#define TRACE_ZONE_BEGIN(zone, name) ::trace::Zone zone(name)
+#define TRACE_ZONE_END(zone) zone.End()
+#endif
+
+#endif  // NDK_COMMON_TRACE_H_  // NOLINT
@@ -26,6 +26,7 @@ import android.view.View;
 import android.view.WindowManager;
 import com.google.vr.ndk.base.AndroidCompat;
 import com.google.vr.ndk.base.GvrLayout;
+import java.io.File;
 import javax.microedition.khronos.egl.EGLConfig;
 import javax.microedition.khronos.opengles.GL10;
 
@@ -45,6 +46,27 @@ import javax.microedition.khronos.opengles.GL10;
 public class MainActivity extends Activity {
   private static final String TAG = "MainActivity";
 
+  // Name of the file, in the app's private storage, that the drawing is saved to.
+  private static final String DRAWING_FILE_NAME = "drawing.bin";
+
+  // Intent extra that turns on frame tracing, e.g. "adb shell am start --ez trace true
+  // <component>". The trace is written to TRACE_FILE_NAME, in the app's private storage, every
+  // time the app pauses, and opens in chrome://tracing or the Perfetto UI.
+  private static final String EXTRA_TRACE = "trace";
+  private static final String TRACE_FILE_NAME = "trace.json";
+
+  // Intent extras that record the head pose and controller input of every frame to
+  // INPUT_LOG_FILE_NAME, in the app's private storage, or replay it from there in place of the
+  // live input, e.g. "adb shell am start --ez replay_input true <component>". A replayed session
+  // goes through the same frames every time, which makes performance comparable between builds.
+  private static final String EXTRA_RECORD_INPUT = "record_input";
+  private static final String EXTRA_REPLAY_INPUT = "replay_input";
+  private static final String INPUT_LOG_FILE_NAME = "input.log";
+
+  // Intent extra that sets the memory, in megabytes, the undo history may hold on top of the
+  // visible drawing, e.g. "adb shell am start --ei history_budget_mb 8 <component>".
+  private static final String EXTRA_HISTORY_BUDGET_MB = "history_budget_mb";
+
   static {
     // Load our JNI code.
     System.loadLibrary("controllerpaint_jni");
@@ -128,8 +150,21 @@ public class MainActivity extends Activity {
 
     assetManager = getResources().getAssets();
 
+    boolean recordInput = getIntent().getBooleanExtra(EXTRA_RECORD_INPUT, false);
+    boolean replayInput = getIntent().getBooleanExtra(EXTRA_REPLAY_INPUT, false);
     nativeControllerPaint =
-        nativeOnCreate(assetManager, gvrLayout.getGvrApi().getNativeGvrContext());
+        nativeOnCreate(
+            assetManager,
+            gvrLayout.getGvrApi().getNativeGvrContext(),
+            new File(getFilesDir(), DRAWING_FILE_NAME).getAbsolutePath(),
+            getIntent().getBooleanExtra(EXTRA_TRACE, false)
+                ? new File(getFilesDir(), TRACE_FILE_NAME).getAbsolutePath()
+                : null,
+            recordInput || replayInput
+                ? new File(getFilesDir(), INPUT_LOG_FILE_NAME).getAbsolutePath()
+                : null,
+            replayInput,
+            getIntent().getIntExtra(EXTRA_HISTORY_BUDGET_MB, 0));
 
     // Prevent screen from dimming/locking.
     getWindow().addFlags(WindowManager.LayoutParams.FLAG_KEEP_SCREEN_ON);
@@ -216,7 +251,14 @@ public class MainActivity extends Activity {
         }
       };
 
-  private native long nativeOnCreate(AssetManager assetManager, long gvrContextPtr);
+  private native long nativeOnCreate(
+      AssetManager assetManager,
+      long gvrContextPtr,
+      String drawingPath,
+      String tracePath,
+      String inputLogPath,
+      boolean replayInput,
+      int historyBudgetMb);
   private native void nativeOnDestroy(long controllerPaintJptr);
   private native void nativeOnResume(long controllerPaintJptr);
   private native void nativeOnPause(long controllerPaintJptr);
@@ -0,0 +1,286 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "aabb_tree.h"  // NOLINT
+
+#include <algorithm>
+
+namespace {
+
+// Half the surface area of |box|, which is what the cost of a tree is
+// measured in: the chance that a random ray hits a box is proportional to
+// its surface area.
+static float HalfSurfaceArea(const Aabb& box) {
+  const float dx = box.max[0] - box.min[0];
+  const float dy = box.max[1] - box.min[1];
+  const float dz = box.max[2] - box.min[2];
+  return dx * dy + dy * dz + dz * dx;
+}
+
+}  // namespace
+
+Aabb AabbUnion(const Aabb& a, const Aabb& b) {
+  Aabb result;
+  for (int k = 0; k < 3; ++k) {
+    result.min[k] = std::min(a.min[k], b.min[k]);
+    result.max[k] = std::max(a.max[k], b.max[k]);
+  }
+  return result;
+}
+
+void StereoFrustum::Set(const gvr::Mat4f& left_view_projection,
+                        const gvr::Mat4f& right_view_projection) {
+  const gvr::Mat4f* matrices[] = {&left_view_projection,
+                                  &right_view_projection};
+  for (int eye = 0; eye < 2; ++eye) {
+    // A point is inside the frustum if -w <= x, y, z <= w in clip space,
+    // which gives a plane for each bound.
+    const float (*m)[4] = matrices[eye]->m;
+    for (int axis = 0; axis < 3; ++axis) {
+      for (int k = 0; k < 4; ++k) {
+        planes_[eye][2 * axis][k] = m[3][k] + m[axis][k];
+        planes_[eye][2 * axis + 1][k] = m[3][k] - m[axis][k];
+      }
+    }
+  }
+}
+
+StereoFrustum::Result StereoFrustum::Classify(const Aabb& box) const {
+  const Result left = ClassifyOne(planes_[0], box);
+  if (left == kInside) return kInside;
+  const Result right = ClassifyOne(planes_[1], box);
+  if (right == kInside) return kInside;
+  if (left == kOutside && right == kOutside) return kOutside;
+  return kIntersecting;
+}
+
+StereoFrustum::Result StereoFrustum::ClassifyOne(const Planes& planes,
+                                                 const Aabb& box) {
+  bool intersecting = false;
+  for (const std::array<float, 4>& plane : planes) {
+    // Distances (scaled by the length of the normal) of the corners furthest
+    // along and against the plane normal.
+    float max_distance = plane[3];
+    float min_distance = plane[3];
+    for (int k = 0; k < 3; ++k) {
+      if (plane[k] >= 0.0f) {
+        max_distance += plane[k] * box.max[k];
+        min_distance += plane[k] * box.min[k];
+      } else {
+        max_distance += plane[k] * box.min[k];
+        min_distance += plane[k] * box.max[k];
+      }
+    }
+    if (max_distance < 0.0f) return kOutside;
+    if (min_distance < 0.0f) intersecting = true;
+  }
+  return intersecting ? kIntersecting : kInside;
+}
+
+AabbTree::AabbTree() : root_(-1), leaf_count_(0) {}
+
+void AabbTree::Insert(int id, const Aabb& bounds) {
+  const int leaf = AllocateNode();
+  Node& leaf_node = nodes_[leaf];
+  leaf_node.bounds = bounds;
+  leaf_node.parent = -1;
+  leaf_node.children[0] = leaf_node.children[1] = -1;
+  leaf_node.height = 0;
+  leaf_node.id = id;
+  if (id >= static_cast<int>(leaf_nodes_.size())) {
+    leaf_nodes_.resize(id + 1, -1);
+  }
+  leaf_nodes_[id] = leaf;
+  ++leaf_count_;
+  if (root_ < 0) {
+    root_ = leaf;
+    return;
+  }
+
+  // Find the best sibling for the new leaf: descend the tree as long as
+  // pairing the leaf with a child is cheaper than pairing it with the
+  // current node.
+  int sibling = root_;
+  while (!IsLeaf(sibling)) {
+    const Node& node = nodes_[sibling];
+    const float combined_area =
+        HalfSurfaceArea(AabbUnion(node.bounds, bounds));
+    // Cost of a new parent for this node and the leaf.
+    const float cost = 2.0f * combined_area;
+    // Cost every ancestor of a deeper sibling pays for the leaf.
+    const float inherited_cost =
+        2.0f * (combined_area - HalfSurfaceArea(node.bounds));
+    float child_costs[2];
+    for (int i = 0; i < 2; ++i) {
+      const int child = node.children[i];
+      child_costs[i] =
+          HalfSurfaceArea(AabbUnion(nodes_[child].bounds, bounds)) +
+          inherited_cost;
+      if (!IsLeaf(child)) {
+        child_costs[i] -= HalfSurfaceArea(nodes_[child].bounds);
+      }
+    }
+    if (cost < child_costs[0] && cost < child_costs[1]) break;
+    sibling = node.children[child_costs[0] < child_costs[1] ? 0 : 1];
+  }
+
+  // Pair the sibling and the leaf under a new parent.
+  const int old_parent = nodes_[sibling].parent;
+  const int parent = AllocateNode();
+  Node& parent_node = nodes_[parent];
+  parent_node.bounds = AabbUnion(nodes_[sibling].bounds, bounds);
+  parent_node.parent = old_parent;
+  parent_node.children[0] = sibling;
+  parent_node.children[1] = leaf;
+  parent_node.height = nodes_[sibling].height + 1;
+  parent_node.id = -1;
+  nodes_[sibling].parent = parent;
+  nodes_[leaf].parent = parent;
+  ReplaceChild(old_parent, sibling, parent);
+  RefitAncestors(old_parent);
+}
+
+void AabbTree::Remove(int id) {
+  if (id >= static_cast<int>(leaf_nodes_.size()) || leaf_nodes_[id] < 0) {
+    return;
+  }
+  const int leaf = leaf_nodes_[id];
+  leaf_nodes_[id] = -1;
+  --leaf_count_;
+  free_nodes_.push_back(leaf);
+  const int parent = nodes_[leaf].parent;
+  if (parent < 0) {
+    root_ = -1;
+    return;
+  }
+
+  // The sibling of the leaf takes the place of their parent.
+  const std::array<int, 2>& children = nodes_[parent].children;
+  const int sibling = children[children[0] == leaf ? 1 : 0];
+  const int grandparent = nodes_[parent].parent;
+  ReplaceChild(grandparent, parent, sibling);
+  nodes_[sibling].parent = grandparent;
+  free_nodes_.push_back(parent);
+  RefitAncestors(grandparent);
+}
+
+void AabbTree::Clear() {
+  nodes_.clear();
+  free_nodes_.clear();
+  leaf_nodes_.clear();
+  root_ = -1;
+  leaf_count_ = 0;
+}
+
+void AabbTree::Cull(const StereoFrustum& frustum, std::vector<int>* ids) {
+  if (root_ < 0) return;
+  stack_.clear();
+  stack_.push_back(root_);
+  while (!stack_.empty()) {
+    const int node = stack_.back();
+    stack_.pop_back();
+    switch (frustum.Classify(nodes_[node].bounds)) {
+      case StereoFrustum::kOutside:
+        break;
+      case StereoFrustum::kInside:
+        // No need to test anything below.
+        CollectLeaves(node, ids);
+        break;
+      case StereoFrustum::kIntersecting:
+        if (IsLeaf(node)) {
+          ids->push_back(nodes_[node].id);
+        } else {
+          stack_.push_back(nodes_[node].children[0]);
+          stack_.push_back(nodes_[node].children[1]);
+        }
+        break;
+    }
+  }
+}
+
+int AabbTree::AllocateNode() {
+  if (free_nodes_.empty()) {
+    nodes_.push_back(Node());
+    return static_cast<int>(nodes_.size()) - 1;
+  }
+  const int node = free_nodes_.back();
+  free_nodes_.pop_back();
+  return node;
+}
+
+void AabbTree::RefitAncestors(int node) {
+  for (; node >= 0; node = nodes_[node].parent) {
+    node = Balance(node);
+    Refit(node);
+  }
+}
+
+void AabbTree::Refit(int node) {
+  const Node& first = nodes_[nodes_[node].children[0]];
+  const Node& second = nodes_[nodes_[node].children[1]];
+  nodes_[node].bounds = AabbUnion(first.bounds, second.bounds);
+  nodes_[node].height = 1 + std::max(first.height, second.height);
+}
+
+int AabbTree::Balance(int node) {
+  if (IsLeaf(node) || nodes_[node].height < 2) return node;
+  const std::array<int, 2> children = nodes_[node].children;
+  const int balance =
+      nodes_[children[1]].height - nodes_[children[0]].height;
+  if (balance >= -1 && balance <= 1) return node;
+
+  // Rotate the taller child up. It takes the place of |node|, which becomes
+  // its child and adopts the shorter of its children.
+  const int side = balance > 1 ? 1 : 0;
+  const int pivot = children[side];
+  const std::array<int, 2> grandchildren = nodes_[pivot].children;
+  const bool first_taller =
+      nodes_[grandchildren[0]].height > nodes_[grandchildren[1]].height;
+  const int taller = grandchildren[first_taller ? 0 : 1];
+  const int shorter = grandchildren[first_taller ? 1 : 0];
+
+  const int parent = nodes_[node].parent;
+  ReplaceChild(parent, node, pivot);
+  nodes_[pivot].parent = parent;
+  nodes_[pivot].children[0] = node;
+  nodes_[pivot].children[1] = taller;
+  nodes_[node].parent = pivot;
+  nodes_[node].children[side] = shorter;
+  nodes_[shorter].parent = node;
+  Refit(node);
+  Refit(pivot);
+  return pivot;
+}
+
+void AabbTree::ReplaceChild(int parent, int child, int new_child) {
+  if (parent < 0) {
+    root_ = new_child;
+  } else if (nodes_[parent].children[0] == child) {
+    nodes_[parent].children[0] = new_child;
+  } else {
+    nodes_[parent].children[1] = new_child;
+  }
+}
+
+void AabbTree::CollectLeaves(int node, std::vector<int>* ids) {
+  if (IsLeaf(node)) {
+    ids->push_back(nodes_[node].id);
+    return;
+  }
+  // The tree is balanced, so the recursion is only logarithmically deep.
+  CollectLeaves(nodes_[node].children[0], ids);
+  CollectLeaves(nodes_[node].children[1], ids);
+}
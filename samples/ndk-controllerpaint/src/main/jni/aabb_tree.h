@@ -0,0 +1,139 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CONTROLLER_PAINT_APP_SRC_MAIN_JNI_AABB_TREE_H_  // NOLINT
+#define CONTROLLER_PAINT_APP_SRC_MAIN_JNI_AABB_TREE_H_
+
+#include <array>
+#include <vector>
+
+#include "vr/gvr/capi/include/gvr_types.h"
+
+// Axis-aligned bounding box.
+struct Aabb {
+  std::array<float, 3> min;
+  std::array<float, 3> max;
+};
+
+// Returns the smallest box containing both |a| and |b|.
+Aabb AabbUnion(const Aabb& a, const Aabb& b);
+
+// The view frusta of both eyes, used to cull geometry once for the two of
+// them. Something is visible if it is visible from either eye.
+class StereoFrustum {
+ public:
+  enum Result { kOutside, kIntersecting, kInside };
+
+  // Sets the frusta from the left and right eye's projection * view
+  // matrices, which transform world space to clip space.
+  void Set(const gvr::Mat4f& left_view_projection,
+           const gvr::Mat4f& right_view_projection);
+
+  // Returns kInside if |box| is entirely inside one of the frusta, kOutside
+  // if it is entirely outside both, and kIntersecting otherwise.
+  Result Classify(const Aabb& box) const;
+
+ private:
+  // Plane equations (a, b, c, d) with the inside where ax + by + cz + d >= 0,
+  // in the order left, right, bottom, top, near, far.
+  typedef std::array<std::array<float, 4>, 6> Planes;
+
+  static Result ClassifyOne(const Planes& planes, const Aabb& box);
+
+  std::array<Planes, 2> planes_;
+};
+
+// Bounding volume hierarchy over boxes identified by non-negative integer
+// ids. Leaves are inserted one at a time next to the leaf that grows the tree
+// the least, and the tree is rebalanced with rotations on the way back up, so
+// it stays shallow even though brush strokes arrive in spatial order.
+// Removing a leaf rebalances its ancestors the same way, and the nodes it
+// frees are reused. This class never touches GL.
+class AabbTree {
+ public:
+  AabbTree();
+
+  // Adds a leaf for |id| with the given bounds. |id| must not be in the
+  // tree already.
+  void Insert(int id, const Aabb& bounds);
+
+  // Removes the leaf for |id|, if there is one.
+  void Remove(int id);
+
+  // Removes all leaves.
+  void Clear();
+
+  // Number of leaves.
+  int size() const { return leaf_count_; }
+
+  // Number of levels below the root, or -1 if the tree is empty.
+  int height() const { return root_ < 0 ? -1 : nodes_[root_].height; }
+
+  // Appends to |ids| the id of every leaf that is not entirely outside
+  // |frustum|, in no particular order.
+  void Cull(const StereoFrustum& frustum, std::vector<int>* ids);
+
+ private:
+  struct Node {
+    Aabb bounds;
+    int parent;
+    // Both -1 for leaves.
+    std::array<int, 2> children;
+    // 0 for leaves.
+    int height;
+    // Id of the leaf, or -1.
+    int id;
+  };
+
+  bool IsLeaf(int node) const { return nodes_[node].children[0] < 0; }
+
+  // Returns the index of an unused node, reusing a removed one if possible.
+  int AllocateNode();
+
+  // Walks from |node| to the root, fixing the bounds and balance of every
+  // node on the way.
+  void RefitAncestors(int node);
+
+  // Recomputes the bounds and height of |node| from its children.
+  void Refit(int node);
+
+  // Rotates the subtree at |node| if one child is more than one level
+  // taller than the other. Returns the node now at the root of the subtree.
+  int Balance(int node);
+
+  // Replaces |child| by |new_child| in the children of |parent|, or as the
+  // root if |parent| is -1.
+  void ReplaceChild(int parent, int child, int new_child);
+
+  // Appends the ids of all leaves under |node| to |ids|.
+  void CollectLeaves(int node, std::vector<int>* ids);
+
+  std::vector<Node> nodes_;
+  // Nodes that were removed, to be reused.
+  std::vector<int> free_nodes_;
+  // The leaf node of each id, or -1.
+  std::vector<int> leaf_nodes_;
+  int root_;
+  int leaf_count_;
+
+  // Scratch space for the traversals.
+  std::vector<int> stack_;
+
+  AabbTree(const AabbTree& other) = delete;
+  AabbTree& operator=(const AabbTree& other) = delete;
+};
+
+#endif  // CONTROLLER_PAINT_APP_SRC_MAIN_JNI_AABB_TREE_H_  // NOLINT
@@ -29,8 +29,12 @@ inline DemoApp* ptr(jlong jptr) { return reinterpret_cast<DemoApp*>(jptr); }
 }  // namespace
 
 NATIVE_METHOD(jlong, nativeOnCreate)
-(JNIEnv* env, jobject obj, jobject asset_mgr, jlong gvr_context_ptr) {
-  return jptr(new DemoApp(env, asset_mgr, gvr_context_ptr));
+(JNIEnv* env, jobject obj, jobject asset_mgr, jlong gvr_context_ptr,
+ jstring drawing_path, jstring trace_path, jstring input_log_path,
+ jboolean replay_input, jint history_budget_mb) {
+  return jptr(new DemoApp(env, asset_mgr, gvr_context_ptr, drawing_path,
+                          trace_path, input_log_path, replay_input,
+                          history_budget_mb));
 }
 
 NATIVE_METHOD(void, nativeOnResume)
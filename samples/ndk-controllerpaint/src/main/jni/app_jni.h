@@ -27,7 +27,9 @@
 extern "C" {
 
 NATIVE_METHOD(jlong, nativeOnCreate)
-(JNIEnv* env, jobject obj, jobject asset_mgr, jlong gvrContextPtr);
+(JNIEnv* env, jobject obj, jobject asset_mgr, jlong gvrContextPtr,
+ jstring drawing_path, jstring trace_path, jstring input_log_path,
+ jboolean replay_input);
 NATIVE_METHOD(void, nativeOnResume)
 (JNIEnv* env, jobject obj, jlong controller_paint_jptr);
 NATIVE_METHOD(void, nativeOnPause)
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "controller_sampler.h"  // NOLINT
+
+#include <chrono>  // NOLINT
+
+#include "trace.h"  // NOLINT
+#include "utils.h"  // NOLINT
+
+namespace {
+
+// Time between two polls of the controller. The controller reports at a few
+// hundred hertz; polling faster only finds nothing new more often.
+static const std::chrono::microseconds kPollInterval(2000);
+
+// Number of samples the ring holds: about a second of motion, so the ring
+// only fills up when the rendering thread stalls.
+static const size_t kRingCapacity = 512;
+
+// Copies the parts of the controller state the painting logic looks at.
+static PaintInput ReadPaintInput(const gvr::ControllerState& state) {
+  PaintInput input;
+  input.orientation = state.GetOrientation();
+  input.is_touching = state.IsTouching();
+  input.touch_pos = state.GetTouchPos();
+  input.touch_down = state.GetTouchDown();
+  input.touch_up = state.GetTouchUp();
+  input.click_button_down = state.GetButtonDown(gvr::kControllerButtonClick);
+  input.click_button_up = state.GetButtonUp(gvr::kControllerButtonClick);
+  input.app_button_down = state.GetButtonDown(gvr::kControllerButtonApp);
+  return input;
+}
+
+// Whether |input| has a button or touch event.
+static bool HasEvents(const PaintInput& input) {
+  return input.touch_down || input.touch_up || input.click_button_down ||
+         input.click_button_up || input.app_button_down;
+}
+
+}  // namespace
+
+ControllerSampler::ControllerSampler()
+    : ring_(kRingCapacity),
+      api_(nullptr),
+      running_(false),
+      last_orientation_timestamp_(0),
+      last_touch_timestamp_(0),
+      merged_count_(0) {}
+
+ControllerSampler::~ControllerSampler() { Stop(); }
+
+void ControllerSampler::Start(gvr::ControllerApi* api) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (thread_.joinable()) {
+    if (api == api_) return;
+    running_ = false;
+    thread_.join();
+  }
+  api_ = api;
+  running_ = true;
+  thread_ = std::thread(&ControllerSampler::Run, this);
+}
+
+void ControllerSampler::Stop() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!thread_.joinable()) return;
+  running_ = false;
+  thread_.join();
+  api_ = nullptr;
+}
+
+void ControllerSampler::TakeSamples(std::vector<ControllerSample>* samples) {
+  ControllerSample sample;
+  while (ring_.TryPop(&sample)) {
+    samples->push_back(sample);
+  }
+}
+
+void ControllerSampler::Run() {
+  if (trace::IsEnabled()) trace::SetThreadName("ControllerSampler");
+  while (running_) {
+    TRACE_ZONE_BEGIN(poll_zone, "PollController");
+    const int32_t old_status = state_.GetApiStatus();
+    const int32_t old_connection_state = state_.GetConnectionState();
+    const gvr::ControllerBatteryLevel old_battery_level =
+        state_.GetBatteryLevel();
+    const bool old_battery_charging = state_.GetBatteryCharging();
+
+    state_.Update(*api_);
+
+    // Print new API status and connection state, if they changed.
+    if (state_.GetApiStatus() != old_status ||
+        state_.GetConnectionState() != old_connection_state) {
+      LOGD("ControllerSampler: controller API status: %s, "
+           "connection state: %s",
+           gvr_controller_api_status_to_string(state_.GetApiStatus()),
+           gvr_controller_connection_state_to_string(
+               state_.GetConnectionState()));
+    }
+    // Print new controller battery level and charging state, if they
+    // changed.
+    if (state_.GetBatteryLevel() != old_battery_level ||
+        state_.GetBatteryCharging() != old_battery_charging) {
+      LOGD("ControllerSampler: controller battery level: %s, charging: %s",
+           gvr::ControllerApi::ToString(state_.GetBatteryLevel()),
+           state_.GetBatteryCharging() ? "true" : "false");
+    }
+
+    // Only queue what is new: an orientation, a touch position or an event.
+    FlushBacklog();
+    ControllerSample sample;
+    sample.orientation_timestamp = state_.GetLastOrientationTimestamp();
+    sample.input = ReadPaintInput(state_);
+    const int64_t touch_timestamp = state_.GetLastTouchTimestamp();
+    if (sample.orientation_timestamp != last_orientation_timestamp_ ||
+        touch_timestamp != last_touch_timestamp_ || HasEvents(sample.input)) {
+      last_orientation_timestamp_ = sample.orientation_timestamp;
+      last_touch_timestamp_ = touch_timestamp;
+      Deliver(sample);
+    }
+    TRACE_ZONE_END(poll_zone);
+    std::this_thread::sleep_for(kPollInterval);
+  }
+}
+
+void ControllerSampler::FlushBacklog() {
+  while (!backlog_.empty() && ring_.TryPush(backlog_.front())) {
+    backlog_.pop_front();
+  }
+  if (backlog_.empty() && merged_count_ > 0) {
+    LOGW("ControllerSampler: %d samples merged while the ring was full.",
+         merged_count_);
+    merged_count_ = 0;
+  }
+}
+
+void ControllerSampler::Deliver(const ControllerSample& sample) {
+  if (backlog_.empty() && ring_.TryPush(sample)) return;
+  // The ring is full. A sample without events replaces the last one that is
+  // waiting if that one has no events either, which keeps the backlog small
+  // and only loses an intermediate orientation.
+  if (!backlog_.empty() && !HasEvents(backlog_.back().input) &&
+      !HasEvents(sample.input)) {
+    backlog_.back() = sample;
+    ++merged_count_;
+  } else {
+    backlog_.push_back(sample);
+  }
+}
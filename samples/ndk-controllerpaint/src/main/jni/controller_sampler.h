@@ -0,0 +1,103 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CONTROLLER_PAINT_APP_SRC_MAIN_JNI_CONTROLLER_SAMPLER_H_  // NOLINT
+#define CONTROLLER_PAINT_APP_SRC_MAIN_JNI_CONTROLLER_SAMPLER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "paint_simulation.h"  // NOLINT
+#include "spsc_ring.h"  // NOLINT
+#include "vr/gvr/capi/include/gvr_controller.h"
+
+// A reading of the controller.
+struct ControllerSample {
+  // When the orientation was measured, in nanoseconds on the clock of
+  // gvr::ControllerState::GetLastOrientationTimestamp().
+  int64_t orientation_timestamp;
+  // The state at that time. The button and touch events are the ones that
+  // happened since the previous sample.
+  PaintInput input;
+};
+
+// Reads the controller on its own thread, much more often than frames are
+// drawn, so that fast hand motions are seen at the rate of the sensors
+// rather than at the display rate. A sample is queued every time the
+// controller reports something new, and the rendering thread takes all of
+// them once per frame.
+//
+// Samples go through a lock-free ring, so neither thread ever waits for the
+// other. If the rendering thread stalls long enough for the ring to fill up,
+// samples back up on the polling thread, and consecutive ones without
+// events are merged: only intermediate orientations are ever lost, never a
+// button or touch event.
+class ControllerSampler {
+ public:
+  ControllerSampler();
+
+  // Stops polling.
+  ~ControllerSampler();
+
+  // Starts polling |api| on a new thread, if not already polling it. |api|
+  // must stay valid until Stop().
+  void Start(gvr::ControllerApi* api);
+
+  // Stops polling and waits for the thread to exit. Samples that were
+  // already taken stay queued.
+  void Stop();
+
+  // Moves the samples taken since the last call to the end of |samples|,
+  // oldest first. Must always be called from the same thread.
+  void TakeSamples(std::vector<ControllerSample>* samples);
+
+ private:
+  // Body of the polling thread.
+  void Run();
+
+  // Moves as much of |backlog_| to the ring as fits.
+  void FlushBacklog();
+
+  // Queues |sample|, or keeps it for later if the ring is full.
+  void Deliver(const ControllerSample& sample);
+
+  spsc::Ring<ControllerSample> ring_;
+
+  // Guards starting and stopping the thread.
+  std::mutex mutex_;
+  gvr::ControllerApi* api_;
+  std::atomic<bool> running_;
+  std::thread thread_;
+
+  // Only used by the polling thread.
+  gvr::ControllerState state_;
+  int64_t last_orientation_timestamp_;
+  int64_t last_touch_timestamp_;
+  // Samples that did not fit in the ring yet, oldest first.
+  std::deque<ControllerSample> backlog_;
+  // Number of samples merged into others since the ring last had room.
+  int merged_count_;
+
+  ControllerSampler(const ControllerSampler& other) = delete;
+  ControllerSampler& operator=(const ControllerSampler& other) = delete;
+};
+
+#endif  // CONTROLLER_PAINT_APP_SRC_MAIN_JNI_CONTROLLER_SAMPLER_H_  // NOLINT
@@ -19,16 +19,15 @@
 #include <android/asset_manager.h>
 #include <android/asset_manager_jni.h>
 #include <jni.h>
+#include <stddef.h>
+#include <algorithm>
+#include <cmath>
 #include <string>
 
 #include "utils.h"  // NOLINT
 
 namespace {
 
-// If true, requires the click button for painting. If false, the user can
-// paint by simply touching the touchpad.
-static const bool kRequireClickToPaint = true;
-
 // Near and far clipping planes.
 static const float kNearClip = 0.01f;
 static const float kFarClip = 100.0f;
@@ -55,8 +54,10 @@ static const std::array<float, 4> kGroundColor =
 static const std::array<float, 4> kCursorBorderColor =
     { 1.0f, 1.0f, 1.0f, 1.0f };
 
-// Vertex shader.
-static const char* kPaintShaderVp =
+// Vertex shaders. The first variant renders a single eye (ES 2.0). The
+// second renders both eyes at once with OVR_multiview2 (ES 3.0) and picks
+// the model-view-projection matrix of each eye with gl_ViewID_OVR.
+static const char* kPaintShaderVps[] = {
     "uniform mat4 u_MVP;\n"
     "attribute vec4 a_Position;\n"
     "attribute vec2 a_TexCoords;\n"
@@ -64,10 +65,23 @@ static const char* kPaintShaderVp =
     "void main() {\n"
     "  gl_Position = u_MVP * a_Position;\n"
     "  v_TexCoords = a_TexCoords;\n"
-    "}\n";
+    "}\n",
+
+    "#version 300 es\n"
+    "#extension GL_OVR_multiview2 : enable\n"
+    "layout(num_views=2) in;\n"
+    "uniform mat4 u_MVP[2];\n"
+    "in vec4 a_Position;\n"
+    "in vec2 a_TexCoords;\n"
+    "out vec2 v_TexCoords;\n"
+    "void main() {\n"
+    "  gl_Position = u_MVP[gl_ViewID_OVR] * a_Position;\n"
+    "  v_TexCoords = a_TexCoords;\n"
+    "}\n",
+};
 
-// Fragment shader.
-static const char* kPaintShaderFp =
+// Fragment shaders, matching the vertex shaders above.
+static const char* kPaintShaderFps[] = {
     "precision mediump float;\n"
     "uniform vec4 u_Color;\n"
     "varying vec2 v_TexCoords;\n"
@@ -75,18 +89,26 @@ static const char* kPaintShaderFp =
     "void main() {\n"
     "  gl_FragColor = u_Color * texture2D(u_Sampler, vec2(\n"
     "      fract(v_TexCoords.s), fract(v_TexCoords.t)));\n"
-    "}\n";
+    "}\n",
 
-// In geometry data, this is the offset where texture coordinates start.
-static int kGeomTexCoordOffset = 3;  // in elements, not bytes.
+    "#version 300 es\n"
+    "precision mediump float;\n"
+    "uniform vec4 u_Color;\n"
+    "in vec2 v_TexCoords;\n"
+    "uniform sampler2D u_Sampler;\n"
+    "out vec4 FragColor;\n"
+    "void main() {\n"
+    "  FragColor = u_Color * texture(u_Sampler, vec2(\n"
+    "      fract(v_TexCoords.s), fract(v_TexCoords.t)));\n"
+    "}\n",
+};
 
 // In geometry data, this is how many bytes we skip ahead to get to the
-// data about the next vertex (3 floats for vertex coords, 2 for texture
-// coords).
-static int kGeomDataStride = 5 * sizeof(float);
+// data about the next vertex.
+static const int kGeomDataStride = sizeof(PaintVertex);
 
 // Repetitions of the ground texture.
-static float kGroundTexRepeat = 20.0f;
+static const GLubyte kGroundTexRepeat = 20;
 
 // Size of the ground plane.
 static float kGroundSize = 30.0f;
@@ -96,14 +118,14 @@ static float kGroundSize = 30.0f;
 static float kDefaultGroundY = -2.0f;
 
 // Geometry of the ground plane.
-static float kGroundGeom[] = {
+static const PaintVertex kGroundGeom[] = {
     // Data is X, Y, Z (vertex coords), S, T (texture coords).
-    kGroundSize, 0.0f, -kGroundSize, kGroundTexRepeat, 0.0f,
-    -kGroundSize, 0.0f, -kGroundSize, 0.0f, 0.0f,
-    -kGroundSize, 0.0f, kGroundSize, 0.0f, kGroundTexRepeat,
-    kGroundSize, 0.0f, -kGroundSize, kGroundTexRepeat, 0.0f,
-    -kGroundSize, 0.0f, kGroundSize, 0.0f, kGroundTexRepeat,
-    kGroundSize, 0.0f, kGroundSize, kGroundTexRepeat, kGroundTexRepeat,
+    {kGroundSize, 0.0f, -kGroundSize, kGroundTexRepeat, 0},
+    {-kGroundSize, 0.0f, -kGroundSize, 0, 0},
+    {-kGroundSize, 0.0f, kGroundSize, 0, kGroundTexRepeat},
+    {kGroundSize, 0.0f, -kGroundSize, kGroundTexRepeat, 0},
+    {-kGroundSize, 0.0f, kGroundSize, 0, kGroundTexRepeat},
+    {kGroundSize, 0.0f, kGroundSize, kGroundTexRepeat, kGroundTexRepeat},
 };
 static int kGroundVertexCount = 6;
 
@@ -111,17 +133,21 @@ static int kGroundVertexCount = 6;
 static float kCursorScale = 0.01f;
 
 // Geometry of the cursor.
-static float kCursorGeom[] = {
+static const PaintVertex kCursorGeom[] = {
     // Data is X, Y, Z (vertex coords), S, T (texture coords).
-    kCursorScale, kCursorScale, 0.0f, 1.0f, 0.0f,
-    -kCursorScale, kCursorScale, 0.0f, 0.0f, 0.0f,
-    -kCursorScale, -kCursorScale, 0.0f, 0.0f, 1.0f,
-    kCursorScale, kCursorScale, 0.0f, 1.0f, 0.0f,
-    -kCursorScale, -kCursorScale, 0.0f, 0.0f, 1.0f,
-    kCursorScale, -kCursorScale, 0.0f, 1.0f, 1.0f,
+    {kCursorScale, kCursorScale, 0.0f, 1, 0},
+    {-kCursorScale, kCursorScale, 0.0f, 0, 0},
+    {-kCursorScale, -kCursorScale, 0.0f, 0, 1},
+    {kCursorScale, kCursorScale, 0.0f, 1, 0},
+    {-kCursorScale, -kCursorScale, 0.0f, 0, 1},
+    {kCursorScale, -kCursorScale, 0.0f, 1, 1},
 };
 static int kCursorVertexCount = 6;
 
+// The ground and the cursor share a static VBO, ground first.
+static const int kGroundFirstVertex = 0;
+static const int kCursorFirstVertex = kGroundVertexCount;
+
 // Available colors the user can paint with.
 static const std::array<std::array<float, 4>, 10> kColors = {
     Utils::ColorFromHex(0xa029b6f6),  // light blue
@@ -136,58 +162,239 @@ static const std::array<std::array<float, 4>, 10> kColors = {
     Utils::ColorFromHex(0xa0e0e0e0),  // white
 };
 
-// When the user moves their finger horizontally by more than this
-// threshold distance, we switch colors.
-// This is given as a fraction of the touch pad.
-static const float kColorSwitchThreshold = 0.4f;
+// Identity model matrix, for geometry that is already in world space.
+static const gvr::Mat4f kIdentityMatrix = {
+    1.0f, 0.0f, 0.0f, 0.0f,
+    0.0f, 1.0f, 0.0f, 0.0f,
+    0.0f, 0.0f, 1.0f, 0.0f,
+    0.0f, 0.0f, 0.0f, 1.0f,
+};
 
-// Maximum number of drawn vertices to allow a color switch.
-// If more than this number of vertices have been drawn, then a color
-// switch gesture is forbidden.
-static const int kMaxVerticesForColorSwitch = 10;
+// Capacity, in vertices, of the streaming buffer that holds the geometry that
+// was not committed yet. Each range is at most a few dozen vertices, so the
+// buffer only needs to be orphaned every few dozen commits.
+// Stroke geometry never uses more than three indices per vertex.
+static const int kStreamingVboCapacity = 4096;
+static const int kStreamingIboCapacity = 3 * kStreamingVboCapacity;
+
+// Number of vertices in each page of committed stroke geometry. Each page is
+// drawn with a single draw call, so this trades memory held by partially
+// filled pages against draw calls for large drawings.
+static const int kStrokePageCapacity = 16384;
+
+// Simplification tolerance of each level of detail of committed geometry, in
+// meters, starting with the full detail. With kMaxStrokeLodError, level 1 is
+// drawn from 1.5 m, so strokes at kDefaultPaintDistance use it and only
+// strokes brought close to the head are drawn at full detail; level 2 is
+// drawn from 6 m. On the strokes of ndk-host's stroke_lod_test, levels 1 and
+// 2 keep 72% and 33% of the vertices.
+static const float kStrokeLodTolerances[] = {0.0f, 0.00375f, 0.015f};
+
+// Largest angle, in radians, that the simplification error of the level of
+// detail a piece of geometry is drawn at may cover, as seen from the head.
+// This is about two pixels on current headsets.
+static const float kMaxStrokeLodError = 0.0025f;
+
+// Time spent uploading committed geometry per frame, past which the rest is
+// left for the next frames. This bounds the hitch when a large drawing is
+// restored after the GL context was lost, or loaded.
+static const std::chrono::microseconds kStrokeUploadBudget(2000);
+
+// Memory the undo history may use on top of the visible drawing, for the
+// pieces it hides, unless the app is told otherwise.
+static const size_t kDefaultHistoryMemoryBudget = 32 * 1024 * 1024;
+
+// Bounds of the scale of each dimension the eyes are rendered at, relative to
+// the maximum effective render target size. Because we are using 2X MSAA, we
+// can render to half as many pixels and achieve similar quality, so the
+// largest scale is sqrt(2)/2 ~= 7/10ths. Under load it goes down from there.
+static const float kMaxRenderScale = 0.7f;
+static const float kMinRenderScale = 0.5f;
+
+// Frame time the render scale is adjusted to stay under. Frames come at
+// 60 Hz, and GVR's distortion pass needs the rest of the frame.
+static const int64_t kTargetFrameNanos = 12000000;
+
+static dynamic_resolution::ScaleControllerOptions RenderScaleOptions() {
+  dynamic_resolution::ScaleControllerOptions options;
+  options.min_scale = kMinRenderScale;
+  options.max_scale = kMaxRenderScale;
+  options.target_nanos = kTargetFrameNanos;
+  return options;
+}
 
-// Prediction time to use when estimating head pose.
-static const int64_t kPredictionTimeWithoutVsyncNanos = 50000000;  // 50ms
+// Returns the bounds of the vertices of |chunk|.
+static Aabb ComputeBounds(const PaintVertex* vertices, int vertex_count) {
+  Aabb bounds;
+  bounds.min = bounds.max = {vertices[0].x, vertices[0].y, vertices[0].z};
+  for (int i = 1; i < vertex_count; ++i) {
+    const PaintVertex& vertex = vertices[i];
+    const std::array<float, 3> position = {vertex.x, vertex.y, vertex.z};
+    for (int k = 0; k < 3; ++k) {
+      bounds.min[k] = std::min(bounds.min[k], position[k]);
+      bounds.max[k] = std::max(bounds.max[k], position[k]);
+    }
+  }
+  return bounds;
+}
 
-// Minimum length of any paint segment. If the user tries to draw something
-// smaller than this length, it is ignored.
-static const float kMinPaintSegmentLength = 0.04f;
+// Returns the memory taken by a chunk of |vertex_count| vertices and
+// |index_count| indices.
+static size_t ChunkBytes(int vertex_count, int index_count) {
+  return vertex_count * sizeof(PaintVertex) + index_count * sizeof(GLushort);
+}
 
-// When the number of vertices in the recently drawn geometry exceeds this
-// number, we commit the geometry to the GPU as a VBO.
-static const int kVboCommitThreshold = 50;
+// Returns whether every chunk of |store| can be added to a StrokeArena with
+// kColors.size() colors and pages of kStrokePageCapacity vertices. The
+// indices were checked against the vertices by DrawingStore::Load().
+static bool IsValidDrawing(const DrawingStore& store) {
+  for (int i = 0; i < store.size(); ++i) {
+    const DrawingStore::Chunk& chunk = store.chunk(i);
+    if (chunk.color < 0 || chunk.color >= static_cast<int>(kColors.size()) ||
+        chunk.vertex_count <= 0 || chunk.vertex_count > kStrokePageCapacity ||
+        chunk.index_count < 0 || chunk.index_count > 3 * kStrokePageCapacity) {
+      return false;
+    }
+  }
+  return true;
+}
 
-// Minimum and maximum stroke widths.
-static const float kMinStrokeWidth = 0.015f;
-static const float kMaxStrokeWidth = 0.04f;
+// Returns the position of the head in start space, given the transform from
+// start space to head space.
+static std::array<float, 3> HeadPosition(const gvr::Mat4f& head_view) {
+  // The transform is a rotation R followed by a translation t, so the head is
+  // at -R^T t.
+  std::array<float, 3> position = {0.0f, 0.0f, 0.0f};
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      position[j] -= head_view.m[i][j] * head_view.m[i][3];
+    }
+  }
+  return position;
+}
+
+// Returns the distance from |point| to the closest point of |box|.
+static float DistanceToBox(const Aabb& box, const std::array<float, 3>& point) {
+  float distance2 = 0.0f;
+  for (int k = 0; k < 3; ++k) {
+    const float d = std::max(std::max(box.min[k] - point[k],
+                                      point[k] - box.max[k]), 0.0f);
+    distance2 += d * d;
+  }
+  return std::sqrt(distance2);
+}
 
 }  // namespace
 
-DemoApp::DemoApp(JNIEnv* env, jobject asset_mgr_obj, jlong gvr_context_ptr)
+DemoApp::DemoApp(JNIEnv* env, jobject asset_mgr_obj, jlong gvr_context_ptr,
+                 jstring drawing_path, jstring trace_path,
+                 jstring input_log_path, jboolean replay_input,
+                 jint history_budget_mb)
     :  // This is the GVR context pointer obtained from Java:
       gvr_context_(reinterpret_cast<gvr_context*>(gvr_context_ptr)),
       // Wrap the gvr_context* into a GvrApi C++ object for convenience:
       gvr_api_(gvr::GvrApi::WrapNonOwned(gvr_context_)),
       gvr_api_initialized_(false),
+      multiview_enabled_(false),
+      pose_predictor_([this](int64_t time) {
+        gvr::ClockTimePoint time_point;
+        time_point.monotonic_system_time_nanos = time;
+        return gvr_api_->GetHeadSpaceFromStartSpaceTransform(time_point);
+      }),
       viewport_list_(gvr_api_->CreateEmptyBufferViewportList()),
       scratch_viewport_(gvr_api_->CreateBufferViewport()),
+      resolution_(RenderScaleOptions()),
       shader_(-1),
       shader_u_color_(-1),
       shader_u_mvp_matrix_(-1),
       shader_u_sampler_(-1),
       shader_a_position_(-1),
       shader_a_texcoords_(-1),
+      attrib_vbo_(0),
+      hidden_area_stale_(true),
+      static_geom_vbo_(0),
       ground_texture_(-1),
       paint_texture_(-1),
       asset_mgr_(AAssetManager_fromJava(env, asset_mgr_obj)),
-      recent_geom_vertex_count_(0),
-      brush_stroke_total_vertices_(0),
-      selected_color_(0),
-      painting_(false),
-      has_continuation_(false),
-      switched_color_(false),
-      stroke_width_(kMinStrokeWidth) {
+      simulation_(kColors.size(), kDefaultPaintDistance),
+      recent_geom_generation_(0),
+      tail_generation_(0),
+      history_(history_budget_mb > 0
+                   ? static_cast<size_t>(history_budget_mb) * 1024 * 1024
+                   : kDefaultHistoryMemoryBudget),
+      saved_history_version_(0),
+      simplifier_(std::vector<float>(
+          kStrokeLodTolerances + 1,
+          kStrokeLodTolerances + sizeof(kStrokeLodTolerances) /
+                                     sizeof(kStrokeLodTolerances[0]))),
+      simplified_chunk_count_(0),
+      uploaded_lod_count_(0),
+      full_detail_vertex_count_(0),
+      coarsest_vertex_count_(0),
+      stroke_upload_time_(0),
+      restore_frame_count_(0),
+      restore_upload_time_(0),
+      draw_call_count_(0),
+      last_draw_call_count_(0),
+      stroke_draw_call_count_(0),
+      created_vertex_array_count_(0),
+      gpu_timer_("GPU") {
   CHECK(asset_mgr_);
+  static_assert(sizeof(kStrokeLodTolerances) /
+                    sizeof(kStrokeLodTolerances[0]) == kStrokeLodCount,
+                "One tolerance is needed per level of detail.");
+  for (std::unique_ptr<StrokeArena>& arena : stroke_arenas_) {
+    arena.reset(
+        new StrokeArena(kColors.size(), kStrokePageCapacity, kGeomDataStride));
+  }
+
+  const char* path = env->GetStringUTFChars(drawing_path, nullptr);
+  drawing_path_ = path;
+  env->ReleaseStringUTFChars(drawing_path, path);
+  // The drawing is uploaded to the GPU in the first frame.
+  if (drawing_store_.Load(drawing_path_) && !IsValidDrawing(drawing_store_)) {
+    LOGE("Ignoring invalid drawing %s.", drawing_path_.c_str());
+    drawing_store_.Clear();
+  }
+  LOGD("Loaded %d stroke chunks.", drawing_store_.size());
+  // The loaded drawing cannot be undone.
+  std::vector<size_t> chunk_bytes(drawing_store_.size());
+  for (int i = 0; i < drawing_store_.size(); ++i) {
+    const DrawingStore::Chunk& chunk = drawing_store_.chunk(i);
+    chunk_bytes[i] = ChunkBytes(chunk.vertex_count, chunk.index_count);
+  }
+  history_.Reset(chunk_bytes);
+  saved_history_version_ = history_.version();
+
+  gpu_timer_.set_frame_listener(
+      [this](int64_t gpu_nanos) { UpdateRenderScale(gpu_nanos); });
+
+  if (trace_path) {
+    path = env->GetStringUTFChars(trace_path, nullptr);
+    trace_path_ = path;
+    env->ReleaseStringUTFChars(trace_path, path);
+    trace::SetEnabled(true);
+    LOGD("Tracing frames to %s.", trace_path_.c_str());
+  }
+
+  if (input_log_path) {
+    path = env->GetStringUTFChars(input_log_path, nullptr);
+    const std::string input_log = path;
+    env->ReleaseStringUTFChars(input_log_path, path);
+    if (!replay_input) {
+      if (input_recorder_.Open(input_log)) {
+        LOGD("Recording input to %s.", input_log.c_str());
+      } else {
+        LOGE("Failed to create the input log %s.", input_log.c_str());
+      }
+    } else if (input_replayer_.Load(input_log)) {
+      LOGD("Replaying %d frames of input from %s.",
+           input_replayer_.frame_count(), input_log.c_str());
+    } else {
+      LOGE("Failed to load the input log %s, using live input.",
+           input_log.c_str());
+    }
+  }
   LOGD("DemoApp initialized.");
 }
 
@@ -200,17 +407,51 @@ void DemoApp::OnResume() {
   if (gvr_api_initialized_) {
     gvr_api_->RefreshViewerProfile();
     gvr_api_->ResumeTracking();
+    hidden_area_stale_ = true;
+  }
+  if (controller_api_) {
+    controller_api_->Resume();
+    if (!input_replayer_.is_loaded()) {
+      controller_sampler_.Start(controller_api_.get());
+    }
   }
-  if (controller_api_) controller_api_->Resume();
 }
 
 void DemoApp::OnPause() {
   LOGD("DemoApp::OnPause");
-  // The GL context is not preserved when pausing. Delete the drawing VBOs to
-  // avoid dangling GL object IDs.
+  // The GL context is not preserved when pausing. Delete the drawing and
+  // streaming VBOs to avoid dangling GL object IDs; the drawing is rebuilt from
+  // |drawing_store_| on resume. Save it too, since the app may not come back.
   ClearDrawing();
+  LOGD("DemoApp: streamed %ld bytes of strokes being painted.",
+       recent_geom_vbo_.uploaded_bytes() + tail_geom_vbo_.uploaded_bytes());
+  recent_geom_vbo_.Destroy();
+  tail_geom_vbo_.Destroy();
+  if (history_.version() != saved_history_version_) {
+    // Only the visible pieces are saved: the history is not.
+    saved_chunks_.clear();
+    history_.GetVisibleChunks(&saved_chunks_);
+    if (drawing_store_.Save(drawing_path_, saved_chunks_)) {
+      LOGD("Saved %d stroke chunks.", static_cast<int>(saved_chunks_.size()));
+      saved_history_version_ = history_.version();
+    } else {
+      LOGE("Failed to save the drawing to %s.", drawing_path_.c_str());
+    }
+  }
   if (gvr_api_initialized_) gvr_api_->PauseTracking();
+  controller_sampler_.Stop();
   if (controller_api_) controller_api_->Pause();
+  input_recorder_.Flush();
+  // The whole trace so far is written every time, since the app may not
+  // come back.
+  if (!trace_path_.empty()) {
+    if (trace::WriteChromeTrace(trace_path_)) {
+      LOGD("Wrote the trace to %s (%d events dropped).", trace_path_.c_str(),
+           static_cast<int>(trace::DroppedEventCount()));
+    } else {
+      LOGE("Failed to write the trace to %s.", trace_path_.c_str());
+    }
+  }
 }
 
 void DemoApp::OnSurfaceCreated() {
@@ -220,38 +461,76 @@ void DemoApp::OnSurfaceCreated() {
   gvr_api_->InitializeGl();
 
   LOGD("Initializing ControllerApi.");
+  controller_sampler_.Stop();
   controller_api_.reset(new gvr::ControllerApi);
   CHECK(controller_api_);
   CHECK(controller_api_->Init(gvr::ControllerApi::DefaultOptions(),
                               gvr_context_));
   controller_api_->Resume();
+  if (!input_replayer_.is_loaded()) {
+    controller_sampler_.Start(controller_api_.get());
+  }
+
+  multiview_enabled_ = gvr_api_->IsFeatureSupported(GVR_FEATURE_MULTIVIEW);
+  LOGD(multiview_enabled_ ? "Using multiview." : "Not using multiview.");
 
   LOGD("Initializing framebuffer.");
   std::vector<gvr::BufferSpec> specs;
   specs.push_back(gvr_api_->CreateBufferSpec());
-  framebuf_size_ = gvr_api_->GetMaximumEffectiveRenderTargetSize();
-  // Because we are using 2X MSAA, we can render to half as many pixels and
-  // achieve similar quality. Scale each dimension by sqrt(2)/2 ~= 7/10ths.
-  framebuf_size_.width = (7 * framebuf_size_.width) / 10;
-  framebuf_size_.height = (7 * framebuf_size_.height) / 10;
-
-  specs[0].SetSize(framebuf_size_);
+  framebuf_size_ = dynamic_resolution::ScaleSize(
+      gvr_api_->GetMaximumEffectiveRenderTargetSize(), kMaxRenderScale);
+
+  // With multiview, the framebuffer is a texture array with two layers
+  // whose width is half the render width.
+  if (multiview_enabled_) {
+    gvr::Sizei half_size = { framebuf_size_.width / 2, framebuf_size_.height };
+    specs[0].SetMultiviewLayers(2);
+    specs[0].SetSize(half_size);
+  } else {
+    specs[0].SetSize(framebuf_size_);
+  }
   specs[0].SetColorFormat(GVR_COLOR_FORMAT_RGBA_8888);
   specs[0].SetDepthStencilFormat(GVR_DEPTH_STENCIL_FORMAT_DEPTH_16);
   specs[0].SetSamples(2);
   swapchain_.reset(new gvr::SwapChain(gvr_api_->CreateSwapChain(specs)));
 
   LOGD("Compiling shaders.");
-  int vp = Utils::BuildShader(GL_VERTEX_SHADER, kPaintShaderVp);
-  int fp = Utils::BuildShader(GL_FRAGMENT_SHADER, kPaintShaderFp);
+  const int shader_index = multiview_enabled_ ? 1 : 0;
+  int vp = Utils::BuildShader(GL_VERTEX_SHADER, kPaintShaderVps[shader_index]);
+  int fp =
+      Utils::BuildShader(GL_FRAGMENT_SHADER, kPaintShaderFps[shader_index]);
   shader_ = Utils::BuildProgram(vp, fp);
   shader_u_color_ = glGetUniformLocation(shader_, "u_Color");
   shader_u_mvp_matrix_ = glGetUniformLocation(shader_, "u_MVP");
   shader_u_sampler_ = glGetUniformLocation(shader_, "u_Sampler");
   shader_a_position_ = glGetAttribLocation(shader_, "a_Position");
   shader_a_texcoords_ = glGetAttribLocation(shader_, "a_TexCoords");
+  CHECK(shader_a_position_ >= 0 && shader_a_texcoords_ >= 0);
+  // The sampler always reads texture unit 0.
+  glUseProgram(shader_);
+  glUniform1i(shader_u_sampler_, 0);
   CHECK(glGetError() == GL_NO_ERROR);
 
+  // The objects of the previous context, if any, died with it. They are
+  // normally deleted on pause, but the context may also have been lost
+  // without one. The drawing is restored from |drawing_store_| over the
+  // next frames.
+  gl_state_.Initialize(gl_state::LoadGlFunctions());
+  ForgetDrawing();
+  LOGD(gl_state_.vertex_arrays_supported() ? "Using vertex array objects."
+                                           : "Not using vertex array objects.");
+  CHECK(hidden_area_.Initialize(&gl_state_, multiview_enabled_));
+  hidden_area_stale_ = true;
+  gpu_timer_.Initialize();
+  resolution_.Reset();
+  LOGD(gpu_timer_.supported() ? "Scaling the resolution by GPU time."
+                              : "Scaling the resolution by CPU time.");
+  if (!trace_path_.empty()) {
+    trace::SetThreadName("Render");
+    LOGD(gpu_timer_.supported() ? "Timing the GPU."
+                                : "Not timing the GPU.");
+  }
+
   LOGD("Loading textures.");
   paint_texture_ = Utils::LoadRawTextureFromAsset(
       asset_mgr_, kPaintTexturePath, kPaintTextureWidth, kPaintTextureHeight);
@@ -259,6 +538,34 @@ void DemoApp::OnSurfaceCreated() {
       asset_mgr_, kGroundTexturePath, kGroundTextureWidth,
       kGroundTextureHeight);
 
+  LOGD("Creating static geometry buffer.");
+  glGenBuffers(1, &static_geom_vbo_);
+  glBindBuffer(GL_ARRAY_BUFFER, static_geom_vbo_);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(kGroundGeom) + sizeof(kCursorGeom),
+               nullptr, GL_STATIC_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, kGroundFirstVertex * kGeomDataStride,
+                  sizeof(kGroundGeom), kGroundGeom);
+  glBufferSubData(GL_ARRAY_BUFFER, kCursorFirstVertex * kGeomDataStride,
+                  sizeof(kCursorGeom), kCursorGeom);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  LOGD("Creating streaming buffer.");
+  // Unless they were deleted on pause, the buffers died with the old context.
+  recent_geom_vbo_.Abandon();
+  tail_geom_vbo_.Abandon();
+  recent_geom_vbo_.Initialize(kStreamingVboCapacity, kGeomDataStride,
+                              kStreamingIboCapacity);
+  recent_geom_vbo_.Sync(simulation_.recent_geom().data(),
+                        simulation_.recent_geom().size(),
+                        simulation_.recent_indices().data(),
+                        simulation_.recent_indices().size());
+  tail_geom_vbo_.Initialize(kStreamingVboCapacity, kGeomDataStride,
+                            kStreamingIboCapacity);
+  tail_geom_vbo_.Sync(simulation_.tail_geom().data(),
+                      simulation_.tail_geom().size(),
+                      simulation_.tail_indices().data(),
+                      simulation_.tail_indices().size());
+
   CHECK(glGetError() == GL_NO_ERROR);
   gvr_api_initialized_ = true;
 
@@ -271,345 +578,711 @@ void DemoApp::OnSurfaceChanged(int width, int height) {
 }
 
 void DemoApp::OnDrawFrame() {
+  TRACE_ZONE("OnDrawFrame");
+  const int64_t frame_start = trace::NowNanos();
+  gpu_timer_.Collect();
   PrepareFramebuffer();
+  if (hidden_area_stale_) UpdateHiddenArea();
+  draw_call_count_ = 0;
+  stroke_draw_call_count_ = 0;
 
-  // Enable blending so we get a transparency effect.
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-  glEnable(GL_BLEND);
-
-  viewport_list_.SetToRecommendedBufferViewports();
-  gvr::ClockTimePoint pred_time = gvr::GvrApi::GetTimePointNow();
-  pred_time.monotonic_system_time_nanos += kPredictionTimeWithoutVsyncNanos;
-
-  gvr::Mat4f head_view =
-      gvr_api_->GetHeadSpaceFromStartSpaceTransform(pred_time);
-  const gvr::Mat4f left_eye_view =
-      Utils::MatrixMul(gvr_api_->GetEyeFromHeadMatrix(GVR_LEFT_EYE),
-                       head_view);
-  const gvr::Mat4f right_eye_view =
-      Utils::MatrixMul(gvr_api_->GetEyeFromHeadMatrix(GVR_RIGHT_EYE),
-                       head_view);
-
-  const int32_t old_status = controller_state_.GetApiStatus();
-  const int32_t old_connection_state = controller_state_.GetConnectionState();
-
-  const gvr::ControllerBatteryLevel old_battery_level =
-      controller_state_.GetBatteryLevel();
-  const bool old_battery_charging =
-      controller_state_.GetBatteryCharging();
-
-  // Read current controller state.
-  controller_state_.Update(*controller_api_);
-
-  // Print new API status and connection state, if they changed.
-  if (controller_state_.GetApiStatus() != old_status ||
-      controller_state_.GetConnectionState() != old_connection_state) {
-    LOGD("DemoApp: controller API status: %s, connection state: %s",
-         gvr_controller_api_status_to_string(controller_state_.GetApiStatus()),
-         gvr_controller_connection_state_to_string(
-             controller_state_.GetConnectionState()));
-  }
-  // Print new controller battery level and charging state, if they changed.
-  if (controller_state_.GetBatteryLevel() != old_battery_level ||
-      controller_state_.GetBatteryCharging() != old_battery_charging) {
-    LOGD("DemoApp: controller battery level: %s, charging: %s",
-         gvr::ControllerApi::ToString(controller_state_.GetBatteryLevel()),
-         controller_state_.GetBatteryCharging() ? "true" : "false");
-  }
+  UpdateFrame();
+  UploadPaintedGeometry();
+  CullPaintedGeometry();
 
+  TRACE_ZONE_BEGIN(acquire_zone, "AcquireFrame");
   gvr::Frame frame = swapchain_->AcquireFrame();
+  TRACE_ZONE_END(acquire_zone);
   frame.BindBuffer(0);
 
+  // The uploads above and GVR's distortion pass in the previous frame
+  // changed GL state behind the cache's back.
+  gl_state_.Invalidate();
+  attrib_vbo_ = 0;
+
+  // Enable blending so we get a transparency effect.
+  gl_state_.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  gl_state_.SetCapability(GL_BLEND, true);
+
   glClearColor(kSkyColor[0], kSkyColor[1], kSkyColor[2], 1.0f);
-  viewport_list_.GetBufferViewport(0, &scratch_viewport_);
-  DrawEye(GVR_LEFT_EYE, left_eye_view, scratch_viewport_);
-  viewport_list_.GetBufferViewport(1, &scratch_viewport_);
-  DrawEye(GVR_RIGHT_EYE, right_eye_view, scratch_viewport_);
+  if (multiview_enabled_) {
+    DrawMultiview(frame_);
+  } else {
+    viewport_list_.GetBufferViewport(0, &scratch_viewport_);
+    DrawEye(GVR_LEFT_EYE, frame_, scratch_viewport_);
+    viewport_list_.GetBufferViewport(1, &scratch_viewport_);
+    DrawEye(GVR_RIGHT_EYE, frame_, scratch_viewport_);
+  }
+  // Leave the default vertex array and buffer bindings for GVR, and for the
+  // buffer uploads at the start of the next frame.
+  if (gl_state_.vertex_arrays_supported()) {
+    gl_state_.BindVertexArray(0);
+  }
+  gl_state_.BindBuffer(GL_ARRAY_BUFFER, 0);
+  gl_state_.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  gl_state_.SetVertexAttribArrays(0);
   frame.Unbind();
-  frame.Submit(viewport_list_, head_view);
-}
-
-void DemoApp::PrepareFramebuffer() {
-  gvr::Sizei recommended_size = gvr_api_->GetMaximumEffectiveRenderTargetSize();
-  // Because we are using 2X MSAA, we can render to half as many pixels and
-  // achieve similar quality. Scale each dimension by sqrt(2)/2 ~= 7/10ths.
-  recommended_size.width = (7 * recommended_size.width) / 10;
-  recommended_size.height = (7 * recommended_size.height) / 10;
-  if (framebuf_size_.width != recommended_size.width ||
-      framebuf_size_.height != recommended_size.height) {
-    // We need to resize the framebuffer.
-    swapchain_->ResizeBuffer(0, recommended_size);
-    framebuf_size_ = recommended_size;
+  {
+    TRACE_ZONE("Submit");
+    frame.Submit(viewport_list_, frame_.head_view);
+  }
+  pose_predictor_.EndFrame(
+      gvr::GvrApi::GetTimePointNow().monotonic_system_time_nanos);
+  if (!gpu_timer_.supported()) {
+    UpdateRenderScale(trace::NowNanos() - frame_start);
   }
-}
 
-void DemoApp::CheckColorSwitch() {
-  if (switched_color_ || !controller_state_.IsTouching()) return;
-  float x_diff = fabs(controller_state_.GetTouchPos().x - touch_down_x_);
-  if (x_diff < kColorSwitchThreshold) return;
-  if (brush_stroke_total_vertices_ > kMaxVerticesForColorSwitch) return;
-  if (controller_state_.GetTouchPos().x > touch_down_x_) {
-    selected_color_ = (selected_color_ + 1) % kColors.size();
-  } else {
-    selected_color_ = selected_color_ == 0 ? kColors.size() - 1 :
-        selected_color_ - 1;
+  if (draw_call_count_ != last_draw_call_count_) {
+    LOGD("DemoApp: %d draw calls per frame (%d of %d stroke chunks visible, "
+         "%d vertices simplified to %d).",
+         draw_call_count_, static_cast<int>(visible_chunks_.size()),
+         static_cast<int>(committed_.size()), full_detail_vertex_count_,
+         coarsest_vertex_count_);
+    last_draw_call_count_ = draw_call_count_;
+  }
+  // Report restores that take more than a frame when they start and when
+  // they are done.
+  if (HasPendingUploads() || restore_frame_count_ > 0) {
+    if (restore_frame_count_ == 0) {
+      LOGD("DemoApp: restoring %d stroke chunks and %d levels of detail.",
+           drawing_store_.size(), static_cast<int>(simplified_chunks_.size()));
+    }
+    ++restore_frame_count_;
+    restore_upload_time_ += stroke_upload_time_;
+    if (!HasPendingUploads()) {
+      LOGD("DemoApp: restored the drawing in %d frames, %lld us spent "
+           "uploading.",
+           restore_frame_count_,
+           static_cast<long long>(  // NOLINT
+               restore_upload_time_.count() / 1000));
+      restore_frame_count_ = 0;
+      restore_upload_time_ = std::chrono::nanoseconds::zero();
+    }
   }
-  switched_color_ = true;
 }
 
-void DemoApp::CheckChangeStrokeWidth() {
-  if (!controller_state_.IsTouching()) return;
-  float delta_y = controller_state_.GetTouchPos().y - touch_down_y_;
-  float delta_width = -delta_y * (kMaxStrokeWidth - kMinStrokeWidth);
-  stroke_width_ = touch_down_stroke_width_ + delta_width;
-  stroke_width_ = stroke_width_ < kMinStrokeWidth ? kMinStrokeWidth :
-      stroke_width_ > kMaxStrokeWidth ? kMaxStrokeWidth : stroke_width_;
+DemoApp::RestoreStats DemoApp::GetRestoreStats() const {
+  RestoreStats stats;
+  stats.uploaded_chunk_count = static_cast<int>(committed_.size());
+  stats.chunk_count = drawing_store_.size();
+  stats.uploaded_lod_count = uploaded_lod_count_;
+  stats.lod_count = static_cast<int>(simplified_chunks_.size());
+  stats.last_slice_nanos = stroke_upload_time_.count();
+  stats.slice_budget_nanos =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(kStrokeUploadBudget)
+          .count();
+  stats.frame_count = restore_frame_count_;
+  return stats;
 }
 
-void DemoApp::DrawEye(gvr::Eye which_eye, const gvr::Mat4f& eye_view_matrix,
-                      const gvr::BufferViewport& viewport) {
-  Utils::SetUpViewportAndScissor(framebuf_size_, viewport);
+DemoApp::DrawStats DemoApp::GetDrawStats() const {
+  DrawStats stats;
+  stats.multiview = multiview_enabled_;
+  stats.draw_call_count = draw_call_count_;
+  stats.stroke_draw_call_count = stroke_draw_call_count_;
+  stats.visible_chunk_count = static_cast<int>(visible_chunks_.size());
+  stats.visible_range_count = static_cast<int>(visible_ranges_.size());
+  stats.vertex_array_count = static_cast<int>(vertex_arrays_.size());
+  stats.created_vertex_array_count = created_vertex_array_count_;
+  return stats;
+}
 
-  gvr::Mat4f proj_matrix =
-      Utils::PerspectiveMatrixFromView(viewport.GetSourceFov(), kNearClip,
-                                       kFarClip);
-
-  // Figure out the point the cursor is pointing to.
-  const gvr::Mat4f cursor_mat =
-      Utils::ControllerQuatToMatrix(controller_state_.GetOrientation());
-  const std::array<float, 3> neutral_pos = { 0, 0, -kDefaultPaintDistance };
-  const std::array<float, 3> target_pos = Utils::MatrixVectorMul(
-      cursor_mat, neutral_pos);
-
-  bool paint_button_down =
-      kRequireClickToPaint
-          ? controller_state_.GetButtonDown(gvr::kControllerButtonClick)
-          : controller_state_.GetTouchDown();
-  bool paint_button_up =
-      kRequireClickToPaint
-          ? controller_state_.GetButtonUp(gvr::kControllerButtonClick)
-          : controller_state_.GetTouchUp();
-
-  if (paint_button_down) {
-    StartPainting(target_pos);
-  } else if (paint_button_up) {
-    StopPainting(true);
-  }
-
-  if (controller_state_.GetTouchDown()) {
-    touch_down_x_ = controller_state_.GetTouchPos().x;
-    touch_down_y_ = controller_state_.GetTouchPos().y;
-    touch_down_stroke_width_ = stroke_width_;
-  } else if (controller_state_.GetTouchUp()) {
-    switched_color_ = false;
-  }
-
-  if (!painting_ &&
-      controller_state_.GetButtonDown(gvr::kControllerButtonApp)) {
-    ClearDrawing();
-  }
-
-  CheckColorSwitch();
-  CheckChangeStrokeWidth();
-
-  if (painting_) {
-    const float dist = Utils::VecNorm(
-        Utils::VecAdd(1, paint_anchor_, -1, target_pos));
-    if (dist > kMinPaintSegmentLength) {
-      AddPaintSegment(paint_anchor_, target_pos);
-      paint_anchor_ = target_pos;
+void DemoApp::UpdateFrame() {
+  TRACE_ZONE("UpdateFrame");
+  viewport_list_.SetToRecommendedBufferViewports();
+  // Take the head pose and every controller sample since the last frame,
+  // live or from the input log.
+  const int64_t now =
+      gvr::GvrApi::GetTimePointNow().monotonic_system_time_nanos;
+  controller_samples_.clear();
+  int64_t prediction_nanos = 0;
+  if (input_replayer_.is_loaded()) {
+    // Once the log is over, the head stays still and the controller idle.
+    if (input_replayer_.NextFrame(&frame_.head_view, &controller_samples_) &&
+        input_replayer_.done()) {
+      LOGD("DemoApp: input replay finished.");
     }
+  } else {
+    frame_.head_view = pose_predictor_.BeginFrame(now);
+    prediction_nanos = pose_predictor_.prediction_nanos();
+    controller_sampler_.TakeSamples(&controller_samples_);
+  }
+  input_recorder_.RecordFrame(now, frame_.head_view, prediction_nanos,
+                              controller_samples_);
+  const gvr::Mat4f eye_from_head[2] = {
+      gvr_api_->GetEyeFromHeadMatrix(GVR_LEFT_EYE),
+      gvr_api_->GetEyeFromHeadMatrix(GVR_RIGHT_EYE)};
+  simd_math::MatrixMulBatch(eye_from_head, frame_.head_view,
+                            frame_.eye_views.data(), 2);
+  // The eyes are rendered into the corner of the framebuffer that the
+  // current render scale covers, and GVR only samples that corner.
+  const float render_scale = resolution_.scale();
+  frame_.render_size = dynamic_resolution::ScaleSize(
+      framebuf_size_, render_scale / kMaxRenderScale);
+  const gvr::Rectf fullscreen = { 0, 1, 0, 1 };
+  for (int eye = 0; eye < 2; ++eye) {
+    viewport_list_.GetBufferViewport(eye, &scratch_viewport_);
+    frame_.eye_projections[eye] = Utils::PerspectiveMatrixFromView(
+        scratch_viewport_.GetSourceFov(), kNearClip, kFarClip);
+    frame_.eye_view_projections[eye] =
+        Utils::MatrixMul(frame_.eye_projections[eye], frame_.eye_views[eye]);
+    if (multiview_enabled_) {
+      // Each eye is a whole layer of the framebuffer.
+      scratch_viewport_.SetSourceUv(fullscreen);
+      scratch_viewport_.SetSourceLayer(eye);
+    }
+    scratch_viewport_.SetSourceUv(dynamic_resolution::ScaleUv(
+        scratch_viewport_.GetSourceUv(), render_scale, kMaxRenderScale));
+    viewport_list_.SetBufferViewport(eye, scratch_viewport_);
   }
 
-  glUseProgram(shader_);
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, ground_texture_);
-  DrawGround(eye_view_matrix, proj_matrix);
-  glBindTexture(GL_TEXTURE_2D, paint_texture_);
-  DrawPaintedGeometry(eye_view_matrix, proj_matrix);
-  DrawCursor(eye_view_matrix, proj_matrix);
+  // Run the simulation over every controller sample, so fast motions are
+  // painted at the rate of the sensors.
+  for (const ControllerSample& sample : controller_samples_) {
+    simulation_.Update(sample.input);
+  }
+  frame_.selected_color = simulation_.selected_color();
 
-  CHECK(glGetError() == GL_NO_ERROR);
-}
+  gvr::Value floor_height;
+  // This may change when the floor height changes so it's computed every frame.
+  float ground_y = gvr_api_->GetCurrentProperties().Get(
+                       GVR_PROPERTY_TRACKING_FLOOR_HEIGHT, &floor_height)
+                       ? floor_height.f
+                       : kDefaultGroundY;
+  frame_.ground_model = {
+      1.0f, 0.0f, 0.0f, 0.0f,
+      0.0f, 1.0f, 0.0f, ground_y,
+      0.0f, 0.0f, 1.0f, 0.0f,
+      0.0f, 0.0f, 0.0f, 1.0f,
+  };
 
-void DemoApp::AddVertex(const std::array<float, 3>& coords, float u, float v) {
-  ++recent_geom_vertex_count_;
-  ++brush_stroke_total_vertices_;
-  recent_geom_.push_back(coords[0]);
-  recent_geom_.push_back(coords[1]);
-  recent_geom_.push_back(coords[2]);
-  recent_geom_.push_back(u);
-  recent_geom_.push_back(v);
+  const float scale = simulation_.stroke_scale();
+  const float rect_scales[] = { scale * 1.50f, scale * 1.25f, scale * 1.00f };
+  for (int i = 0; i < 3; ++i) {
+    const gvr::Mat4f neutral_matrix = {
+        rect_scales[i], 0.0f, 0.0f, 0.0f,
+        0.0f, rect_scales[i], 0.0f, 0.0f,
+        0.0f, 0.0f, rect_scales[i], -kDefaultPaintDistance,
+        0.0f, 0.0f, 0.0f, 1.0f,
+    };
+    frame_.cursor_models[i] =
+        Utils::MatrixMul(simulation_.controller_matrix(), neutral_matrix);
+  }
+  frame_.cursor_colors[0] = kCursorBorderColor;
+  frame_.cursor_colors[1] = { 0.0f, 0.0f, 0.0f, 1.0f };
+  frame_.cursor_colors[2] = kColors[frame_.selected_color];
 }
 
-void DemoApp::AddPaintSegment(const std::array<float, 3>& start_point,
-                              const std::array<float, 3>& end_point) {
-  std::array<float, 3> to_end = Utils::VecAdd(1, end_point, -1, start_point);
-  std::array<float, 3> cross = Utils::VecNormalize(
-      Utils::VecCrossProd(start_point, to_end));
+void DemoApp::UploadPaintedGeometry() {
+  TRACE_ZONE("UploadPaintedGeometry");
+  // The uploads below bind buffers directly. This is safe because no vertex
+  // array is bound between frames.
+  drawing_edits_.clear();
+  simulation_.TakeEdits(&drawing_edits_);
+  ApplyDrawingEdits();
+  ReleaseChunks();
+  CompactStrokeArenas();
+
+  // Pieces are only simplified once: their levels of detail are kept for
+  // when the GPU copy must be rebuilt.
+  for (; simplified_chunk_count_ < drawing_store_.size();
+       ++simplified_chunk_count_) {
+    if (drawing_store_.IsReleased(simplified_chunk_count_)) continue;
+    const DrawingStore::Chunk& chunk =
+        drawing_store_.chunk(simplified_chunk_count_);
+    simplifier_.Enqueue(simplified_chunk_count_, chunk.color, chunk.vertices,
+                        chunk.vertex_count, chunk.indices, chunk.index_count);
+  }
+  // The drawing is never replaced, and its levels of detail outlive the GL
+  // context, so every result applies. Only the pieces released while they
+  // were simplified need none.
+  const size_t first_result = simplified_chunks_.size();
+  simplifier_.TakeResults(&simplified_chunks_);
+  for (size_t i = first_result; i < simplified_chunks_.size(); ++i) {
+    SimplifiedChunk& simplified = simplified_chunks_[i];
+    if (drawing_store_.IsReleased(simplified.id)) {
+      std::vector<PaintVertex>().swap(simplified.chunk.vertices);
+      std::vector<GLushort>().swap(simplified.chunk.indices);
+    }
+  }
 
-  std::array<float, 3> start_top;
-  std::array<float, 3> start_bottom;
+  // Upload whatever is not on the GPU yet: the new pieces and levels of
+  // detail, or the whole drawing after it was loaded or the GL context was
+  // lost. Full detail pieces go first, so the drawing is complete as soon as
+  // possible; the coarser levels only make it cheaper to draw. At least one
+  // piece is uploaded per frame, however long it takes. The others are only
+  // started if one as slow as the slowest yet would still fit the budget.
+  stroke_upload_time_ = std::chrono::nanoseconds::zero();
+  if (HasPendingUploads()) {
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point upload_end = start;
+    std::chrono::nanoseconds slowest_upload(0);
+    do {
+      const std::chrono::steady_clock::time_point upload_start = upload_end;
+      const int uploaded_count = static_cast<int>(committed_.size());
+      if (uploaded_count < drawing_store_.size()) {
+        UploadChunk(uploaded_count);
+      } else {
+        UploadLod(uploaded_lod_count_++);
+      }
+      upload_end = std::chrono::steady_clock::now();
+      slowest_upload = std::max<std::chrono::nanoseconds>(
+          slowest_upload, upload_end - upload_start);
+    } while (HasPendingUploads() &&
+             upload_end - start + slowest_upload <= kStrokeUploadBudget);
+    stroke_upload_time_ = upload_end - start;
+  }
 
-  if (has_continuation_) {
-    // Continue from where we left off to form a continuous shape.
-    start_top = continuation_points_[0];
-    start_bottom = continuation_points_[1];
-  } else {
-    // Start of a new shape.
-    start_top = Utils::VecAdd(1, start_point, stroke_width_, cross);
-    start_bottom = Utils::VecAdd(1, start_point, -stroke_width_, cross);
+  // Send only the recent vertices that were added since the last frame.
+  if (simulation_.recent_geom_generation() != recent_geom_generation_) {
+    recent_geom_vbo_.StartRange();
+    recent_geom_generation_ = simulation_.recent_geom_generation();
   }
+  recent_geom_vbo_.Sync(simulation_.recent_geom().data(),
+                        simulation_.recent_geom().size(),
+                        simulation_.recent_indices().data(),
+                        simulation_.recent_indices().size());
+
+  // The tail is small and changes as a whole, so it goes in a new range.
+  if (simulation_.tail_generation() != tail_generation_) {
+    tail_geom_vbo_.StartRange();
+    tail_geom_vbo_.Sync(simulation_.tail_geom().data(),
+                        simulation_.tail_geom().size(),
+                        simulation_.tail_indices().data(),
+                        simulation_.tail_indices().size());
+    tail_generation_ = simulation_.tail_generation();
+  }
+}
 
-  const std::array<float, 3> end_top = Utils::VecAdd(
-      1, end_point, stroke_width_, cross);
-  const std::array<float, 3> end_bottom = Utils::VecAdd(
-      1, end_point, -stroke_width_, cross);
-  AddVertex(start_top, 0.0f, 0.0f);
-  AddVertex(start_bottom, 0.0f, 1.0f);
-  AddVertex(end_top, 1.0f, 0.0f);
-  AddVertex(start_bottom, 0.0f, 1.0f);
-  AddVertex(end_bottom, 1.0f, 1.0f);
-  AddVertex(end_top, 1.0f, 0.0f);
-  if (recent_geom_vertex_count_ > kVboCommitThreshold) {
-    CommitToVbo();
+void DemoApp::ApplyDrawingEdits() {
+  bool applied_command = false;
+  for (const DrawingEdit& edit : drawing_edits_) {
+    if (!edit.is_command) {
+      const StrokeChunk& chunk = edit.chunk;
+      history_.AddChunk(drawing_store_.size(), chunk.stroke,
+                        ChunkBytes(chunk.vertices.size(),
+                                   chunk.indices.size()));
+      drawing_store_.Add(chunk);
+      continue;
+    }
+    applied_command = true;
+    switch (edit.command) {
+      case kUndoCommand:
+        history_.Undo();
+        break;
+      case kRedoCommand:
+        history_.Redo();
+        break;
+      case kClearCommand:
+        history_.Clear();
+        break;
+    }
   }
+  if (!applied_command) return;
+  LOGD("DemoApp: %d steps to undo and %d to redo, holding %d bytes.",
+       history_.undo_count(), history_.redo_count(),
+       static_cast<int>(history_.retained_bytes()));
+}
 
-  has_continuation_ = true;
-  continuation_points_[0] = end_top;
-  continuation_points_[1] = end_bottom;
+void DemoApp::ReleaseChunks() {
+  released_chunks_.clear();
+  history_.TakeReleasedChunks(&released_chunks_);
+  if (released_chunks_.empty()) return;
+  for (int id : released_chunks_) {
+    drawing_store_.Release(id);
+    // The piece may not be on the GPU yet, while the drawing is restored.
+    if (id >= static_cast<int>(committed_.size())) continue;
+    stroke_bvh_.Remove(id);
+    CommittedChunk& committed = committed_[id];
+    int coarsest_lod = kStrokeLodCount - 1;
+    while (committed.lods[coarsest_lod] < 0) --coarsest_lod;
+    full_detail_vertex_count_ -=
+        stroke_arenas_[0]->chunks()[committed.lods[0]].vertex_count;
+    coarsest_vertex_count_ -= stroke_arenas_[coarsest_lod]
+                                  ->chunks()[committed.lods[coarsest_lod]]
+                                  .vertex_count;
+    for (int lod = 0; lod < kStrokeLodCount; ++lod) {
+      if (committed.lods[lod] < 0) continue;
+      stroke_arenas_[lod]->ReleaseChunk(committed.lods[lod]);
+      committed.lods[lod] = -1;
+    }
+  }
+  for (SimplifiedChunk& simplified : simplified_chunks_) {
+    if (drawing_store_.IsReleased(simplified.id)) {
+      std::vector<PaintVertex>().swap(simplified.chunk.vertices);
+      std::vector<GLushort>().swap(simplified.chunk.indices);
+    }
+  }
+  ForgetDeletedPages();
 }
 
-void DemoApp::StartPainting(const std::array<float, 3> paint_start_pos) {
-  if (painting_) return;
-  painting_ = true;
-  paint_anchor_ = paint_start_pos;
+void DemoApp::CompactStrokeArenas() {
+  // At most one page is moved per frame, which uploads less than half a page.
+  for (int lod = 0; lod < kStrokeLodCount; ++lod) {
+    StrokeArena* arena = stroke_arenas_[lod].get();
+    for (int color = 0; color < arena->color_count(); ++color) {
+      const int page = arena->FindSparsePage(color);
+      if (page < 0) continue;
+      moved_chunks_.clear();
+      arena->GetPageChunks(color, page, &moved_chunks_);
+      for (int moved : moved_chunks_) {
+        const int id = arena->chunks()[moved].owner;
+        CommittedChunk& committed = committed_[id];
+        if (lod == 0) {
+          const DrawingStore::Chunk& chunk = drawing_store_.chunk(id);
+          committed.lods[lod] = arena->AddChunk(
+              id, color, chunk.vertices, chunk.vertex_count, chunk.indices,
+              chunk.index_count);
+        } else {
+          const StrokeChunk& chunk =
+              simplified_chunks_[committed.lod_sources[lod]].chunk;
+          committed.lods[lod] = arena->AddChunk(
+              id, color, chunk.vertices.data(), chunk.vertices.size(),
+              chunk.indices.data(), chunk.indices.size());
+        }
+        arena->ReleaseChunk(moved);
+      }
+      ForgetDeletedPages();
+      return;
+    }
+  }
 }
 
-void DemoApp::StopPainting(bool commit_cur_segment) {
-  if (!painting_) return;
-  if (commit_cur_segment) {
-    CommitToVbo();
+void DemoApp::ForgetDeletedPages() {
+  deleted_vbos_.clear();
+  for (std::unique_ptr<StrokeArena>& arena : stroke_arenas_) {
+    arena->TakeDeletedVbos(&deleted_vbos_);
+  }
+  for (GLuint vbo : deleted_vbos_) {
+    std::map<GLuint, GLuint>::iterator it = vertex_arrays_.find(vbo);
+    if (it != vertex_arrays_.end()) {
+      gl_state_.DeleteVertexArray(it->second);
+      vertex_arrays_.erase(it);
+    }
+    if (attrib_vbo_ == vbo) attrib_vbo_ = 0;
   }
-  recent_geom_.clear();
-  recent_geom_vertex_count_ = 0;
-  painting_ = false;
-  has_continuation_ = false;
-  brush_stroke_total_vertices_ = 0;
 }
 
-void DemoApp::ClearDrawing() {
-  for (auto it : committed_vbos_) {
-    glDeleteBuffers(1, &it.vbo);
+bool DemoApp::HasPendingUploads() const {
+  return static_cast<int>(committed_.size()) < drawing_store_.size() ||
+         uploaded_lod_count_ < static_cast<int>(simplified_chunks_.size());
+}
+
+void DemoApp::UploadChunk(int id) {
+  const DrawingStore::Chunk& chunk = drawing_store_.chunk(id);
+  CommittedChunk committed = CommittedChunk();
+  committed.lods.fill(-1);
+  committed.lod_sources.fill(-1);
+  if (drawing_store_.IsReleased(id)) {
+    // Keep the ids in step with |drawing_store_|.
+    committed_.push_back(committed);
+    return;
   }
-  committed_vbos_.clear();
+  committed.bounds = ComputeBounds(chunk.vertices, chunk.vertex_count);
+  // Loaded pieces are uploaded straight from the mapped file.
+  committed.lods[0] = stroke_arenas_[0]->AddChunk(
+      id, chunk.color, chunk.vertices, chunk.vertex_count, chunk.indices,
+      chunk.index_count);
+  committed_.push_back(committed);
+  stroke_bvh_.Insert(id, committed.bounds);
+  full_detail_vertex_count_ += chunk.vertex_count;
+  coarsest_vertex_count_ += chunk.vertex_count;
 }
 
-void DemoApp::DrawObject(const gvr::Mat4f& mvp,
-                         const std::array<float, 4>& color, const float* data,
-                         GLuint vbo, int vertex_count) {
-  if (!data) {
-    // Use VBO.
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+void DemoApp::UploadLod(int index) {
+  // The levels of detail of each piece arrive from the finest to the
+  // coarsest.
+  const SimplifiedChunk& simplified = simplified_chunks_[index];
+  if (drawing_store_.IsReleased(simplified.id)) return;
+  CommittedChunk& committed = committed_[simplified.id];
+  const StrokeChunk& chunk = simplified.chunk;
+  int previous_lod = simplified.level - 1;
+  while (committed.lods[previous_lod] < 0) --previous_lod;
+  coarsest_vertex_count_ -= stroke_arenas_[previous_lod]
+                                ->chunks()[committed.lods[previous_lod]]
+                                .vertex_count;
+  committed.lods[simplified.level] =
+      stroke_arenas_[simplified.level]->AddChunk(
+          simplified.id, chunk.color, chunk.vertices.data(),
+          chunk.vertices.size(), chunk.indices.data(), chunk.indices.size());
+  committed.lod_sources[simplified.level] = index;
+  coarsest_vertex_count_ += chunk.vertices.size();
+}
+
+void DemoApp::CullPaintedGeometry() {
+  TRACE_ZONE("CullPaintedGeometry");
+  StereoFrustum frustum;
+  frustum.Set(frame_.eye_view_projections[0], frame_.eye_view_projections[1]);
+  visible_chunks_.clear();
+  stroke_bvh_.Cull(frustum, &visible_chunks_);
+  // The pieces that were undone or cleared stay in the tree until they are
+  // released, since they can come back.
+  visible_chunks_.erase(
+      std::remove_if(visible_chunks_.begin(), visible_chunks_.end(),
+                     [this](int id) { return !history_.IsVisible(id); }),
+      visible_chunks_.end());
+
+  // Make a range of each visible chunk, at the level of detail to draw it
+  // at. Only the visible chunks are looked at, so this costs nothing for the
+  // parts of the drawing the tree culled.
+  const std::array<float, 3> head_position = HeadPosition(frame_.head_view);
+  visible_ranges_.clear();
+  for (int id : visible_chunks_) {
+    const CommittedChunk& committed = committed_[id];
+    // Pick the coarsest level whose error is small enough at this distance,
+    // or the finest level below it that is available.
+    const float distance = DistanceToBox(committed.bounds, head_position);
+    int lod = 0;
+    while (lod + 1 < kStrokeLodCount &&
+           kStrokeLodTolerances[lod + 1] <= kMaxStrokeLodError * distance) {
+      ++lod;
+    }
+    while (committed.lods[lod] < 0) --lod;
+    const StrokeArena::Chunk& chunk =
+        stroke_arenas_[lod]->chunks()[committed.lods[lod]];
+    const StrokeRange range = {lod, chunk.color, chunk.page,
+                               chunk.first_index, chunk.index_count};
+    visible_ranges_.push_back(range);
   }
 
-  glUniform1i(shader_u_sampler_, 0);  // texture unit 0
-  glUniformMatrix4fv(shader_u_mvp_matrix_, 1, GL_FALSE,
-                     Utils::MatrixToGLArray(mvp).data());
-  glUniform4f(shader_u_color_, color[0], color[1], color[2], color[3]);
-  glEnableVertexAttribArray(shader_a_position_);
-  glEnableVertexAttribArray(shader_a_texcoords_);
-  glVertexAttribPointer(shader_a_position_, 3, GL_FLOAT, false,
-                        kGeomDataStride, data);
-  glVertexAttribPointer(shader_a_texcoords_, 2, GL_FLOAT, false,
-                        kGeomDataStride, data + kGeomTexCoordOffset);
-  glDrawArrays(GL_TRIANGLES, 0, vertex_count);
-  glDisableVertexAttribArray(shader_a_position_);
-  glDisableVertexAttribArray(shader_a_texcoords_);
+  // Order the ranges by color, then by page, and merge the ones that follow
+  // each other in a page.
+  std::sort(visible_ranges_.begin(), visible_ranges_.end(),
+            [](const StrokeRange& a, const StrokeRange& b) {
+              if (a.color != b.color) return a.color < b.color;
+              if (a.lod != b.lod) return a.lod < b.lod;
+              if (a.page != b.page) return a.page < b.page;
+              return a.first_index < b.first_index;
+            });
+  size_t merged_count = 0;
+  for (const StrokeRange& range : visible_ranges_) {
+    if (merged_count > 0) {
+      StrokeRange& last = visible_ranges_[merged_count - 1];
+      if (last.color == range.color && last.lod == range.lod &&
+          last.page == range.page &&
+          last.first_index + last.index_count == range.first_index) {
+        last.index_count += range.index_count;
+        continue;
+      }
+    }
+    visible_ranges_[merged_count++] = range;
+  }
+  visible_ranges_.resize(merged_count);
+}
 
-  if (!data) {
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+void DemoApp::PrepareFramebuffer() {
+  // The framebuffer is only resized when the recommended size changes: the
+  // render scale does not resize it.
+  const gvr::Sizei recommended_size = dynamic_resolution::ScaleSize(
+      gvr_api_->GetMaximumEffectiveRenderTargetSize(), kMaxRenderScale);
+  if (framebuf_size_.width != recommended_size.width ||
+      framebuf_size_.height != recommended_size.height) {
+    // We need to resize the framebuffer. Note that multiview uses two texture
+    // layers, each with half the render width.
+    gvr::Sizei buffer_size = recommended_size;
+    if (multiview_enabled_) {
+      buffer_size.width /= 2;
+    }
+    swapchain_->ResizeBuffer(0, buffer_size);
+    framebuf_size_ = recommended_size;
   }
 }
 
-void DemoApp::DrawGround(const gvr::Mat4f& view_matrix,
-                         const gvr::Mat4f& proj_matrix) {
-  gvr::Value floor_height;
-  // This may change when the floor height changes so it's computed every frame.
-  float ground_y = gvr_api_->GetCurrentProperties().Get(
-                       GVR_PROPERTY_TRACKING_FLOOR_HEIGHT, &floor_height)
-                       ? floor_height.f
-                       : kDefaultGroundY;
-  const gvr::Mat4f ground_model_matrix = {
-      1.0f, 0.0f, 0.0f, 0.0f,
-      0.0f, 1.0f, 0.0f, ground_y,
-      0.0f, 0.0f, 1.0f, 0.0f,
-      0.0f, 0.0f, 0.0f, 1.0f,
-  };
+void DemoApp::UpdateHiddenArea() {
+  gvr::GvrApi* gvr_api = gvr_api_.get();
+  hidden_area_.Update(
+      [gvr_api](const gvr::Vec2f& screen_uv) {
+        return gvr_api->ComputeDistortedPoint(GVR_LEFT_EYE, screen_uv);
+      },
+      [gvr_api](const gvr::Vec2f& screen_uv) {
+        return gvr_api->ComputeDistortedPoint(GVR_RIGHT_EYE, screen_uv);
+      });
+  hidden_area_stale_ = false;
+  LOGD("DemoApp: the lenses hide %.1f%% of the left view and %.1f%% of the "
+       "right one.",
+       100.0f * hidden_area_.hidden_fraction(0),
+       100.0f * hidden_area_.hidden_fraction(1));
+}
+
+void DemoApp::UpdateRenderScale(int64_t frame_nanos) {
+  // |resolution_| starts at the maximum scale, and the log is loaded before
+  // the first frame.
+  if (input_replayer_.is_loaded()) return;
+  if (resolution_.AddFrameTime(frame_nanos)) {
+    LOGD("DemoApp: rendering at %.2f of the maximum render target size.",
+         resolution_.scale());
+  }
+}
+
+void DemoApp::DrawEye(gvr::Eye which_eye, const FrameState& frame,
+                      const gvr::BufferViewport& viewport) {
+  const char* name =
+      which_eye == GVR_LEFT_EYE ? "DrawLeftEye" : "DrawRightEye";
+  TRACE_ZONE(name);
+  gpu_timer_.Begin(name);
+  Utils::SetUpViewportAndScissor(framebuf_size_, viewport);
+  const ViewType view = which_eye == GVR_LEFT_EYE ? kLeftView : kRightView;
+  MaskHiddenArea(view);
+  DrawWorld(frame, view);
+  glDepthMask(GL_TRUE);
+  gpu_timer_.End();
+}
+
+void DemoApp::DrawMultiview(const FrameState& frame) {
+  TRACE_ZONE("DrawMultiview");
+  gpu_timer_.Begin("DrawMultiview");
+  // Both layers are rendered at once, into the same corner of each.
+  glViewport(0, 0, frame.render_size.width / 2, frame.render_size.height);
+  gl_state_.SetCapability(GL_SCISSOR_TEST, false);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  MaskHiddenArea(kMultiview);
+  DrawWorld(frame, kMultiview);
+  glDepthMask(GL_TRUE);
+  gpu_timer_.End();
+}
 
-  gvr::Mat4f mv = Utils::MatrixMul(view_matrix, ground_model_matrix);
-  gvr::Mat4f mvp = Utils::MatrixMul(proj_matrix, mv);
+void DemoApp::DrawWorld(const FrameState& frame, ViewType view) {
+  gl_state_.UseProgram(shader_);
+  gl_state_.BindTexture2D(GL_TEXTURE0, ground_texture_);
+  DrawGround(frame, view);
+  gl_state_.BindTexture2D(GL_TEXTURE0, paint_texture_);
+  DrawPaintedGeometry(frame, view);
+  DrawCursor(frame, view);
 
-  DrawObject(mvp, kGroundColor, kGroundGeom, 0, kGroundVertexCount);
+  CHECK(glGetError() == GL_NO_ERROR);
+}
+
+void DemoApp::MaskHiddenArea(ViewType view) {
+  gl_state_.SetCapability(GL_DEPTH_TEST, true);
+  hidden_area_.Draw(view == kRightView ? 1 : 0);
+  // The mask set its own attribute pointers.
+  attrib_vbo_ = 0;
+  glDepthMask(GL_FALSE);
 }
 
-void DemoApp::DrawPaintedGeometry(const gvr::Mat4f& view_matrix,
-                                  const gvr::Mat4f& proj_matrix) {
-  gvr::Mat4f mv = view_matrix;
-  gvr::Mat4f mvp = Utils::MatrixMul(proj_matrix, mv);
+void DemoApp::ComputeMvp(const FrameState& frame, ViewType view,
+                         const gvr::Mat4f& model_matrix,
+                         MvpMatrices* mvp) const {
+  // Multiview shaders take both eyes' matrices, one after the other.
+  const int first_eye = view == kMultiview ? 0 : view;
+  simd_math::MatrixMulBatchToGL(&frame.eye_view_projections[first_eye],
+                                model_matrix, mvp->data(),
+                                view == kMultiview ? 2 : 1);
+}
 
-  // Draw committed VBOs.
-  for (auto it : committed_vbos_) {
-    DrawObject(mvp, kColors[it.color], 0, it.vbo, it.vertex_count);
+void DemoApp::ClearDrawing() {
+  // Buffer names are recycled, so forget the vertex arrays that refer to the
+  // pages being deleted. The others are recreated when next drawn.
+  for (const auto& entry : vertex_arrays_) {
+    gl_state_.DeleteVertexArray(entry.second);
+  }
+  for (std::unique_ptr<StrokeArena>& arena : stroke_arenas_) {
+    arena->Clear();
   }
+  ForgetDrawing();
+}
 
-  // Draw recent geometry (directly from main memory).
-  if (recent_geom_vertex_count_ > 0) {
-    DrawObject(mvp, kColors[selected_color_], recent_geom_.data(), 0,
-               recent_geom_vertex_count_);
+void DemoApp::ForgetDrawing() {
+  vertex_arrays_.clear();
+  for (std::unique_ptr<StrokeArena>& arena : stroke_arenas_) {
+    arena->Abandon();
   }
+  committed_.clear();
+  uploaded_lod_count_ = 0;
+  stroke_bvh_.Clear();
+  full_detail_vertex_count_ = 0;
+  coarsest_vertex_count_ = 0;
 }
 
-void DemoApp::CommitToVbo() {
-  // Only commit if we have at least a triangle.
-  if (recent_geom_vertex_count_ > 2) {
-    VboInfo info;
-    glGenBuffers(1, &info.vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, info.vbo);
-    glBufferData(GL_ARRAY_BUFFER, recent_geom_.size() * sizeof(float),
-                 recent_geom_.data(), GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    info.vertex_count = recent_geom_vertex_count_;
-    info.color = selected_color_;
-    committed_vbos_.push_back(info);
+void DemoApp::BindGeometry(GLuint vbo, GLuint ibo) {
+  if (gl_state_.vertex_arrays_supported()) {
+    std::map<GLuint, GLuint>::const_iterator it = vertex_arrays_.find(vbo);
+    if (it != vertex_arrays_.end()) {
+      gl_state_.BindVertexArray(it->second);
+      return;
+    }
+    // First use of this buffer: record its layout in a new vertex array.
+    const GLuint vertex_array = gl_state_.CreateVertexArray();
+    vertex_arrays_[vbo] = vertex_array;
+    ++created_vertex_array_count_;
+    gl_state_.BindVertexArray(vertex_array);
+  } else if (vbo == attrib_vbo_) {
+    // The attribute pointers already point into this buffer.
+    return;
   }
-  recent_geom_.clear();
-  recent_geom_vertex_count_ = 0;
+  gl_state_.BindBuffer(GL_ARRAY_BUFFER, vbo);
+  gl_state_.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+  gl_state_.SetVertexAttribArrays((1u << shader_a_position_) |
+                                  (1u << shader_a_texcoords_));
+  // These are offsets into the VBO.
+  glVertexAttribPointer(shader_a_position_, 3, GL_FLOAT, false,
+                        kGeomDataStride,
+                        reinterpret_cast<const GLvoid*>(
+                            offsetof(PaintVertex, x)));
+  glVertexAttribPointer(shader_a_texcoords_, 2, GL_UNSIGNED_BYTE, false,
+                        kGeomDataStride,
+                        reinterpret_cast<const GLvoid*>(
+                            offsetof(PaintVertex, s)));
+  attrib_vbo_ = vbo;
 }
 
-void DemoApp::DrawCursorRect(float scale, const std::array<float, 4> color,
-                             const gvr::Mat4f& view_matrix,
-                             const gvr::Mat4f& proj_matrix) {
-  gvr::Mat4f neutral_matrix = {
-      scale, 0.0f, 0.0f, 0.0f, 0.0f,  scale,
-      0.0f,  0.0f, 0.0f, 0.0f, scale, -kDefaultPaintDistance,
-      0.0f,  0.0f, 0.0f, 1.0f,
-  };
-  gvr::Mat4f controller_matrix =
-      Utils::ControllerQuatToMatrix(controller_state_.GetOrientation());
-  gvr::Mat4f model_matrix = Utils::MatrixMul(controller_matrix, neutral_matrix);
-  gvr::Mat4f mv = Utils::MatrixMul(view_matrix, model_matrix);
-  gvr::Mat4f mvp = Utils::MatrixMul(proj_matrix, mv);
-  DrawObject(mvp, color, kCursorGeom, 0, kCursorVertexCount);
+void DemoApp::DrawObject(const MvpMatrices& mvp,
+                         const std::array<float, 4>& color, GLuint vbo,
+                         GLuint ibo, int first, int count) {
+  BindGeometry(vbo, ibo);
+  glUniformMatrix4fv(shader_u_mvp_matrix_, multiview_enabled_ ? 2 : 1,
+                     GL_FALSE, mvp.data());
+  glUniform4f(shader_u_color_, color[0], color[1], color[2], color[3]);
+  if (ibo) {
+    glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_SHORT,
+                   reinterpret_cast<const GLvoid*>(first * sizeof(GLushort)));
+  } else {
+    glDrawArrays(GL_TRIANGLES, first, count);
+  }
+  ++draw_call_count_;
 }
 
-void DemoApp::DrawCursor(const gvr::Mat4f& view_matrix,
-                         const gvr::Mat4f& proj_matrix) {
-  float scale = stroke_width_ / kMinStrokeWidth;
-  DrawCursorRect(scale * 1.50f, kCursorBorderColor, view_matrix, proj_matrix);
-  DrawCursorRect(scale * 1.25f, { 0.0f, 0.0f, 0.0f, 1.0f }, view_matrix,
-                 proj_matrix);
-  DrawCursorRect(scale * 1.00f, kColors[selected_color_], view_matrix,
-                 proj_matrix);
+void DemoApp::DrawGround(const FrameState& frame, ViewType view) {
+  MvpMatrices mvp;
+  ComputeMvp(frame, view, frame.ground_model, &mvp);
+  DrawObject(mvp, kGroundColor, static_geom_vbo_, 0, kGroundFirstVertex,
+             kGroundVertexCount);
+}
+
+void DemoApp::DrawPaintedGeometry(const FrameState& frame, ViewType view) {
+  MvpMatrices mvp;
+  ComputeMvp(frame, view, kIdentityMatrix, &mvp);
+
+  // Draw the visible committed geometry, one call per run of visible chunks
+  // in each page.
+  const int first_draw_call = draw_call_count_;
+  for (const StrokeRange& range : visible_ranges_) {
+    DrawObject(mvp, kColors[range.color],
+               stroke_arenas_[range.lod]->page_vbo(range.color, range.page),
+               stroke_arenas_[range.lod]->page_ibo(range.color, range.page),
+               range.first_index, range.index_count);
+  }
+  stroke_draw_call_count_ += draw_call_count_ - first_draw_call;
+
+  // Draw recent geometry from the streaming buffer.
+  if (recent_geom_vbo_.index_count() > 0) {
+    DrawObject(mvp, kColors[frame.selected_color], recent_geom_vbo_.vbo(),
+               recent_geom_vbo_.ibo(), recent_geom_vbo_.first_index(),
+               recent_geom_vbo_.index_count());
+  }
+  if (tail_geom_vbo_.index_count() > 0) {
+    DrawObject(mvp, kColors[frame.selected_color], tail_geom_vbo_.vbo(),
+               tail_geom_vbo_.ibo(), tail_geom_vbo_.first_index(),
+               tail_geom_vbo_.index_count());
+  }
 }
 
+void DemoApp::DrawCursor(const FrameState& frame, ViewType view) {
+  MvpMatrices mvp;
+  for (int i = 0; i < 3; ++i) {
+    ComputeMvp(frame, view, frame.cursor_models[i], &mvp);
+    DrawObject(mvp, frame.cursor_colors[i], static_geom_vbo_, 0,
+               kCursorFirstVertex, kCursorVertexCount);
+  }
+}
@@ -23,9 +23,27 @@
 
 #include <array>
 #include <chrono>  // NOLINT
+#include <map>
 #include <memory>
+#include <string>
 #include <vector>
 
+#include "aabb_tree.h"  // NOLINT
+#include "controller_sampler.h"  // NOLINT
+#include "drawing_store.h"  // NOLINT
+#include "dynamic_resolution.h"  // NOLINT
+#include "gl_state_cache.h"  // NOLINT
+#include "gpu_timer.h"  // NOLINT
+#include "hidden_area.h"  // NOLINT
+#include "input_log.h"  // NOLINT
+#include "paint_simulation.h"  // NOLINT
+#include "pose_prediction.h"  // NOLINT
+#include "simd_math.h"  // NOLINT
+#include "streaming_vbo.h"  // NOLINT
+#include "stroke_arena.h"  // NOLINT
+#include "stroke_history.h"  // NOLINT
+#include "stroke_simplifier.h"  // NOLINT
+#include "trace.h"  // NOLINT
 #include "vr/gvr/capi/include/gvr.h"
 #include "vr/gvr/capi/include/gvr_controller.h"
 
@@ -45,13 +63,25 @@ class DemoApp {
   // |asset_manager| is the Android Asset Manager obtained from Java.
   // |gvr_context_ptr| a jlong representing a pointer to the GVR context
   //     obtained from Java.
-  DemoApp(JNIEnv* env, jobject asset_manager, jlong gvr_context_ptr);
+  // |drawing_path| is the file the drawing is saved to when the app pauses,
+  //     and loaded from when it starts.
+  // |trace_path| is the file a trace of the frames is written to when the
+  //     app pauses, or null not to trace.
+  // |input_log_path| is the input log (see input_log.h) the head pose and
+  //     controller input of every frame are recorded to, or replayed from if
+  //     |replay_input|, or null to just use the live input.
+  // |history_budget_mb| is the memory, in megabytes, the undo history may
+  //     hold on top of the visible drawing, or 0 for the default.
+  DemoApp(JNIEnv* env, jobject asset_manager, jlong gvr_context_ptr,
+          jstring drawing_path, jstring trace_path, jstring input_log_path,
+          jboolean replay_input, jint history_budget_mb);
   ~DemoApp();
   // Must be called when the Activity gets onResume().
-  // Must be called on the UI thread.
+  // Must be called on the rendering thread, which the Activity queues it to.
   void OnResume();
-  // Must be called when the Activity gets onPause().
-  // Must be called on the UI thread.
+  // Must be called when the Activity gets onPause(), before the GL surface
+  // is paused: it deletes the GL objects of the drawing.
+  // Must be called on the rendering thread, which the Activity queues it to.
   void OnPause();
   // Must be called when the GL renderer gets onSurfaceCreated().
   // Must be called on the rendering thread.
@@ -63,99 +93,275 @@ class DemoApp {
   // Must be called on the rendering thread.
   void OnDrawFrame();
 
+  // Progress of the upload of the drawing to the GPU, which is restored a
+  // slice of at most a couple of milliseconds per frame after the drawing
+  // was loaded or the GL context was lost.
+  struct RestoreStats {
+    // Full detail pieces of the drawing on the GPU, and in the drawing.
+    int uploaded_chunk_count;
+    int chunk_count;
+    // Coarser levels of detail on the GPU, and computed so far.
+    int uploaded_lod_count;
+    int lod_count;
+    // Time the last frame spent uploading, and the budget it is kept under.
+    int64_t last_slice_nanos;
+    int64_t slice_budget_nanos;
+    // Frames the restore in progress took so far, or 0 if everything is on
+    // the GPU.
+    int frame_count;
+  };
+  // Must be called on the rendering thread.
+  RestoreStats GetRestoreStats() const;
+
+  // What the last frame drew.
+  struct DrawStats {
+    bool multiview;
+    // Draw calls of the frame, and those of the committed pieces among them:
+    // one per run of visible pieces in a page, for each eye or, with
+    // multiview, for both at once.
+    int draw_call_count;
+    int stroke_draw_call_count;
+    // Committed pieces in view, and the runs they were merged into.
+    int visible_chunk_count;
+    int visible_range_count;
+    // Vertex array objects cached by vertex buffer, and created since the
+    // app started, or 0 without vertex array objects.
+    int vertex_array_count;
+    int created_vertex_array_count;
+  };
+  // Must be called on the rendering thread.
+  DrawStats GetDrawStats() const;
+
  private:
   // Quick explanation of the implementation:
   //
-  // When the user paints, we generate geometry (a series of connected
-  // triangles).
+  // Every frame is split in two stages. UpdateFrame() runs once per frame:
+  // it reads the head pose and the controller samples taken since the last
+  // frame (see ControllerSampler), advances |simulation_| through them
+  // (which turns controller input into brush stroke geometry) and gathers
+  // everything the eyes need into a FrameState. DrawEye() then runs once per
+  // eye and only renders that state.
+  //
+  // When the user paints, the simulation generates geometry (a series of
+  // connected triangles) along a smooth curve through the cursor positions
+  // (see StrokeBuilder). As vertices are added, they are streamed into
+  // |recent_geom_vbo_|, so each vertex crosses the bus once no matter how
+  // many times it is drawn (the end of the curve is only settled once the
+  // cursor moved on, so until then it is drawn from |tail_geom_vbo_|). When
+  // the recent geometry gets too crowded (exceeds a threshold number of
+  // vertices), the simulation commits the geometry and we move it
+  // to |stroke_arena_|. From then on, that piece of geometry resides in the
+  // GPU and can be rendered quickly without us needing to push it down the
+  // bus from CPU to GPU on every frame. Committed pieces are packed by color
+  // into a few large VBOs (see StrokeArena), so the whole drawing takes a
+  // handful of draw calls regardless of how many pieces it is made of.
+  // Every frame, the pieces outside the view of both eyes are culled with a
+  // bounding volume hierarchy, and the visible ones that are adjacent in a
+  // VBO are merged back into a single draw call.
+  //
+  // Committed pieces are also simplified to coarser levels of detail on a
+  // worker thread (see StrokeSimplifier). Each level is packed into its own
+  // StrokeArena, and each frame every visible piece is drawn at the coarsest
+  // level whose error is too small to see from where the user stands.
+  //
+  // The GPU copy of the drawing dies with the GL context when the app
+  // pauses, so the committed pieces are also kept in |drawing_store_|. It is
+  // saved to a file on pause and mapped back in when the app starts. The
+  // levels of detail are kept on the CPU as well. When the GPU copy is
+  // missing pieces, it is rebuilt from these copies a couple of milliseconds
+  // per frame, so restoring a large drawing does not stall rendering.
   //
-  // When the user starts painting, we accumulate the new geometry
-  // (vertices and texture coordinates) in the |recent_geom_| array.
-  // When that gets too crowded (exceeds a threshold number of vertices),
-  // we commit the geometry to the GPU using a VBO (Vertex Buffer Object).
-  // From then on, that piece of geometry resides in the GPU and can be
-  // rendered quickly without us needing to push it down the bus from
-  // CPU to GPU on every frame.
+  // Undo and redo are handled by |history_|, which only changes which of the
+  // committed pieces are visible: undoing a stroke or a clear hides or shows
+  // pieces that stay on the GPU, and costs no GPU work.
+
+  // Everything the per-eye render stage needs, computed once per frame.
+  struct FrameState {
+    // Head pose the frame is rendered with.
+    gvr::Mat4f head_view;
+    // Size of the corner of the framebuffer the eyes are rendered into, at
+    // the current render scale.
+    gvr::Sizei render_size;
+    // View and projection matrices of the left and right eyes.
+    std::array<gvr::Mat4f, 2> eye_views;
+    std::array<gvr::Mat4f, 2> eye_projections;
+    // Their products, projection * view.
+    std::array<gvr::Mat4f, 2> eye_view_projections;
+    // Model matrix of the ground plane.
+    gvr::Mat4f ground_model;
+    // Model matrices and colors of the rectangles that make the cursor,
+    // from back to front.
+    std::array<gvr::Mat4f, 3> cursor_models;
+    std::array<std::array<float, 4>, 3> cursor_colors;
+    // Color of the geometry that is being painted.
+    int selected_color;
+  };
+
+  // The views DrawWorld() can render. Single views are indices into the
+  // per-eye arrays of FrameState.
+  enum ViewType {
+    kLeftView = GVR_LEFT_EYE,
+    kRightView = GVR_RIGHT_EYE,
+    kMultiview
+  };
+
+  // Number of levels of detail of the committed geometry, including the
+  // full detail level 0.
+  static const int kStrokeLodCount = 3;
+
+  // A piece of committed geometry.
+  struct CommittedChunk {
+    // Bounds of the full detail geometry.
+    Aabb bounds;
+    // Index of the piece in the chunks() of the StrokeArena of each level of
+    // detail, or -1 if that level is not available (yet).
+    std::array<int, kStrokeLodCount> lods;
+    // Index in |simplified_chunks_| of each coarser level of detail on the
+    // GPU, which is kept to move it to another page.
+    std::array<int, kStrokeLodCount> lod_sources;
+  };
+
+  // A run of consecutive indices of committed geometry to draw.
+  struct StrokeRange {
+    int lod;
+    int color;
+    int page;
+    int first_index;
+    int index_count;
+  };
+
+  // Model-view-projection matrices in column-major order: one matrix when
+  // rendering a single view, or the left then the right eye's matrix when
+  // rendering with multiview.
+  typedef std::array<float, 32> MvpMatrices;
 
   // Prepares the GvrApi framebuffer for rendering, resizing if needed.
   void PrepareFramebuffer();
 
-  // Draws the image for the indicated eye.
-  void DrawEye(gvr::Eye which_eye, const gvr::Mat4f& eye_view_matrix,
-               const gvr::BufferViewport& params);
+  // Rebuilds |hidden_area_| from the distortion of the current viewer.
+  void UpdateHiddenArea();
 
-  // Draws the ground plane below the player.
-  void DrawGround(const gvr::Mat4f& view_matrix, const gvr::Mat4f& proj_matrix);
+  // Feeds the time the last frame took, on the GPU or on the CPU, to
+  // |resolution_|. While input is replayed, the scale stays at its maximum
+  // instead, so that replays of a log render the same pixels.
+  void UpdateRenderScale(int64_t frame_nanos);
 
-  // Draws the cursor that indicates where the controller is pointing.
-  // This method obtains the current cursor orientation from
-  // |controller_state_|, which is assumed to be up to date.
-  void DrawCursor(const gvr::Mat4f& view_matrix, const gvr::Mat4f& proj_matrix);
+  // Reads the head pose and controller state, or replays them, advances the
+  // simulation and fills |frame_|. Does not render anything.
+  void UpdateFrame();
+
+  // Moves the geometry the simulation produced this frame to
+  // |drawing_store_| and applies the user's commands, then moves the pieces
+  // and levels of detail that are not on the GPU yet to the GPU, for up to
+  // kStrokeUploadBudget.
+  void UploadPaintedGeometry();
+
+  // Adds the pieces committed this frame to |drawing_store_| and
+  // |history_|, and applies the commands the user issued, in order.
+  void ApplyDrawingEdits();
+
+  // Frees the CPU and GPU copies of the pieces |history_| released.
+  void ReleaseChunks();
+
+  // Moves the pieces left in one page that is mostly made of released
+  // pieces, if any, to new pages, so that it is deleted.
+  void CompactStrokeArenas();
 
-  // Draws a rectangle. The cursor is made of several rectangles.
-  void DrawCursorRect(float scale, const std::array<float, 4> color,
-                      const gvr::Mat4f& view_matrix,
-                      const gvr::Mat4f& proj_matrix);
+  // Forgets the vertex arrays of the pages the arenas deleted.
+  void ForgetDeletedPages();
 
-  // Adds a new segment to the geometry currently being drawn. The new
-  // segment will be created in such a way that is connects to the
-  // last created paint segment to produce the effect of a continuous
-  // brush stroke.
-  void AddPaintSegment(const std::array<float, 3>& start_point,
-                       const std::array<float, 3>& end_point);
+  // Returns whether some pieces or levels of detail are not on the GPU yet.
+  bool HasPendingUploads() const;
 
-  // Starts painting. This means that as the cursor moves, new geometry
-  // will be created to represent the brush stroke.
-  void StartPainting(const std::array<float, 3> paint_start_pos);
+  // Uploads the full detail piece |id| of |drawing_store_|, which must be
+  // the next one that is not on the GPU.
+  void UploadChunk(int id);
 
-  // Stops painting. This means that the cursor's motion will cease to
-  // create new geometry.
-  void StopPainting(bool commit_cur_segment);
+  // Uploads the level of detail |simplified_chunks_[index]| of a piece that
+  // is already on the GPU.
+  void UploadLod(int index);
 
-  // Adds a single vertex to the geometry.
-  void AddVertex(const std::array<float, 3>& coords, float u, float v);
+  // Fills |visible_ranges_| with the committed geometry that is part of the
+  // drawing and visible from either eye in |frame_|, at the level of detail
+  // to draw it at.
+  void CullPaintedGeometry();
+
+  // Draws the image for the indicated eye from |frame|.
+  void DrawEye(gvr::Eye which_eye, const FrameState& frame,
+               const gvr::BufferViewport& params);
+
+  // Draws the images for both eyes from |frame| in a single pass. Only
+  // valid if |multiview_enabled_|.
+  void DrawMultiview(const FrameState& frame);
+
+  // Draws the scene for |view|. The viewport must already be set up.
+  void DrawWorld(const FrameState& frame, ViewType view);
+
+  // Masks the parts of |view| the lenses hide out of the depth buffer, which
+  // must just have been cleared, and leaves depth writes off so the scene,
+  // which is blended in order, only tests against the mask. Depth writes
+  // must be turned back on before the next clear.
+  void MaskHiddenArea(ViewType view);
+
+  // Computes the model-view-projection matrices of |model_matrix| for
+  // |view| into |mvp|.
+  void ComputeMvp(const FrameState& frame, ViewType view,
+                  const gvr::Mat4f& model_matrix, MvpMatrices* mvp) const;
+
+  // Draws the ground plane below the player.
+  void DrawGround(const FrameState& frame, ViewType view);
+
+  // Draws the cursor that indicates where the controller is pointing.
+  void DrawCursor(const FrameState& frame, ViewType view);
 
   // Renders all the geometry the user painted, including the recent
   // uncommitted geometry and the committed VBOs.
-  void DrawPaintedGeometry(const gvr::Mat4f& view_matrix,
-                           const gvr::Mat4f& proj_matrix);
+  void DrawPaintedGeometry(const FrameState& frame, ViewType view);
 
-  // Pushes the current geometry to the GPU in the form of a VBO. This
-  // does not mean painting needs to stop: it just offloads vertices
-  // to the GPU for performance. If painting was active, it continues
-  // normally.
-  void CommitToVbo();
+  // Makes |vbo| the source of the vertex attributes and |ibo| the source of
+  // indices. On ES 3.0 this binds a vertex array object that is created the
+  // first time |vbo| is drawn; otherwise the attribute pointers are only
+  // re-specified when |vbo| changes. A VBO is always drawn with the same IBO.
+  void BindGeometry(GLuint vbo, GLuint ibo);
 
-  // Draws a single object, which may have its geometry specified via a regular
-  // pointer, or as a VBO handle.
+  // Draws a single object, which may be indexed.
   //
-  // @param mvp The model-view-projection matrix to use.
+  // @param mvp The model-view-projection matrices to use, as produced by
+  //     ComputeMvp().
   // @param color The color to use.
-  // @param data If non-NULL, points to the data to draw.
-  //     If this is NULL, then this method will use a VBO to draw.
-  // @param vbo If data == NULL, this is the VBO to use.
-  // @param vertex_count The number of vertices to draw.
-  void DrawObject(const gvr::Mat4f& mvp, const std::array<float, 4>& color,
-                  const float* data, GLuint vbo, int vertex_count);
-
-  // Checks if the user performed the "switch color" gesture and switches
-  // color, if applicable.
-  void CheckColorSwitch();
-
-  // Checks if the user wants to change the stroke width.
-  void CheckChangeStrokeWidth();
-
-  // Clears the whole drawing.
+  // @param vbo The VBO holding the object's PaintVertex data.
+  // @param ibo If non-zero, the buffer of 16-bit indices to draw with.
+  // @param first The first vertex to draw, or the first index if ibo != 0.
+  // @param count The number of vertices to draw, or of indices if ibo != 0.
+  void DrawObject(const MvpMatrices& mvp,
+                  const std::array<float, 4>& color, GLuint vbo, GLuint ibo,
+                  int first, int count);
+
+  // Deletes the committed geometry, and the vertex arrays, from the GPU.
+  // |drawing_store_| and the levels of detail are left alone, so the GPU copy
+  // is rebuilt from them by the next frames.
   void ClearDrawing();
 
+  // Like ClearDrawing(), for when the GL context was lost: forgets the GPU
+  // objects without deleting them.
+  void ForgetDrawing();
+
   // Gvr API entry point.
   gvr_context* gvr_context_;
   std::unique_ptr<gvr::GvrApi> gvr_api_;
   bool gvr_api_initialized_;
 
+  // If true, both eyes are rendered in a single pass into the two layers of
+  // the framebuffer (GVR_FEATURE_MULTIVIEW).
+  bool multiview_enabled_;
+
   // Controller API entry point.
   std::unique_ptr<gvr::ControllerApi> controller_api_;
 
+  // Predicts the head pose for when each frame will be displayed, from the
+  // measured frame timings.
+  pose_prediction::PosePredictor pose_predictor_;
+
   // Handle to the swapchain. On every frame, we have to check if the buffers
   // are still the right size for the frame (since they can be resized at any
   // time). This is done by PrepareFramebuffer().
@@ -165,9 +371,14 @@ class DemoApp {
   gvr::BufferViewportList viewport_list_;
   gvr::BufferViewport scratch_viewport_;
 
-  // Size of the offscreen framebuffer.
+  // Size of the offscreen framebuffer. It is allocated for the largest
+  // render scale, and the eyes are rendered into a corner of it.
   gvr::Sizei framebuf_size_;
 
+  // Picks the scale the eyes are rendered at from the GPU time of each
+  // frame, or from its CPU time where the GPU cannot be timed.
+  dynamic_resolution::ScaleController resolution_;
+
   // The shader we use to render our geometry. Since this is a very simple
   // demo, we use only one shader.
   int shader_;
@@ -180,6 +391,25 @@ class DemoApp {
   int shader_a_position_;
   int shader_a_texcoords_;
 
+  // GL state shadowed to skip redundant calls. It is invalidated at the start
+  // of every frame.
+  gl_state::StateCache gl_state_;
+
+  // Vertex array objects by the VBO they read from, when supported.
+  std::map<GLuint, GLuint> vertex_arrays_;
+
+  // Without vertex array objects, the VBO the attribute pointers currently
+  // point into, or 0 if unknown.
+  GLuint attrib_vbo_;
+
+  // Keeps the parts of the views the lenses hide from being shaded. It is
+  // rebuilt when the viewer profile may have changed.
+  hidden_area::Mask hidden_area_;
+  bool hidden_area_stale_;
+
+  // VBO holding the ground and cursor geometry.
+  GLuint static_geom_vbo_;
+
   // Ground texture.
   int ground_texture_;
 
@@ -189,66 +419,117 @@ class DemoApp {
   // Android asset manager (we use it to load the texture).
   AAssetManager* asset_mgr_;
 
-  // The last controller state (updated once per frame).
-  gvr::ControllerState controller_state_;
-
-  // The vertex and texture coordinates representing recently painted geometry.
-  // As this array grows beyond a certain limit, we commit that geometry
-  // to a VBO for performance. This is formatted for rendering, with
-  // each group of 5 floats meaning vx, vy, vz, s, t, where (vx, vy, vz) are the
-  // vertex coordinates in world space and s,t are the texture coordinates.
-  std::vector<float> recent_geom_;
-
-  // Count of vertices in recent_geom_.
-  int recent_geom_vertex_count_;
-
-  // Total vertices in the current brush stroke (the brush
-  // stroke starts when the user first touches the touchpad and continues
-  // until they release it).
-  int brush_stroke_total_vertices_;
-
-  // Currently selected color (index).
-  int selected_color_;
-
-  // If true, we are currently painting.
-  bool painting_;
-
-  // If painting_ == true, then this is the position where the last
-  // paint segment ended (or the position where painting began, if no
-  // segments were added yet).
-  std::array<float, 3> paint_anchor_;
-
-  // Indicates whether we have continuation points to continue the shape
-  // from (for smooth drawing).
-  bool has_continuation_;
-
-  // If has_continuation_ == true, these are the continuation points.
-  std::array<std::array<float, 3>, 2> continuation_points_;
-
-  // This is the list of committed VBOs that contains the static parts
-  // of the current drawing. As the drawing accumulates in painted_geom_,
-  // we push it to a static VBO on the GPU for performance.
-  struct VboInfo {
-    GLuint vbo;
-    int vertex_count;
-    int color;
-  };
-  std::vector<VboInfo> committed_vbos_;
-
-  // Touchpad coordinates where touch started. We use this to detect
-  // the swipe gestures that cause the drawing color to change.
-  float touch_down_x_;
-  float touch_down_y_;
-
-  // If true, a color switch already happened during this touch cycle.
-  bool switched_color_;
-
-  // Width of the painting stroke.
-  float stroke_width_;
-
-  // Width of the painting stroke when the user last started touching the
-  // touchpad.
-  float touch_down_stroke_width_;
+  // Reads the controller on its own thread, and the samples it took since
+  // the last frame. It is declared after |controller_api_| so it stops
+  // polling before the API is destroyed.
+  ControllerSampler controller_sampler_;
+  std::vector<ControllerSample> controller_samples_;
+
+  // The painting state machine, advanced once per controller sample.
+  PaintSimulation simulation_;
+
+  // The state rendered by both eyes in the current frame.
+  FrameState frame_;
+
+  // GPU copy of the simulation's recent geometry. It is uploaded
+  // incrementally once per frame.
+  StreamingVbo recent_geom_vbo_;
+
+  // Value of simulation_.recent_geom_generation() when the recent geometry
+  // was last uploaded.
+  int recent_geom_generation_;
+
+  // GPU copy of the simulation's tail geometry, which is uploaded again
+  // every time it is rebuilt.
+  StreamingVbo tail_geom_vbo_;
+  int tail_generation_;
+
+  // The canonical copy of the committed parts of the current drawing, and
+  // the file it is saved to.
+  DrawingStore drawing_store_;
+  std::string drawing_path_;
+
+  // The committed, static parts of the current drawing, by level of detail.
+  // As the drawing accumulates in the simulation, we push it to the GPU for
+  // performance.
+  std::array<std::unique_ptr<StrokeArena>, kStrokeLodCount> stroke_arenas_;
+
+  // The committed pieces on the GPU, in the order of |drawing_store_|.
+  std::vector<CommittedChunk> committed_;
+
+  // Scratch space for the chunks committed, and the commands issued, in the
+  // simulation each frame.
+  std::vector<DrawingEdit> drawing_edits_;
+
+  // Which pieces of |drawing_store_| make the drawing, and the version of it
+  // that was last saved or loaded.
+  StrokeHistory history_;
+  int saved_history_version_;
+
+  // Scratch space for the pieces |history_| releases, and for the pieces to
+  // save.
+  std::vector<int> released_chunks_;
+  std::vector<int> saved_chunks_;
+
+  // Scratch space for the pieces to move out of a page, and the pages the
+  // arenas deleted.
+  std::vector<int> moved_chunks_;
+  std::vector<GLuint> deleted_vbos_;
+
+  // Produces the coarser levels of detail of the committed pieces.
+  StrokeSimplifier simplifier_;
+
+  // The levels of detail produced by |simplifier_|, in the order they were
+  // produced, and the number of pieces of |drawing_store_| that were handed
+  // to it.
+  std::vector<SimplifiedChunk> simplified_chunks_;
+  int simplified_chunk_count_;
+
+  // Number of |simplified_chunks_| on the GPU. They are uploaded in order.
+  int uploaded_lod_count_;
+
+  // Number of vertices of the committed pieces at full detail, and at the
+  // coarsest level of detail available for each.
+  int full_detail_vertex_count_;
+  int coarsest_vertex_count_;
+
+  // Time spent uploading committed geometry in the current frame.
+  std::chrono::nanoseconds stroke_upload_time_;
+
+  // Frames and upload time of the restore in progress, when uploads carry
+  // over from one frame to the next.
+  int restore_frame_count_;
+  std::chrono::nanoseconds restore_upload_time_;
+
+  // Bounds of the committed pieces, by index in |committed_|.
+  AabbTree stroke_bvh_;
+
+  // The committed geometry to draw this frame, by color then page, and
+  // scratch space for the visible pieces.
+  std::vector<StrokeRange> visible_ranges_;
+  std::vector<int> visible_chunks_;
+
+  // Number of draw calls issued so far in the current frame, and in the
+  // frame that was last logged.
+  int draw_call_count_;
+  int last_draw_call_count_;
+  // Draw calls of the committed pieces in the current frame.
+  int stroke_draw_call_count_;
+  // Number of vertex arrays |vertex_arrays_| ever created.
+  int created_vertex_array_count_;
+
+  // Times the rendering of the eyes on the GPU, for the trace and for
+  // |resolution_|.
+  trace::GpuTimer gpu_timer_;
+
+  // The file the trace is written to on pause, or empty if not tracing.
+  std::string trace_path_;
+
+  // Records the input of every frame, when recording. When replaying,
+  // |input_replayer_| supplies it instead of GVR and |controller_sampler_|,
+  // and the controller is not polled.
+  InputRecorder input_recorder_;
+  InputReplayer input_replayer_;
 
   // Disallow copy and assign.
   DemoApp(const DemoApp& other) = delete;
@@ -0,0 +1,213 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "drawing_store.h"  // NOLINT
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+static_assert(sizeof(PaintVertex) % kDrawingFileAlignment == 0,
+              "Vertex blocks must stay aligned.");
+
+// Rounds |offset| up to the next multiple of kDrawingFileAlignment.
+static uint64_t Align(uint64_t offset) {
+  return (offset + kDrawingFileAlignment - 1) & ~(kDrawingFileAlignment - 1);
+}
+
+// Writes |size| bytes from |data| to |file| at |*offset|, after padding the
+// file up to |*offset|, and advances |*offset| past them.
+static bool WriteAt(FILE* file, uint64_t* offset, const void* data,
+                    size_t size) {
+  static const char kPadding[kDrawingFileAlignment] = {};
+  const long position = ftell(file);  // NOLINT
+  if (position < 0 || static_cast<uint64_t>(position) > *offset) return false;
+  const size_t padding = *offset - position;
+  if (padding > 0 && fwrite(kPadding, 1, padding, file) != padding) {
+    return false;
+  }
+  if (size > 0 && fwrite(data, 1, size, file) != size) return false;
+  *offset += size;
+  return true;
+}
+
+}  // namespace
+
+DrawingStore::DrawingStore() : mapping_(nullptr), mapping_size_(0) {}
+
+DrawingStore::~DrawingStore() { Unmap(); }
+
+void DrawingStore::Add(const StrokeChunk& chunk) {
+  added_chunks_.resize(chunks_.size());
+  added_chunks_.emplace_back(new StrokeChunk(chunk));
+  const StrokeChunk& copy = *added_chunks_.back();
+  Chunk stored;
+  stored.color = copy.color;
+  stored.vertices = copy.vertices.data();
+  stored.vertex_count = static_cast<int>(copy.vertices.size());
+  stored.indices = copy.indices.data();
+  stored.index_count = static_cast<int>(copy.indices.size());
+  chunks_.push_back(stored);
+}
+
+void DrawingStore::Release(int index) {
+  Chunk& chunk = chunks_[index];
+  chunk.vertices = nullptr;
+  chunk.vertex_count = 0;
+  chunk.indices = nullptr;
+  chunk.index_count = 0;
+  if (index < static_cast<int>(added_chunks_.size())) {
+    added_chunks_[index].reset();
+  }
+}
+
+void DrawingStore::Clear() {
+  chunks_.clear();
+  added_chunks_.clear();
+  Unmap();
+}
+
+bool DrawingStore::Save(const std::string& path,
+                        const std::vector<int>& indices) {
+  // Lay out the file first, so the header and table can be written in one
+  // go ahead of the blocks.
+  DrawingFileHeader header;
+  header.magic = kDrawingFileMagic;
+  header.version = kDrawingFileVersion;
+  header.vertex_size = sizeof(PaintVertex);
+  header.chunk_count = static_cast<uint32_t>(indices.size());
+  std::vector<DrawingFileChunk> table(indices.size());
+  uint64_t offset =
+      sizeof(header) + table.size() * sizeof(DrawingFileChunk);
+  for (size_t i = 0; i < indices.size(); ++i) {
+    const Chunk& chunk = chunks_[indices[i]];
+    DrawingFileChunk& entry = table[i];
+    entry.color = chunk.color;
+    entry.vertex_count = chunk.vertex_count;
+    entry.index_count = chunk.index_count;
+    entry.reserved = 0;
+    entry.vertex_offset = Align(offset);
+    offset = entry.vertex_offset + chunk.vertex_count * sizeof(PaintVertex);
+    entry.index_offset = Align(offset);
+    offset = entry.index_offset + chunk.index_count * sizeof(GLushort);
+  }
+
+  // Write to a temporary file and move it over the old one, which a mapping
+  // of the old file survives.
+  const std::string temp_path = path + ".tmp";
+  FILE* file = fopen(temp_path.c_str(), "wb");
+  if (!file) return false;
+  uint64_t written = 0;
+  bool ok = WriteAt(file, &written, &header, sizeof(header)) &&
+            WriteAt(file, &written, table.data(),
+                    table.size() * sizeof(DrawingFileChunk));
+  for (size_t i = 0; ok && i < indices.size(); ++i) {
+    const Chunk& chunk = chunks_[indices[i]];
+    written = table[i].vertex_offset;
+    ok = WriteAt(file, &written, chunk.vertices,
+                 chunk.vertex_count * sizeof(PaintVertex));
+    written = table[i].index_offset;
+    ok = ok && WriteAt(file, &written, chunk.indices,
+                       chunk.index_count * sizeof(GLushort));
+  }
+  ok = fclose(file) == 0 && ok;
+  if (!ok || rename(temp_path.c_str(), path.c_str()) != 0) {
+    unlink(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool DrawingStore::Load(const std::string& path) {
+  Clear();
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 ||
+      static_cast<uint64_t>(file_stat.st_size) < sizeof(DrawingFileHeader)) {
+    close(fd);
+    return false;
+  }
+  const size_t size = file_stat.st_size;
+  void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps the file alive.
+  close(fd);
+  if (mapping == MAP_FAILED) return false;
+  mapping_ = mapping;
+  mapping_size_ = size;
+
+  // The blocks are used in place, once the header, the table and the indices
+  // are validated: an index past the vertices of its chunk would make the
+  // GPU read past them.
+  const uint8_t* base = static_cast<const uint8_t*>(mapping);
+  const DrawingFileHeader* header =
+      reinterpret_cast<const DrawingFileHeader*>(base);
+  if (header->magic != kDrawingFileMagic ||
+      header->version != kDrawingFileVersion ||
+      header->vertex_size != sizeof(PaintVertex) ||
+      header->chunk_count >
+          (size - sizeof(*header)) / sizeof(DrawingFileChunk)) {
+    Unmap();
+    return false;
+  }
+  const DrawingFileChunk* table =
+      reinterpret_cast<const DrawingFileChunk*>(header + 1);
+  chunks_.resize(header->chunk_count);
+  for (uint32_t i = 0; i < header->chunk_count; ++i) {
+    const DrawingFileChunk& entry = table[i];
+    const uint64_t vertex_bytes =
+        static_cast<uint64_t>(entry.vertex_count) * sizeof(PaintVertex);
+    const uint64_t index_bytes =
+        static_cast<uint64_t>(entry.index_count) * sizeof(GLushort);
+    if (entry.vertex_offset % kDrawingFileAlignment != 0 ||
+        entry.index_offset % kDrawingFileAlignment != 0 ||
+        entry.vertex_offset > size ||
+        vertex_bytes > size - entry.vertex_offset ||
+        entry.index_offset > size ||
+        index_bytes > size - entry.index_offset) {
+      chunks_.clear();
+      Unmap();
+      return false;
+    }
+    const GLushort* indices =
+        reinterpret_cast<const GLushort*>(base + entry.index_offset);
+    for (uint32_t j = 0; j < entry.index_count; ++j) {
+      if (indices[j] >= entry.vertex_count) {
+        chunks_.clear();
+        Unmap();
+        return false;
+      }
+    }
+    Chunk& chunk = chunks_[i];
+    chunk.color = entry.color;
+    chunk.vertices =
+        reinterpret_cast<const PaintVertex*>(base + entry.vertex_offset);
+    chunk.vertex_count = entry.vertex_count;
+    chunk.indices = indices;
+    chunk.index_count = entry.index_count;
+  }
+  return true;
+}
+
+void DrawingStore::Unmap() {
+  if (mapping_) munmap(mapping_, mapping_size_);
+  mapping_ = nullptr;
+  mapping_size_ = 0;
+}
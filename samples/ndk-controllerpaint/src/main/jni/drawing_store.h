@@ -0,0 +1,126 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CONTROLLER_PAINT_APP_SRC_MAIN_JNI_DRAWING_STORE_H_  // NOLINT
+#define CONTROLLER_PAINT_APP_SRC_MAIN_JNI_DRAWING_STORE_H_
+
+#include <GLES2/gl2.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "paint_simulation.h"  // NOLINT
+
+// Layout of a drawing file. All fields are in the byte order of the device
+// that wrote the file, which is checked with |magic|:
+//
+//   DrawingFileHeader
+//   DrawingFileChunk[chunk_count]
+//   vertex and index blocks, each starting at a multiple of
+//   kDrawingFileAlignment from the start of the file.
+//
+// The blocks hold PaintVertex and 16-bit index data exactly as it is
+// uploaded to the GPU, so a mapped file is drawn from without being parsed.
+struct DrawingFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  // Must be sizeof(PaintVertex).
+  uint32_t vertex_size;
+  uint32_t chunk_count;
+};
+
+struct DrawingFileChunk {
+  uint32_t color;
+  uint32_t vertex_count;
+  uint32_t index_count;
+  uint32_t reserved;
+  // Offsets of the blocks from the start of the file.
+  uint64_t vertex_offset;
+  uint64_t index_offset;
+};
+
+static const uint32_t kDrawingFileMagic = 0x52445043;  // "CPDR"
+static const uint32_t kDrawingFileVersion = 1;
+static const size_t kDrawingFileAlignment = 16;
+
+// The canonical, CPU-side copy of the committed geometry of a drawing. The
+// GPU copy dies with the GL context, so it is rebuilt from here on resume.
+// Chunks either live in memory or in a mapped drawing file, and look the
+// same either way. This class never touches GL.
+class DrawingStore {
+ public:
+  // A committed chunk. The pointers stay valid until the next Clear() or
+  // Load(), or until the chunk is released.
+  struct Chunk {
+    int color;
+    const PaintVertex* vertices;
+    int vertex_count;
+    const GLushort* indices;
+    int index_count;
+  };
+
+  DrawingStore();
+  ~DrawingStore();
+
+  // Appends a copy of |chunk|.
+  void Add(const StrokeChunk& chunk);
+
+  // Removes all chunks.
+  void Clear();
+
+  // Frees the data of chunk |index|, which keeps its index but becomes
+  // empty. The data of loaded chunks stays mapped until the next Load().
+  void Release(int index);
+
+  int size() const { return static_cast<int>(chunks_.size()); }
+  const Chunk& chunk(int index) const { return chunks_[index]; }
+
+  // Whether chunk |index| was released.
+  bool IsReleased(int index) const {
+    return chunks_[index].vertices == nullptr;
+  }
+
+  // Writes the chunks |indices|, in that order, to |path|. The file is
+  // replaced atomically, so a failed save leaves the previous one intact.
+  // Returns false on failure.
+  bool Save(const std::string& path, const std::vector<int>& indices);
+
+  // Replaces the chunks by the ones of the file at |path|, which is mapped
+  // into memory rather than read. Returns false, leaving the store empty, if
+  // the file does not exist or is not a valid drawing file, which includes
+  // a chunk with an index past its vertices.
+  bool Load(const std::string& path);
+
+ private:
+  // Unmaps the current file, if any.
+  void Unmap();
+
+  std::vector<Chunk> chunks_;
+  // Storage of each chunk that was added rather than loaded, or null.
+  std::vector<std::unique_ptr<StrokeChunk>> added_chunks_;
+
+  // The mapped drawing file, or null.
+  void* mapping_;
+  size_t mapping_size_;
+
+  DrawingStore(const DrawingStore& other) = delete;
+  DrawingStore& operator=(const DrawingStore& other) = delete;
+};
+
+#endif  // CONTROLLER_PAINT_APP_SRC_MAIN_JNI_DRAWING_STORE_H_  // NOLINT
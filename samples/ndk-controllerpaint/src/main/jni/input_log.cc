@@ -0,0 +1,200 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "input_log.h"  // NOLINT
+
+#include <string.h>
+
+#include "utils.h"  // NOLINT
+
+namespace {
+
+// Size of the buffer the log is written through, so frames only cost a
+// write to the file every few seconds.
+static const size_t kWriteBufferSize = 64 * 1024;
+
+static uint32_t PackFlags(const PaintInput& input) {
+  return (input.is_touching ? kInputLogTouchingBit : 0) |
+         (input.touch_down ? kInputLogTouchDownBit : 0) |
+         (input.touch_up ? kInputLogTouchUpBit : 0) |
+         (input.click_button_down ? kInputLogClickDownBit : 0) |
+         (input.click_button_up ? kInputLogClickUpBit : 0) |
+         (input.app_button_down ? kInputLogAppDownBit : 0);
+}
+
+static void UnpackFlags(uint32_t flags, PaintInput* input) {
+  input->is_touching = (flags & kInputLogTouchingBit) != 0;
+  input->touch_down = (flags & kInputLogTouchDownBit) != 0;
+  input->touch_up = (flags & kInputLogTouchUpBit) != 0;
+  input->click_button_down = (flags & kInputLogClickDownBit) != 0;
+  input->click_button_up = (flags & kInputLogClickUpBit) != 0;
+  input->app_button_down = (flags & kInputLogAppDownBit) != 0;
+}
+
+// Reads the whole file at |path| into |data|. Returns false on failure.
+static bool ReadFile(const std::string& path, std::vector<uint8_t>* data) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file) return false;
+  bool ok = fseek(file, 0, SEEK_END) == 0;
+  const long size = ok ? ftell(file) : -1;  // NOLINT
+  ok = size >= 0 && fseek(file, 0, SEEK_SET) == 0;
+  if (ok) {
+    data->resize(size);
+    ok = size == 0 || fread(data->data(), 1, size, file) ==
+                          static_cast<size_t>(size);
+  }
+  fclose(file);
+  return ok;
+}
+
+}  // namespace
+
+InputRecorder::InputRecorder()
+    : file_(nullptr), buffer_(new char[kWriteBufferSize]), frame_count_(0) {}
+
+InputRecorder::~InputRecorder() { Close(); }
+
+bool InputRecorder::Open(const std::string& path) {
+  Close();
+  file_ = fopen(path.c_str(), "wb");
+  if (!file_) return false;
+  setvbuf(file_, buffer_.get(), _IOFBF, kWriteBufferSize);
+  path_ = path;
+  frame_count_ = 0;
+  InputLogHeader header;
+  header.magic = kInputLogMagic;
+  header.version = kInputLogVersion;
+  Write(&header, sizeof(header));
+  return is_open();
+}
+
+void InputRecorder::RecordFrame(int64_t time, const gvr::Mat4f& head_view,
+                                int64_t prediction_nanos,
+                                const std::vector<ControllerSample>& samples) {
+  if (!file_) return;
+  InputLogFrame frame;
+  frame.time = time;
+  memcpy(frame.head_view, head_view.m, sizeof(frame.head_view));
+  frame.sample_count = static_cast<uint32_t>(samples.size());
+  frame.prediction_nanos = static_cast<uint32_t>(prediction_nanos);
+  Write(&frame, sizeof(frame));
+  for (const ControllerSample& sample : samples) {
+    InputLogSample entry;
+    entry.orientation_timestamp = sample.orientation_timestamp;
+    entry.orientation[0] = sample.input.orientation.qx;
+    entry.orientation[1] = sample.input.orientation.qy;
+    entry.orientation[2] = sample.input.orientation.qz;
+    entry.orientation[3] = sample.input.orientation.qw;
+    entry.touch_pos[0] = sample.input.touch_pos.x;
+    entry.touch_pos[1] = sample.input.touch_pos.y;
+    entry.flags = PackFlags(sample.input);
+    entry.reserved = 0;
+    Write(&entry, sizeof(entry));
+  }
+  ++frame_count_;
+}
+
+void InputRecorder::Flush() {
+  if (file_ && fflush(file_) != 0) {
+    LOGE("Failed to write the input log %s.", path_.c_str());
+    fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+void InputRecorder::Close() {
+  Flush();
+  if (!file_) return;
+  if (fclose(file_) == 0) {
+    LOGD("Recorded %d frames of input to %s.", frame_count_, path_.c_str());
+  } else {
+    LOGE("Failed to write the input log %s.", path_.c_str());
+  }
+  file_ = nullptr;
+}
+
+void InputRecorder::Write(const void* data, size_t size) {
+  if (!file_ || fwrite(data, 1, size, file_) == size) return;
+  LOGE("Failed to write the input log %s.", path_.c_str());
+  fclose(file_);
+  file_ = nullptr;
+}
+
+InputReplayer::InputReplayer() : next_frame_(0), loaded_(false) {}
+
+bool InputReplayer::Load(const std::string& path) {
+  frames_.clear();
+  samples_.clear();
+  next_frame_ = 0;
+  loaded_ = false;
+  std::vector<uint8_t> data;
+  if (!ReadFile(path, &data) || data.size() < sizeof(InputLogHeader)) {
+    return false;
+  }
+  InputLogHeader header;
+  memcpy(&header, data.data(), sizeof(header));
+  if (header.magic != kInputLogMagic || header.version != kInputLogVersion) {
+    return false;
+  }
+
+  // The records are copied out, since they are not aligned in |data|.
+  size_t offset = sizeof(header);
+  while (data.size() - offset >= sizeof(InputLogFrame)) {
+    InputLogFrame record;
+    memcpy(&record, data.data() + offset, sizeof(record));
+    const size_t samples_size =
+        static_cast<size_t>(record.sample_count) * sizeof(InputLogSample);
+    // A partial frame can only be the last one.
+    if (data.size() - offset - sizeof(record) < samples_size) break;
+    offset += sizeof(record);
+    Frame frame;
+    memcpy(frame.head_view.m, record.head_view, sizeof(record.head_view));
+    frame.first_sample = samples_.size();
+    frame.sample_count = record.sample_count;
+    for (uint32_t i = 0; i < record.sample_count; ++i) {
+      InputLogSample entry;
+      memcpy(&entry, data.data() + offset, sizeof(entry));
+      offset += sizeof(entry);
+      ControllerSample sample;
+      sample.orientation_timestamp = entry.orientation_timestamp;
+      sample.input.orientation.qx = entry.orientation[0];
+      sample.input.orientation.qy = entry.orientation[1];
+      sample.input.orientation.qz = entry.orientation[2];
+      sample.input.orientation.qw = entry.orientation[3];
+      sample.input.touch_pos.x = entry.touch_pos[0];
+      sample.input.touch_pos.y = entry.touch_pos[1];
+      UnpackFlags(entry.flags, &sample.input);
+      samples_.push_back(sample);
+    }
+    frames_.push_back(frame);
+  }
+  if (frames_.empty()) {
+    samples_.clear();
+    return false;
+  }
+  loaded_ = true;
+  return true;
+}
+
+bool InputReplayer::NextFrame(gvr::Mat4f* head_view,
+                              std::vector<ControllerSample>* samples) {
+  if (done()) return false;
+  const Frame& frame = frames_[next_frame_++];
+  *head_view = frame.head_view;
+  samples->insert(samples->end(), samples_.begin() + frame.first_sample,
+                  samples_.begin() + frame.first_sample + frame.sample_count);
+  return true;
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CONTROLLER_PAINT_APP_SRC_MAIN_JNI_INPUT_LOG_H_  // NOLINT
+#define CONTROLLER_PAINT_APP_SRC_MAIN_JNI_INPUT_LOG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "controller_sampler.h"  // NOLINT
+#include "vr/gvr/capi/include/gvr_types.h"
+
+// Layout of an input log, which holds the input every frame was computed
+// from. All fields are in the byte order of the device that wrote the file,
+// which is checked with |magic|:
+//
+//   InputLogHeader
+//   for each frame: InputLogFrame, then InputLogSample[sample_count]
+//
+// Frames are appended as they are drawn, so a log whose writer was killed
+// ends with a partial frame, which is ignored.
+struct InputLogHeader {
+  uint32_t magic;
+  uint32_t version;
+};
+
+struct InputLogFrame {
+  // When the frame started, in nanoseconds on the monotonic clock.
+  int64_t time;
+  // The head pose the frame was rendered with, row-major.
+  float head_view[16];
+  // Number of controller samples the frame consumed.
+  uint32_t sample_count;
+  // How far past |time| |head_view| was predicted for, in nanoseconds, or 0
+  // if it was not predicted, as when the frame was replayed.
+  uint32_t prediction_nanos;
+};
+
+struct InputLogSample {
+  int64_t orientation_timestamp;
+  float orientation[4];
+  float touch_pos[2];
+  // The boolean fields of PaintInput, as kInputLog*Bit.
+  uint32_t flags;
+  uint32_t reserved;
+};
+
+static const uint32_t kInputLogMagic = 0x4c495043;  // "CPIL"
+static const uint32_t kInputLogVersion = 1;
+
+static const uint32_t kInputLogTouchingBit = 1 << 0;
+static const uint32_t kInputLogTouchDownBit = 1 << 1;
+static const uint32_t kInputLogTouchUpBit = 1 << 2;
+static const uint32_t kInputLogClickDownBit = 1 << 3;
+static const uint32_t kInputLogClickUpBit = 1 << 4;
+static const uint32_t kInputLogAppDownBit = 1 << 5;
+
+// Writes the head pose and controller samples of each frame to an input
+// log, so that the same session can be replayed by an InputReplayer.
+class InputRecorder {
+ public:
+  InputRecorder();
+
+  // Closes the log.
+  ~InputRecorder();
+
+  // Starts a new log at |path|, replacing any file there. Returns false on
+  // failure.
+  bool Open(const std::string& path);
+
+  // Whether a log is being written.
+  bool is_open() const { return file_ != nullptr; }
+
+  // Appends a frame that started at |time|, was rendered with |head_view|,
+  // predicted for |prediction_nanos| later, and consumed |samples|. Writes
+  // are buffered. If one fails, the log is closed and recording stops.
+  void RecordFrame(int64_t time, const gvr::Mat4f& head_view,
+                   int64_t prediction_nanos,
+                   const std::vector<ControllerSample>& samples);
+
+  // Writes out the buffered frames, so the log is complete up to here
+  // should the app never come back.
+  void Flush();
+
+  // Flushes and closes the log.
+  void Close();
+
+ private:
+  // Writes |size| bytes, or closes the log on failure.
+  void Write(const void* data, size_t size);
+
+  FILE* file_;
+  // The buffer |file_| writes through.
+  std::unique_ptr<char[]> buffer_;
+  std::string path_;
+  int frame_count_;
+
+  InputRecorder(const InputRecorder& other) = delete;
+  InputRecorder& operator=(const InputRecorder& other) = delete;
+};
+
+// Plays back an input log in place of the live head pose and controller:
+// each frame takes the pose and the samples of the next recorded frame,
+// however long frames take, so the simulation and rendering see exactly the
+// same input on every run.
+class InputReplayer {
+ public:
+  InputReplayer();
+
+  // Reads the whole log at |path| into memory. Returns false, leaving the
+  // replayer empty, if the file does not exist, is not a valid log or has
+  // no complete frame.
+  bool Load(const std::string& path);
+
+  // Whether a log was loaded.
+  bool is_loaded() const { return loaded_; }
+
+  int frame_count() const { return static_cast<int>(frames_.size()); }
+
+  // Whether every frame was played back.
+  bool done() const { return next_frame_ == frame_count(); }
+
+  // Sets |head_view| to the pose of the next frame and appends its samples
+  // to |samples|, then moves to the following frame. Once done(), returns
+  // false, and leaves both alone.
+  bool NextFrame(gvr::Mat4f* head_view,
+                 std::vector<ControllerSample>* samples);
+
+ private:
+  struct Frame {
+    gvr::Mat4f head_view;
+    size_t first_sample;
+    size_t sample_count;
+  };
+
+  std::vector<Frame> frames_;
+  std::vector<ControllerSample> samples_;
+  int next_frame_;
+  bool loaded_;
+
+  InputReplayer(const InputReplayer& other) = delete;
+  InputReplayer& operator=(const InputReplayer& other) = delete;
+};
+
+#endif  // CONTROLLER_PAINT_APP_SRC_MAIN_JNI_INPUT_LOG_H_  // NOLINT
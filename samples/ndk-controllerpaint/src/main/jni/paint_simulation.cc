@@ -0,0 +1,333 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "paint_simulation.h"  // NOLINT
+
+#include <utility>
+
+#include "utils.h"  // NOLINT
+
+namespace {
+
+// If true, requires the click button for painting. If false, the user can
+// paint by simply touching the touchpad.
+static const bool kRequireClickToPaint = true;
+
+// When the user moves their finger horizontally by more than this
+// threshold distance, we switch colors.
+// This is given as a fraction of the touch pad.
+static const float kColorSwitchThreshold = 0.4f;
+
+// Longest brush stroke, in meters of cursor travel, that still allows a
+// color switch. Once the stroke is longer, a color switch gesture is
+// forbidden. The original sample allowed 10 points at least 4 cm apart.
+static const float kMaxStrokeLengthForColorSwitch = 0.4f;
+
+// Minimum distance the cursor must move before its position is sampled
+// again while painting. The brush stroke follows a smooth curve through the
+// samples, so they can be much closer than the segments it ends up with.
+static const float kMinSampleDistance = 0.015f;
+
+// Largest angle, seen from the controller, between the brush stroke and the
+// curve through the samples. Multiplied by the paint distance, this gives
+// the tolerance of the stroke in meters.
+static const float kMaxStrokeErrorAngle = 0.001f;
+
+// Longest segment of a brush stroke, so long straight strokes still have
+// some vertices to light and to cull with.
+static const float kMaxStrokeSegmentLength = 0.2f;
+
+// Largest angle, in radians, by which the direction of a brush stroke turns
+// from one segment to the next. This keeps the stroke from visibly twisting
+// in tight curves, where it turns about its width.
+static const float kMaxStrokeTurn = 0.26f;  // 15 degrees
+
+// Maximum number of points in the tail of a brush stroke, so its geometry
+// stays small whatever the cursor does.
+static const int kMaxTailPoints = 128;
+
+// When the number of vertices in the recently drawn geometry exceeds this
+// number, we commit the geometry to the GPU.
+static const int kCommitThreshold = 50;
+
+// Touchpad positions left of this, as a fraction of its width, make the app
+// button undo rather than redo.
+static const float kRedoTouchThreshold = 0.5f;
+
+// Minimum and maximum stroke widths.
+static const float kMinStrokeWidth = 0.015f;
+static const float kMaxStrokeWidth = 0.04f;
+
+}  // namespace
+
+PaintSimulation::PaintSimulation(int color_count, float paint_distance)
+    : color_count_(color_count),
+      paint_distance_(paint_distance),
+      recent_geom_generation_(0),
+      tail_generation_(0),
+      stroke_builder_(kMaxStrokeErrorAngle * paint_distance,
+                      kMaxStrokeSegmentLength, kMaxStrokeTurn),
+      stroke_count_(0),
+      brush_stroke_length_(0.0f),
+      selected_color_(0),
+      painting_(false),
+      stroke_cross_({{0.0f, 1.0f, 0.0f}}),
+      has_continuation_(false),
+      touch_down_x_(0.0f),
+      touch_down_y_(0.0f),
+      switched_color_(false),
+      stroke_width_(kMinStrokeWidth),
+      touch_down_stroke_width_(kMinStrokeWidth) {
+  gvr::ControllerQuat identity;
+  identity.qx = identity.qy = identity.qz = 0.0f;
+  identity.qw = 1.0f;
+  controller_matrix_ = Utils::ControllerQuatToMatrix(identity);
+}
+
+void PaintSimulation::Update(const PaintInput& input) {
+  // Figure out the point the cursor is pointing to.
+  controller_matrix_ = Utils::ControllerQuatToMatrix(input.orientation);
+  const std::array<float, 3> neutral_pos = { 0, 0, -paint_distance_ };
+  const std::array<float, 3> target_pos = Utils::MatrixVectorMul(
+      controller_matrix_, neutral_pos);
+
+  bool paint_button_down =
+      kRequireClickToPaint ? input.click_button_down : input.touch_down;
+  bool paint_button_up =
+      kRequireClickToPaint ? input.click_button_up : input.touch_up;
+
+  if (paint_button_down) {
+    StartPainting(target_pos);
+  } else if (paint_button_up) {
+    StopPainting(true);
+  }
+
+  if (input.touch_down) {
+    touch_down_x_ = input.touch_pos.x;
+    touch_down_y_ = input.touch_pos.y;
+    touch_down_stroke_width_ = stroke_width_;
+  } else if (input.touch_up) {
+    switched_color_ = false;
+  }
+
+  CheckCommand(input);
+  CheckColorSwitch(input);
+  CheckChangeStrokeWidth(input);
+
+  if (painting_) {
+    const float dist = Utils::VecNorm(
+        Utils::VecAdd(1, paint_anchor_, -1, target_pos));
+    if (dist > kMinSampleDistance) {
+      stroke_points_.clear();
+      stroke_builder_.AddSample(target_pos, &stroke_points_);
+      for (const StrokePoint& point : stroke_points_) {
+        AddStrokePoint(point);
+      }
+      paint_anchor_ = target_pos;
+      brush_stroke_length_ += dist;
+      UpdateTail();
+    }
+  }
+}
+
+float PaintSimulation::stroke_scale() const {
+  return stroke_width_ / kMinStrokeWidth;
+}
+
+void PaintSimulation::TakeEdits(std::vector<DrawingEdit>* edits) {
+  for (DrawingEdit& edit : edits_) {
+    edits->push_back(std::move(edit));
+  }
+  edits_.clear();
+}
+
+void PaintSimulation::CheckCommand(const PaintInput& input) {
+  if (painting_ || !input.app_button_down) return;
+  // The app button alone clears the drawing. While touching the touchpad, it
+  // undoes, or redoes if the touch is on the right side.
+  DrawingEdit edit = DrawingEdit();
+  edit.is_command = true;
+  if (!input.is_touching) {
+    edit.command = kClearCommand;
+  } else if (input.touch_pos.x >= kRedoTouchThreshold) {
+    edit.command = kRedoCommand;
+  } else {
+    edit.command = kUndoCommand;
+  }
+  edits_.push_back(std::move(edit));
+}
+
+void PaintSimulation::CheckColorSwitch(const PaintInput& input) {
+  if (switched_color_ || !input.is_touching) return;
+  float x_diff = fabs(input.touch_pos.x - touch_down_x_);
+  if (x_diff < kColorSwitchThreshold) return;
+  if (brush_stroke_length_ > kMaxStrokeLengthForColorSwitch) return;
+  if (input.touch_pos.x > touch_down_x_) {
+    selected_color_ = (selected_color_ + 1) % color_count_;
+  } else {
+    selected_color_ = selected_color_ == 0 ? color_count_ - 1 :
+        selected_color_ - 1;
+  }
+  switched_color_ = true;
+}
+
+void PaintSimulation::CheckChangeStrokeWidth(const PaintInput& input) {
+  if (!input.is_touching) return;
+  float delta_y = input.touch_pos.y - touch_down_y_;
+  float delta_width = -delta_y * (kMaxStrokeWidth - kMinStrokeWidth);
+  stroke_width_ = touch_down_stroke_width_ + delta_width;
+  stroke_width_ = stroke_width_ < kMinStrokeWidth ? kMinStrokeWidth :
+      stroke_width_ > kMaxStrokeWidth ? kMaxStrokeWidth : stroke_width_;
+}
+
+void PaintSimulation::AddVertex(const std::array<float, 3>& coords, GLubyte u,
+                                GLubyte v, std::vector<PaintVertex>* geom) {
+  PaintVertex vertex = {coords[0], coords[1], coords[2], u, v, {0, 0}};
+  geom->push_back(vertex);
+}
+
+void PaintSimulation::AddJoin(GLushort start_index,
+                              std::vector<GLushort>* indices) {
+  const GLushort join[] = {
+      start_index, static_cast<GLushort>(start_index + 1),
+      static_cast<GLushort>(start_index + 2),
+      static_cast<GLushort>(start_index + 1),
+      static_cast<GLushort>(start_index + 3),
+      static_cast<GLushort>(start_index + 2),
+  };
+  indices->insert(indices->end(), join,
+                  join + sizeof(join) / sizeof(join[0]));
+}
+
+void PaintSimulation::ComputeEdge(const StrokePoint& point,
+                                  std::array<float, 3>* top,
+                                  std::array<float, 3>* bottom) {
+  // The edge is perpendicular to the stroke and to the line of sight from
+  // the controller, so the stroke faces the user.
+  const std::array<float, 3> cross =
+      Utils::VecCrossProd(point.position, point.tangent);
+  if (Utils::VecNorm(cross) > 1e-6f) {
+    stroke_cross_ = Utils::VecNormalize(cross);
+  }
+  *top = Utils::VecAdd(1, point.position, stroke_width_, stroke_cross_);
+  *bottom = Utils::VecAdd(1, point.position, -stroke_width_, stroke_cross_);
+}
+
+void PaintSimulation::AddStrokePoint(const StrokePoint& point) {
+  std::array<float, 3> top;
+  std::array<float, 3> bottom;
+  ComputeEdge(point, &top, &bottom);
+  if (recent_geom_.empty() && has_continuation_) {
+    // Start of a new piece of geometry: emit the edge we left off at, to
+    // form a continuous shape.
+    AddVertex(continuation_points_[0], 0, 0, &recent_geom_);
+    AddVertex(continuation_points_[1], 0, 1, &recent_geom_);
+  }
+  // The texture repeats once per segment. Rather than duplicating the shared
+  // edge with S = 0 and S = 1, S keeps counting up along the geometry; the
+  // shader only uses its fractional part.
+  const GLubyte s = recent_geom_.size() / 2;
+  AddVertex(top, s, 0, &recent_geom_);
+  AddVertex(bottom, s, 1, &recent_geom_);
+  has_continuation_ = true;
+  continuation_points_[0] = top;
+  continuation_points_[1] = bottom;
+  // The first edge of a stroke has no segment before it.
+  if (recent_geom_.size() < 4) return;
+  AddJoin(recent_geom_.size() - 4, &recent_indices_);
+  if (static_cast<int>(recent_geom_.size()) > kCommitThreshold) {
+    Commit();
+  }
+}
+
+void PaintSimulation::UpdateTail() {
+  tail_geom_.clear();
+  tail_indices_.clear();
+  ++tail_generation_;
+  if (!painting_) return;
+  stroke_points_.clear();
+  stroke_builder_.GetProvisionalPoints(&stroke_points_);
+  if (stroke_points_.size() > static_cast<size_t>(kMaxTailPoints)) {
+    // Keep the end, which is where the cursor is.
+    stroke_points_.erase(stroke_points_.begin(),
+                         stroke_points_.end() - kMaxTailPoints);
+  }
+  // The tail has its own edges, so computing them must not change the
+  // width direction of the final geometry.
+  const std::array<float, 3> stroke_cross = stroke_cross_;
+  if (has_continuation_) {
+    AddVertex(continuation_points_[0], 0, 0, &tail_geom_);
+    AddVertex(continuation_points_[1], 0, 1, &tail_geom_);
+  }
+  for (const StrokePoint& point : stroke_points_) {
+    std::array<float, 3> top;
+    std::array<float, 3> bottom;
+    ComputeEdge(point, &top, &bottom);
+    const GLubyte s = tail_geom_.size() / 2;
+    AddVertex(top, s, 0, &tail_geom_);
+    AddVertex(bottom, s, 1, &tail_geom_);
+    if (tail_geom_.size() >= 4) AddJoin(tail_geom_.size() - 4, &tail_indices_);
+  }
+  stroke_cross_ = stroke_cross;
+}
+
+void PaintSimulation::StartPainting(
+    const std::array<float, 3> paint_start_pos) {
+  if (painting_) return;
+  painting_ = true;
+  ++stroke_count_;
+  paint_anchor_ = paint_start_pos;
+  stroke_builder_.Begin(paint_start_pos);
+}
+
+void PaintSimulation::StopPainting(bool commit_cur_segment) {
+  if (!painting_) return;
+  if (commit_cur_segment) {
+    // Finish the stroke at the last sample.
+    stroke_points_.clear();
+    stroke_builder_.End(&stroke_points_);
+    for (const StrokePoint& point : stroke_points_) {
+      AddStrokePoint(point);
+    }
+    Commit();
+  }
+  ClearRecentGeometry();
+  painting_ = false;
+  has_continuation_ = false;
+  brush_stroke_length_ = 0.0f;
+  UpdateTail();
+}
+
+void PaintSimulation::Commit() {
+  // Only commit if we have at least a triangle.
+  if (recent_indices_.size() >= 3) {
+    edits_.push_back(DrawingEdit());
+    edits_.back().is_command = false;
+    StrokeChunk& chunk = edits_.back().chunk;
+    chunk.stroke = stroke_count_;
+    chunk.color = selected_color_;
+    chunk.vertices = recent_geom_;
+    chunk.indices = recent_indices_;
+  }
+  ClearRecentGeometry();
+}
+
+void PaintSimulation::ClearRecentGeometry() {
+  if (recent_geom_.empty()) return;
+  recent_geom_.clear();
+  recent_indices_.clear();
+  ++recent_geom_generation_;
+}
@@ -0,0 +1,250 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CONTROLLER_PAINT_APP_SRC_MAIN_JNI_PAINT_SIMULATION_H_  // NOLINT
+#define CONTROLLER_PAINT_APP_SRC_MAIN_JNI_PAINT_SIMULATION_H_
+
+#include <GLES2/gl2.h>
+
+#include <array>
+#include <vector>
+
+#include "stroke_builder.h"  // NOLINT
+#include "vr/gvr/capi/include/gvr_types.h"
+
+// Vertex format used for all the geometry in this demo: the position in
+// world space followed by texture coordinates. The texture coordinates are
+// always small whole numbers (the paint shader only uses their fractional
+// part, which comes from interpolation), so they are stored as bytes, which
+// makes a vertex 16 bytes instead of 20.
+struct PaintVertex {
+  float x, y, z;
+  GLubyte s, t;
+  GLubyte padding[2];
+};
+
+// The controller input consumed by one simulation step. This is a plain
+// copy of the parts of gvr::ControllerState the painting logic looks at, so
+// the simulation can be driven without a controller.
+struct PaintInput {
+  gvr::ControllerQuat orientation;
+  bool is_touching;
+  gvr::Vec2f touch_pos;
+  bool touch_down;
+  bool touch_up;
+  bool click_button_down;
+  bool click_button_up;
+  bool app_button_down;
+};
+
+// A piece of a brush stroke that is complete and can be moved to the GPU.
+// Indices are relative to the first vertex of the chunk.
+struct StrokeChunk {
+  // Number of the brush stroke the chunk is part of. A stroke is made of
+  // consecutive chunks, which are undone together.
+  int stroke;
+  int color;
+  std::vector<PaintVertex> vertices;
+  std::vector<GLushort> indices;
+};
+
+// Changes to the drawing as a whole that the user asked for.
+enum DrawingCommand { kUndoCommand, kRedoCommand, kClearCommand };
+
+// A change to the drawing: either a piece of a brush stroke that was
+// committed, or a command.
+struct DrawingEdit {
+  bool is_command;
+  // Only set if |is_command|.
+  DrawingCommand command;
+  // Only set if not |is_command|.
+  StrokeChunk chunk;
+};
+
+// The painting state machine: turns controller input into brush stroke
+// geometry, color changes and stroke width changes. It runs once per
+// controller sample and never calls GL, so everything it produces is handed
+// to the renderer through the accessors below.
+class PaintSimulation {
+ public:
+  // |color_count| is the number of colors the user can pick from and
+  // |paint_distance| the distance from the controller at which we paint.
+  PaintSimulation(int color_count, float paint_distance);
+
+  // Advances the simulation by one controller sample.
+  void Update(const PaintInput& input);
+
+  // Rotation of the controller as of the last Update().
+  const gvr::Mat4f& controller_matrix() const { return controller_matrix_; }
+
+  // Currently selected color (index).
+  int selected_color() const { return selected_color_; }
+
+  // Width of the painting stroke relative to the thinnest stroke, which is
+  // how much the cursor should be scaled.
+  float stroke_scale() const;
+
+  // The recently painted geometry that was not committed yet. Consecutive
+  // segments share their common edge, so each segment adds two vertices and
+  // six indices.
+  const std::vector<PaintVertex>& recent_geom() const { return recent_geom_; }
+  const std::vector<GLushort>& recent_indices() const {
+    return recent_indices_;
+  }
+
+  // Incremented every time the recent geometry is emptied, so the renderer
+  // knows when it must start uploading it from scratch.
+  int recent_geom_generation() const { return recent_geom_generation_; }
+
+  // The end of the brush stroke being painted that is not final yet: it
+  // continues the recent geometry up to the cursor, and is rebuilt from
+  // scratch whenever the cursor moves. It has at most a few hundred
+  // vertices.
+  const std::vector<PaintVertex>& tail_geom() const { return tail_geom_; }
+  const std::vector<GLushort>& tail_indices() const { return tail_indices_; }
+
+  // Incremented every time the tail is rebuilt.
+  int tail_generation() const { return tail_generation_; }
+
+  // Moves the chunks committed and the commands issued since the last call
+  // to the end of |edits|, in the order of the samples that produced them,
+  // which is the order they must be applied in.
+  void TakeEdits(std::vector<DrawingEdit>* edits);
+
+ private:
+  // Adds a new segment to the geometry currently being drawn, ending at
+  // |point| of the centreline of the brush stroke. The new segment will be
+  // created in such a way that is connects to the last created paint
+  // segment to produce the effect of a continuous brush stroke.
+  void AddStrokePoint(const StrokePoint& point);
+
+  // Computes the edge of the brush stroke across |point|.
+  void ComputeEdge(const StrokePoint& point, std::array<float, 3>* top,
+                   std::array<float, 3>* bottom);
+
+  // Rebuilds the tail of the brush stroke.
+  void UpdateTail();
+
+  // Starts painting. This means that as the cursor moves, new geometry
+  // will be created to represent the brush stroke.
+  void StartPainting(const std::array<float, 3> paint_start_pos);
+
+  // Stops painting. This means that the cursor's motion will cease to
+  // create new geometry.
+  void StopPainting(bool commit_cur_segment);
+
+  // Adds a single vertex to |geom|.
+  void AddVertex(const std::array<float, 3>& coords, GLubyte u, GLubyte v,
+                 std::vector<PaintVertex>* geom);
+
+  // Adds the two triangles joining the edge starting at vertex |start_index|
+  // to the next one to |indices|.
+  void AddJoin(GLushort start_index, std::vector<GLushort>* indices);
+
+  // Moves the recent geometry to |edits_|. This does not mean
+  // painting needs to stop: it just offloads vertices to the GPU for
+  // performance. If painting was active, it continues normally.
+  void Commit();
+
+  // Empties the recent geometry.
+  void ClearRecentGeometry();
+
+  // Checks if the user performed the "switch color" gesture and switches
+  // color, if applicable.
+  void CheckColorSwitch(const PaintInput& input);
+
+  // Checks if the user wants to change the stroke width.
+  void CheckChangeStrokeWidth(const PaintInput& input);
+
+  // Checks if the user pressed the app button, which issues a command.
+  void CheckCommand(const PaintInput& input);
+
+  int color_count_;
+  float paint_distance_;
+
+  gvr::Mat4f controller_matrix_;
+
+  // The vertices representing recently painted geometry, and the triangles
+  // made out of them. As this grows beyond a certain limit, we commit that
+  // geometry.
+  std::vector<PaintVertex> recent_geom_;
+  std::vector<GLushort> recent_indices_;
+  int recent_geom_generation_;
+
+  // The tail of the brush stroke.
+  std::vector<PaintVertex> tail_geom_;
+  std::vector<GLushort> tail_indices_;
+  int tail_generation_;
+
+  // Turns the cursor positions into the centreline of the brush stroke, and
+  // scratch space for its points.
+  StrokeBuilder stroke_builder_;
+  std::vector<StrokePoint> stroke_points_;
+
+  // Geometry committed, and commands issued, since the last TakeEdits().
+  std::vector<DrawingEdit> edits_;
+
+  // Number of brush strokes started so far.
+  int stroke_count_;
+
+  // Distance the cursor has travelled in the current brush stroke, in
+  // meters (the brush stroke starts when the user first touches the
+  // touchpad and continues until they release it).
+  float brush_stroke_length_;
+
+  // Currently selected color (index).
+  int selected_color_;
+
+  // If true, we are currently painting.
+  bool painting_;
+
+  // If painting_ == true, then this is the last cursor position given to
+  // |stroke_builder_| (or the position where painting began).
+  std::array<float, 3> paint_anchor_;
+
+  // Unit vector across the last edge of the brush stroke, which is kept
+  // when the stroke heads straight away from the user and has no well
+  // defined width direction.
+  std::array<float, 3> stroke_cross_;
+
+  // Indicates whether we have continuation points to continue the shape
+  // from (for smooth drawing).
+  bool has_continuation_;
+
+  // If has_continuation_ == true, these are the continuation points.
+  std::array<std::array<float, 3>, 2> continuation_points_;
+
+  // Touchpad coordinates where touch started. We use this to detect
+  // the swipe gestures that cause the drawing color to change.
+  float touch_down_x_;
+  float touch_down_y_;
+
+  // If true, a color switch already happened during this touch cycle.
+  bool switched_color_;
+
+  // Width of the painting stroke.
+  float stroke_width_;
+
+  // Width of the painting stroke when the user last started touching the
+  // touchpad.
+  float touch_down_stroke_width_;
+
+  // Disallow copy and assign.
+  PaintSimulation(const PaintSimulation& other) = delete;
+  PaintSimulation& operator=(const PaintSimulation& other) = delete;
+};
+
+#endif  // CONTROLLER_PAINT_APP_SRC_MAIN_JNI_PAINT_SIMULATION_H_  // NOLINT
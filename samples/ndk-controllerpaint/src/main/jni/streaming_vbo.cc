@@ -0,0 +1,124 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "streaming_vbo.h"  // NOLINT
+
+#include "utils.h"  // NOLINT
+
+StreamingVbo::StreamingVbo()
+    : vbo_(0),
+      ibo_(0),
+      vertex_capacity_(0),
+      vertex_stride_(0),
+      index_capacity_(0),
+      vertex_start_(0),
+      vertex_uploaded_(0),
+      index_start_(0),
+      index_uploaded_(0),
+      uploaded_bytes_(0) {}
+
+void StreamingVbo::Initialize(int vertex_capacity, int vertex_stride,
+                              int index_capacity) {
+  // Indices are 16-bit and absolute within the ring.
+  CHECK(vertex_capacity > 0 && vertex_capacity <= 65536);
+  CHECK(vertex_stride > 0 && index_capacity > 0);
+  vertex_capacity_ = vertex_capacity;
+  vertex_stride_ = vertex_stride;
+  index_capacity_ = index_capacity;
+  Destroy();
+  glGenBuffers(1, &vbo_);
+  glGenBuffers(1, &ibo_);
+  Orphan();
+  uploaded_bytes_ = 0;
+}
+
+void StreamingVbo::Destroy() {
+  if (vbo_) {
+    glDeleteBuffers(1, &vbo_);
+    glDeleteBuffers(1, &ibo_);
+  }
+  Abandon();
+}
+
+void StreamingVbo::Abandon() {
+  vbo_ = 0;
+  ibo_ = 0;
+}
+
+void StreamingVbo::StartRange() {
+  vertex_start_ += vertex_uploaded_;
+  vertex_uploaded_ = 0;
+  index_start_ += index_uploaded_;
+  index_uploaded_ = 0;
+}
+
+void StreamingVbo::Sync(const void* vertices, int vertex_count,
+                        const GLushort* indices, int index_count) {
+  CHECK(vertex_count <= vertex_capacity_ && index_count <= index_capacity_);
+  if (vertex_count <= vertex_uploaded_ && index_count <= index_uploaded_) {
+    return;
+  }
+  if (vertex_start_ + vertex_count > vertex_capacity_ ||
+      index_start_ + index_count > index_capacity_) {
+    // The range no longer fits. Rather than overwriting data that earlier
+    // draws may still be reading, get new storage and re-send the range.
+    Orphan();
+  }
+
+  if (vertex_count > vertex_uploaded_) {
+    const int new_count = vertex_count - vertex_uploaded_;
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(vertices);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glBufferSubData(GL_ARRAY_BUFFER,
+                    (vertex_start_ + vertex_uploaded_) * vertex_stride_,
+                    new_count * vertex_stride_,
+                    src + vertex_uploaded_ * vertex_stride_);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    vertex_uploaded_ = vertex_count;
+    uploaded_bytes_ += new_count * vertex_stride_;
+  }
+
+  if (index_count > index_uploaded_) {
+    rebased_indices_.clear();
+    for (int i = index_uploaded_; i < index_count; ++i) {
+      rebased_indices_.push_back(
+          static_cast<GLushort>(indices[i] + vertex_start_));
+    }
+    const int new_count = index_count - index_uploaded_;
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER,
+                    (index_start_ + index_uploaded_) * sizeof(GLushort),
+                    new_count * sizeof(GLushort), rebased_indices_.data());
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    index_uploaded_ = index_count;
+    uploaded_bytes_ += new_count * sizeof(GLushort);
+  }
+}
+
+void StreamingVbo::Orphan() {
+  glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+  glBufferData(GL_ARRAY_BUFFER, vertex_capacity_ * vertex_stride_, nullptr,
+               GL_STREAM_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_capacity_ * sizeof(GLushort),
+               nullptr, GL_STREAM_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  vertex_start_ = 0;
+  vertex_uploaded_ = 0;
+  index_start_ = 0;
+  index_uploaded_ = 0;
+}
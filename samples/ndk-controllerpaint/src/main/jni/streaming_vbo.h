@@ -0,0 +1,106 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CONTROLLER_PAINT_APP_SRC_MAIN_JNI_STREAMING_VBO_H_  // NOLINT
+#define CONTROLLER_PAINT_APP_SRC_MAIN_JNI_STREAMING_VBO_H_
+
+#include <GLES2/gl2.h>
+
+#include <vector>
+
+// A persistent vertex buffer and index buffer used as rings for indexed
+// geometry that grows a few vertices at a time, such as the brush stroke
+// currently being painted.
+//
+// The geometry is kept in CPU memory by the caller and is exposed to the GPU
+// as a "range": a run of consecutive vertices and a run of consecutive
+// 16-bit indices in the buffers. Each call to Sync() only uploads the
+// vertices and indices appended since the previous call, so data that was
+// already sent is never copied again. Ranges are written one after the other
+// and never overwritten in place; when a buffer is full both are orphaned
+// (re-specified with glBufferData) so the driver can hand out fresh storage
+// without waiting for draws still reading the old one.
+class StreamingVbo {
+ public:
+  StreamingVbo();
+
+  // Creates the GL buffers with room for |vertex_capacity| vertices of
+  // |vertex_stride| bytes each and |index_capacity| indices, deleting the
+  // previous ones if any. Must be called on the rendering thread, and again
+  // after the GL context is recreated, once the buffers that died with the
+  // old context were abandoned.
+  void Initialize(int vertex_capacity, int vertex_stride, int index_capacity);
+
+  // Deletes the GL buffers. Must be called on the rendering thread with the
+  // context that created the buffers still current.
+  void Destroy();
+
+  // Forgets the GL buffers without deleting them, for when they died with
+  // the GL context.
+  void Abandon();
+
+  // Starts a new, empty range after the current one. Call this whenever the
+  // CPU-side geometry is cleared and will be rebuilt from scratch.
+  void StartRange();
+
+  // Makes the current range match the first |vertex_count| vertices at
+  // |vertices| and the first |index_count| indices at |indices|, uploading
+  // only what was not uploaded before. Indices are relative to the first
+  // vertex of the range and are rebased as they are uploaded. The data must
+  // start with what previous calls for this range were given, and the counts
+  // must not exceed the capacities.
+  void Sync(const void* vertices, int vertex_count, const GLushort* indices,
+            int index_count);
+
+  // The GL buffers to bind when drawing the current range.
+  GLuint vbo() const { return vbo_; }
+  GLuint ibo() const { return ibo_; }
+
+  // Offset of the first index of the current range within ibo(), and the
+  // number of its indices that are on the GPU.
+  int first_index() const { return index_start_; }
+  int index_count() const { return index_uploaded_; }
+
+  // Total number of bytes uploaded since Initialize(), for instrumentation.
+  long uploaded_bytes() const { return uploaded_bytes_; }
+
+ private:
+  // Re-specifies the buffer storage and moves the current range to its start.
+  void Orphan();
+
+  GLuint vbo_;
+  GLuint ibo_;
+  int vertex_capacity_;
+  int vertex_stride_;
+  int index_capacity_;
+
+  // First vertex and first index of the current range, and how many of its
+  // vertices and indices have been uploaded so far.
+  int vertex_start_;
+  int vertex_uploaded_;
+  int index_start_;
+  int index_uploaded_;
+
+  long uploaded_bytes_;
+
+  // Scratch space for rebasing indices before they are uploaded.
+  std::vector<GLushort> rebased_indices_;
+
+  StreamingVbo(const StreamingVbo& other) = delete;
+  StreamingVbo& operator=(const StreamingVbo& other) = delete;
+};
+
+#endif  // CONTROLLER_PAINT_APP_SRC_MAIN_JNI_STREAMING_VBO_H_  // NOLINT
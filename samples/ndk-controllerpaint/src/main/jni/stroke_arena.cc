@@ -0,0 +1,191 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stroke_arena.h"  // NOLINT
+
+#include "utils.h"  // NOLINT
+
+PageAllocator::PageAllocator(int vertex_capacity, int index_capacity)
+    : vertex_capacity_(vertex_capacity), index_capacity_(index_capacity) {
+  CHECK(vertex_capacity_ > 0 && index_capacity_ > 0);
+}
+
+PageAllocator::Allocation PageAllocator::Allocate(int vertex_count,
+                                                  int index_count) {
+  CHECK(vertex_count > 0 && vertex_count <= vertex_capacity_);
+  CHECK(index_count >= 0 && index_count <= index_capacity_);
+  if (pages_.empty() ||
+      pages_.back().vertices_used + vertex_count > vertex_capacity_ ||
+      pages_.back().indices_used + index_count > index_capacity_) {
+    Page page;
+    page.vertices_used = 0;
+    page.indices_used = 0;
+    pages_.push_back(page);
+  }
+  Allocation result;
+  result.page = page_count() - 1;
+  result.first_vertex = pages_.back().vertices_used;
+  result.first_index = pages_.back().indices_used;
+  pages_.back().vertices_used += vertex_count;
+  pages_.back().indices_used += index_count;
+  return result;
+}
+
+void PageAllocator::Clear() {
+  pages_.clear();
+}
+
+StrokeArena::StrokeArena(int color_count, int page_capacity,
+                         int vertex_stride)
+    : vertex_stride_(vertex_stride),
+      colors_(color_count, ColorPages(page_capacity)),
+      allocated_vertex_count_(0) {
+  CHECK(page_capacity <= 65536);
+}
+
+int StrokeArena::AddChunk(int owner, int color, const void* vertices,
+                          int vertex_count, const GLushort* indices,
+                          int index_count) {
+  ColorPages& pages = colors_[color];
+  const PageAllocator::Allocation alloc =
+      pages.allocator.Allocate(vertex_count, index_count);
+  if (alloc.page == static_cast<int>(pages.vbos.size())) {
+    // The allocator opened a new page; create its storage up front so chunks
+    // can be appended with glBufferSubData.
+    GLuint buffers[2];
+    glGenBuffers(2, buffers);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+    glBufferData(GL_ARRAY_BUFFER,
+                 pages.allocator.vertex_capacity() * vertex_stride_, nullptr,
+                 GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 pages.allocator.index_capacity() * sizeof(GLushort), nullptr,
+                 GL_DYNAMIC_DRAW);
+    pages.vbos.push_back(buffers[0]);
+    pages.ibos.push_back(buffers[1]);
+    pages.live_vertices.push_back(0);
+    allocated_vertex_count_ += pages.allocator.vertex_capacity();
+    // The previous page is full now, and may have nothing left in it.
+    const int previous = alloc.page - 1;
+    if (previous >= 0 && pages.vbos[previous] &&
+        pages.live_vertices[previous] == 0) {
+      DeletePage(&pages, previous);
+    }
+  } else {
+    glBindBuffer(GL_ARRAY_BUFFER, pages.vbos[alloc.page]);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pages.ibos[alloc.page]);
+  }
+  glBufferSubData(GL_ARRAY_BUFFER, alloc.first_vertex * vertex_stride_,
+                  vertex_count * vertex_stride_, vertices);
+
+  rebased_indices_.resize(index_count);
+  for (int i = 0; i < index_count; ++i) {
+    rebased_indices_[i] =
+        static_cast<GLushort>(indices[i] + alloc.first_vertex);
+  }
+  glBufferSubData(GL_ELEMENT_ARRAY_BUFFER,
+                  alloc.first_index * sizeof(GLushort),
+                  index_count * sizeof(GLushort), rebased_indices_.data());
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+  pages.live_vertices[alloc.page] += vertex_count;
+
+  Chunk chunk;
+  chunk.owner = owner;
+  chunk.color = color;
+  chunk.page = alloc.page;
+  chunk.first_vertex = alloc.first_vertex;
+  chunk.vertex_count = vertex_count;
+  chunk.first_index = alloc.first_index;
+  chunk.index_count = index_count;
+  chunk.released = false;
+  chunks_.push_back(chunk);
+  return static_cast<int>(chunks_.size()) - 1;
+}
+
+void StrokeArena::ReleaseChunk(int chunk) {
+  Chunk& released = chunks_[chunk];
+  CHECK(!released.released);
+  released.released = true;
+  ColorPages& pages = colors_[released.color];
+  pages.live_vertices[released.page] -= released.vertex_count;
+  if (pages.live_vertices[released.page] == 0 &&
+      IsFull(pages, released.page)) {
+    DeletePage(&pages, released.page);
+  }
+}
+
+void StrokeArena::TakeDeletedVbos(std::vector<GLuint>* vbos) {
+  vbos->insert(vbos->end(), deleted_vbos_.begin(), deleted_vbos_.end());
+  deleted_vbos_.clear();
+}
+
+int StrokeArena::FindSparsePage(int color) const {
+  const ColorPages& pages = colors_[color];
+  for (int page = 0; page < pages.allocator.page_count(); ++page) {
+    if (pages.vbos[page] && IsFull(pages, page) &&
+        2 * pages.live_vertices[page] < pages.allocator.vertices_used(page)) {
+      return page;
+    }
+  }
+  return -1;
+}
+
+void StrokeArena::GetPageChunks(int color, int page,
+                                std::vector<int>* chunks) const {
+  for (size_t i = 0; i < chunks_.size(); ++i) {
+    const Chunk& chunk = chunks_[i];
+    if (chunk.color == color && chunk.page == page && !chunk.released) {
+      chunks->push_back(static_cast<int>(i));
+    }
+  }
+}
+
+void StrokeArena::DeletePage(ColorPages* pages, int page) {
+  deleted_vbos_.push_back(pages->vbos[page]);
+  glDeleteBuffers(1, &pages->vbos[page]);
+  glDeleteBuffers(1, &pages->ibos[page]);
+  pages->vbos[page] = 0;
+  pages->ibos[page] = 0;
+  allocated_vertex_count_ -= pages->allocator.vertex_capacity();
+}
+
+void StrokeArena::Clear() {
+  // Deleted pages have the name 0, which glDeleteBuffers() ignores.
+  for (ColorPages& pages : colors_) {
+    if (!pages.vbos.empty()) {
+      glDeleteBuffers(static_cast<GLsizei>(pages.vbos.size()),
+                      pages.vbos.data());
+      glDeleteBuffers(static_cast<GLsizei>(pages.ibos.size()),
+                      pages.ibos.data());
+    }
+  }
+  Abandon();
+}
+
+void StrokeArena::Abandon() {
+  for (ColorPages& pages : colors_) {
+    pages.vbos.clear();
+    pages.ibos.clear();
+    pages.live_vertices.clear();
+    pages.allocator.Clear();
+  }
+  chunks_.clear();
+  allocated_vertex_count_ = 0;
+  deleted_vbos_.clear();
+}
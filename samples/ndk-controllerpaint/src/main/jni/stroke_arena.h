@@ -0,0 +1,184 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CONTROLLER_PAINT_APP_SRC_MAIN_JNI_STROKE_ARENA_H_  // NOLINT
+#define CONTROLLER_PAINT_APP_SRC_MAIN_JNI_STROKE_ARENA_H_
+
+#include <GLES2/gl2.h>
+
+#include <vector>
+
+// Bump allocator that hands out runs of vertices and indices from fixed-size
+// pages. Allocations are packed back to back, so the used part of every page
+// is one contiguous run of indices that can be drawn with a single call. This
+// class only does the bookkeeping and never touches GL.
+class PageAllocator {
+ public:
+  struct Allocation {
+    int page;
+    int first_vertex;
+    int first_index;
+  };
+
+  // |vertex_capacity| and |index_capacity| are the number of vertices and
+  // indices per page.
+  PageAllocator(int vertex_capacity, int index_capacity);
+
+  // Reserves |vertex_count| consecutive vertices and |index_count|
+  // consecutive indices in the same page, opening a new page if the last one
+  // does not have enough room left for either. The counts must not exceed the
+  // page capacities.
+  Allocation Allocate(int vertex_count, int index_count);
+
+  // Forgets all pages and allocations.
+  void Clear();
+
+  int vertex_capacity() const { return vertex_capacity_; }
+  int index_capacity() const { return index_capacity_; }
+  int page_count() const { return static_cast<int>(pages_.size()); }
+
+  // Number of vertices and indices allocated from the given page.
+  int vertices_used(int page) const { return pages_[page].vertices_used; }
+  int indices_used(int page) const { return pages_[page].indices_used; }
+
+ private:
+  struct Page {
+    int vertices_used;
+    int indices_used;
+  };
+
+  int vertex_capacity_;
+  int index_capacity_;
+  std::vector<Page> pages_;
+};
+
+// Storage for committed brush strokes. Stroke chunks are grouped by color and
+// copied into a few large vertex and index buffers ("pages") per color, so the
+// whole drawing can be rendered with one draw call per page instead of one per
+// chunk. Indices are 16-bit, so a page holds at most 65536 vertices.
+//
+// Chunks that are no longer needed are released. The space they took is not
+// reused, but a page is deleted once all its chunks are released, and the
+// caller can move the chunks that are left in a mostly released page
+// elsewhere (see FindSparsePage()) so that it gets deleted too.
+class StrokeArena {
+ public:
+  // A piece of a stroke that was committed with AddChunk().
+  struct Chunk {
+    // The id the caller gave the chunk.
+    int owner;
+    int color;
+    int page;
+    int first_vertex;
+    int vertex_count;
+    int first_index;
+    int index_count;
+    bool released;
+  };
+
+  // |color_count| is the number of distinct colors, |page_capacity| the
+  // number of vertices per page and |vertex_stride| the size of a vertex in
+  // bytes. Each page has room for three indices per vertex, which is enough
+  // for any triangle strip or list of quads sharing edges.
+  StrokeArena(int color_count, int page_capacity, int vertex_stride);
+
+  // Copies |vertex_count| vertices from |vertices| and |index_count| indices
+  // from |indices| into a page for |color| and returns the index of the new
+  // chunk in chunks(). Indices are relative to the first of the vertices.
+  // |owner| is kept with the chunk. Must be called on the rendering thread.
+  int AddChunk(int owner, int color, const void* vertices, int vertex_count,
+               const GLushort* indices, int index_count);
+
+  // Releases chunk |chunk|, which must not be drawn anymore. Deletes its
+  // page if that was the last chunk of a page that is full. Must be called
+  // on the rendering thread.
+  void ReleaseChunk(int chunk);
+
+  // Moves the names of the vertex buffers of the pages deleted since the
+  // last call to the end of |vbos|, so the caller can forget what refers to
+  // them: buffer names are recycled.
+  void TakeDeletedVbos(std::vector<GLuint>* vbos);
+
+  // Returns a page of |color| that is full and has less than half of its
+  // vertices in chunks that were not released, or -1. Moving these chunks to
+  // new ones, then releasing them, deletes the page.
+  int FindSparsePage(int color) const;
+
+  // Appends the chunks of |page| of |color| that were not released to
+  // |chunks|.
+  void GetPageChunks(int color, int page, std::vector<int>* chunks) const;
+
+  // Deletes all pages and chunks. Must be called on the rendering thread.
+  void Clear();
+
+  // Forgets all pages and chunks without deleting them, for when they died
+  // with the GL context.
+  void Abandon();
+
+  int color_count() const { return static_cast<int>(colors_.size()); }
+  // Number of pages ever opened for |color|, deleted ones included.
+  int page_count(int color) const {
+    return colors_[color].allocator.page_count();
+  }
+  // The buffers of a page, or 0 if it was deleted.
+  GLuint page_vbo(int color, int page) const {
+    return colors_[color].vbos[page];
+  }
+  GLuint page_ibo(int color, int page) const {
+    return colors_[color].ibos[page];
+  }
+  int page_index_count(int color, int page) const {
+    return colors_[color].allocator.indices_used(page);
+  }
+
+  const std::vector<Chunk>& chunks() const { return chunks_; }
+
+  // Number of vertices the pages that were not deleted have room for.
+  int allocated_vertex_count() const { return allocated_vertex_count_; }
+
+ private:
+  struct ColorPages {
+    explicit ColorPages(int page_capacity)
+        : allocator(page_capacity, 3 * page_capacity) {}
+    PageAllocator allocator;
+    std::vector<GLuint> vbos;
+    std::vector<GLuint> ibos;
+    // Vertices of each page in chunks that were not released.
+    std::vector<int> live_vertices;
+  };
+
+  // Whether no more chunks can be added to |page| of |pages|.
+  static bool IsFull(const ColorPages& pages, int page) {
+    return page + 1 < pages.allocator.page_count();
+  }
+
+  // Deletes |page| of |pages|.
+  void DeletePage(ColorPages* pages, int page);
+
+  int vertex_stride_;
+  std::vector<ColorPages> colors_;
+  std::vector<Chunk> chunks_;
+  int allocated_vertex_count_;
+  std::vector<GLuint> deleted_vbos_;
+
+  // Scratch space for rebasing indices before they are uploaded.
+  std::vector<GLushort> rebased_indices_;
+
+  StrokeArena(const StrokeArena& other) = delete;
+  StrokeArena& operator=(const StrokeArena& other) = delete;
+};
+
+#endif  // CONTROLLER_PAINT_APP_SRC_MAIN_JNI_STROKE_ARENA_H_  // NOLINT
@@ -0,0 +1,219 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stroke_builder.h"  // NOLINT
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+typedef std::array<float, 3> Vec3;
+
+// Spans are split in at most 2^kMaxSubdivisionDepth pieces.
+static const int kMaxSubdivisionDepth = 6;
+
+// Knot intervals are kept above this, so repeated samples don't divide by
+// zero.
+static const float kMinKnotInterval = 1e-4f;
+
+Vec3 Lerp(const Vec3& a, const Vec3& b, float u) {
+  return {a[0] + (b[0] - a[0]) * u, a[1] + (b[1] - a[1]) * u,
+          a[2] + (b[2] - a[2]) * u};
+}
+
+Vec3 Sub(const Vec3& a, const Vec3& b) {
+  return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+}
+
+float Dot(const Vec3& a, const Vec3& b) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+float Length(const Vec3& v) { return std::sqrt(Dot(v, v)); }
+
+// Returns |v| scaled to unit length, or |fallback| if |v| is too short to
+// have a direction.
+Vec3 Normalize(const Vec3& v, const Vec3& fallback) {
+  const float length = Length(v);
+  if (length < 1e-9f) return fallback;
+  return {v[0] / length, v[1] / length, v[2] / length};
+}
+
+// Returns |a| mirrored about |center|.
+Vec3 Reflect(const Vec3& a, const Vec3& center) {
+  return {2 * center[0] - a[0], 2 * center[1] - a[1], 2 * center[2] - a[2]};
+}
+
+float DistanceToSegment(const Vec3& p, const Vec3& a, const Vec3& b) {
+  const Vec3 ab = Sub(b, a);
+  const Vec3 ap = Sub(p, a);
+  const float length_sq = Dot(ab, ab);
+  float u = length_sq > 0.0f ? Dot(ap, ab) / length_sq : 0.0f;
+  u = std::min(1.0f, std::max(0.0f, u));
+  return Length(Sub(ap, {ab[0] * u, ab[1] * u, ab[2] * u}));
+}
+
+}  // namespace
+
+StrokeBuilder::StrokeBuilder(float tolerance, float max_segment_length,
+                             float max_turn)
+    : tolerance_(tolerance),
+      max_segment_length_(max_segment_length),
+      min_turn_cosine_(std::cos(max_turn)),
+      sample_count_(0),
+      has_anchor_(false) {}
+
+void StrokeBuilder::Begin(const std::array<float, 3>& sample) {
+  samples_[3] = sample;
+  sample_count_ = 1;
+  has_anchor_ = false;
+  pending_.clear();
+}
+
+void StrokeBuilder::AddSample(const std::array<float, 3>& sample,
+                              std::vector<StrokePoint>* points) {
+  if (sample_count_ == 0) {
+    Begin(sample);
+    return;
+  }
+  std::rotate(samples_.begin(), samples_.begin() + 1, samples_.end());
+  samples_[3] = sample;
+  ++sample_count_;
+  // The span ending at the previous sample is now known.
+  if (sample_count_ < 3) return;
+  controls_[0] =
+      sample_count_ == 3 ? Reflect(samples_[2], samples_[1]) : samples_[0];
+  controls_[1] = samples_[1];
+  controls_[2] = samples_[2];
+  controls_[3] = samples_[3];
+  AddSpan(points);
+}
+
+void StrokeBuilder::End(std::vector<StrokePoint>* points) {
+  if (sample_count_ >= 2) {
+    // The last span has no sample after it: mirror the one before it.
+    controls_[0] =
+        sample_count_ == 2 ? Reflect(samples_[3], samples_[2]) : samples_[1];
+    controls_[1] = samples_[2];
+    controls_[2] = samples_[3];
+    controls_[3] = Reflect(samples_[2], samples_[3]);
+    AddSpan(points);
+  }
+  if (!pending_.empty()) points->push_back(pending_.back());
+  pending_.clear();
+  sample_count_ = 0;
+  has_anchor_ = false;
+}
+
+void StrokeBuilder::GetProvisionalPoints(
+    std::vector<StrokePoint>* points) const {
+  if (sample_count_ < 2) return;
+  const Vec3 direction = Normalize(Sub(samples_[3], samples_[2]), {1, 0, 0});
+  if (!has_anchor_) {
+    points->push_back({samples_[2], direction});
+  }
+  points->insert(points->end(), pending_.begin(), pending_.end());
+  points->push_back({samples_[3], direction});
+}
+
+void StrokeBuilder::AddSpan(std::vector<StrokePoint>* points) {
+  // Centripetal parametrization: knots are spaced by the square root of the
+  // distance between the control points.
+  knots_[0] = 0.0f;
+  for (int i = 1; i < 4; ++i) {
+    const float interval =
+        std::sqrt(Length(Sub(controls_[i], controls_[i - 1])));
+    knots_[i] = knots_[i - 1] + std::max(interval, kMinKnotInterval);
+  }
+  const StrokePoint start = Evaluate(knots_[1]);
+  if (!has_anchor_) {
+    anchor_ = start;
+    has_anchor_ = true;
+    points->push_back(anchor_);
+  }
+  Subdivide(knots_[1], start, knots_[2], Evaluate(knots_[2]), 0, points);
+}
+
+void StrokeBuilder::Subdivide(float t0, const StrokePoint& p0, float t1,
+                              const StrokePoint& p1, int depth,
+                              std::vector<StrokePoint>* points) {
+  const float t = 0.5f * (t0 + t1);
+  const StrokePoint middle = Evaluate(t);
+  if (depth < kMaxSubdivisionDepth &&
+      (DistanceToSegment(middle.position, p0.position, p1.position) >
+           0.5f * tolerance_ ||
+       Dot(p0.tangent, p1.tangent) < min_turn_cosine_)) {
+    Subdivide(t0, p0, t, middle, depth + 1, points);
+    Subdivide(t, middle, t1, p1, depth + 1, points);
+  } else {
+    Merge(p1, points);
+  }
+}
+
+StrokePoint StrokeBuilder::Evaluate(float t) const {
+  // The tangent is taken from a tiny chord around |t|, clamped to the span.
+  const float h = 1e-3f * (knots_[2] - knots_[1]);
+  const Vec3 before = EvaluatePosition(std::max(knots_[1], t - h));
+  const Vec3 after = EvaluatePosition(std::min(knots_[2], t + h));
+  StrokePoint point;
+  point.position = EvaluatePosition(t);
+  point.tangent =
+      Normalize(Sub(after, before),
+                Normalize(Sub(controls_[2], controls_[1]), {1, 0, 0}));
+  return point;
+}
+
+StrokeBuilder::Vec3 StrokeBuilder::EvaluatePosition(float t) const {
+  // Barry and Goldman's pyramidal formulation of Catmull-Rom splines.
+  const std::array<float, 4>& k = knots_;
+  const Vec3 a1 = Lerp(controls_[0], controls_[1], (t - k[0]) / (k[1] - k[0]));
+  const Vec3 a2 = Lerp(controls_[1], controls_[2], (t - k[1]) / (k[2] - k[1]));
+  const Vec3 a3 = Lerp(controls_[2], controls_[3], (t - k[2]) / (k[3] - k[2]));
+  const Vec3 b1 = Lerp(a1, a2, (t - k[0]) / (k[2] - k[0]));
+  const Vec3 b2 = Lerp(a2, a3, (t - k[1]) / (k[3] - k[1]));
+  return Lerp(b1, b2, (t - k[1]) / (k[2] - k[1]));
+}
+
+void StrokeBuilder::Merge(const StrokePoint& point,
+                          std::vector<StrokePoint>* points) {
+  if (!CanMerge(point) && !pending_.empty()) {
+    // The last pending point is as far as a straight segment can go.
+    anchor_ = pending_.back();
+    points->push_back(anchor_);
+    pending_.clear();
+  }
+  if (CanMerge(point)) {
+    pending_.push_back(point);
+  } else {
+    anchor_ = point;
+    points->push_back(anchor_);
+  }
+}
+
+bool StrokeBuilder::CanMerge(const StrokePoint& point) const {
+  if (Length(Sub(point.position, anchor_.position)) > max_segment_length_) {
+    return false;
+  }
+  if (Dot(anchor_.tangent, point.tangent) < min_turn_cosine_) return false;
+  for (const StrokePoint& pending : pending_) {
+    if (DistanceToSegment(pending.position, anchor_.position,
+                          point.position) > 0.5f * tolerance_) {
+      return false;
+    }
+  }
+  return true;
+}
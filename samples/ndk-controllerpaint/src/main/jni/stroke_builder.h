@@ -0,0 +1,111 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CONTROLLER_PAINT_APP_SRC_MAIN_JNI_STROKE_BUILDER_H_  // NOLINT
+#define CONTROLLER_PAINT_APP_SRC_MAIN_JNI_STROKE_BUILDER_H_
+
+#include <array>
+#include <vector>
+
+// A point of the centreline of a brush stroke.
+struct StrokePoint {
+  std::array<float, 3> position;
+  // Unit direction of the stroke at |position|.
+  std::array<float, 3> tangent;
+};
+
+// Turns the cursor positions sampled while painting into the centreline of a
+// smooth brush stroke. A centripetal Catmull-Rom spline is fitted through
+// the samples, so it passes through all of them without overshooting when
+// they are unevenly spaced. Each span is subdivided where the spline bends,
+// until it is within half the tolerance of its chords and the direction
+// turns by at most the maximum angle between points. Consecutive points that
+// stay within the other half of the tolerance of a straight line are then
+// merged, up to the maximum segment length. Fast motions come out smooth,
+// and slow or straight motions take few points.
+//
+// A span is only final once the sample after it is known, so the points
+// lag one sample behind; GetProvisionalPoints() fills the gap up to the last
+// sample. This class never touches GL.
+class StrokeBuilder {
+ public:
+  // |tolerance| is the largest distance, in meters, between the spline and
+  // the centreline, |max_segment_length| the longest segment of the
+  // centreline, and |max_turn| the largest angle, in radians, by which its
+  // direction turns at a point.
+  StrokeBuilder(float tolerance, float max_segment_length, float max_turn);
+
+  // Starts a new stroke at |sample|.
+  void Begin(const std::array<float, 3>& sample);
+
+  // Adds a sample to the stroke and appends the points that became final to
+  // |points|. Samples must be apart from the previous one.
+  void AddSample(const std::array<float, 3>& sample,
+                 std::vector<StrokePoint>* points);
+
+  // Ends the stroke and appends its remaining points to |points|. A stroke
+  // with a single sample has no points.
+  void End(std::vector<StrokePoint>* points);
+
+  // Appends the points from the last final one, exclusive, to the last
+  // sample. They may change as more samples arrive.
+  void GetProvisionalPoints(std::vector<StrokePoint>* points) const;
+
+ private:
+  typedef std::array<float, 3> Vec3;
+
+  // Outputs the span of the spline from |controls_[1]| to |controls_[2]|.
+  void AddSpan(std::vector<StrokePoint>* points);
+
+  // Outputs the points of the spline between parameters |t0| and |t1|,
+  // excluding the point at |t0|, subdividing as needed.
+  void Subdivide(float t0, const StrokePoint& p0, float t1,
+                 const StrokePoint& p1, int depth,
+                 std::vector<StrokePoint>* points);
+
+  // Evaluates the current span at parameter |t|.
+  StrokePoint Evaluate(float t) const;
+  Vec3 EvaluatePosition(float t) const;
+
+  // Feeds a point of the subdivided spline to the merging stage, which
+  // outputs the points that cannot be merged anymore to |points|.
+  void Merge(const StrokePoint& point, std::vector<StrokePoint>* points);
+
+  // Returns whether the points in |pending_| and |point| can be replaced by
+  // a straight segment from |anchor_| to |point|.
+  bool CanMerge(const StrokePoint& point) const;
+
+  float tolerance_;
+  float max_segment_length_;
+  float min_turn_cosine_;
+
+  // The last four samples, oldest first, and how many samples the stroke
+  // has so far.
+  std::array<Vec3, 4> samples_;
+  int sample_count_;
+
+  // Control points of the span being evaluated, and their parameters.
+  std::array<Vec3, 4> controls_;
+  std::array<float, 4> knots_;
+
+  // The last point that was output, and the points after it that may still
+  // be merged away.
+  bool has_anchor_;
+  StrokePoint anchor_;
+  std::vector<StrokePoint> pending_;
+};
+
+#endif  // CONTROLLER_PAINT_APP_SRC_MAIN_JNI_STROKE_BUILDER_H_  // NOLINT
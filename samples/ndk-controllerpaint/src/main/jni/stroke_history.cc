@@ -0,0 +1,182 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stroke_history.h"  // NOLINT
+
+#include <algorithm>
+
+StrokeHistory::StrokeHistory(size_t memory_budget)
+    : memory_budget_(memory_budget),
+      applied_count_(0),
+      base_({0, 0, 0}),
+      open_stroke_(0),
+      stroke_open_(false),
+      released_prefix_(0),
+      retained_bytes_(0),
+      version_(0) {}
+
+void StrokeHistory::set_memory_budget(size_t memory_budget) {
+  memory_budget_ = memory_budget;
+  FitBudget();
+}
+
+void StrokeHistory::Reset(const std::vector<size_t>& chunk_bytes) {
+  commands_.clear();
+  applied_count_ = 0;
+  chunk_bytes_ = chunk_bytes;
+  base_.begin = 0;
+  base_.end = static_cast<int>(chunk_bytes_.size());
+  base_.bytes = 0;
+  for (size_t bytes : chunk_bytes_) base_.bytes += bytes;
+  stroke_open_ = false;
+  released_prefix_ = 0;
+  released_chunks_.clear();
+  retained_bytes_ = 0;
+  OnChanged();
+}
+
+void StrokeHistory::AddChunk(int id, int stroke, size_t bytes) {
+  chunk_bytes_.push_back(bytes);
+  if (!stroke_open_ || stroke != open_stroke_) {
+    DiscardRedo();
+    Command command;
+    command.clear = false;
+    command.first_chunk = id;
+    command.state = current_state();
+    commands_.push_back(command);
+    ++applied_count_;
+    retained_bytes_ += sizeof(Command);
+    open_stroke_ = stroke;
+    stroke_open_ = true;
+  }
+  Command& command = commands_.back();
+  command.end_chunk = id + 1;
+  command.state.end = id + 1;
+  command.state.bytes += bytes;
+  OnChanged();
+}
+
+bool StrokeHistory::Undo() {
+  if (applied_count_ == 0) return false;
+  const State& previous = current_state();
+  --applied_count_;
+  stroke_open_ = false;
+  ShowState(previous, current_state());
+  OnChanged();
+  return true;
+}
+
+bool StrokeHistory::Redo() {
+  if (applied_count_ == static_cast<int>(commands_.size())) return false;
+  const State& previous = current_state();
+  ++applied_count_;
+  stroke_open_ = false;
+  ShowState(previous, current_state());
+  OnChanged();
+  return true;
+}
+
+void StrokeHistory::Clear() {
+  const State& state = current_state();
+  bool empty = true;
+  for (int id = state.begin; id < state.end && empty; ++id) {
+    empty = chunk_bytes_[id] == 0;
+  }
+  if (empty) return;
+  DiscardRedo();
+  const int chunk_count = static_cast<int>(chunk_bytes_.size());
+  Command command;
+  command.clear = true;
+  command.first_chunk = command.end_chunk = chunk_count;
+  command.state.begin = command.state.end = chunk_count;
+  command.state.bytes = 0;
+  const size_t visible_bytes = current_state().bytes;
+  commands_.push_back(command);
+  ++applied_count_;
+  retained_bytes_ += sizeof(Command) + visible_bytes;
+  stroke_open_ = false;
+  OnChanged();
+}
+
+bool StrokeHistory::IsVisible(int id) const {
+  const State& state = current_state();
+  return id >= state.begin && id < state.end && chunk_bytes_[id] != 0;
+}
+
+void StrokeHistory::GetVisibleChunks(std::vector<int>* ids) const {
+  const State& state = current_state();
+  for (int id = state.begin; id < state.end; ++id) {
+    if (chunk_bytes_[id] != 0) ids->push_back(id);
+  }
+}
+
+void StrokeHistory::TakeReleasedChunks(std::vector<int>* ids) {
+  ids->insert(ids->end(), released_chunks_.begin(), released_chunks_.end());
+  released_chunks_.clear();
+}
+
+void StrokeHistory::ShowState(const State& previous, const State& state) {
+  retained_bytes_ += previous.bytes;
+  retained_bytes_ -= state.bytes;
+}
+
+void StrokeHistory::DiscardRedo() {
+  while (applied_count_ < static_cast<int>(commands_.size())) {
+    const Command& command = commands_.back();
+    Release(command.first_chunk, command.end_chunk);
+    commands_.pop_back();
+    retained_bytes_ -= sizeof(Command);
+  }
+}
+
+void StrokeHistory::Release(int first, int end) {
+  for (int id = first; id < end; ++id) {
+    if (chunk_bytes_[id] == 0) continue;
+    // Only hidden chunks are ever released.
+    retained_bytes_ -= chunk_bytes_[id];
+    chunk_bytes_[id] = 0;
+    released_chunks_.push_back(id);
+  }
+}
+
+void StrokeHistory::OnChanged() {
+  ++version_;
+  FitBudget();
+}
+
+void StrokeHistory::FitBudget() {
+  while (retained_bytes_ > memory_budget_ && !commands_.empty()) {
+    if (applied_count_ < static_cast<int>(commands_.size())) {
+      // Forget the newest command that could be redone, which releases its
+      // chunks. Forgetting an applied command only frees chunks when a clear
+      // hid them, so the undo steps are kept as long as possible.
+      const Command& command = commands_.back();
+      Release(command.first_chunk, command.end_chunk);
+      commands_.pop_back();
+      retained_bytes_ -= sizeof(Command);
+    } else {
+      // Forget the oldest command. Nothing can go back past it anymore, so
+      // the chunks a clear hid before it are gone for good.
+      base_ = commands_.front().state;
+      commands_.erase(commands_.begin());
+      --applied_count_;
+      retained_bytes_ -= sizeof(Command);
+      Release(released_prefix_, base_.begin);
+      released_prefix_ = std::max(released_prefix_, base_.begin);
+    }
+    if (commands_.empty()) stroke_open_ = false;
+  }
+}
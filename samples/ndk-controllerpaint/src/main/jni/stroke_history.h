@@ -0,0 +1,153 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CONTROLLER_PAINT_APP_SRC_MAIN_JNI_STROKE_HISTORY_H_  // NOLINT
+#define CONTROLLER_PAINT_APP_SRC_MAIN_JNI_STROKE_HISTORY_H_
+
+#include <stddef.h>
+
+#include <deque>
+#include <vector>
+
+// Undo and redo history of a drawing made of committed chunks, which are
+// identified by consecutive ids in the order they were committed.
+//
+// Chunks are never modified, so every state of the drawing shares them: a
+// state is just the range of ids that is visible, and undoing or redoing
+// only moves from one range to another. Chunks that are hidden are kept
+// around (on the GPU too) so they can come back. Once no state can show a
+// chunk anymore, it is released. The memory held by hidden chunks and by the
+// history itself is kept under a budget by forgetting the strokes that could
+// be redone first, since that frees their chunks, then the oldest history.
+// This class never touches GL.
+class StrokeHistory {
+ public:
+  // |memory_budget| is the number of bytes the history may hold on top of
+  // the visible drawing.
+  explicit StrokeHistory(size_t memory_budget);
+
+  // Changes the budget, forgetting history right away if it no longer fits.
+  void set_memory_budget(size_t memory_budget);
+  size_t memory_budget() const { return memory_budget_; }
+
+  // Forgets everything, then makes chunks 0, 1, ... the drawing, which
+  // cannot be undone. |chunk_bytes| are their sizes.
+  void Reset(const std::vector<size_t>& chunk_bytes);
+
+  // Records chunk |id|, of |bytes| bytes, as part of brush stroke number
+  // |stroke|. |id| must be the number of chunks recorded so far. The chunk
+  // extends the last stroke if it has the same number and was not undone,
+  // and starts a new one otherwise, which forgets the strokes that could be
+  // redone.
+  void AddChunk(int id, int stroke, size_t bytes);
+
+  // Hides the last visible stroke, or shows the drawing the last clear hid.
+  // Returns false if there is nothing to undo.
+  bool Undo();
+
+  // Redoes what the last Undo() undid. Returns false if there is nothing to
+  // redo.
+  bool Redo();
+
+  // Hides the whole drawing, in a way that can be undone.
+  void Clear();
+
+  // Whether chunk |id| is part of the current drawing.
+  bool IsVisible(int id) const;
+
+  // Appends the ids of the visible chunks to |ids|, in increasing order.
+  void GetVisibleChunks(std::vector<int>* ids) const;
+
+  // Moves the ids of the chunks that were released since the last call to
+  // the end of |ids|. They can never become visible again.
+  void TakeReleasedChunks(std::vector<int>* ids);
+
+  // Number of bytes held by the history on top of the visible drawing.
+  size_t retained_bytes() const { return retained_bytes_; }
+
+  // Number of steps that can be undone and redone.
+  int undo_count() const { return applied_count_; }
+  int redo_count() const {
+    return static_cast<int>(commands_.size()) - applied_count_;
+  }
+
+  // Incremented every time the visible chunks change.
+  int version() const { return version_; }
+
+ private:
+  // A state of the drawing: the chunks with ids in [begin, end) that were
+  // not released. Only hidden chunks are released, and no other state can
+  // show them, so |bytes| stays the size of these chunks.
+  struct State {
+    int begin;
+    int end;
+    size_t bytes;
+  };
+
+  // A brush stroke or a clear.
+  struct Command {
+    bool clear;
+    // The chunks of the stroke, or an empty range for a clear.
+    int first_chunk;
+    int end_chunk;
+    // The state of the drawing right after the command.
+    State state;
+  };
+
+  const State& current_state() const {
+    return applied_count_ > 0 ? commands_[applied_count_ - 1].state : base_;
+  }
+
+  // Makes |state| the current state in |retained_bytes_|, which counted the
+  // chunks of |previous| as visible.
+  void ShowState(const State& previous, const State& state);
+
+  // Forgets the commands that could be redone, and releases their chunks.
+  void DiscardRedo();
+
+  // Releases the chunks with ids in [first, end) that were not released.
+  void Release(int first, int end);
+
+  // Forgets history until |retained_bytes_| fits in the budget, after a
+  // change.
+  void OnChanged();
+
+  // Forgets history until |retained_bytes_| fits in the budget.
+  void FitBudget();
+
+  size_t memory_budget_;
+  std::deque<Command> commands_;
+  // Number of commands that are applied; the others can be redone.
+  int applied_count_;
+  // The state before the first command.
+  State base_;
+  // Number of the stroke the last command is, if chunks can still be added
+  // to it.
+  int open_stroke_;
+  bool stroke_open_;
+  // Size of each chunk, or 0 once it was released.
+  std::vector<size_t> chunk_bytes_;
+  // All chunks with ids below this were released.
+  int released_prefix_;
+  std::vector<int> released_chunks_;
+  size_t retained_bytes_;
+  int version_;
+
+  StrokeHistory(const StrokeHistory& other) = delete;
+  StrokeHistory& operator=(const StrokeHistory& other) = delete;
+};
+
+#endif  // CONTROLLER_PAINT_APP_SRC_MAIN_JNI_STROKE_HISTORY_H_  // NOLINT
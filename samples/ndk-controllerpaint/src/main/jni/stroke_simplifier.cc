@@ -0,0 +1,192 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stroke_simplifier.h"  // NOLINT
+
+#include <array>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+typedef std::array<float, 3> Point;
+
+// Returns the squared distance from |p| to the segment from |a| to |b|.
+static float SquaredDistanceToSegment(const Point& p, const Point& a,
+                                      const Point& b) {
+  float ab[3], ap[3];
+  float ab_length2 = 0.0f;
+  float dot = 0.0f;
+  for (int k = 0; k < 3; ++k) {
+    ab[k] = b[k] - a[k];
+    ap[k] = p[k] - a[k];
+    ab_length2 += ab[k] * ab[k];
+    dot += ab[k] * ap[k];
+  }
+  float t = ab_length2 > 0.0f ? dot / ab_length2 : 0.0f;
+  t = t < 0.0f ? 0.0f : t > 1.0f ? 1.0f : t;
+  float distance2 = 0.0f;
+  for (int k = 0; k < 3; ++k) {
+    const float d = ap[k] - t * ab[k];
+    distance2 += d * d;
+  }
+  return distance2;
+}
+
+}  // namespace
+
+bool SimplifyStroke(const StrokeChunk& chunk, float tolerance,
+                    StrokeChunk* simplified) {
+  const int point_count = static_cast<int>(chunk.vertices.size()) / 2;
+  if (point_count < 3) return false;
+  std::vector<Point> centreline(point_count);
+  for (int i = 0; i < point_count; ++i) {
+    const PaintVertex& top = chunk.vertices[2 * i];
+    const PaintVertex& bottom = chunk.vertices[2 * i + 1];
+    centreline[i] = {0.5f * (top.x + bottom.x), 0.5f * (top.y + bottom.y),
+                     0.5f * (top.z + bottom.z)};
+  }
+
+  // Douglas-Peucker: keep the point furthest from the line between the ends
+  // of a span if it is further than the tolerance, then do the same for the
+  // two halves.
+  std::vector<bool> keep(point_count, false);
+  keep[0] = keep[point_count - 1] = true;
+  int kept_count = 2;
+  const float tolerance2 = tolerance * tolerance;
+  std::vector<std::pair<int, int>> spans;
+  spans.push_back(std::make_pair(0, point_count - 1));
+  while (!spans.empty()) {
+    const std::pair<int, int> span = spans.back();
+    spans.pop_back();
+    float max_distance2 = tolerance2;
+    int furthest = -1;
+    for (int i = span.first + 1; i < span.second; ++i) {
+      const float distance2 = SquaredDistanceToSegment(
+          centreline[i], centreline[span.first], centreline[span.second]);
+      if (distance2 > max_distance2) {
+        max_distance2 = distance2;
+        furthest = i;
+      }
+    }
+    if (furthest >= 0) {
+      keep[furthest] = true;
+      ++kept_count;
+      spans.push_back(std::make_pair(span.first, furthest));
+      spans.push_back(std::make_pair(furthest, span.second));
+    }
+  }
+  if (kept_count == point_count) return false;
+
+  // Rebuild the strip from the surviving cross sections. The texture
+  // coordinates keep counting the original segments, so the texture keeps
+  // its density along the stroke.
+  simplified->stroke = chunk.stroke;
+  simplified->color = chunk.color;
+  simplified->vertices.clear();
+  simplified->indices.clear();
+  for (int i = 0; i < point_count; ++i) {
+    if (!keep[i]) continue;
+    if (!simplified->vertices.empty()) {
+      const GLushort start_index = simplified->vertices.size() - 2;
+      const GLushort indices[] = {
+          start_index, static_cast<GLushort>(start_index + 1),
+          static_cast<GLushort>(start_index + 2),
+          static_cast<GLushort>(start_index + 1),
+          static_cast<GLushort>(start_index + 3),
+          static_cast<GLushort>(start_index + 2),
+      };
+      simplified->indices.insert(
+          simplified->indices.end(), indices,
+          indices + sizeof(indices) / sizeof(indices[0]));
+    }
+    simplified->vertices.push_back(chunk.vertices[2 * i]);
+    simplified->vertices.push_back(chunk.vertices[2 * i + 1]);
+  }
+  return true;
+}
+
+StrokeSimplifier::StrokeSimplifier(const std::vector<float>& tolerances)
+    : tolerances_(tolerances),
+      stopping_(false),
+      thread_(&StrokeSimplifier::Run, this) {}
+
+StrokeSimplifier::~StrokeSimplifier() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  job_available_.notify_one();
+  thread_.join();
+}
+
+void StrokeSimplifier::Enqueue(int id, int color, const PaintVertex* vertices,
+                               int vertex_count, const GLushort* indices,
+                               int index_count) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.push_back(Job());
+    Job& job = jobs_.back();
+    job.id = id;
+    job.chunk.color = color;
+    job.chunk.vertices.assign(vertices, vertices + vertex_count);
+    job.chunk.indices.assign(indices, indices + index_count);
+  }
+  job_available_.notify_one();
+}
+
+void StrokeSimplifier::TakeResults(std::vector<SimplifiedChunk>* results) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (SimplifiedChunk& result : results_) {
+    results->push_back(std::move(result));
+  }
+  results_.clear();
+}
+
+void StrokeSimplifier::Run() {
+  std::vector<SimplifiedChunk> levels;
+  for (;;) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      job_available_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+      if (stopping_) return;
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+    }
+
+    // Each level is simplified from the full detail, which gives better
+    // results than simplifying the previous level again.
+    levels.clear();
+    size_t previous_vertex_count = job.chunk.vertices.size();
+    for (size_t i = 0; i < tolerances_.size(); ++i) {
+      SimplifiedChunk level;
+      if (!SimplifyStroke(job.chunk, tolerances_[i], &level.chunk) ||
+          level.chunk.vertices.size() >= previous_vertex_count) {
+        continue;
+      }
+      level.id = job.id;
+      level.level = static_cast<int>(i) + 1;
+      previous_vertex_count = level.chunk.vertices.size();
+      levels.push_back(std::move(level));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (SimplifiedChunk& level : levels) {
+      results_.push_back(std::move(level));
+    }
+  }
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CONTROLLER_PAINT_APP_SRC_MAIN_JNI_STROKE_SIMPLIFIER_H_  // NOLINT
+#define CONTROLLER_PAINT_APP_SRC_MAIN_JNI_STROKE_SIMPLIFIER_H_
+
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "paint_simulation.h"  // NOLINT
+
+// Simplifies |chunk| so that its centreline strays from the original by at
+// most |tolerance|, with Douglas-Peucker. The chunk must be a strip of
+// quads, as produced by PaintSimulation: vertices 2i and 2i + 1 are the two
+// sides of the stroke at point i of the centreline. The simplified strip
+// keeps the cross sections at the points that survive, including the first
+// and last ones, so it still joins the neighbouring chunks seamlessly.
+// Returns false, leaving |simplified| untouched, if no point can be removed.
+bool SimplifyStroke(const StrokeChunk& chunk, float tolerance,
+                    StrokeChunk* simplified);
+
+// A chunk simplified to some level of detail by StrokeSimplifier.
+struct SimplifiedChunk {
+  // The id the chunk was enqueued with.
+  int id;
+  // The level of detail, starting at 1.
+  int level;
+  StrokeChunk chunk;
+};
+
+// Runs SimplifyStroke() on a worker thread, producing coarser levels of
+// detail for committed stroke chunks off the rendering thread.
+class StrokeSimplifier {
+ public:
+  // |tolerances| are the tolerances of levels 1, 2, ... in increasing order.
+  // Starts the worker thread.
+  explicit StrokeSimplifier(const std::vector<float>& tolerances);
+
+  // Stops the worker thread, dropping any pending work.
+  ~StrokeSimplifier();
+
+  // Queues a copy of the chunk made of the given vertices and indices, in
+  // |color|, for simplification. Its levels of detail are reported with |id|.
+  void Enqueue(int id, int color, const PaintVertex* vertices,
+               int vertex_count, const GLushort* indices, int index_count);
+
+  // Moves the levels of detail produced since the last call to the end of
+  // |results|. A level is only produced if it has fewer vertices than the
+  // previous one, so levels may be missing.
+  void TakeResults(std::vector<SimplifiedChunk>* results);
+
+ private:
+  struct Job {
+    int id;
+    StrokeChunk chunk;
+  };
+
+  // Body of the worker thread.
+  void Run();
+
+  const std::vector<float> tolerances_;
+
+  // Everything below is guarded by |mutex_|.
+  std::mutex mutex_;
+  std::condition_variable job_available_;
+  std::deque<Job> jobs_;
+  std::vector<SimplifiedChunk> results_;
+  bool stopping_;
+
+  std::thread thread_;
+
+  StrokeSimplifier(const StrokeSimplifier& other) = delete;
+  StrokeSimplifier& operator=(const StrokeSimplifier& other) = delete;
+};
+
+#endif  // CONTROLLER_PAINT_APP_SRC_MAIN_JNI_STROKE_SIMPLIFIER_H_  // NOLINT
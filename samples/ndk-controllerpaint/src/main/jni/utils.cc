@@ -16,11 +16,13 @@
 
 #include "utils.h"  // NOLINT
 
+#include "simd_math.h"  // NOLINT
+
 void Utils::SetUpViewportAndScissor(const gvr::Sizei& framebuf_size,
                                     const gvr::BufferViewport& params) {
   const gvr::Rectf& rect = params.GetSourceUv();
   int left = static_cast<int>(rect.left * framebuf_size.width);
-  int bottom = static_cast<int>(rect.bottom * framebuf_size.width);
+  int bottom = static_cast<int>(rect.bottom * framebuf_size.height);
   int width = static_cast<int>((rect.right - rect.left) * framebuf_size.width);
   int height =
       static_cast<int>((rect.top - rect.bottom) * framebuf_size.height);
@@ -32,29 +34,14 @@ void Utils::SetUpViewportAndScissor(const gvr::Sizei& framebuf_size,
 }
 
 gvr::Mat4f Utils::MatrixMul(const gvr::Mat4f& m1, const gvr::Mat4f& m2) {
-  gvr::Mat4f result;
-  for (int i = 0; i < 4; ++i) {
-    for (int j = 0; j < 4; ++j) {
-      result.m[i][j] = 0.0f;
-      for (int k = 0; k < 4; ++k) {
-        result.m[i][j] += m1.m[i][k] * m2.m[k][j];
-      }
-    }
-  }
-  return result;
+  return simd_math::MatrixMul(m1, m2);
 }
 
 std::array<float, 3> Utils::MatrixVectorMul(const gvr::Mat4f& matrix,
                                             const std::array<float, 3>& vec) {
   // Use homogeneous coordinates for the multiplication.
-  std::array<float, 4> vec_h = {{ vec[0], vec[1], vec[2], 1.0f }};
-  std::array<float, 4> result;
-  for (int i = 0; i < 4; ++i) {
-    result[i] = 0;
-    for (int k = 0; k < 4; ++k) {
-      result[i] += matrix.m[i][k] * vec_h[k];
-    }
-  }
+  const simd_math::Vec4 result =
+      simd_math::MatrixVectorMul(matrix, {{ vec[0], vec[1], vec[2], 1.0f }});
   // Convert back from homogeneous coordinates.
   float rw = 1.0f / result[3];
   return {{ rw * result[0], rw * result[1], rw * result[2] }};
@@ -134,48 +121,12 @@ int Utils::BuildProgram(int vertex_shader, int frag_shader) {
 
 gvr::Mat4f Utils::PerspectiveMatrixFromView(const gvr::Rectf& fov,
                                             float near_clip, float far_clip) {
-  gvr::Mat4f result;
-  const float x_left = -tan(fov.left * M_PI / 180.0f) * near_clip;
-  const float x_right = tan(fov.right * M_PI / 180.0f) * near_clip;
-  const float y_bottom = -tan(fov.bottom * M_PI / 180.0f) * near_clip;
-  const float y_top = tan(fov.top * M_PI / 180.0f) * near_clip;
-  const float zero = 0.0f;
-
-  CHECK(x_left < x_right && y_bottom < y_top && near_clip < far_clip &&
-         near_clip > zero && far_clip > zero);
-  const float X = (2 * near_clip) / (x_right - x_left);
-  const float Y = (2 * near_clip) / (y_top - y_bottom);
-  const float A = (x_right + x_left) / (x_right - x_left);
-  const float B = (y_top + y_bottom) / (y_top - y_bottom);
-  const float C = (near_clip + far_clip) / (near_clip - far_clip);
-  const float D = (2 * near_clip * far_clip) / (near_clip - far_clip);
-
-  for (int i = 0; i < 4; ++i) {
-    for (int j = 0; j < 4; ++j) {
-      result.m[i][j] = 0.0f;
-    }
-  }
-  result.m[0][0] = X;
-  result.m[0][2] = A;
-  result.m[1][1] = Y;
-  result.m[1][2] = B;
-  result.m[2][2] = C;
-  result.m[2][3] = D;
-  result.m[3][2] = -1;
-
-  return result;
+  CHECK(simd_math::IsValidFrustum(fov, near_clip, far_clip));
+  return simd_math::PerspectiveMatrixFromView(fov, near_clip, far_clip);
 }
 
 std::array<float, 16> Utils::MatrixToGLArray(const gvr::Mat4f& matrix) {
-  // Note that this performs a *tranpose* to a column-major matrix array, as
-  // expected by GL.
-  std::array<float, 16> result;
-  for (int i = 0; i < 4; ++i) {
-    for (int j = 0; j < 4; ++j) {
-      result[j * 4 + i] = matrix.m[i][j];
-    }
-  }
-  return result;
+  return simd_math::MatrixToGL(matrix);
 }
 
 int Utils::LoadRawTextureFromAsset(
@@ -206,37 +157,7 @@ int Utils::LoadRawTextureFromAsset(
 }
 
 gvr::Mat4f Utils::ControllerQuatToMatrix(const gvr::ControllerQuat& quat) {
-  gvr::Mat4f result;
-  const float x = quat.qx;
-  const float x2 = quat.qx * quat.qx;
-  const float y = quat.qy;
-  const float y2 = quat.qy * quat.qy;
-  const float z = quat.qz;
-  const float z2 = quat.qz * quat.qz;
-  const float w = quat.qw;
-  const float xy = quat.qx * quat.qy;
-  const float xz = quat.qx * quat.qz;
-  const float xw = quat.qx * quat.qw;
-  const float yz = quat.qy * quat.qz;
-  const float yw = quat.qy * quat.qw;
-  const float zw = quat.qz * quat.qw;
-
-  const float m11 = 1.0f - 2.0f * y2 - 2.0f * z2;
-  const float m12 = 2.0f * (xy - zw);
-  const float m13 = 2.0f * (xz + yw);
-  const float m21 = 2.0f * (xy + zw);
-  const float m22 = 1.0f - 2.0f * x2 - 2.0f * z2;
-  const float m23 = 2.0f * (yz - xw);
-  const float m31 = 2.0f * (xz - yw);
-  const float m32 = 2.0f * (yz + xw);
-  const float m33 = 1.0f - 2.0f * x2 - 2.0f * y2;
-
-  return {
-    m11,  m12,  m13,  0.0f,
-    m21,  m22,  m23,  0.0f,
-    m31,  m32,  m33,  0.0f,
-    0.0f, 0.0f, 0.0f, 1.0f
-  };
+  return simd_math::QuatToMatrix(quat);
 }
 
 std::array<float, 4> Utils::ColorFromHex(int hex) {
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDK_HOST_INCLUDE_ANDROID_ASSET_MANAGER_H_  // NOLINT
+#define NDK_HOST_INCLUDE_ANDROID_ASSET_MANAGER_H_
+
+#include <sys/types.h>
+
+// Host stand-in for <android/asset_manager.h>. Assets are read from a
+// directory (see host_runtime::NewAssetManager()).
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct AAssetManager;
+typedef struct AAssetManager AAssetManager;
+
+struct AAsset;
+typedef struct AAsset AAsset;
+
+enum {
+  AASSET_MODE_UNKNOWN = 0,
+  AASSET_MODE_RANDOM = 1,
+  AASSET_MODE_STREAMING = 2,
+  AASSET_MODE_BUFFER = 3
+};
+
+AAsset* AAssetManager_open(AAssetManager* mgr, const char* filename,
+                           int mode);
+const void* AAsset_getBuffer(AAsset* asset);
+off_t AAsset_getLength(AAsset* asset);
+void AAsset_close(AAsset* asset);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // NDK_HOST_INCLUDE_ANDROID_ASSET_MANAGER_H_  // NOLINT
@@ -0,0 +1,36 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDK_HOST_INCLUDE_ANDROID_ASSET_MANAGER_JNI_H_  // NOLINT
+#define NDK_HOST_INCLUDE_ANDROID_ASSET_MANAGER_JNI_H_
+
+#include <android/asset_manager.h>
+#include <jni.h>
+
+// Host stand-in for <android/asset_manager_jni.h>. The Java object is the
+// AAssetManager itself, as returned by host_runtime::NewAssetManager().
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+AAssetManager* AAssetManager_fromJava(JNIEnv* env, jobject asset_manager);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // NDK_HOST_INCLUDE_ANDROID_ASSET_MANAGER_JNI_H_  // NOLINT
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDK_HOST_INCLUDE_JNI_H_  // NOLINT
+#define NDK_HOST_INCLUDE_JNI_H_
+
+#include <stdint.h>
+
+// Host stand-in for the parts of <jni.h> the NDK samples use outside of
+// their JNI glue, which is not built on the host. There is no Java VM:
+// strings are plain C strings, made with NewHostString(), and object and
+// method lookups find nothing.
+
+typedef uint8_t jboolean;
+typedef int32_t jint;
+typedef int64_t jlong;
+typedef float jfloat;
+
+class _jobject {};
+class _jclass : public _jobject {};
+class _jstring : public _jobject {
+ public:
+  explicit _jstring(const char* utf) : utf_(utf) {}
+  const char* utf() const { return utf_; }
+
+ private:
+  const char* utf_;
+};
+
+typedef _jobject* jobject;
+typedef _jclass* jclass;
+typedef _jstring* jstring;
+
+struct _jmethodID;
+typedef _jmethodID* jmethodID;
+
+struct _JNIEnv {
+  jclass GetObjectClass(jobject object) { return nullptr; }
+  jmethodID GetMethodID(jclass clazz, const char* name, const char* sig) {
+    return nullptr;
+  }
+  jobject CallObjectMethod(jobject object, jmethodID method, ...) {
+    return nullptr;
+  }
+  void DeleteLocalRef(jobject object) {}
+  const char* GetStringUTFChars(jstring string, jboolean* is_copy) {
+    if (is_copy) *is_copy = 0;
+    return string->utf();
+  }
+  void ReleaseStringUTFChars(jstring string, const char* utf) {}
+};
+typedef _JNIEnv JNIEnv;
+
+#define JNIEXPORT __attribute__((visibility("default")))
+#define JNICALL
+
+#endif  // NDK_HOST_INCLUDE_JNI_H_  // NOLINT
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Stand-in for the Android log and asset manager libraries. Log messages go
+// to stderr, and assets are read from a directory.
+
+#include <android/asset_manager.h>
+#include <android/asset_manager_jni.h>
+#include <android/log.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "host_runtime_internal.h"  // NOLINT
+
+struct AAssetManager {
+  std::string directory;
+};
+
+struct AAsset {
+  std::vector<char> data;
+};
+
+namespace host_runtime {
+
+AAssetManager* NewAssetManager(const std::string& directory) {
+  AAssetManager* manager = new AAssetManager;
+  manager->directory = directory;
+  return manager;
+}
+
+}  // namespace host_runtime
+
+extern "C" {
+
+int __android_log_print(int prio, const char* tag, const char* fmt, ...) {
+  if (!host_runtime::internal::IsLogEnabled()) return 0;
+  static const char kPriorityLetters[] = "??VDIWEFS";
+  const char letter = prio >= 0 && prio < ANDROID_LOG_SILENT + 1
+                          ? kPriorityLetters[prio]
+                          : '?';
+  fprintf(stderr, "%c/%s: ", letter, tag);
+  va_list args;
+  va_start(args, fmt);
+  const int length = vfprintf(stderr, fmt, args);
+  va_end(args);
+  fputc('\n', stderr);
+  return length;
+}
+
+AAssetManager* AAssetManager_fromJava(JNIEnv* env, jobject asset_manager) {
+  return reinterpret_cast<AAssetManager*>(asset_manager);
+}
+
+AAsset* AAssetManager_open(AAssetManager* mgr, const char* filename,
+                           int mode) {
+  const std::string path = mgr->directory + "/" + filename;
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file) return nullptr;
+  AAsset* asset = new AAsset;
+  char buffer[4096];
+  size_t count;
+  while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    asset->data.insert(asset->data.end(), buffer, buffer + count);
+  }
+  fclose(file);
+  return asset;
+}
+
+const void* AAsset_getBuffer(AAsset* asset) { return asset->data.data(); }
+
+off_t AAsset_getLength(AAsset* asset) {
+  return static_cast<off_t>(asset->data.size());
+}
+
+void AAsset_close(AAsset* asset) { delete asset; }
+
+}  // extern "C"
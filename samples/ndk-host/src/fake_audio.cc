@@ -0,0 +1,95 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Stand-in for the parts of libgvr_audio the NDK samples use. It is a sink:
+// sounds are accepted and tracked, but never played.
+
+#include <mutex>  // NOLINT
+#include <set>
+#include <string>
+
+#include "vr/gvr/capi/include/gvr_audio.h"
+
+struct gvr_audio_context_ {
+  // Guards the members: sounds may be loaded on another thread than the one
+  // that plays them.
+  std::mutex mutex;
+  std::set<std::string> preloaded_files;
+  gvr_audio_source_id next_source_id;
+};
+
+namespace {
+
+gvr_audio_source_id CreateSource(gvr_audio_context* api,
+                                 const char* filename) {
+  std::lock_guard<std::mutex> lock(api->mutex);
+  // Like the real library, sounds can only be made of preloaded files.
+  if (api->preloaded_files.count(filename) == 0) {
+    return GVR_AUDIO_INVALID_SOURCE_ID;
+  }
+  return api->next_source_id++;
+}
+
+}  // namespace
+
+extern "C" {
+
+gvr_audio_context* gvr_audio_create(int32_t rendering_mode) {
+  gvr_audio_context* api = new gvr_audio_context;
+  api->next_source_id = 0;
+  return api;
+}
+
+void gvr_audio_destroy(gvr_audio_context** api) {
+  delete *api;
+  *api = nullptr;
+}
+
+void gvr_audio_pause(gvr_audio_context* api) {}
+
+void gvr_audio_resume(gvr_audio_context* api) {}
+
+void gvr_audio_update(gvr_audio_context* api) {}
+
+bool gvr_audio_preload_soundfile(gvr_audio_context* api,
+                                 const char* filename) {
+  std::lock_guard<std::mutex> lock(api->mutex);
+  api->preloaded_files.insert(filename);
+  return true;
+}
+
+gvr_audio_source_id gvr_audio_create_sound_object(gvr_audio_context* api,
+                                                  const char* filename) {
+  return CreateSource(api, filename);
+}
+
+gvr_audio_source_id gvr_audio_create_stereo_sound(gvr_audio_context* api,
+                                                  const char* filename) {
+  return CreateSource(api, filename);
+}
+
+void gvr_audio_play_sound(gvr_audio_context* api,
+                          gvr_audio_source_id source_id,
+                          bool looping_enabled) {}
+
+void gvr_audio_set_sound_object_position(gvr_audio_context* api,
+                                         gvr_audio_source_id sound_object_id,
+                                         float x, float y, float z) {}
+
+void gvr_audio_set_head_pose(gvr_audio_context* api,
+                             gvr_mat4f head_pose_matrix) {}
+
+}  // extern "C"
@@ -0,0 +1,188 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Stand-in for the controller API of libgvr, driven by the controller
+// script. See host_runtime.h.
+
+#include "host_runtime_internal.h"  // NOLINT
+#include "vr/gvr/capi/include/gvr_controller.h"
+
+struct gvr_controller_context_ {
+  bool paused;
+};
+
+struct gvr_controller_state_ {
+  host_runtime::ControllerScriptState current;
+  host_runtime::ControllerScriptState previous;
+  int64_t last_orientation_timestamp;
+  int64_t last_touch_timestamp;
+  // Updates happened since creation.
+  bool updated;
+};
+
+namespace {
+
+// The controller reports new readings at this period, like the real one
+// does at a few hundred hertz, however often it is polled.
+static const int64_t kSensorPeriodNanos = 5000000;
+
+bool IsPressed(const host_runtime::ControllerScriptState& state,
+               int32_t button) {
+  switch (button) {
+    case GVR_CONTROLLER_BUTTON_CLICK:
+      return state.click_button_pressed;
+    case GVR_CONTROLLER_BUTTON_APP:
+      return state.app_button_pressed;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+extern "C" {
+
+int32_t gvr_controller_get_default_options() {
+  return GVR_CONTROLLER_ENABLE_ORIENTATION | GVR_CONTROLLER_ENABLE_TOUCH;
+}
+
+gvr_controller_context* gvr_controller_create_and_init(int32_t options,
+                                                       gvr_context* context) {
+  gvr_controller_context* api = new gvr_controller_context;
+  api->paused = false;
+  return api;
+}
+
+void gvr_controller_destroy(gvr_controller_context** api) {
+  delete *api;
+  *api = nullptr;
+}
+
+void gvr_controller_pause(gvr_controller_context* api) { api->paused = true; }
+
+void gvr_controller_resume(gvr_controller_context* api) {
+  api->paused = false;
+}
+
+const char* gvr_controller_api_status_to_string(int32_t status) {
+  return status == GVR_CONTROLLER_API_OK ? "GVR_CONTROLLER_API_OK"
+                                         : "GVR_CONTROLLER_API_UNAVAILABLE";
+}
+
+const char* gvr_controller_connection_state_to_string(int32_t state) {
+  return state == GVR_CONTROLLER_CONNECTED ? "GVR_CONTROLLER_CONNECTED"
+                                           : "GVR_CONTROLLER_DISCONNECTED";
+}
+
+gvr_controller_state* gvr_controller_state_create() {
+  gvr_controller_state* state = new gvr_controller_state;
+  state->last_orientation_timestamp = 0;
+  state->last_touch_timestamp = 0;
+  state->updated = false;
+  return state;
+}
+
+void gvr_controller_state_destroy(gvr_controller_state** state) {
+  delete *state;
+  *state = nullptr;
+}
+
+void gvr_controller_state_update(gvr_controller_context* api,
+                                 int32_t controller_index,
+                                 gvr_controller_state* out_state) {
+  // Events are the changes since the previous update; a paused controller
+  // reports nothing new.
+  out_state->previous = out_state->current;
+  if (api->paused && out_state->updated) return;
+  const int64_t now = host_runtime::internal::NowNanos();
+  const int64_t reading_time = now - now % kSensorPeriodNanos;
+  out_state->current =
+      host_runtime::internal::EvaluateControllerScript(reading_time);
+  if (!out_state->updated) out_state->previous = out_state->current;
+  out_state->updated = true;
+  out_state->last_orientation_timestamp = reading_time;
+  if (out_state->current.is_touching) {
+    out_state->last_touch_timestamp = reading_time;
+  }
+}
+
+int32_t gvr_controller_state_get_api_status(
+    const gvr_controller_state* state) {
+  return GVR_CONTROLLER_API_OK;
+}
+
+int32_t gvr_controller_state_get_connection_state(
+    const gvr_controller_state* state) {
+  return state->updated ? GVR_CONTROLLER_CONNECTED
+                        : GVR_CONTROLLER_DISCONNECTED;
+}
+
+int32_t gvr_controller_state_get_battery_level(
+    const gvr_controller_state* state) {
+  return GVR_CONTROLLER_BATTERY_LEVEL_FULL;
+}
+
+bool gvr_controller_state_get_battery_charging(
+    const gvr_controller_state* state) {
+  return false;
+}
+
+gvr_quatf gvr_controller_state_get_orientation(
+    const gvr_controller_state* state) {
+  return state->current.orientation;
+}
+
+int64_t gvr_controller_state_get_last_orientation_timestamp(
+    const gvr_controller_state* state) {
+  return state->last_orientation_timestamp;
+}
+
+bool gvr_controller_state_is_touching(const gvr_controller_state* state) {
+  return state->current.is_touching;
+}
+
+gvr_vec2f gvr_controller_state_get_touch_pos(
+    const gvr_controller_state* state) {
+  return state->current.touch_pos;
+}
+
+bool gvr_controller_state_get_touch_down(const gvr_controller_state* state) {
+  return state->current.is_touching && !state->previous.is_touching;
+}
+
+bool gvr_controller_state_get_touch_up(const gvr_controller_state* state) {
+  return !state->current.is_touching && state->previous.is_touching;
+}
+
+int64_t gvr_controller_state_get_last_touch_timestamp(
+    const gvr_controller_state* state) {
+  return state->last_touch_timestamp;
+}
+
+
+bool gvr_controller_state_get_button_down(const gvr_controller_state* state,
+                                          int32_t button) {
+  return IsPressed(state->current, button) &&
+         !IsPressed(state->previous, button);
+}
+
+bool gvr_controller_state_get_button_up(const gvr_controller_state* state,
+                                        int32_t button) {
+  return !IsPressed(state->current, button) &&
+         IsPressed(state->previous, button);
+}
+
+}  // extern "C"
@@ -0,0 +1,529 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Stand-in for the GLES and EGL entry points the NDK samples use. Calls do
+// little more than count themselves: object names are handed out, shaders
+// always compile, and nothing is ever drawn. The buffer bindings, including
+// those of vertex array objects, and the contents of buffers are kept, so
+// tests can check what was uploaded and that draws only read buffers. Like
+// a real context, it must only be used from one thread at a time.
+
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "host_runtime_internal.h"  // NOLINT
+
+namespace {
+
+using host_runtime::internal::CountClientArrayDrawCall;
+using host_runtime::internal::CountDrawCall;
+using host_runtime::internal::CountGlCall;
+using host_runtime::internal::CountUploadedBytes;
+
+// Locations handed out by glGetAttribLocation and glGetUniformLocation, by
+// program then name. Each program numbers its attributes and its uniforms
+// from 0.
+struct ProgramLocations {
+  std::map<std::string, GLint> attribs;
+  std::map<std::string, GLint> uniforms;
+};
+
+// Vertex attributes tracked, which is more than the samples use.
+static const int kMaxVertexAttribs = 16;
+
+// The state of a vertex array object: the element array buffer binding,
+// the enabled attributes and the buffer each reads from, 0 for client
+// memory.
+struct VertexArray {
+  VertexArray() : element_buffer(0), enabled_attribs(0) {
+    memset(attrib_buffers, 0, sizeof(attrib_buffers));
+  }
+
+  GLuint element_buffer;
+  uint32_t enabled_attribs;
+  GLuint attrib_buffers[kMaxVertexAttribs];
+};
+
+struct GlState {
+  GlState() : next_name(1), array_buffer(0), vertex_array(0) {
+    vertex_arrays[0] = VertexArray();
+  }
+
+  // Names are shared by all object types, so they are never confused.
+  GLuint next_name;
+  std::map<GLuint, ProgramLocations> programs;
+  // The contents of every buffer that exists.
+  std::map<GLuint, std::vector<uint8_t>> buffers;
+  GLuint array_buffer;
+  // The bound vertex array object, 0 being the default one.
+  GLuint vertex_array;
+  std::map<GLuint, VertexArray> vertex_arrays;
+};
+
+GlState& GetGlState() {
+  static GlState* state = new GlState;
+  return *state;
+}
+
+void GenNames(GLsizei n, GLuint* names) {
+  for (GLsizei i = 0; i < n; ++i) names[i] = GetGlState().next_name++;
+}
+
+// Returns the contents of the buffer bound to |target|, or null.
+std::vector<uint8_t>* GetBoundBuffer(GLenum target) {
+  GlState& state = GetGlState();
+  const GLuint buffer =
+      target == GL_ARRAY_BUFFER
+          ? state.array_buffer
+          : state.vertex_arrays[state.vertex_array].element_buffer;
+  const auto found = state.buffers.find(buffer);
+  return found == state.buffers.end() ? nullptr : &found->second;
+}
+
+VertexArray& GetBoundVertexArray() {
+  GlState& state = GetGlState();
+  return state.vertex_arrays[state.vertex_array];
+}
+
+// Counts a draw call, and whether it reads client memory: an enabled
+// attribute with no buffer, or the indices of an indexed draw.
+void CountDraw(bool indexed) {
+  CountDrawCall();
+  const VertexArray& vertex_array = GetBoundVertexArray();
+  bool client_arrays = indexed && vertex_array.element_buffer == 0;
+  for (int i = 0; i < kMaxVertexAttribs; ++i) {
+    if ((vertex_array.enabled_attribs & (1u << i)) &&
+        vertex_array.attrib_buffers[i] == 0) {
+      client_arrays = true;
+    }
+  }
+  if (client_arrays) CountClientArrayDrawCall();
+}
+
+GLint GetLocation(std::map<std::string, GLint>* locations, const GLchar* name) {
+  const auto inserted = locations->insert(
+      std::make_pair(name, static_cast<GLint>(locations->size())));
+  return inserted.first->second;
+}
+
+// Bytes per pixel of the texture formats the samples upload.
+int BytesPerPixel(GLenum format) {
+  switch (format) {
+    case GL_RGBA:
+      return 4;
+    case GL_RGB:
+      return 3;
+    case GL_LUMINANCE_ALPHA:
+      return 2;
+    default:
+      return 1;
+  }
+}
+
+// The ES 3.0 entry points, which the samples load with eglGetProcAddress.
+void GL_APIENTRY GenVertexArrays(GLsizei n, GLuint* arrays) {
+  CountGlCall();
+  GenNames(n, arrays);
+  for (GLsizei i = 0; i < n; ++i) {
+    GetGlState().vertex_arrays[arrays[i]] = VertexArray();
+  }
+}
+
+void GL_APIENTRY BindVertexArray(GLuint array) {
+  CountGlCall();
+  GetGlState().vertex_array = array;
+}
+
+void GL_APIENTRY DeleteVertexArrays(GLsizei n, const GLuint* arrays) {
+  CountGlCall();
+  GlState& state = GetGlState();
+  for (GLsizei i = 0; i < n; ++i) {
+    if (arrays[i] == 0) continue;
+    state.vertex_arrays.erase(arrays[i]);
+    if (state.vertex_array == arrays[i]) state.vertex_array = 0;
+  }
+}
+
+void GL_APIENTRY VertexAttribDivisor(GLuint index, GLuint divisor) {
+  CountGlCall();
+}
+
+void GL_APIENTRY DrawArraysInstanced(GLenum mode, GLint first, GLsizei count,
+                                     GLsizei instances) {
+  CountGlCall();
+  CountDraw(false);
+}
+
+struct ProcEntry {
+  const char* name;
+  __eglMustCastToProperFunctionPointerType proc;
+};
+
+}  // namespace
+
+namespace host_runtime {
+
+std::vector<uint8_t> GetBufferContents(GLuint buffer) {
+  const std::map<GLuint, std::vector<uint8_t>>& buffers =
+      GetGlState().buffers;
+  const auto found = buffers.find(buffer);
+  return found == buffers.end() ? std::vector<uint8_t>() : found->second;
+}
+
+int GetLiveBufferCount() {
+  return static_cast<int>(GetGlState().buffers.size());
+}
+
+}  // namespace host_runtime
+
+extern "C" {
+
+__eglMustCastToProperFunctionPointerType eglGetProcAddress(
+    const char* procname) {
+  static const ProcEntry kProcs[] = {
+      {"glGenVertexArrays",
+       reinterpret_cast<__eglMustCastToProperFunctionPointerType>(
+           GenVertexArrays)},
+      {"glBindVertexArray",
+       reinterpret_cast<__eglMustCastToProperFunctionPointerType>(
+           BindVertexArray)},
+      {"glDeleteVertexArrays",
+       reinterpret_cast<__eglMustCastToProperFunctionPointerType>(
+           DeleteVertexArrays)},
+      {"glVertexAttribDivisor",
+       reinterpret_cast<__eglMustCastToProperFunctionPointerType>(
+           VertexAttribDivisor)},
+      {"glDrawArraysInstanced",
+       reinterpret_cast<__eglMustCastToProperFunctionPointerType>(
+           DrawArraysInstanced)},
+  };
+  // Like a real ES 2.0 context, ES 3.0 functions are only found in ES 3.0
+  // contexts. Timer queries are not supported.
+  if (!host_runtime::internal::GetViewerConfig().gl_es3) return nullptr;
+  for (const ProcEntry& entry : kProcs) {
+    if (strcmp(entry.name, procname) == 0) return entry.proc;
+  }
+  return nullptr;
+}
+
+const GLubyte* GL_APIENTRY glGetString(GLenum name) {
+  CountGlCall();
+  const host_runtime::ViewerConfig config =
+      host_runtime::internal::GetViewerConfig();
+  const char* result = "";
+  switch (name) {
+    case GL_VENDOR:
+    case GL_RENDERER:
+      result = "Host stand-in";
+      break;
+    case GL_VERSION:
+      result = config.gl_es3 ? "OpenGL ES 3.0 host stand-in"
+                             : "OpenGL ES 2.0 host stand-in";
+      break;
+    case GL_SHADING_LANGUAGE_VERSION:
+      result = config.gl_es3 ? "OpenGL ES GLSL ES 3.00"
+                             : "OpenGL ES GLSL ES 1.00";
+      break;
+    case GL_EXTENSIONS:
+      result = config.multiview ? "GL_OVR_multiview GL_OVR_multiview2" : "";
+      break;
+  }
+  return reinterpret_cast<const GLubyte*>(result);
+}
+
+GLenum GL_APIENTRY glGetError() {
+  CountGlCall();
+  return GL_NO_ERROR;
+}
+
+void GL_APIENTRY glGetIntegerv(GLenum pname, GLint* data) {
+  CountGlCall();
+  *data = 0;
+}
+
+void GL_APIENTRY glEnable(GLenum cap) { CountGlCall(); }
+
+void GL_APIENTRY glDisable(GLenum cap) { CountGlCall(); }
+
+void GL_APIENTRY glBlendFunc(GLenum sfactor, GLenum dfactor) {
+  CountGlCall();
+}
+
+void GL_APIENTRY glClear(GLbitfield mask) { CountGlCall(); }
+
+void GL_APIENTRY glClearColor(GLfloat red, GLfloat green, GLfloat blue,
+                              GLfloat alpha) {
+  CountGlCall();
+}
+
+void GL_APIENTRY glClearDepthf(GLfloat depth) { CountGlCall(); }
+
+void GL_APIENTRY glColorMask(GLboolean red, GLboolean green, GLboolean blue,
+                             GLboolean alpha) {
+  CountGlCall();
+}
+
+void GL_APIENTRY glDepthMask(GLboolean flag) { CountGlCall(); }
+
+void GL_APIENTRY glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+  CountGlCall();
+}
+
+void GL_APIENTRY glScissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+  CountGlCall();
+}
+
+GLuint GL_APIENTRY glCreateShader(GLenum type) {
+  CountGlCall();
+  GLuint shader;
+  GenNames(1, &shader);
+  return shader;
+}
+
+void GL_APIENTRY glShaderSource(GLuint shader, GLsizei count,
+                                const GLchar* const* string,
+                                const GLint* length) {
+  CountGlCall();
+}
+
+void GL_APIENTRY glCompileShader(GLuint shader) { CountGlCall(); }
+
+void GL_APIENTRY glGetShaderiv(GLuint shader, GLenum pname, GLint* params) {
+  CountGlCall();
+  *params = pname == GL_COMPILE_STATUS ? GL_TRUE : 0;
+}
+
+void GL_APIENTRY glGetShaderInfoLog(GLuint shader, GLsizei buf_size,
+                                    GLsizei* length, GLchar* info_log) {
+  CountGlCall();
+  if (length) *length = 0;
+  if (buf_size > 0) info_log[0] = '\0';
+}
+
+void GL_APIENTRY glDeleteShader(GLuint shader) { CountGlCall(); }
+
+GLuint GL_APIENTRY glCreateProgram() {
+  CountGlCall();
+  GLuint program;
+  GenNames(1, &program);
+  GetGlState().programs[program];
+  return program;
+}
+
+void GL_APIENTRY glAttachShader(GLuint program, GLuint shader) {
+  CountGlCall();
+}
+
+void GL_APIENTRY glLinkProgram(GLuint program) { CountGlCall(); }
+
+void GL_APIENTRY glGetProgramiv(GLuint program, GLenum pname, GLint* params) {
+  CountGlCall();
+  *params = pname == GL_LINK_STATUS ? GL_TRUE : 0;
+}
+
+void GL_APIENTRY glGetProgramInfoLog(GLuint program, GLsizei buf_size,
+                                     GLsizei* length, GLchar* info_log) {
+  CountGlCall();
+  if (length) *length = 0;
+  if (buf_size > 0) info_log[0] = '\0';
+}
+
+void GL_APIENTRY glDeleteProgram(GLuint program) {
+  CountGlCall();
+  GetGlState().programs.erase(program);
+}
+
+void GL_APIENTRY glUseProgram(GLuint program) { CountGlCall(); }
+
+GLint GL_APIENTRY glGetAttribLocation(GLuint program, const GLchar* name) {
+  CountGlCall();
+  return GetLocation(&GetGlState().programs[program].attribs, name);
+}
+
+GLint GL_APIENTRY glGetUniformLocation(GLuint program, const GLchar* name) {
+  CountGlCall();
+  return GetLocation(&GetGlState().programs[program].uniforms, name);
+}
+
+void GL_APIENTRY glUniform1i(GLint location, GLint v0) { CountGlCall(); }
+
+void GL_APIENTRY glUniform1f(GLint location, GLfloat v0) { CountGlCall(); }
+
+void GL_APIENTRY glUniform3fv(GLint location, GLsizei count,
+                              const GLfloat* value) {
+  CountGlCall();
+}
+
+void GL_APIENTRY glUniform4f(GLint location, GLfloat v0, GLfloat v1,
+                             GLfloat v2, GLfloat v3) {
+  CountGlCall();
+}
+
+void GL_APIENTRY glUniform4fv(GLint location, GLsizei count,
+                              const GLfloat* value) {
+  CountGlCall();
+}
+
+void GL_APIENTRY glUniformMatrix4fv(GLint location, GLsizei count,
+                                    GLboolean transpose,
+                                    const GLfloat* value) {
+  CountGlCall();
+}
+
+void GL_APIENTRY glGenBuffers(GLsizei n, GLuint* buffers) {
+  CountGlCall();
+  GenNames(n, buffers);
+  for (GLsizei i = 0; i < n; ++i) {
+    GetGlState().buffers[buffers[i]].clear();
+  }
+}
+
+void GL_APIENTRY glDeleteBuffers(GLsizei n, const GLuint* buffers) {
+  CountGlCall();
+  GlState& state = GetGlState();
+  for (GLsizei i = 0; i < n; ++i) {
+    // Deleting a bound buffer unbinds it, but only from the bound vertex
+    // array object.
+    if (buffers[i] == 0 || !state.buffers.erase(buffers[i])) continue;
+    if (state.array_buffer == buffers[i]) state.array_buffer = 0;
+    VertexArray& vertex_array = GetBoundVertexArray();
+    if (vertex_array.element_buffer == buffers[i]) {
+      vertex_array.element_buffer = 0;
+    }
+    for (GLuint& attrib_buffer : vertex_array.attrib_buffers) {
+      if (attrib_buffer == buffers[i]) attrib_buffer = 0;
+    }
+  }
+}
+
+void GL_APIENTRY glBindBuffer(GLenum target, GLuint buffer) {
+  CountGlCall();
+  GlState& state = GetGlState();
+  if (target == GL_ARRAY_BUFFER) {
+    state.array_buffer = buffer;
+  } else if (target == GL_ELEMENT_ARRAY_BUFFER) {
+    GetBoundVertexArray().element_buffer = buffer;
+  }
+}
+
+void GL_APIENTRY glBufferData(GLenum target, GLsizeiptr size,
+                              const void* data, GLenum usage) {
+  CountGlCall();
+  if (data) CountUploadedBytes(size);
+  std::vector<uint8_t>* buffer = GetBoundBuffer(target);
+  if (!buffer) return;
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  if (bytes) {
+    buffer->assign(bytes, bytes + size);
+  } else {
+    buffer->assign(size, 0);
+  }
+}
+
+void GL_APIENTRY glBufferSubData(GLenum target, GLintptr offset,
+                                 GLsizeiptr size, const void* data) {
+  CountGlCall();
+  CountUploadedBytes(size);
+  std::vector<uint8_t>* buffer = GetBoundBuffer(target);
+  // Like a real context, writing past the end of the buffer fails.
+  if (!buffer || offset + size > static_cast<GLintptr>(buffer->size())) {
+    return;
+  }
+  memcpy(buffer->data() + offset, data, size);
+}
+
+void GL_APIENTRY glEnableVertexAttribArray(GLuint index) {
+  CountGlCall();
+  if (index < kMaxVertexAttribs) {
+    GetBoundVertexArray().enabled_attribs |= 1u << index;
+  }
+}
+
+void GL_APIENTRY glDisableVertexAttribArray(GLuint index) {
+  CountGlCall();
+  if (index < kMaxVertexAttribs) {
+    GetBoundVertexArray().enabled_attribs &= ~(1u << index);
+  }
+}
+
+void GL_APIENTRY glVertexAttribPointer(GLuint index, GLint size, GLenum type,
+                                       GLboolean normalized, GLsizei stride,
+                                       const void* pointer) {
+  CountGlCall();
+  if (index < kMaxVertexAttribs) {
+    GetBoundVertexArray().attrib_buffers[index] =
+        GetGlState().array_buffer;
+  }
+}
+
+void GL_APIENTRY glVertexAttrib3f(GLuint index, GLfloat x, GLfloat y,
+                                  GLfloat z) {
+  CountGlCall();
+}
+
+void GL_APIENTRY glVertexAttrib4f(GLuint index, GLfloat x, GLfloat y,
+                                  GLfloat z, GLfloat w) {
+  CountGlCall();
+}
+
+void GL_APIENTRY glGenTextures(GLsizei n, GLuint* textures) {
+  CountGlCall();
+  GenNames(n, textures);
+}
+
+void GL_APIENTRY glDeleteTextures(GLsizei n, const GLuint* textures) {
+  CountGlCall();
+}
+
+void GL_APIENTRY glActiveTexture(GLenum texture) { CountGlCall(); }
+
+void GL_APIENTRY glBindTexture(GLenum target, GLuint texture) {
+  CountGlCall();
+}
+
+void GL_APIENTRY glTexParameteri(GLenum target, GLenum pname, GLint param) {
+  CountGlCall();
+}
+
+void GL_APIENTRY glTexImage2D(GLenum target, GLint level,
+                              GLint internalformat, GLsizei width,
+                              GLsizei height, GLint border, GLenum format,
+                              GLenum type, const void* pixels) {
+  CountGlCall();
+  if (pixels) {
+    CountUploadedBytes(static_cast<int64_t>(width) * height *
+                       BytesPerPixel(format));
+  }
+}
+
+void GL_APIENTRY glDrawArrays(GLenum mode, GLint first, GLsizei count) {
+  CountGlCall();
+  CountDraw(false);
+}
+
+void GL_APIENTRY glDrawElements(GLenum mode, GLsizei count, GLenum type,
+                                const void* indices) {
+  CountGlCall();
+  CountDraw(true);
+}
+
+}  // extern "C"
@@ -0,0 +1,405 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Stand-in for the parts of libgvr the NDK samples use: the context, buffer
+// viewports, swap chains and frames. See host_runtime.h.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "host_runtime_internal.h"  // NOLINT
+#include "vr/gvr/capi/include/gvr.h"
+
+struct gvr_properties_ {
+  float floor_height;
+};
+
+struct gvr_context_ {
+  host_runtime::ViewerConfig config;
+  gvr_properties_ properties;
+};
+
+struct gvr_buffer_viewport_ {
+  gvr_rectf source_uv;
+  gvr_rectf source_fov;
+  gvr_mat4f transform;
+  int32_t target_eye;
+  int32_t source_buffer_index;
+  int32_t source_layer;
+  int32_t reprojection;
+};
+
+struct gvr_buffer_viewport_list_ {
+  std::vector<gvr_buffer_viewport_> viewports;
+};
+
+struct gvr_buffer_spec_ {
+  gvr_sizei size;
+  int32_t samples;
+  int32_t multiview_layers;
+};
+
+struct gvr_frame_ {
+  gvr_swap_chain_* swap_chain;
+};
+
+struct gvr_swap_chain_ {
+  std::vector<gvr_buffer_spec_> buffers;
+  gvr_frame_ frame;
+  // Whether |frame| was acquired and not submitted yet.
+  bool frame_acquired;
+};
+
+namespace {
+
+gvr_mat4f Identity() {
+  gvr_mat4f result = {{{1.0f, 0.0f, 0.0f, 0.0f},
+                       {0.0f, 1.0f, 0.0f, 0.0f},
+                       {0.0f, 0.0f, 1.0f, 0.0f},
+                       {0.0f, 0.0f, 0.0f, 1.0f}}};
+  return result;
+}
+
+// Reports a call the real runtime would reject, and aborts: the samples are
+// expected never to make one.
+void Fail(const char* message) {
+  fprintf(stderr, "Host GVR runtime: %s\n", message);
+  abort();
+}
+
+// Returns the radius r such that r (1 + k1 r^2 + k2 r^4) is |distorted|,
+// which is unique for non-negative coefficients, by Newton's method.
+float UndistortRadius(float distorted, float k1, float k2) {
+  float r = distorted;
+  for (int i = 0; i < 8; ++i) {
+    const float r2 = r * r;
+    const float value = r * (1.0f + k1 * r2 + k2 * r2 * r2) - distorted;
+    const float slope = 1.0f + 3.0f * k1 * r2 + 5.0f * k2 * r2 * r2;
+    r -= value / slope;
+  }
+  return r;
+}
+
+}  // namespace
+
+extern "C" {
+
+gvr_context* gvr_create() {
+  gvr_context* gvr = new gvr_context;
+  gvr->config = host_runtime::internal::GetViewerConfig();
+  gvr->properties.floor_height = gvr->config.floor_height;
+  return gvr;
+}
+
+void gvr_destroy(gvr_context** gvr) {
+  delete *gvr;
+  *gvr = nullptr;
+}
+
+void gvr_initialize_gl(gvr_context* gvr) {}
+
+int32_t gvr_get_viewer_type(const gvr_context* gvr) {
+  return gvr->config.viewer_type;
+}
+
+bool gvr_is_feature_supported(const gvr_context* gvr, int32_t feature) {
+  return feature == GVR_FEATURE_MULTIVIEW && gvr->config.multiview;
+}
+
+void gvr_pause_tracking(gvr_context* gvr) {}
+
+void gvr_resume_tracking(gvr_context* gvr) {}
+
+void gvr_refresh_viewer_profile(gvr_context* gvr) {
+  gvr->config = host_runtime::internal::GetViewerConfig();
+}
+
+gvr_clock_time_point gvr_get_time_point_now() {
+  gvr_clock_time_point now;
+  now.monotonic_system_time_nanos = host_runtime::internal::NowNanos();
+  return now;
+}
+
+gvr_mat4f gvr_get_head_space_from_start_space_transform(
+    const gvr_context* gvr, const gvr_clock_time_point time) {
+  return host_runtime::internal::EvaluateHeadPoseScript(
+      time.monotonic_system_time_nanos);
+}
+
+gvr_mat4f gvr_get_eye_from_head_matrix(const gvr_context* gvr,
+                                       const int32_t eye) {
+  gvr_mat4f result = Identity();
+  const float half_ipd = gvr->config.interpupillary_distance / 2;
+  result.m[0][3] = eye == GVR_LEFT_EYE ? half_ipd : -half_ipd;
+  return result;
+}
+
+gvr_sizei gvr_get_maximum_effective_render_target_size(
+    const gvr_context* gvr) {
+  return gvr->config.render_target_size;
+}
+
+const gvr_properties* gvr_get_current_properties(gvr_context* gvr) {
+  return &gvr->properties;
+}
+
+int32_t gvr_properties_get(const gvr_properties* properties,
+                           int32_t property_key, gvr_value* value_out) {
+  if (property_key != GVR_PROPERTY_TRACKING_FLOOR_HEIGHT) {
+    return GVR_ERROR_NO_PROPERTY_AVAILABLE;
+  }
+  value_out->value_type = GVR_VALUE_TYPE_FLOAT;
+  value_out->flags = 0;
+  value_out->f = properties->floor_height;
+  return GVR_ERROR_NONE;
+}
+
+gvr_buffer_viewport* gvr_buffer_viewport_create(gvr_context* gvr) {
+  gvr_buffer_viewport* viewport = new gvr_buffer_viewport;
+  viewport->source_uv = {0.0f, 1.0f, 0.0f, 1.0f};
+  const float half_fov = gvr->config.half_fov_degrees;
+  viewport->source_fov = {half_fov, half_fov, half_fov, half_fov};
+  viewport->transform = Identity();
+  viewport->target_eye = GVR_LEFT_EYE;
+  viewport->source_buffer_index = 0;
+  viewport->source_layer = 0;
+  viewport->reprojection = GVR_REPROJECTION_FULL;
+  return viewport;
+}
+
+void gvr_buffer_viewport_destroy(gvr_buffer_viewport** viewport) {
+  delete *viewport;
+  *viewport = nullptr;
+}
+
+gvr_rectf gvr_buffer_viewport_get_source_uv(
+    const gvr_buffer_viewport* viewport) {
+  return viewport->source_uv;
+}
+
+void gvr_buffer_viewport_set_source_uv(gvr_buffer_viewport* viewport,
+                                       gvr_rectf uv) {
+  viewport->source_uv = uv;
+}
+
+gvr_rectf gvr_buffer_viewport_get_source_fov(
+    const gvr_buffer_viewport* viewport) {
+  return viewport->source_fov;
+}
+
+void gvr_buffer_viewport_set_source_fov(gvr_buffer_viewport* viewport,
+                                        gvr_rectf fov) {
+  viewport->source_fov = fov;
+}
+
+void gvr_buffer_viewport_set_transform(gvr_buffer_viewport* viewport,
+                                       gvr_mat4f transform) {
+  viewport->transform = transform;
+}
+
+void gvr_buffer_viewport_set_target_eye(gvr_buffer_viewport* viewport,
+                                        int32_t index) {
+  viewport->target_eye = index;
+}
+
+void gvr_buffer_viewport_set_source_buffer_index(
+    gvr_buffer_viewport* viewport, int32_t buffer_index) {
+  viewport->source_buffer_index = buffer_index;
+}
+
+void gvr_buffer_viewport_set_source_layer(gvr_buffer_viewport* viewport,
+                                          int32_t layer_index) {
+  viewport->source_layer = layer_index;
+}
+
+void gvr_buffer_viewport_set_reprojection(gvr_buffer_viewport* viewport,
+                                          int32_t reprojection) {
+  viewport->reprojection = reprojection;
+}
+
+gvr_buffer_viewport_list* gvr_buffer_viewport_list_create(
+    const gvr_context* gvr) {
+  return new gvr_buffer_viewport_list;
+}
+
+void gvr_buffer_viewport_list_destroy(
+    gvr_buffer_viewport_list** viewport_list) {
+  delete *viewport_list;
+  *viewport_list = nullptr;
+}
+
+void gvr_get_recommended_buffer_viewports(
+    const gvr_context* gvr, gvr_buffer_viewport_list* viewport_list) {
+  // One viewport per eye, side by side in buffer 0.
+  viewport_list->viewports.clear();
+  for (int eye = 0; eye < GVR_NUM_EYES; ++eye) {
+    gvr_buffer_viewport* viewport =
+        gvr_buffer_viewport_create(const_cast<gvr_context*>(gvr));
+    viewport->source_uv = eye == GVR_LEFT_EYE
+                              ? gvr_rectf{0.0f, 0.5f, 0.0f, 1.0f}
+                              : gvr_rectf{0.5f, 1.0f, 0.0f, 1.0f};
+    viewport->target_eye = eye;
+    viewport_list->viewports.push_back(*viewport);
+    gvr_buffer_viewport_destroy(&viewport);
+  }
+}
+
+void gvr_buffer_viewport_list_get_item(
+    const gvr_buffer_viewport_list* viewport_list, size_t index,
+    gvr_buffer_viewport* viewport) {
+  if (index >= viewport_list->viewports.size()) {
+    Fail("buffer viewport index out of range.");
+  }
+  *viewport = viewport_list->viewports[index];
+}
+
+void gvr_buffer_viewport_list_set_item(gvr_buffer_viewport_list* viewport_list,
+                                       size_t index,
+                                       const gvr_buffer_viewport* viewport) {
+  // Like the real runtime, an item may be appended at the end.
+  if (index > viewport_list->viewports.size()) {
+    Fail("buffer viewport index out of range.");
+  }
+  if (index == viewport_list->viewports.size()) {
+    viewport_list->viewports.push_back(*viewport);
+  } else {
+    viewport_list->viewports[index] = *viewport;
+  }
+}
+
+gvr_buffer_spec* gvr_buffer_spec_create(gvr_context* gvr) {
+  gvr_buffer_spec* spec = new gvr_buffer_spec;
+  spec->size = gvr->config.render_target_size;
+  spec->samples = 0;
+  spec->multiview_layers = 1;
+  return spec;
+}
+
+void gvr_buffer_spec_destroy(gvr_buffer_spec** spec) {
+  delete *spec;
+  *spec = nullptr;
+}
+
+void gvr_buffer_spec_set_size(gvr_buffer_spec* spec, gvr_sizei size) {
+  spec->size = size;
+}
+
+void gvr_buffer_spec_set_samples(gvr_buffer_spec* spec, int32_t num_samples) {
+  spec->samples = num_samples;
+}
+
+void gvr_buffer_spec_set_color_format(gvr_buffer_spec* spec,
+                                      int32_t color_format) {}
+
+void gvr_buffer_spec_set_depth_stencil_format(gvr_buffer_spec* spec,
+                                              int32_t depth_stencil_format) {}
+
+void gvr_buffer_spec_set_multiview_layers(gvr_buffer_spec* spec,
+                                          int32_t num_layers) {
+  spec->multiview_layers = num_layers;
+}
+
+gvr_swap_chain* gvr_swap_chain_create(gvr_context* gvr,
+                                      const gvr_buffer_spec** buffers,
+                                      int32_t count) {
+  gvr_swap_chain* swap_chain = new gvr_swap_chain;
+  for (int32_t i = 0; i < count; ++i) {
+    swap_chain->buffers.push_back(*buffers[i]);
+  }
+  swap_chain->frame.swap_chain = swap_chain;
+  swap_chain->frame_acquired = false;
+  return swap_chain;
+}
+
+void gvr_swap_chain_destroy(gvr_swap_chain** swap_chain) {
+  delete *swap_chain;
+  *swap_chain = nullptr;
+}
+
+void gvr_swap_chain_resize_buffer(gvr_swap_chain* swap_chain, int32_t index,
+                                  gvr_sizei size) {
+  if (index < 0 || index >= static_cast<int32_t>(swap_chain->buffers.size())) {
+    Fail("swap chain buffer index out of range.");
+  }
+  swap_chain->buffers[index].size = size;
+}
+
+gvr_frame* gvr_swap_chain_acquire_frame(gvr_swap_chain* swap_chain) {
+  // Frames come back as soon as they are submitted: there is no display to
+  // wait for.
+  if (swap_chain->frame_acquired) return nullptr;
+  swap_chain->frame_acquired = true;
+  return &swap_chain->frame;
+}
+
+void gvr_frame_bind_buffer(gvr_frame* frame, int32_t index) {
+  if (index < 0 ||
+      index >= static_cast<int32_t>(frame->swap_chain->buffers.size())) {
+    Fail("frame buffer index out of range.");
+  }
+  // The real runtime binds a framebuffer object.
+  host_runtime::internal::CountGlCall();
+}
+
+void gvr_frame_unbind(gvr_frame* frame) {
+  host_runtime::internal::CountGlCall();
+}
+
+void gvr_frame_submit(gvr_frame** frame, const gvr_buffer_viewport_list* list,
+                      gvr_mat4f head_space_from_start_space) {
+  for (const gvr_buffer_viewport_& viewport : list->viewports) {
+    if (viewport.source_buffer_index < 0 ||
+        viewport.source_buffer_index >=
+            static_cast<int32_t>((*frame)->swap_chain->buffers.size())) {
+      Fail("submitted viewport reads a buffer the frame does not have.");
+    }
+  }
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      if (!isfinite(head_space_from_start_space.m[i][j])) {
+        Fail("submitted head pose is not finite.");
+      }
+    }
+  }
+  (*frame)->swap_chain->frame_acquired = false;
+  *frame = nullptr;
+  host_runtime::internal::CountFrame();
+}
+
+void gvr_compute_distorted_point(const gvr_context* gvr, const int32_t eye,
+                                 const gvr_vec2f uv_in, gvr_vec2f uv_out[3]) {
+  const float k1 = gvr->config.distortion_coefficients[0];
+  const float k2 = gvr->config.distortion_coefficients[1];
+  const float x = 2.0f * uv_in.x - 1.0f;
+  const float y = 2.0f * uv_in.y - 1.0f;
+  const float r = sqrtf(x * x + y * y);
+  // The inverse distortion has a slope of 1 at the center. It is scaled so
+  // that the middle of each edge, at r = 1, samples the edge of the texture.
+  const float undistorted_ratio =
+      r > 0.0f ? UndistortRadius(r, k1, k2) / r : 1.0f;
+  const float scale = undistorted_ratio / UndistortRadius(1.0f, k1, k2);
+  static const float kChannelScales[3] = {0.99f, 1.0f, 1.01f};
+  for (int channel = 0; channel < 3; ++channel) {
+    const float channel_scale = scale * kChannelScales[channel];
+    uv_out[channel].x = 0.5f + 0.5f * x * channel_scale;
+    uv_out[channel].y = 0.5f + 0.5f * y * channel_scale;
+  }
+}
+
+}  // extern "C"
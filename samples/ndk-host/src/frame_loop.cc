@@ -0,0 +1,150 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "frame_loop.h"  // NOLINT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "host_runtime.h"  // NOLINT
+
+namespace host_runtime {
+namespace {
+
+static const char kUsage[] =
+    "Common flags:\n"
+    "  --frames=N         frames to measure (default 600)\n"
+    "  --warmup=N         frames to run before measuring (default 30)\n"
+    "  --fps=N            pace frames at N per second (default: unpaced)\n"
+    "  --es2              report an ES 2.0 context, without multiview\n"
+    "  --no_multiview     do not report multiview support\n"
+    "  --cardboard        simulate a Cardboard viewer\n"
+    "  --quiet            do not print the samples' log messages\n";
+
+}  // namespace
+
+FrameLoopReport RunFrameLoop(
+    const FrameLoopOptions& options,
+    const std::function<void(int frame)>& draw_frame) {
+  typedef std::chrono::steady_clock Clock;
+  std::vector<double> frame_ms;
+  frame_ms.reserve(options.frame_count);
+  const Clock::duration frame_interval =
+      options.frames_per_second > 0
+          ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<
+                double>(1.0 / options.frames_per_second))
+          : Clock::duration::zero();
+  Clock::time_point next_frame = Clock::now();
+  Stats start_stats = GetStats();
+  const int total = options.warmup_frame_count + options.frame_count;
+  for (int frame = 0; frame < total; ++frame) {
+    if (frame == options.warmup_frame_count) start_stats = GetStats();
+    if (options.frames_per_second > 0) {
+      std::this_thread::sleep_until(next_frame);
+      next_frame += frame_interval;
+    }
+    const Clock::time_point start = Clock::now();
+    draw_frame(frame);
+    const Clock::time_point end = Clock::now();
+    if (frame >= options.warmup_frame_count) {
+      frame_ms.push_back(
+          std::chrono::duration<double, std::milli>(end - start).count());
+    }
+  }
+  const Stats end_stats = GetStats();
+
+  FrameLoopReport report;
+  report.frame_count = static_cast<int>(frame_ms.size());
+  if (frame_ms.empty()) {
+    report.mean_ms = report.p50_ms = report.p99_ms = report.max_ms = 0.0;
+    report.gl_calls = report.draw_calls = report.uploaded_bytes = 0.0;
+    return report;
+  }
+  double sum = 0.0;
+  for (double ms : frame_ms) sum += ms;
+  report.mean_ms = sum / frame_ms.size();
+  std::sort(frame_ms.begin(), frame_ms.end());
+  report.p50_ms = frame_ms[frame_ms.size() / 2];
+  report.p99_ms = frame_ms[frame_ms.size() * 99 / 100];
+  report.max_ms = frame_ms.back();
+  const double count = static_cast<double>(frame_ms.size());
+  report.gl_calls = (end_stats.gl_calls - start_stats.gl_calls) / count;
+  report.draw_calls = (end_stats.draw_calls - start_stats.draw_calls) / count;
+  report.uploaded_bytes =
+      (end_stats.uploaded_bytes - start_stats.uploaded_bytes) / count;
+  return report;
+}
+
+void PrintReport(const char* name, const FrameLoopReport& report) {
+  printf("%s: frames=%d mean_ms=%.4f p50_ms=%.4f p99_ms=%.4f max_ms=%.4f "
+         "gl_calls=%.1f draw_calls=%.1f uploaded_bytes=%.0f\n",
+         name, report.frame_count, report.mean_ms, report.p50_ms,
+         report.p99_ms, report.max_ms, report.gl_calls, report.draw_calls,
+         report.uploaded_bytes);
+  fflush(stdout);
+}
+
+bool ParseFlag(const char* arg, const char* name, std::string* value) {
+  const size_t length = strlen(name);
+  if (strncmp(arg, "--", 2) != 0 || strncmp(arg + 2, name, length) != 0 ||
+      arg[2 + length] != '=') {
+    return false;
+  }
+  *value = arg + 3 + length;
+  return true;
+}
+
+bool ParseCommonFlags(
+    int argc, char** argv,
+    const std::function<bool(const char* arg)>& is_runner_flag,
+    FrameLoopOptions* options) {
+  ViewerConfig config = DefaultViewerConfig();
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    std::string value;
+    if (is_runner_flag(arg)) {
+      continue;
+    } else if (ParseFlag(arg, "frames", &value)) {
+      options->frame_count = atoi(value.c_str());
+    } else if (ParseFlag(arg, "warmup", &value)) {
+      options->warmup_frame_count = atoi(value.c_str());
+    } else if (ParseFlag(arg, "fps", &value)) {
+      options->frames_per_second = atoi(value.c_str());
+    } else if (strcmp(arg, "--es2") == 0) {
+      config.gl_es3 = false;
+      config.multiview = false;
+    } else if (strcmp(arg, "--no_multiview") == 0) {
+      config.multiview = false;
+    } else if (strcmp(arg, "--cardboard") == 0) {
+      config.viewer_type = GVR_VIEWER_TYPE_CARDBOARD;
+    } else if (strcmp(arg, "--quiet") == 0) {
+      SetLogEnabled(false);
+    } else {
+      fprintf(stderr, "Unknown flag %s.\n%s", arg, kUsage);
+      return false;
+    }
+  }
+  SetViewerConfig(config);
+  return true;
+}
+
+}  // namespace host_runtime
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDK_HOST_SRC_FRAME_LOOP_H_  // NOLINT
+#define NDK_HOST_SRC_FRAME_LOOP_H_
+
+#include <functional>
+#include <string>
+
+// Runs the frame loop of a sample on the host runtime and measures it.
+namespace host_runtime {
+
+struct FrameLoopOptions {
+  FrameLoopOptions()
+      : frame_count(600), warmup_frame_count(30), frames_per_second(0) {}
+
+  // Frames measured, after |warmup_frame_count| frames that are not.
+  int frame_count;
+  int warmup_frame_count;
+  // If positive, frames are started at this rate, as if paced by a display,
+  // so that the scripts advance as they would on a device. Otherwise they
+  // run back to back.
+  int frames_per_second;
+};
+
+// Timings of the measured frames, in milliseconds of wall time spent in the
+// frame function, and what they issued, per frame.
+struct FrameLoopReport {
+  int frame_count;
+  double mean_ms;
+  double p50_ms;
+  double p99_ms;
+  double max_ms;
+  double gl_calls;
+  double draw_calls;
+  double uploaded_bytes;
+};
+
+// Calls |draw_frame| with the index of each frame, and measures the frames
+// after the warm-up.
+FrameLoopReport RunFrameLoop(const FrameLoopOptions& options,
+                             const std::function<void(int frame)>& draw_frame);
+
+// Prints |report| to stdout on one line of key=value pairs, for scripts to
+// compare between runs.
+void PrintReport(const char* name, const FrameLoopReport& report);
+
+// If |arg| is "--<name>=<value>", sets |value| and returns true.
+bool ParseFlag(const char* arg, const char* name, std::string* value);
+
+// Parses the flags every runner takes into |options| and the runtime. Returns
+// false, after printing a message, on an unknown flag. Flags the runner
+// handled itself are skipped by passing |is_runner_flag|.
+bool ParseCommonFlags(
+    int argc, char** argv,
+    const std::function<bool(const char* arg)>& is_runner_flag,
+    FrameLoopOptions* options);
+
+}  // namespace host_runtime
+
+#endif  // NDK_HOST_SRC_FRAME_LOOP_H_  // NOLINT
@@ -0,0 +1,226 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "host_runtime.h"  // NOLINT
+
+#include <math.h>
+#include <time.h>
+
+#include <atomic>
+#include <mutex>  // NOLINT
+
+#include "host_runtime_internal.h"  // NOLINT
+
+namespace host_runtime {
+namespace {
+
+struct RuntimeState {
+  RuntimeState() : config(DefaultViewerConfig()), log_enabled(true) {}
+
+  // Guards the configuration and the scripts. Scripts are copied out before
+  // being called, so they may take their time.
+  std::mutex mutex;
+  ViewerConfig config;
+  HeadPoseScript head_pose_script;
+  ControllerScript controller_script;
+
+  std::atomic<int64_t> gl_calls{0};
+  std::atomic<int64_t> draw_calls{0};
+  std::atomic<int64_t> client_array_draw_calls{0};
+  std::atomic<int64_t> uploaded_bytes{0};
+  std::atomic<int64_t> frames{0};
+  std::atomic<bool> log_enabled;
+};
+
+RuntimeState& GetState() {
+  static RuntimeState* state = new RuntimeState;
+  return *state;
+}
+
+gvr_mat4f Identity() {
+  gvr_mat4f result = {{{1.0f, 0.0f, 0.0f, 0.0f},
+                       {0.0f, 1.0f, 0.0f, 0.0f},
+                       {0.0f, 0.0f, 1.0f, 0.0f},
+                       {0.0f, 0.0f, 0.0f, 1.0f}}};
+  return result;
+}
+
+// The controller at rest: pointing forward, with nothing pressed.
+ControllerScriptState RestingController() {
+  ControllerScriptState state;
+  state.orientation = {0.0f, 0.0f, 0.0f, 1.0f};
+  state.is_touching = false;
+  state.touch_pos = {0.5f, 0.5f};
+  state.click_button_pressed = false;
+  state.app_button_pressed = false;
+  return state;
+}
+
+double Seconds(int64_t time) { return time * 1e-9; }
+
+}  // namespace
+
+ViewerConfig DefaultViewerConfig() {
+  ViewerConfig config;
+  config.viewer_type = GVR_VIEWER_TYPE_DAYDREAM;
+  config.render_target_size = {2560, 1440};
+  config.multiview = true;
+  config.gl_es3 = true;
+  config.half_fov_degrees = 45.0f;
+  config.distortion_coefficients[0] = 0.385f;
+  config.distortion_coefficients[1] = 0.593f;
+  config.interpupillary_distance = 0.064f;
+  config.floor_height = -1.7f;
+  return config;
+}
+
+void SetViewerConfig(const ViewerConfig& config) {
+  RuntimeState& state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.config = config;
+}
+
+HeadPoseScript LookAroundScript(float amplitude, float period_seconds) {
+  return [amplitude, period_seconds](int64_t time) {
+    // The head view turns the world the opposite way the head turns.
+    const double yaw =
+        amplitude * sin(2.0 * M_PI * Seconds(time) / period_seconds);
+    const float c = static_cast<float>(cos(-yaw));
+    const float s = static_cast<float>(sin(-yaw));
+    gvr_mat4f result = Identity();
+    result.m[0][0] = c;
+    result.m[0][2] = s;
+    result.m[2][0] = -s;
+    result.m[2][2] = c;
+    return result;
+  };
+}
+
+ControllerScript PaintCirclesScript(float stroke_seconds, float gap_seconds) {
+  return [stroke_seconds, gap_seconds](int64_t time) {
+    const double seconds = Seconds(time);
+    // A circle every two seconds, about 17 degrees across.
+    const double angle = M_PI * seconds;
+    const double yaw = 0.3 * cos(angle);
+    const double pitch = 0.3 * sin(angle);
+    // Yaw about the vertical axis, then pitch about the horizontal one.
+    const float cy = static_cast<float>(cos(yaw / 2));
+    const float sy = static_cast<float>(sin(yaw / 2));
+    const float cp = static_cast<float>(cos(pitch / 2));
+    const float sp = static_cast<float>(sin(pitch / 2));
+    ControllerScriptState state = RestingController();
+    state.orientation = {cy * sp, sy * cp, -sy * sp, cy * cp};
+    const bool painting =
+        fmod(seconds, stroke_seconds + gap_seconds) < stroke_seconds;
+    state.is_touching = painting;
+    state.click_button_pressed = painting;
+    return state;
+  };
+}
+
+void SetHeadPoseScript(HeadPoseScript script) {
+  RuntimeState& state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.head_pose_script = std::move(script);
+}
+
+void SetControllerScript(ControllerScript script) {
+  RuntimeState& state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.controller_script = std::move(script);
+}
+
+Stats GetStats() {
+  RuntimeState& state = GetState();
+  Stats stats;
+  stats.gl_calls = state.gl_calls.load(std::memory_order_relaxed);
+  stats.draw_calls = state.draw_calls.load(std::memory_order_relaxed);
+  stats.client_array_draw_calls =
+      state.client_array_draw_calls.load(std::memory_order_relaxed);
+  stats.uploaded_bytes = state.uploaded_bytes.load(std::memory_order_relaxed);
+  stats.frames = state.frames.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void ResetStats() {
+  RuntimeState& state = GetState();
+  state.gl_calls = 0;
+  state.draw_calls = 0;
+  state.client_array_draw_calls = 0;
+  state.uploaded_bytes = 0;
+  state.frames = 0;
+}
+
+void SetLogEnabled(bool enabled) { GetState().log_enabled = enabled; }
+
+namespace internal {
+
+ViewerConfig GetViewerConfig() {
+  RuntimeState& state = GetState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  return state.config;
+}
+
+gvr_mat4f EvaluateHeadPoseScript(int64_t time) {
+  HeadPoseScript script;
+  {
+    RuntimeState& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    script = state.head_pose_script;
+  }
+  return script ? script(time) : Identity();
+}
+
+ControllerScriptState EvaluateControllerScript(int64_t time) {
+  ControllerScript script;
+  {
+    RuntimeState& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    script = state.controller_script;
+  }
+  return script ? script(time) : RestingController();
+}
+
+int64_t NowNanos() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+void CountGlCall() {
+  GetState().gl_calls.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CountDrawCall() {
+  GetState().draw_calls.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CountClientArrayDrawCall() {
+  GetState().client_array_draw_calls.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CountUploadedBytes(int64_t bytes) {
+  GetState().uploaded_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void CountFrame() {
+  GetState().frames.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool IsLogEnabled() { return GetState().log_enabled; }
+
+}  // namespace internal
+}  // namespace host_runtime
@@ -0,0 +1,154 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDK_HOST_SRC_HOST_RUNTIME_H_  // NOLINT
+#define NDK_HOST_SRC_HOST_RUNTIME_H_
+
+#include <GLES2/gl2.h>
+#include <android/asset_manager.h>
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "vr/gvr/capi/include/gvr_types.h"
+
+// A stand-in for the GVR runtime, and for the parts of Android and GL the NDK
+// samples use, so that their frame loops run on a Linux host.
+//
+// It implements the subset of the GVR, controller and audio C APIs the
+// samples call:
+// - The head pose comes from a HeadPoseScript, and the controller from a
+//   ControllerScript, both functions of time, so runs are reproducible.
+// - Swap chains and frames hold no images: binding and submitting them only
+//   counts frames.
+// - Audio is a sink: sounds are accepted and never played.
+// - GL calls do nothing but count themselves, hand out object names and
+//   keep the contents of buffers, for tests to look at. Nothing is
+//   rasterized, so timings measure the CPU side of the frame: simulation,
+//   culling, state changes and the calls themselves.
+//
+// Everything can be changed between frames. The functions here are
+// thread-safe, and so are the controller and clock functions the samples
+// call from their own threads.
+namespace host_runtime {
+
+// Returns the head-space-from-start-space transform (the head view) at a
+// time in nanoseconds on the monotonic clock.
+typedef std::function<gvr_mat4f(int64_t time)> HeadPoseScript;
+
+// What the controller reports at a given time.
+struct ControllerScriptState {
+  gvr_quatf orientation;
+  bool is_touching;
+  gvr_vec2f touch_pos;
+  bool click_button_pressed;
+  bool app_button_pressed;
+};
+
+// Returns the controller state at a time in nanoseconds on the monotonic
+// clock. Button and touch events are derived from the changes between the
+// states returned at successive updates.
+typedef std::function<ControllerScriptState(int64_t time)> ControllerScript;
+
+// The viewer being simulated.
+struct ViewerConfig {
+  // GVR_VIEWER_TYPE_CARDBOARD or GVR_VIEWER_TYPE_DAYDREAM.
+  int32_t viewer_type;
+  // What gvr_get_maximum_effective_render_target_size() returns.
+  gvr_sizei render_target_size;
+  // Whether GVR_FEATURE_MULTIVIEW is reported as supported.
+  bool multiview;
+  // Whether the GL context claims to be ES 3.0 (vertex array objects and
+  // instancing) rather than ES 2.0. Multiview requires it.
+  bool gl_es3;
+  // Half the field of view of each eye, in degrees.
+  float half_fov_degrees;
+  // Coefficients k1 and k2 of the radial distortion of the lenses, which
+  // map a distance r from the center of the render texture to the distance
+  // r (1 + k1 r^2 + k2 r^4) on the screen. A point of an eye's viewport on
+  // the screen is sampled from the render texture through the inverse
+  // mapping, scaled so that the middle of each edge of the viewport samples
+  // the edge of the texture; the corners of the texture are not seen. The
+  // red and blue channels are sampled 1% closer to and further from the
+  // center.
+  float distortion_coefficients[2];
+  // Distance between the eyes, in meters.
+  float interpupillary_distance;
+  // What GVR_PROPERTY_TRACKING_FLOOR_HEIGHT reports.
+  float floor_height;
+};
+
+// Returns a Daydream viewer with multiview and ES 3.0.
+ViewerConfig DefaultViewerConfig();
+
+// Changes the viewer. Takes effect for the objects created afterwards, and
+// for the existing ones when their viewer profile is refreshed; the GL
+// version is read by the samples when their context is created.
+void SetViewerConfig(const ViewerConfig& config);
+
+// Returns a head that keeps looking left and right, |amplitude| radians to
+// each side, |period_seconds| for a full turn.
+HeadPoseScript LookAroundScript(float amplitude, float period_seconds);
+
+// Returns a controller that sweeps circles in front of the user, pressing
+// the touchpad for |stroke_seconds| then letting go for |gap_seconds|, so
+// that the paint sample keeps painting strokes.
+ControllerScript PaintCirclesScript(float stroke_seconds, float gap_seconds);
+
+// Sets the scripts. By default the head and the controller stay still,
+// pointing forward.
+void SetHeadPoseScript(HeadPoseScript script);
+void SetControllerScript(ControllerScript script);
+
+// What was issued to the GL and GVR since the last ResetStats().
+struct Stats {
+  // GL calls of any kind, and draw calls.
+  int64_t gl_calls;
+  int64_t draw_calls;
+  // Draw calls that read vertex attributes or indices from client memory
+  // rather than from buffers.
+  int64_t client_array_draw_calls;
+  // Bytes handed to glBufferData, glBufferSubData and glTexImage2D.
+  int64_t uploaded_bytes;
+  // Frames submitted.
+  int64_t frames;
+};
+
+Stats GetStats();
+void ResetStats();
+
+// Returns the contents of GL buffer |buffer| as uploaded with glBufferData
+// and glBufferSubData, or an empty vector if it does not exist. Must be
+// called on the thread that uses the GL.
+std::vector<uint8_t> GetBufferContents(GLuint buffer);
+
+// Number of GL buffers created and not deleted yet.
+int GetLiveBufferCount();
+
+// Returns an asset manager that reads the assets from |directory|, to hand
+// to AAssetManager_fromJava() in place of the Java object. It is never
+// freed.
+AAssetManager* NewAssetManager(const std::string& directory);
+
+// Whether the samples' log messages are printed to stderr. They are by
+// default.
+void SetLogEnabled(bool enabled);
+
+}  // namespace host_runtime
+
+#endif  // NDK_HOST_SRC_HOST_RUNTIME_H_  // NOLINT
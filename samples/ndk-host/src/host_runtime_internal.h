@@ -0,0 +1,50 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDK_HOST_SRC_HOST_RUNTIME_INTERNAL_H_  // NOLINT
+#define NDK_HOST_SRC_HOST_RUNTIME_INTERNAL_H_
+
+#include <stdint.h>
+
+#include "host_runtime.h"  // NOLINT
+
+// The state shared by the stand-in libraries, which is set through
+// host_runtime.h.
+namespace host_runtime {
+namespace internal {
+
+ViewerConfig GetViewerConfig();
+
+gvr_mat4f EvaluateHeadPoseScript(int64_t time);
+ControllerScriptState EvaluateControllerScript(int64_t time);
+
+// Nanoseconds on the monotonic clock.
+int64_t NowNanos();
+
+// Statistics, counted with relaxed atomics since the GL and GVR calls may
+// come from several threads.
+void CountGlCall();
+void CountDrawCall();
+void CountClientArrayDrawCall();
+void CountUploadedBytes(int64_t bytes);
+void CountFrame();
+
+bool IsLogEnabled();
+
+}  // namespace internal
+}  // namespace host_runtime
+
+#endif  // NDK_HOST_SRC_HOST_RUNTIME_INTERNAL_H_  // NOLINT
@@ -0,0 +1,228 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Replays the head poses of an input log of the controller paint sample
+// (see input_log.h), recorded with run_controllerpaint --record_input or on
+// a device, through the head pose prediction of the samples (see
+// pose_prediction.h), and prints how far off the predicted poses are:
+//
+// - For a few horizons, the angle between the head pose that many
+//   milliseconds after each frame and the pose predicted for then, by
+//   keeping the last pose, and by extrapolating it as PosePredictor does
+//   when its source has no pose.
+// - The horizon PosePredictor picks from the frame timings, and its error
+//   on the frames where its source drops out.
+//
+// Each frame of the log holds the pose predicted for some time after the
+// frame started; those poses, at those times, are taken as the true motion
+// of the head. Exits with 1 if the log cannot be read, or if extrapolating
+// is worse than keeping the last pose at the shortest horizon.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "frame_loop.h"  // NOLINT
+#include "input_log.h"  // NOLINT
+#include "pose_prediction.h"  // NOLINT
+
+namespace {
+
+static const char kUsage[] =
+    "Usage: replay_pose_prediction --input_log=PATH [flags]\n"
+    "  --render_ms=N      time from the start of a frame to its submission,\n"
+    "                     for PosePredictor's frame timer (default 8)\n"
+    "  --dropout_period=N the pose source drops out one frame in N\n"
+    "                     (default 10)\n";
+
+// Horizons the extrapolation is measured at, in milliseconds.
+static const int kHorizonsMs[] = {10, 20, 30, 50, 75, 100};
+
+// A head pose and the time it was true at.
+typedef std::pair<int64_t, gvr::Mat4f> TimedPose;
+
+// Reads the head poses of the log at |path|, at the times they were
+// predicted for, into |poses|, in increasing order of time. Returns false
+// if the file is not a valid log.
+static bool ReadPoses(const std::string& path, std::vector<TimedPose>* poses) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file) return false;
+  InputLogHeader header;
+  bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+               header.magic == kInputLogMagic &&
+               header.version == kInputLogVersion;
+  InputLogFrame frame;
+  while (valid && fread(&frame, sizeof(frame), 1, file) == 1) {
+    TimedPose pose;
+    pose.first = frame.time + frame.prediction_nanos;
+    memcpy(pose.second.m, frame.head_view, sizeof(frame.head_view));
+    if (poses->empty() || pose.first > poses->back().first) {
+      poses->push_back(pose);
+    }
+    valid = fseek(file, frame.sample_count * sizeof(InputLogSample),
+                  SEEK_CUR) == 0;
+  }
+  fclose(file);
+  return valid && poses->size() >= 2;
+}
+
+// Returns the angle, in degrees, between the rotations of |a| and |b|.
+static double AngleDegrees(const gvr::Mat4f& a, const gvr::Mat4f& b) {
+  double trace = 0.0;
+  for (int i = 0; i < 3; ++i) {
+    for (int k = 0; k < 3; ++k) trace += a.m[i][k] * b.m[i][k];
+  }
+  const double cos_angle = std::max(-1.0, std::min(1.0, (trace - 1) / 2));
+  return acos(cos_angle) * 180.0 / M_PI;
+}
+
+// The head pose at |time|, turning at a constant rate between the poses
+// around it. |time| must be within the poses.
+static gvr::Mat4f PoseAt(const std::vector<TimedPose>& poses, int64_t time) {
+  const auto after = std::lower_bound(
+      poses.begin(), poses.end(), time,
+      [](const TimedPose& pose, int64_t t) { return pose.first < t; });
+  if (after->first == time) return after->second;
+  // Extrapolating backwards from the later pose interpolates.
+  pose_prediction::AngularExtrapolator interpolator;
+  interpolator.AddPose((after - 1)->first, (after - 1)->second);
+  interpolator.AddPose(after->first, after->second);
+  return interpolator.Predict(time);
+}
+
+// Mean and 99th percentile of |errors|.
+static void Summarize(std::vector<double> errors, double* mean, double* p99) {
+  *mean = *p99 = 0.0;
+  if (errors.empty()) return;
+  for (double error : errors) *mean += error;
+  *mean /= errors.size();
+  const size_t index = errors.size() * 99 / 100;
+  std::nth_element(errors.begin(), errors.begin() + index, errors.end());
+  *p99 = errors[index];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string input_log_path;
+  std::string render_ms = "8";
+  std::string dropout_period_flag = "10";
+  for (int i = 1; i < argc; ++i) {
+    if (!host_runtime::ParseFlag(argv[i], "input_log", &input_log_path) &&
+        !host_runtime::ParseFlag(argv[i], "render_ms", &render_ms) &&
+        !host_runtime::ParseFlag(argv[i], "dropout_period",
+                                 &dropout_period_flag)) {
+      fprintf(stderr, "%s", kUsage);
+      return 1;
+    }
+  }
+  const int dropout_period = atoi(dropout_period_flag.c_str());
+  if (input_log_path.empty() || dropout_period < 2) {
+    fprintf(stderr, "%s", kUsage);
+    return 1;
+  }
+  std::vector<TimedPose> poses;
+  if (!ReadPoses(input_log_path, &poses)) {
+    fprintf(stderr, "Could not read the head poses of %s.\n",
+            input_log_path.c_str());
+    return 1;
+  }
+  printf("%d poses over %.1f s\n", static_cast<int>(poses.size()),
+         (poses.back().first - poses.front().first) * 1e-9);
+
+  // Each pose in turn is the last one known, and the one before it gives
+  // the angular velocity.
+  bool extrapolation_helps = true;
+  for (int horizon_ms : kHorizonsMs) {
+    const int64_t horizon = horizon_ms * 1000000LL;
+    std::vector<double> held_errors;
+    std::vector<double> extrapolated_errors;
+    pose_prediction::AngularExtrapolator extrapolator;
+    for (size_t i = 0; i < poses.size(); ++i) {
+      extrapolator.AddPose(poses[i].first, poses[i].second);
+      const int64_t time = poses[i].first + horizon;
+      if (time > poses.back().first) break;
+      if (!extrapolator.CanPredict()) continue;
+      const gvr::Mat4f actual = PoseAt(poses, time);
+      held_errors.push_back(AngleDegrees(poses[i].second, actual));
+      extrapolated_errors.push_back(
+          AngleDegrees(extrapolator.Predict(time), actual));
+    }
+    double held_mean, held_p99, extrapolated_mean, extrapolated_p99;
+    Summarize(held_errors, &held_mean, &held_p99);
+    Summarize(extrapolated_errors, &extrapolated_mean, &extrapolated_p99);
+    printf("%3d ms ahead: kept %.3f deg mean, %.3f p99; extrapolated %.3f "
+           "mean, %.3f p99\n",
+           horizon_ms, held_mean, held_p99, extrapolated_mean,
+           extrapolated_p99);
+    if (horizon_ms == kHorizonsMs[0]) {
+      extrapolation_helps = extrapolated_mean <= held_mean;
+    }
+  }
+
+  // PosePredictor over the frames, with a source that knows the true motion
+  // but drops out now and then.
+  const int64_t render_nanos =
+      static_cast<int64_t>(atof(render_ms.c_str()) * 1e6);
+  int frame = 0;
+  pose_prediction::PosePredictor predictor([&](int64_t time) {
+    if (frame % dropout_period == 0 || time > poses.back().first) {
+      gvr::Mat4f invalid = gvr::Mat4f();
+      invalid.m[0][0] = NAN;
+      return invalid;
+    }
+    return PoseAt(poses, time);
+  });
+  std::vector<double> dropout_errors;
+  int64_t horizon_sum = 0;
+  int frame_count = 0;
+  // Frames start at the times of the poses, which are paced as the frames
+  // of the log were.
+  for (const TimedPose& pose : poses) {
+    const int64_t now = pose.first;
+    const gvr::Mat4f head_view = predictor.BeginFrame(now);
+    const int64_t time = now + predictor.prediction_nanos();
+    if (time > poses.back().first) break;
+    if (predictor.extrapolating() && frame > 2 * dropout_period) {
+      dropout_errors.push_back(AngleDegrees(head_view, PoseAt(poses, time)));
+    }
+    if (frame >= pose_prediction::kMinTimedFrameCount) {
+      horizon_sum += predictor.prediction_nanos();
+      ++frame_count;
+    }
+    predictor.EndFrame(now + render_nanos);
+    ++frame;
+  }
+  double dropout_mean, dropout_p99;
+  Summarize(dropout_errors, &dropout_mean, &dropout_p99);
+  printf("PosePredictor: %.1f ms ahead on average; %d dropouts, "
+         "extrapolated %.3f deg mean, %.3f p99\n",
+         frame_count > 0 ? horizon_sum * 1e-6 / frame_count : 0.0,
+         static_cast<int>(dropout_errors.size()), dropout_mean, dropout_p99);
+
+  if (!extrapolation_helps) {
+    printf("FAILED: extrapolating is worse than keeping the last pose\n");
+    return 1;
+  }
+  return 0;
+}
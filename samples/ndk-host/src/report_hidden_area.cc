@@ -0,0 +1,132 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Builds the hidden area meshes of the samples (see hidden_area.h) for a
+// few viewer profiles, switching between them the way the samples see it,
+// through a viewer profile refresh. Prints the fraction of each eye's
+// viewport the mesh culls, and checks that the mesh is conservative: that
+// no point of the screen samples the render texture under it. Exits with 1
+// if it is not.
+
+#include <stdio.h>
+
+#include <memory>
+
+#include "hidden_area.h"  // NOLINT
+#include "host_runtime.h"  // NOLINT
+#include "vr/gvr/capi/include/gvr.h"
+
+namespace {
+
+// Lens distortion coefficients of common viewers.
+struct Profile {
+  const char* name;
+  int32_t viewer_type;
+  float distortion_coefficients[2];
+};
+
+static const Profile kProfiles[] = {
+    {"daydream", GVR_VIEWER_TYPE_DAYDREAM, {0.385f, 0.593f}},
+    {"cardboard_v2", GVR_VIEWER_TYPE_CARDBOARD, {0.34f, 0.55f}},
+    {"cardboard_v1", GVR_VIEWER_TYPE_CARDBOARD, {0.441f, 0.156f}},
+};
+
+// Points of the screen viewport sampled along each side for the check.
+static const int kCheckSamples = 200;
+
+// Returns whether |point| is inside the counterclockwise triangle |a|, |b|,
+// |c|, not counting its edges.
+static bool InsideTriangle(const float* a, const float* b, const float* c,
+                           float x, float y) {
+  const float* vertices[3] = {a, b, c};
+  for (int i = 0; i < 3; ++i) {
+    const float* from = vertices[i];
+    const float* to = vertices[(i + 1) % 3];
+    const float cross =
+        (to[0] - from[0]) * (y - from[1]) - (to[1] - from[1]) * (x - from[0]);
+    if (cross <= 0.0f) return false;
+  }
+  return true;
+}
+
+// Returns the number of screen points whose texture sample for some channel
+// lies inside the render texture and under |mesh|.
+static int CountHiddenSamples(
+    const hidden_area::Mesh& mesh,
+    const hidden_area::DistortionFunction& distortion) {
+  int hidden = 0;
+  for (int i = 0; i <= kCheckSamples; ++i) {
+    for (int j = 0; j <= kCheckSamples; ++j) {
+      const gvr::Vec2f screen_uv = {static_cast<float>(i) / kCheckSamples,
+                                    static_cast<float>(j) / kCheckSamples};
+      bool is_hidden = false;
+      for (const gvr::Vec2f& uv : distortion(screen_uv)) {
+        if (uv.x < 0.0f || uv.x > 1.0f || uv.y < 0.0f || uv.y > 1.0f) {
+          continue;
+        }
+        const float x = 2.0f * uv.x - 1.0f;
+        const float y = 2.0f * uv.y - 1.0f;
+        for (size_t v = 0; v + 6 <= mesh.positions.size() && !is_hidden;
+             v += 6) {
+          const float* p = &mesh.positions[v];
+          is_hidden = InsideTriangle(p, p + 2, p + 4, x, y);
+        }
+      }
+      if (is_hidden) ++hidden;
+    }
+  }
+  return hidden;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  host_runtime::SetLogEnabled(false);
+  std::unique_ptr<gvr::GvrApi> gvr_api = gvr::GvrApi::Create();
+  bool all_passed = true;
+  for (const Profile& profile : kProfiles) {
+    host_runtime::ViewerConfig config = host_runtime::DefaultViewerConfig();
+    config.viewer_type = profile.viewer_type;
+    config.distortion_coefficients[0] = profile.distortion_coefficients[0];
+    config.distortion_coefficients[1] = profile.distortion_coefficients[1];
+    host_runtime::SetViewerConfig(config);
+    gvr_api->RefreshViewerProfile();
+
+    printf("%s:", profile.name);
+    bool passed = true;
+    static const gvr::Eye kEyes[2] = {GVR_LEFT_EYE, GVR_RIGHT_EYE};
+    static const char* kEyeNames[2] = {"left", "right"};
+    for (int eye = 0; eye < 2; ++eye) {
+      const gvr::Eye which_eye = kEyes[eye];
+      const hidden_area::DistortionFunction distortion =
+          [&gvr_api, which_eye](const gvr::Vec2f& screen_uv) {
+            return gvr_api->ComputeDistortedPoint(which_eye, screen_uv);
+          };
+      const hidden_area::Mesh mesh = hidden_area::BuildMesh(distortion);
+      const int hidden_samples = CountHiddenSamples(mesh, distortion);
+      printf(" %s_culled=%.1f%%", kEyeNames[eye],
+             100.0f * mesh.hidden_fraction);
+      if (hidden_samples > 0) {
+        printf(" (%d visible samples culled)", hidden_samples);
+        passed = false;
+      }
+    }
+    printf("\n");
+    all_passed = passed && all_passed;
+  }
+  printf(all_passed ? "PASSED\n" : "FAILED\n");
+  return all_passed ? 0 : 1;
+}
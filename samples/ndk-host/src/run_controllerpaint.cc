@@ -0,0 +1,122 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Runs the frame loop of the controller paint sample on the host runtime,
+// with the head looking around and the controller painting circles, and
+// prints how long the frames took.
+
+#include <jni.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+
+#include "demoapp.h"  // NOLINT
+#include "frame_loop.h"  // NOLINT
+#include "host_runtime.h"  // NOLINT
+#include "vr/gvr/capi/include/gvr.h"
+
+namespace {
+
+static const char kUsage[] =
+    "Usage: run_controllerpaint [flags]\n"
+    "  --drawing=PATH     file the drawing is loaded from and saved to\n"
+    "                     (default: a new drawing, saved nowhere)\n"
+    "  --assets=DIR       directory of the sample's assets\n"
+    "  --trace=PATH       write a Chrome trace of the frames to PATH\n"
+    "  --record_input=PATH\n"
+    "                     record the input of every frame to PATH\n"
+    "  --replay_input=PATH\n"
+    "                     replay the input recorded in PATH instead of the\n"
+    "                     scripts; frames past its end get no input\n"
+    "  --history_budget_mb=N\n"
+    "                     memory the undo history may hold, in megabytes\n";
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string drawing_path;
+  std::string asset_dir = CONTROLLERPAINT_ASSET_DIR;
+  std::string trace_path;
+  std::string record_input_path;
+  std::string replay_input_path;
+  std::string history_budget_mb;
+  host_runtime::FrameLoopOptions options;
+  const bool parsed = host_runtime::ParseCommonFlags(
+      argc, argv,
+      [&](const char* arg) {
+        return host_runtime::ParseFlag(arg, "drawing", &drawing_path) ||
+               host_runtime::ParseFlag(arg, "assets", &asset_dir) ||
+               host_runtime::ParseFlag(arg, "trace", &trace_path) ||
+               host_runtime::ParseFlag(arg, "record_input",
+                                       &record_input_path) ||
+               host_runtime::ParseFlag(arg, "replay_input",
+                                       &replay_input_path) ||
+               host_runtime::ParseFlag(arg, "history_budget_mb",
+                                       &history_budget_mb);
+      },
+      &options);
+  if (!parsed ||
+      (!record_input_path.empty() && !replay_input_path.empty())) {
+    fprintf(stderr, "%s", kUsage);
+    return 1;
+  }
+  // Without a drawing file, start from an empty drawing every time, and
+  // throw away what was saved.
+  const bool scratch_drawing = drawing_path.empty();
+  if (scratch_drawing) {
+    const char* temp_dir = getenv("TMPDIR");
+    drawing_path = std::string(temp_dir ? temp_dir : "/tmp") +
+                   "/run_controllerpaint." + std::to_string(getpid()) +
+                   ".drawing";
+  }
+
+  host_runtime::SetHeadPoseScript(host_runtime::LookAroundScript(0.5f, 4.0f));
+  host_runtime::SetControllerScript(
+      host_runtime::PaintCirclesScript(1.5f, 0.5f));
+
+  std::unique_ptr<gvr::GvrApi> gvr_api = gvr::GvrApi::Create();
+  JNIEnv env;
+  _jstring drawing_path_string(drawing_path.c_str());
+  _jstring trace_path_string(trace_path.c_str());
+  const bool replay_input = !replay_input_path.empty();
+  _jstring input_log_path_string(
+      replay_input ? replay_input_path.c_str() : record_input_path.c_str());
+  AAssetManager* asset_manager = host_runtime::NewAssetManager(asset_dir);
+  std::unique_ptr<DemoApp> app(new DemoApp(
+      &env, reinterpret_cast<jobject>(asset_manager),
+      reinterpret_cast<jlong>(gvr_api->cobj()), &drawing_path_string,
+      trace_path.empty() ? nullptr : &trace_path_string,
+      replay_input || !record_input_path.empty() ? &input_log_path_string
+                                                 : nullptr,
+      replay_input, atoi(history_budget_mb.c_str())));
+
+  // The order in which the activity calls the app.
+  app->OnResume();
+  const gvr::Sizei size = gvr_api->GetMaximumEffectiveRenderTargetSize();
+  app->OnSurfaceCreated();
+  app->OnSurfaceChanged(size.width, size.height);
+  const host_runtime::FrameLoopReport report = host_runtime::RunFrameLoop(
+      options, [&app](int frame) { app->OnDrawFrame(); });
+  app->OnPause();
+  app.reset();
+  if (scratch_drawing) unlink(drawing_path.c_str());
+
+  host_runtime::PrintReport("controllerpaint", report);
+  return 0;
+}
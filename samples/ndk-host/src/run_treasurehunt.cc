@@ -0,0 +1,117 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Runs the frame loop of the treasure hunt sample on the host runtime, with
+// the head looking around and the trigger pulled regularly, and prints how
+// long the frames took, and how many pixels the last one shaded.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "frame_loop.h"  // NOLINT
+#include "host_runtime.h"  // NOLINT
+#include "treasure_hunt_renderer.h"  // NOLINT
+#include "vr/gvr/capi/include/gvr.h"
+#include "vr/gvr/capi/include/gvr_audio.h"
+
+namespace {
+
+static const char kUsage[] =
+    "Usage: run_treasurehunt [flags]\n"
+    "  --cubes=N          number of cubes in the scene (default 1)\n"
+    "  --trigger_every=N  pull the trigger every N frames (default 30)\n"
+    "  --trace=PATH       write a Chrome trace of the frames to PATH\n"
+    "  --foveation        render the periphery at a lower resolution\n"
+    "  --inset_degrees=D  half angle of the full resolution insets\n"
+    "  --periphery_scale=S\n"
+    "                     resolution of the periphery relative to the insets\n";
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string cube_count = "1";
+  std::string trigger_every = "30";
+  std::string trace_path;
+  std::string inset_degrees;
+  std::string periphery_scale;
+  foveation::Config foveation_config;
+  host_runtime::FrameLoopOptions options;
+  const bool parsed = host_runtime::ParseCommonFlags(
+      argc, argv,
+      [&](const char* arg) {
+        if (strcmp(arg, "--foveation") == 0) {
+          foveation_config.enabled = true;
+          return true;
+        }
+        return host_runtime::ParseFlag(arg, "cubes", &cube_count) ||
+               host_runtime::ParseFlag(arg, "trigger_every",
+                                       &trigger_every) ||
+               host_runtime::ParseFlag(arg, "trace", &trace_path) ||
+               host_runtime::ParseFlag(arg, "inset_degrees",
+                                       &inset_degrees) ||
+               host_runtime::ParseFlag(arg, "periphery_scale",
+                                       &periphery_scale);
+      },
+      &options);
+  if (!parsed) {
+    fprintf(stderr, "%s", kUsage);
+    return 1;
+  }
+  const int trigger_period = atoi(trigger_every.c_str());
+  if (!inset_degrees.empty()) {
+    foveation_config.inset_half_angle_degrees =
+        static_cast<float>(atof(inset_degrees.c_str()));
+  }
+  if (!periphery_scale.empty()) {
+    foveation_config.periphery_scale =
+        static_cast<float>(atof(periphery_scale.c_str()));
+  }
+
+  host_runtime::SetHeadPoseScript(host_runtime::LookAroundScript(0.5f, 4.0f));
+
+  std::unique_ptr<gvr::GvrApi> gvr_api = gvr::GvrApi::Create();
+  std::unique_ptr<gvr::AudioApi> audio_api(new gvr::AudioApi);
+  audio_api->Init(GVR_AUDIO_RENDERING_BINAURAL_HIGH_QUALITY);
+  std::unique_ptr<TreasureHuntRenderer> renderer(new TreasureHuntRenderer(
+      gvr_api->cobj(), std::move(audio_api),
+      std::max(1, atoi(cube_count.c_str())), trace_path, foveation_config));
+
+  renderer->InitializeGl();
+  renderer->OnResume();
+  const host_runtime::FrameLoopReport report = host_runtime::RunFrameLoop(
+      options, [&](int frame) {
+        if (trigger_period > 0 && frame % trigger_period == 0) {
+          renderer->OnTriggerEvent();
+        }
+        renderer->DrawFrame();
+      });
+  renderer->OnPause();
+  const long long shaded_pixels = renderer->shaded_pixel_count();  // NOLINT
+  const long long unfoveated_pixels =  // NOLINT
+      renderer->unfoveated_pixel_count();
+  renderer.reset();
+
+  host_runtime::PrintReport("treasurehunt", report);
+  printf("treasurehunt: shaded_pixels=%lld unfoveated_pixels=%lld\n",
+         shaded_pixels, unfoveated_pixels);
+  return 0;
+}
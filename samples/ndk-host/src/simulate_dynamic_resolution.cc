@@ -0,0 +1,233 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Runs the render scale controller of the samples (see dynamic_resolution.h)
+// against synthetic frame time traces, and checks that it settles: that it
+// stays put under a steady load, follows changes of the load, and ignores
+// isolated slow frames. Prints one line per trace, and exits with 1 if any
+// check failed.
+
+#include <stdio.h>
+
+#include <deque>
+#include <functional>
+#include <random>
+
+#include "dynamic_resolution.h"  // NOLINT
+
+namespace {
+
+// The settings of the samples.
+static const float kMaxRenderScale = 0.7f;
+static const float kMinRenderScale = 0.5f;
+static const int64_t kTargetFrameNanos = 12000000;
+
+// Frames simulated per trace: a minute at 60 Hz.
+static const int kFrameCount = 3600;
+
+// GPU timings reach the controller this many frames after the frame that
+// was measured, as they do on a device.
+static const int kReportLatency = 2;
+
+// Part of the GPU time of a frame that does not depend on the scale.
+static const double kFixedNanos = 1000000.0;
+
+// A synthetic workload.
+struct Trace {
+  const char* name;
+  // GPU time of the part of frame |frame| that depends on the scale, at the
+  // largest scale.
+  std::function<double(int frame)> scaled_nanos;
+  // Standard deviation of the frame times, relative to their mean.
+  double noise;
+  // If positive, every that many frames one takes three times as long.
+  int spike_period;
+  // Checks the result, and prints why it failed if it did.
+  std::function<bool(const struct Result& result)> check;
+};
+
+// What the controller did over a trace.
+struct Result {
+  // Scale of every frame.
+  std::vector<float> scales;
+  // Whether each frame took longer than the target.
+  std::vector<bool> over_target;
+
+  // Number of scale changes from frame |begin| on.
+  int ChangesFrom(int begin) const {
+    int changes = 0;
+    for (size_t i = begin + 1; i < scales.size(); ++i) {
+      if (scales[i] != scales[i - 1]) ++changes;
+    }
+    return changes;
+  }
+
+  // Number of times the scale went back the way it came from, from frame
+  // |begin| on: oscillations.
+  int ReversalsFrom(int begin) const {
+    int reversals = 0;
+    int last_direction = 0;
+    for (size_t i = begin + 1; i < scales.size(); ++i) {
+      if (scales[i] == scales[i - 1]) continue;
+      const int direction = scales[i] > scales[i - 1] ? 1 : -1;
+      if (last_direction != 0 && direction != last_direction) ++reversals;
+      last_direction = direction;
+    }
+    return reversals;
+  }
+
+  // Fraction of the frames from |begin| to |end| that were over the target.
+  double OverTargetFraction(int begin, int end) const {
+    int count = 0;
+    for (int i = begin; i < end; ++i) count += over_target[i] ? 1 : 0;
+    return static_cast<double>(count) / (end - begin);
+  }
+
+  // First frame from |begin| on that was rendered at |scale| or below, or
+  // -1.
+  int FirstAtOrBelow(int begin, float scale) const {
+    for (size_t i = begin; i < scales.size(); ++i) {
+      if (scales[i] <= scale) return static_cast<int>(i);
+    }
+    return -1;
+  }
+
+  // First frame from |begin| on that was rendered at |scale| or above, or
+  // -1.
+  int FirstAtOrAbove(int begin, float scale) const {
+    for (size_t i = begin; i < scales.size(); ++i) {
+      if (scales[i] >= scale) return static_cast<int>(i);
+    }
+    return -1;
+  }
+};
+
+static Result Simulate(const Trace& trace) {
+  dynamic_resolution::ScaleControllerOptions options;
+  options.min_scale = kMinRenderScale;
+  options.max_scale = kMaxRenderScale;
+  options.target_nanos = kTargetFrameNanos;
+  dynamic_resolution::ScaleController controller(options);
+
+  std::mt19937 random(1);
+  std::normal_distribution<double> noise(1.0, trace.noise);
+  std::deque<int64_t> in_flight;
+  Result result;
+  for (int frame = 0; frame < kFrameCount; ++frame) {
+    const float scale = controller.scale();
+    const double ratio = scale / kMaxRenderScale;
+    double nanos = kFixedNanos + trace.scaled_nanos(frame) * ratio * ratio;
+    if (trace.noise > 0.0) nanos *= std::max(noise(random), 0.1);
+    if (trace.spike_period > 0 && frame % trace.spike_period == 0) {
+      nanos *= 3.0;
+    }
+    result.scales.push_back(scale);
+    result.over_target.push_back(nanos > kTargetFrameNanos);
+
+    in_flight.push_back(static_cast<int64_t>(nanos));
+    if (static_cast<int>(in_flight.size()) > kReportLatency) {
+      controller.AddFrameTime(in_flight.front());
+      in_flight.pop_front();
+    }
+  }
+  return result;
+}
+
+// Returns whether |condition| holds, printing |message| if not.
+static bool Expect(bool condition, const char* message) {
+  if (!condition) printf("  FAILED: %s\n", message);
+  return condition;
+}
+
+static std::function<double(int)> Constant(double nanos) {
+  return [nanos](int frame) { return nanos; };
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  // The scale settles within this many frames of a change of the load.
+  const int kSettleFrames = 300;
+  const int kStepUp = 1200;
+  const int kStepDown = 2400;
+  const Trace traces[] = {
+      {"light", Constant(6e6), 0.05, 0,
+       [](const Result& r) {
+         return Expect(r.ChangesFrom(0) == 0, "the scale changed") &&
+                Expect(r.scales.back() == kMaxRenderScale,
+                       "not at the largest scale");
+       }},
+      {"heavy", Constant(16e6), 0.05, 0,
+       [&](const Result& r) {
+         return Expect(r.scales.back() < kMaxRenderScale,
+                       "the scale did not go down") &&
+                // Noise may still tip a level close to the target over
+                // it, once.
+                Expect(r.ReversalsFrom(0) == 0, "the scale oscillates") &&
+                Expect(r.ChangesFrom(kSettleFrames) <= 1,
+                       "the scale did not settle") &&
+                // The controller keeps the 90th percentile under it.
+                Expect(r.OverTargetFraction(kSettleFrames, kFrameCount) <
+                           0.1,
+                       "frames over the target once settled");
+       }},
+      {"near_target", Constant(10.5e6), 0.08, 0,
+       [&](const Result& r) {
+         return Expect(r.ReversalsFrom(kSettleFrames) <= 2,
+                       "the scale oscillates") &&
+                Expect(r.ChangesFrom(kSettleFrames) <= 4,
+                       "the scale keeps changing");
+       }},
+      {"spikes", Constant(7e6), 0.05, 40,
+       [](const Result& r) {
+         return Expect(r.ChangesFrom(0) == 0,
+                       "isolated slow frames changed the scale");
+       }},
+      {"step",
+       [&](int frame) {
+         return frame >= kStepUp && frame < kStepDown ? 16e6 : 6e6;
+       },
+       0.05, 0,
+       [&](const Result& r) {
+         const int down = r.FirstAtOrBelow(kStepUp, kMaxRenderScale - 0.01f);
+         const int up = r.FirstAtOrAbove(kStepDown, kMaxRenderScale);
+         return Expect(down >= 0 && down - kStepUp <= 60,
+                       "slow to go down after the load went up") &&
+                Expect(up >= 0 && up - kStepDown <= 600,
+                       "slow to go back up after the load went down") &&
+                Expect(r.ReversalsFrom(0) <= 1, "the scale oscillates");
+       }},
+      {"overload", Constant(60e6), 0.05, 0,
+       [](const Result& r) {
+         return Expect(r.scales.back() == kMinRenderScale,
+                       "not at the smallest scale") &&
+                Expect(r.ReversalsFrom(0) == 0, "the scale oscillates");
+       }},
+  };
+
+  bool all_passed = true;
+  for (const Trace& trace : traces) {
+    const Result result = Simulate(trace);
+    printf("%s: changes=%d reversals=%d final_scale=%.2f "
+           "over_target=%.1f%%\n",
+           trace.name, result.ChangesFrom(0), result.ReversalsFrom(0),
+           result.scales.back(),
+           100.0 * result.OverTargetFraction(0, kFrameCount));
+    all_passed = trace.check(result) && all_passed;
+  }
+  printf(all_passed ? "PASSED\n" : "FAILED\n");
+  return all_passed ? 0 : 1;
+}
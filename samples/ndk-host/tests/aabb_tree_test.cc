@@ -0,0 +1,260 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Checks the bounding volume hierarchy the controller paint sample culls
+// committed strokes with: that AabbTree::Cull() returns every box that is
+// not entirely outside the frusta of both eyes, once, and only those, for a
+// drawing that surrounds the viewer; and that it stays so, and shallow,
+// while the chunks of strokes are released and new ones painted, as the
+// undo history does. Prints the time a cull of 100000 chunks takes against
+// classifying every box, and the fraction culled.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "aabb_tree.h"  // NOLINT
+#include "test_util.h"  // NOLINT
+#include "utils.h"  // NOLINT
+
+namespace {
+
+static const int kChunkCount = 100000;
+
+// Chunks per brush stroke, and the size of a chunk's box, in meters.
+static const int kChunksPerStroke = 50;
+static const float kChunkSize = 0.03f;
+
+// Distance from the eyes to the center of the head, in meters.
+static const float kHalfInterpupillaryDistance = 0.032f;
+
+// Field of view of each eye, in degrees, and clipping planes of the sample.
+static const gvr::Rectf kFov = {50.0f, 50.0f, 50.0f, 50.0f};
+static const float kNearClip = 0.01f;
+static const float kFarClip = 100.0f;
+
+static float Random(float min, float max) {
+  return min + (max - min) * static_cast<float>(rand()) / RAND_MAX;
+}
+
+// Returns the boxes of the chunks of random strokes painted all around the
+// viewer, between 1 and 4 m away, each one starting where the previous
+// chunk of its stroke ended, as the sample commits them.
+static std::vector<Aabb> PaintChunks() {
+  srand(1);
+  std::vector<Aabb> boxes;
+  std::array<float, 3> position = {0.0f, 0.0f, 0.0f};
+  for (int i = 0; i < kChunkCount; ++i) {
+    if (i % kChunksPerStroke == 0) {
+      std::array<float, 3> direction = {Random(-1, 1), Random(-1, 1),
+                                        Random(-1, 1)};
+      direction = Utils::VecNormalize(direction);
+      position = Utils::VecAdd(Random(1.0f, 4.0f), direction, 0.0f,
+                               direction);
+    }
+    Aabb box;
+    box.min = box.max = position;
+    for (int k = 0; k < 3; ++k) {
+      position[k] += Random(-kChunkSize, kChunkSize);
+      box.min[k] = std::min(box.min[k], position[k]);
+      box.max[k] = std::max(box.max[k], position[k]);
+    }
+    boxes.push_back(box);
+  }
+  return boxes;
+}
+
+static gvr::Mat4f Translation(float x) {
+  gvr::Mat4f matrix = {{{1.0f, 0.0f, 0.0f, x},
+                        {0.0f, 1.0f, 0.0f, 0.0f},
+                        {0.0f, 0.0f, 1.0f, 0.0f},
+                        {0.0f, 0.0f, 0.0f, 1.0f}}};
+  return matrix;
+}
+
+// Sets |frustum| to the eyes of a viewer at the origin looking down -z.
+static void SetFrustum(StereoFrustum* frustum) {
+  const gvr::Mat4f projection =
+      Utils::PerspectiveMatrixFromView(kFov, kNearClip, kFarClip);
+  frustum->Set(
+      Utils::MatrixMul(projection, Translation(kHalfInterpupillaryDistance)),
+      Utils::MatrixMul(projection,
+                       Translation(-kHalfInterpupillaryDistance)));
+}
+
+// Checks the frustum on boxes whose classification is known.
+static void TestFrustum(const StereoFrustum& frustum) {
+  const Aabb ahead = {{{-0.1f, -0.1f, -2.1f}}, {{0.1f, 0.1f, -1.9f}}};
+  const Aabb behind = {{{-0.1f, -0.1f, 1.9f}}, {{0.1f, 0.1f, 2.1f}}};
+  const Aabb above = {{{-0.1f, 5.0f, -2.1f}}, {{0.1f, 5.2f, -1.9f}}};
+  const Aabb across = {{{-0.1f, -0.1f, -2.1f}}, {{0.1f, 5.0f, -1.9f}}};
+  EXPECT(frustum.Classify(ahead) == StereoFrustum::kInside);
+  EXPECT(frustum.Classify(behind) == StereoFrustum::kOutside);
+  EXPECT(frustum.Classify(above) == StereoFrustum::kOutside);
+  EXPECT(frustum.Classify(across) == StereoFrustum::kIntersecting);
+  // A box only the left eye sees is visible: 2 m ahead, the left side of
+  // the left eye's frustum is at x = -2.42 m, and the right eye's at -2.35.
+  const Aabb left_edge = {{{-2.40f, 0.0f, -2.0f}}, {{-2.38f, 0.02f, -1.98f}}};
+  EXPECT(frustum.Classify(left_edge) == StereoFrustum::kIntersecting);
+  StereoFrustum right_eye;
+  const gvr::Mat4f right_view_projection =
+      Utils::MatrixMul(Utils::PerspectiveMatrixFromView(kFov, kNearClip,
+                                                        kFarClip),
+                       Translation(-kHalfInterpupillaryDistance));
+  right_eye.Set(right_view_projection, right_view_projection);
+  EXPECT(right_eye.Classify(left_edge) == StereoFrustum::kOutside);
+}
+
+// Returns the ids of the boxes in |ids| that are not entirely outside
+// |frustum|, in increasing order.
+static std::vector<int> Visible(const StereoFrustum& frustum,
+                                const std::vector<Aabb>& boxes,
+                                const std::vector<int>& ids) {
+  std::vector<int> visible;
+  for (int id : ids) {
+    if (frustum.Classify(boxes[id]) != StereoFrustum::kOutside) {
+      visible.push_back(id);
+    }
+  }
+  return visible;
+}
+
+static std::vector<int> Cull(const StereoFrustum& frustum, AabbTree* tree) {
+  std::vector<int> visible;
+  tree->Cull(frustum, &visible);
+  std::sort(visible.begin(), visible.end());
+  return visible;
+}
+
+// Releases the chunks of three strokes out of every four, in the order they
+// were painted, then paints them again under new ids, and checks the leaves
+// and culls of the tree at each step.
+static void TestRelease(const StereoFrustum& frustum,
+                        const std::vector<Aabb>& boxes, AabbTree* tree) {
+  std::vector<Aabb> all_boxes = boxes;
+  std::vector<int> ids;
+  for (int i = 0; i < kChunkCount; ++i) {
+    if (i / kChunksPerStroke % 4 == 0) {
+      ids.push_back(i);
+    } else {
+      tree->Remove(i);
+    }
+  }
+  EXPECT(tree->size() == static_cast<int>(ids.size()));
+  EXPECT(Cull(frustum, tree) == Visible(frustum, all_boxes, ids));
+  // Ids that are not in the tree, or no longer, are ignored.
+  tree->Remove(kChunkCount + 1);
+  tree->Remove(kChunksPerStroke);
+  EXPECT(tree->size() == static_cast<int>(ids.size()));
+
+  for (int i = 0; i < kChunkCount; ++i) {
+    if (i / kChunksPerStroke % 4 == 0) continue;
+    const int id = static_cast<int>(all_boxes.size());
+    all_boxes.push_back(boxes[i]);
+    tree->Insert(id, boxes[i]);
+    ids.push_back(id);
+  }
+  EXPECT(tree->size() == kChunkCount);
+  EXPECT(Cull(frustum, tree) == Visible(frustum, all_boxes, ids));
+  // An AVL tree of n leaves is less than 1.45 log2(n) high.
+  EXPECT(tree->height() <= 25);
+
+  for (int id : ids) tree->Remove(id);
+  EXPECT(tree->size() == 0 && tree->height() == -1);
+  EXPECT(Cull(frustum, tree).empty());
+}
+
+// Paints a row of boxes, then releases all of them but a few that the
+// insertion order put along one branch of the tree, which is only as short
+// as their number allows if the removals rebalance it.
+static void TestRebalance() {
+  static const int kRowLength = 1024;
+  AabbTree tree;
+  for (int i = 0; i < kRowLength; ++i) {
+    const float x = static_cast<float>(i);
+    const Aabb box = {{{x, 0.0f, 0.0f}}, {{x + 1.0f, 1.0f, 1.0f}}};
+    tree.Insert(i, box);
+  }
+  std::vector<bool> kept(kRowLength, false);
+  for (int step = 1; step <= kRowLength; step *= 2) {
+    kept[kRowLength - step] = true;
+  }
+  for (int i = 0; i < kRowLength; ++i) {
+    if (!kept[i]) tree.Remove(i);
+  }
+  // 11 leaves; an AVL tree of 5 levels has at least 13.
+  EXPECT(tree.size() == 11);
+  EXPECT(tree.height() == 4);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  StereoFrustum frustum;
+  SetFrustum(&frustum);
+  TestFrustum(frustum);
+
+  const std::vector<Aabb> boxes = PaintChunks();
+  AabbTree tree;
+  for (int i = 0; i < kChunkCount; ++i) tree.Insert(i, boxes[i]);
+  EXPECT(tree.size() == kChunkCount);
+
+  std::vector<int> expected;
+  for (int i = 0; i < kChunkCount; ++i) {
+    if (frustum.Classify(boxes[i]) != StereoFrustum::kOutside) {
+      expected.push_back(i);
+    }
+  }
+  std::vector<int> visible;
+  tree.Cull(frustum, &visible);
+  std::sort(visible.begin(), visible.end());
+  EXPECT(visible == expected);
+  EXPECT(!expected.empty() && static_cast<int>(expected.size()) < kChunkCount);
+
+  volatile int sink = 0;
+  const int kIterations = 100;
+  const double tree_ns = test_util::NanosPerIteration(kIterations, [&](int) {
+    visible.clear();
+    tree.Cull(frustum, &visible);
+    sink = sink + static_cast<int>(visible.size());
+  });
+  const double brute_force_ns =
+      test_util::NanosPerIteration(kIterations, [&](int) {
+        visible.clear();
+        for (int i = 0; i < kChunkCount; ++i) {
+          if (frustum.Classify(boxes[i]) != StereoFrustum::kOutside) {
+            visible.push_back(i);
+          }
+        }
+        sink = sink + static_cast<int>(visible.size());
+      });
+  printf("%d chunks, %.1f%% culled: %.0f us per cull with the tree, %.0f us "
+         "classifying every box\n",
+         kChunkCount, 100.0 - 100.0 * expected.size() / kChunkCount,
+         tree_ns / 1000.0, brute_force_ns / 1000.0);
+
+  TestRelease(frustum, boxes, &tree);
+  TestRebalance();
+
+  tree.Insert(0, boxes[0]);
+  tree.Clear();
+  EXPECT(tree.size() == 0);
+  EXPECT(Cull(frustum, &tree).empty());
+  return test_util::Finish();
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Checks that the controller paint sample's ControllerSampler loses no
+// controller samples, with a synthetic controller that reports a new
+// reading every 5 ms and presses the touchpad every 40 ms. While the
+// rendering thread keeps up, every reading the polling thread saw reaches
+// it, in order. When the rendering thread stalls for longer than the ring
+// holds, intermediate orientations may be merged, but every touch and
+// button event still arrives, in order. Prints how many readings each part
+// saw and delivered.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>  // NOLINT
+#include <mutex>  // NOLINT
+#include <set>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "controller_sampler.h"  // NOLINT
+#include "host_runtime.h"  // NOLINT
+#include "test_util.h"  // NOLINT
+#include "vr/gvr/capi/include/gvr_controller.h"
+
+namespace {
+
+// The period of the readings of the host controller.
+static const int64_t kSensorPeriodNanos = 5000000;
+
+// Readings between two changes of the touchpad.
+static const int64_t kReadingsPerPress = 8;
+
+// How often the rendering thread takes the samples, and for how long it
+// stalls: longer than the 512 readings the ring holds.
+static const std::chrono::milliseconds kFramePeriod(16);
+static const std::chrono::milliseconds kRunTime(1000);
+static const std::chrono::milliseconds kStallTime(3000);
+
+// The times of the readings the polling thread evaluated the script at.
+std::mutex readings_mutex;
+std::set<int64_t> readings;
+
+static bool IsPressed(int64_t time) {
+  return (time / kSensorPeriodNanos / kReadingsPerPress) % 2 == 1;
+}
+
+static host_runtime::ControllerScriptState Script(int64_t time) {
+  {
+    std::lock_guard<std::mutex> lock(readings_mutex);
+    readings.insert(time);
+  }
+  host_runtime::ControllerScriptState state;
+  state.orientation = {0.0f, 0.0f, 0.0f, 1.0f};
+  state.is_touching = state.click_button_pressed = IsPressed(time);
+  state.touch_pos = {0.5f, 0.5f};
+  state.app_button_pressed = false;
+  return state;
+}
+
+static std::set<int64_t> TakeReadings() {
+  std::lock_guard<std::mutex> lock(readings_mutex);
+  std::set<int64_t> taken;
+  taken.swap(readings);
+  return taken;
+}
+
+// A press or release of the touchpad at a reading.
+struct Event {
+  int64_t time;
+  bool down;
+  bool operator==(const Event& other) const {
+    return time == other.time && down == other.down;
+  }
+};
+
+// The events of the readings at |times|, in order. The first reading is
+// what the controller was doing when polling started, so it has none.
+static std::vector<Event> ExpectedEvents(const std::set<int64_t>& times) {
+  std::vector<Event> events;
+  bool first = true;
+  bool pressed = false;
+  for (int64_t time : times) {
+    if (!first && IsPressed(time) != pressed) {
+      events.push_back(Event{time, IsPressed(time)});
+    }
+    pressed = IsPressed(time);
+    first = false;
+  }
+  return events;
+}
+
+// Checks that the events of |samples| are consistent, and returns them.
+static std::vector<Event> DeliveredEvents(
+    const std::vector<ControllerSample>& samples) {
+  std::vector<Event> events;
+  bool consistent = true;
+  for (const ControllerSample& sample : samples) {
+    const PaintInput& input = sample.input;
+    consistent = consistent &&
+                 input.touch_down == input.click_button_down &&
+                 input.touch_up == input.click_button_up &&
+                 !(input.touch_down && input.touch_up) &&
+                 input.is_touching == IsPressed(sample.orientation_timestamp);
+    if (input.touch_down || input.touch_up) {
+      events.push_back(Event{sample.orientation_timestamp, input.touch_down});
+    }
+  }
+  EXPECT(consistent);
+  return events;
+}
+
+static bool InIncreasingOrder(const std::vector<ControllerSample>& samples) {
+  for (size_t i = 1; i < samples.size(); ++i) {
+    if (samples[i].orientation_timestamp <=
+        samples[i - 1].orientation_timestamp) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Polls for |run_time|, taking the samples every frame, after the
+// rendering thread stalled for |stall_time|. Returns the samples, and
+// the readings the polling thread saw in |seen|.
+static std::vector<ControllerSample> Run(gvr::ControllerApi* api,
+                                         std::chrono::milliseconds stall_time,
+                                         std::chrono::milliseconds run_time,
+                                         std::set<int64_t>* seen) {
+  TakeReadings();
+  ControllerSampler sampler;
+  std::vector<ControllerSample> samples;
+  sampler.Start(api);
+  std::this_thread::sleep_for(stall_time);
+  const std::chrono::steady_clock::time_point end =
+      std::chrono::steady_clock::now() + run_time;
+  while (std::chrono::steady_clock::now() < end) {
+    sampler.TakeSamples(&samples);
+    std::this_thread::sleep_for(kFramePeriod);
+  }
+  sampler.Stop();
+  sampler.TakeSamples(&samples);
+  *seen = TakeReadings();
+  return samples;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  host_runtime::SetLogEnabled(false);
+  host_runtime::SetControllerScript(Script);
+  gvr::ControllerApi api;
+  if (!EXPECT(api.Init(gvr::ControllerApi::DefaultOptions(), nullptr))) {
+    return test_util::Finish();
+  }
+
+  // Keeping up: every reading arrives.
+  std::set<int64_t> seen;
+  std::vector<ControllerSample> samples =
+      Run(&api, std::chrono::milliseconds(0), kRunTime, &seen);
+  std::set<int64_t> delivered;
+  for (const ControllerSample& sample : samples) {
+    delivered.insert(sample.orientation_timestamp);
+  }
+  EXPECT(InIncreasingOrder(samples));
+  EXPECT(delivered == seen);
+  EXPECT(DeliveredEvents(samples) == ExpectedEvents(seen));
+  EXPECT(ExpectedEvents(seen).size() > 10);
+  printf("keeping up: %d readings seen, %d delivered\n",
+         static_cast<int>(seen.size()), static_cast<int>(samples.size()));
+
+  // Stalled: the ring fills up, and the events still arrive.
+  samples = Run(&api, kStallTime, kRunTime, &seen);
+  EXPECT(InIncreasingOrder(samples));
+  EXPECT(samples.size() < seen.size());
+  EXPECT(!samples.empty() &&
+         samples.back().orientation_timestamp == *seen.rbegin());
+  const std::vector<Event> events = DeliveredEvents(samples);
+  const std::vector<Event> expected_events = ExpectedEvents(seen);
+  EXPECT(events == expected_events);
+  printf("stalled for %d ms: %d readings seen, %d delivered, with %d of %d "
+         "touchpad events\n",
+         static_cast<int>(kStallTime.count()), static_cast<int>(seen.size()),
+         static_cast<int>(samples.size()), static_cast<int>(events.size()),
+         static_cast<int>(expected_events.size()));
+  return test_util::Finish();
+}
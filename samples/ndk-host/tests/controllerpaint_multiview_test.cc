@@ -0,0 +1,206 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Checks that the controller paint sample draws each run of visible pieces
+// of a loaded drawing with one draw call for both eyes when multiview is
+// available, and once per eye without it: loads a drawing, draws frames with
+// and without multiview, and compares their draw calls. Also checks that the
+// vertex array objects cached by vertex buffer are reused from frame to
+// frame instead of created again. Prints the draw calls of each.
+
+#include <jni.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <memory>
+#include <vector>
+
+#include "demoapp.h"  // NOLINT
+#include "drawing_store.h"  // NOLINT
+#include "host_runtime.h"  // NOLINT
+#include "paint_script.h"  // NOLINT
+#include "paint_simulation.h"  // NOLINT
+#include "test_util.h"  // NOLINT
+#include "vr/gvr/capi/include/gvr.h"
+
+namespace {
+
+static const int kColorCount = 4;
+static const float kPaintDistance = 2.0f;
+static const int kChunkCount = 4000;
+
+// Frames after which loading counts as stuck.
+static const int kMaxFrameCount = 100000;
+// Frames without new levels of detail after which the simplifier counts as
+// done with the loaded drawing.
+static const int kSettledFrameCount = 200;
+// Frames whose draw calls are checked once the drawing is loaded.
+static const int kFrameCount = 60;
+
+// The drawing is written next to the test, in the build directory.
+static const char kDrawingPath[] = "controllerpaint_multiview_test.drawing";
+
+// Saves a drawing of kChunkCount pieces of painted circles, in all colors.
+static bool SaveDrawing() {
+  std::vector<PaintInput> inputs;
+  paint_script::AppendCircle(0.0, 0.0, 0.3, 1.0, 400, &inputs);
+  PaintSimulation simulation(kColorCount, kPaintDistance);
+  std::vector<DrawingEdit> edits;
+  for (const PaintInput& input : inputs) {
+    simulation.Update(input);
+    simulation.TakeEdits(&edits);
+  }
+  std::vector<StrokeChunk> chunks;
+  for (const DrawingEdit& edit : edits) {
+    if (!edit.is_command) chunks.push_back(edit.chunk);
+  }
+  if (chunks.empty()) return false;
+  DrawingStore store;
+  std::vector<int> indices;
+  for (int i = 0; i < kChunkCount; ++i) {
+    StrokeChunk chunk = chunks[i % chunks.size()];
+    chunk.color = i % kColorCount;
+    store.Add(chunk);
+    indices.push_back(i);
+  }
+  return store.Save(kDrawingPath, indices);
+}
+
+// What the frames drawn after loading the drawing looked like.
+struct Run {
+  // Draw stats of the last frame. The head stays still, so every frame
+  // draws the same.
+  DemoApp::DrawStats stats;
+  // Whether every frame drew as many runs of pieces as the last one.
+  bool steady;
+  // GL draw calls of the last frame, counted by the host runtime: those of
+  // the app and those drawing the hidden area of the lenses.
+  int64_t gl_draw_calls;
+  // Vertex array objects created over the frames.
+  int created_vertex_array_count;
+};
+
+// Loads the drawing into a new app on a viewer with or without multiview,
+// and draws kFrameCount frames once every piece and level of detail is on
+// the GPU.
+static Run RunFrames(bool multiview) {
+  host_runtime::ViewerConfig config = host_runtime::DefaultViewerConfig();
+  config.multiview = multiview;
+  host_runtime::SetViewerConfig(config);
+  std::unique_ptr<gvr::GvrApi> gvr_api = gvr::GvrApi::Create();
+  JNIEnv env;
+  _jstring drawing_path(kDrawingPath);
+  AAssetManager* asset_manager =
+      host_runtime::NewAssetManager(CONTROLLERPAINT_ASSET_DIR);
+  std::unique_ptr<DemoApp> app(new DemoApp(
+      &env, reinterpret_cast<jobject>(asset_manager),
+      reinterpret_cast<jlong>(gvr_api->cobj()), &drawing_path, nullptr,
+      nullptr, false, 0));
+  app->OnResume();
+  const gvr::Sizei size = gvr_api->GetMaximumEffectiveRenderTargetSize();
+  app->OnSurfaceCreated();
+  app->OnSurfaceChanged(size.width, size.height);
+
+  int frame_count = 0;
+  int lod_count = -1;
+  int settled_frames = 0;
+  while (frame_count < kMaxFrameCount && settled_frames < kSettledFrameCount) {
+    app->OnDrawFrame();
+    ++frame_count;
+    const DemoApp::RestoreStats stats = app->GetRestoreStats();
+    const bool done = stats.uploaded_chunk_count == stats.chunk_count &&
+                      stats.uploaded_lod_count == stats.lod_count;
+    settled_frames = done && stats.lod_count == lod_count ? settled_frames + 1
+                                                          : 0;
+    lod_count = stats.lod_count;
+  }
+  EXPECT(frame_count < kMaxFrameCount);
+  EXPECT(app->GetRestoreStats().chunk_count == kChunkCount);
+
+  Run run = Run();
+  run.steady = true;
+  const int created_vertex_array_count =
+      app->GetDrawStats().created_vertex_array_count;
+  int range_count = -1;
+  for (int frame = 0; frame < kFrameCount; ++frame) {
+    host_runtime::ResetStats();
+    app->OnDrawFrame();
+    run.gl_draw_calls = host_runtime::GetStats().draw_calls;
+    run.stats = app->GetDrawStats();
+    run.steady = run.steady && (range_count < 0 ||
+                                run.stats.visible_range_count == range_count);
+    range_count = run.stats.visible_range_count;
+  }
+  run.created_vertex_array_count =
+      run.stats.created_vertex_array_count - created_vertex_array_count;
+
+  app->OnPause();
+  app.reset();
+  return run;
+}
+
+// Checks a run on its own, and prints it.
+static void CheckRun(const Run& run, bool multiview) {
+  const DemoApp::DrawStats& stats = run.stats;
+  EXPECT(stats.multiview == multiview);
+  EXPECT(run.steady);
+  // The drawing is in view, and its pieces were merged into runs.
+  EXPECT(stats.visible_chunk_count > 0);
+  EXPECT(stats.visible_range_count > 0);
+  EXPECT(stats.visible_range_count <= stats.visible_chunk_count);
+  // One draw call per run for both eyes with multiview, one per eye without.
+  EXPECT(stats.stroke_draw_call_count ==
+         stats.visible_range_count * (multiview ? 1 : 2));
+  // The GL draw calls include those of the app's own, and the host saw them.
+  EXPECT(stats.draw_call_count <= run.gl_draw_calls);
+  // The vertex array objects of the drawn buffers were all cached before.
+  EXPECT(stats.vertex_array_count > 0);
+  EXPECT(run.created_vertex_array_count == 0);
+  printf("%s: %d pieces in view in %d runs, %d draw calls for them, %d in "
+         "all, %d vertex array objects\n",
+         multiview ? "multiview" : "one eye at a time",
+         stats.visible_chunk_count, stats.visible_range_count,
+         stats.stroke_draw_call_count, stats.draw_call_count,
+         stats.vertex_array_count);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  host_runtime::SetLogEnabled(false);
+  if (!EXPECT(SaveDrawing())) return test_util::Finish();
+
+  const Run multiview = RunFrames(true);
+  CheckRun(multiview, true);
+  const Run single_view = RunFrames(false);
+  CheckRun(single_view, false);
+
+  // Both saw the same drawing from the same place. Without multiview every
+  // draw call is issued again for the second eye.
+  EXPECT(single_view.stats.visible_chunk_count ==
+         multiview.stats.visible_chunk_count);
+  EXPECT(single_view.stats.visible_range_count ==
+         multiview.stats.visible_range_count);
+  EXPECT(single_view.stats.stroke_draw_call_count ==
+         2 * multiview.stats.stroke_draw_call_count);
+  EXPECT(single_view.stats.draw_call_count ==
+         2 * multiview.stats.draw_call_count);
+  EXPECT(single_view.gl_draw_calls == 2 * multiview.gl_draw_calls);
+
+  unlink(kDrawingPath);
+  return test_util::Finish();
+}
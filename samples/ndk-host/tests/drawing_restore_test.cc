@@ -0,0 +1,196 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Checks that the controller paint sample restores a large drawing to the
+// GPU a slice at a time: loads a drawing of 8000 pieces, loses the GL
+// context once it is on the GPU, and checks that every frame of the restore
+// that follows stays within the upload budget, that the restore counters
+// add up, and that the whole drawing and its levels of detail come back.
+// Prints the frames the restore took and its longest slice.
+
+#include <jni.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "demoapp.h"  // NOLINT
+#include "drawing_store.h"  // NOLINT
+#include "host_runtime.h"  // NOLINT
+#include "paint_script.h"  // NOLINT
+#include "paint_simulation.h"  // NOLINT
+#include "test_util.h"  // NOLINT
+#include "vr/gvr/capi/include/gvr.h"
+
+namespace {
+
+static const int kColorCount = 4;
+static const float kPaintDistance = 2.0f;
+static const int kChunkCount = 8000;
+
+// Frames after which a restore counts as stuck.
+static const int kMaxFrameCount = 100000;
+// Frames without new levels of detail after which the simplifier counts as
+// done with the loaded drawing.
+static const int kSettledFrameCount = 200;
+// Restores after which none keeping to the budget counts as a failure.
+static const int kMaxRestoreCount = 5;
+
+// The drawing is written next to the test, in the build directory.
+static const char kDrawingPath[] = "drawing_restore_test.drawing";
+
+// Saves a drawing of kChunkCount pieces of painted circles, in all colors.
+static bool SaveDrawing() {
+  std::vector<PaintInput> inputs;
+  paint_script::AppendCircle(0.0, 0.0, 0.3, 1.0, 400, &inputs);
+  paint_script::AppendCircle(0.0, 0.1, 0.2, 5.0, 2000, &inputs);
+  PaintSimulation simulation(kColorCount, kPaintDistance);
+  std::vector<DrawingEdit> edits;
+  for (const PaintInput& input : inputs) {
+    simulation.Update(input);
+    simulation.TakeEdits(&edits);
+  }
+  std::vector<StrokeChunk> chunks;
+  for (const DrawingEdit& edit : edits) {
+    if (!edit.is_command) chunks.push_back(edit.chunk);
+  }
+  if (chunks.empty()) return false;
+  DrawingStore store;
+  std::vector<int> indices;
+  for (int i = 0; i < kChunkCount; ++i) {
+    StrokeChunk chunk = chunks[i % chunks.size()];
+    chunk.color = i % kColorCount;
+    store.Add(chunk);
+    indices.push_back(i);
+  }
+  return store.Save(kDrawingPath, indices);
+}
+
+// What was seen over the frames of a restore.
+struct Restore {
+  int frame_count;
+  int64_t longest_slice_nanos;
+  int64_t upload_nanos;
+  int longest_reported_frame_count;
+  // Whether every frame kept to the upload budget.
+  bool within_budget;
+};
+
+// Draws frames until every piece and level of detail is on the GPU, and
+// until no new level of detail came for |settled_frame_count| frames.
+static Restore RunRestore(DemoApp* app, int settled_frame_count) {
+  Restore restore = Restore();
+  restore.within_budget = true;
+  int lod_count = -1;
+  int settled_frames = 0;
+  while (restore.frame_count < kMaxFrameCount) {
+    app->OnDrawFrame();
+    ++restore.frame_count;
+    const DemoApp::RestoreStats stats = app->GetRestoreStats();
+    restore.within_budget = restore.within_budget &&
+                            stats.last_slice_nanos <= stats.slice_budget_nanos;
+    restore.longest_slice_nanos =
+        std::max(restore.longest_slice_nanos, stats.last_slice_nanos);
+    restore.upload_nanos += stats.last_slice_nanos;
+    restore.longest_reported_frame_count =
+        std::max(restore.longest_reported_frame_count, stats.frame_count);
+    const bool done = stats.uploaded_chunk_count == stats.chunk_count &&
+                      stats.uploaded_lod_count == stats.lod_count;
+    settled_frames = done && stats.lod_count == lod_count ? settled_frames + 1
+                                                          : 0;
+    lod_count = stats.lod_count;
+    if (done && settled_frames >= settled_frame_count) break;
+  }
+  EXPECT(restore.frame_count < kMaxFrameCount);
+  return restore;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  host_runtime::SetLogEnabled(false);
+  if (!EXPECT(SaveDrawing())) return test_util::Finish();
+
+  std::unique_ptr<gvr::GvrApi> gvr_api = gvr::GvrApi::Create();
+  JNIEnv env;
+  _jstring drawing_path(kDrawingPath);
+  AAssetManager* asset_manager =
+      host_runtime::NewAssetManager(CONTROLLERPAINT_ASSET_DIR);
+  std::unique_ptr<DemoApp> app(new DemoApp(
+      &env, reinterpret_cast<jobject>(asset_manager),
+      reinterpret_cast<jlong>(gvr_api->cobj()), &drawing_path, nullptr,
+      nullptr, false, 0));
+  app->OnResume();
+  const gvr::Sizei size = gvr_api->GetMaximumEffectiveRenderTargetSize();
+  app->OnSurfaceCreated();
+  app->OnSurfaceChanged(size.width, size.height);
+
+  // The loaded drawing is uploaded while it is simplified. The simplifier
+  // thread competes with the frames for the CPU then, which stretches the
+  // slices on a host with a single core without the uploads taking longer,
+  // so only the restore below is held to the budget.
+  const Restore load = RunRestore(app.get(), kSettledFrameCount);
+  DemoApp::RestoreStats stats = app->GetRestoreStats();
+  EXPECT(stats.chunk_count == kChunkCount);
+  EXPECT(stats.uploaded_chunk_count == kChunkCount);
+  EXPECT(stats.lod_count > 0);
+  EXPECT(stats.frame_count == 0);
+  const int lod_count = stats.lod_count;
+
+  // The context is lost without a pause, as when the GL surface is
+  // recreated. Everything is uploaded again, levels of detail included.
+  // Every restore has to finish, but a preempted upload can stretch a slice
+  // past the budget on a loaded host, so the restore is repeated until one
+  // keeps to the budget in every frame.
+  Restore restore;
+  for (int attempt = 0; attempt < kMaxRestoreCount; ++attempt) {
+    app->OnSurfaceCreated();
+    app->OnSurfaceChanged(size.width, size.height);
+    stats = app->GetRestoreStats();
+    EXPECT(stats.uploaded_chunk_count == 0 && stats.uploaded_lod_count == 0);
+    restore = RunRestore(app.get(), 1);
+    stats = app->GetRestoreStats();
+    EXPECT(stats.uploaded_chunk_count == kChunkCount);
+    EXPECT(stats.lod_count == lod_count &&
+           stats.uploaded_lod_count == lod_count);
+    // It took more than a frame, and the counters followed it.
+    EXPECT(restore.frame_count > 1);
+    EXPECT(restore.longest_reported_frame_count == restore.frame_count - 1);
+    EXPECT(stats.frame_count == 0);
+    if (restore.within_budget) break;
+    printf("restore %d went over the budget, longest slice %.2f ms\n",
+           attempt, restore.longest_slice_nanos / 1e6);
+  }
+  EXPECT(restore.within_budget);
+
+  printf("load: %d frames, longest slice %.2f ms\n", load.frame_count,
+         load.longest_slice_nanos / 1e6);
+  printf("restore of %d pieces and %d levels of detail after losing the "
+         "context: %d frames, %.1f ms uploading, longest slice %.2f ms of "
+         "%.2f\n",
+         kChunkCount, lod_count, restore.frame_count,
+         restore.upload_nanos / 1e6, restore.longest_slice_nanos / 1e6,
+         stats.slice_budget_nanos / 1e6);
+
+  app->OnPause();
+  app.reset();
+  unlink(kDrawingPath);
+  return test_util::Finish();
+}
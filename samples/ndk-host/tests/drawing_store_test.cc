@@ -0,0 +1,270 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Checks the drawing files of the controller paint sample: that a drawing
+// saved by DrawingStore loads back with the same chunks, in the order they
+// were saved, with aligned blocks; that saving over a file leaves a store
+// that mapped it intact; and that invalid files are rejected. Prints the
+// time a large drawing takes to save and to load, against reading the file.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "drawing_store.h"  // NOLINT
+#include "paint_script.h"  // NOLINT
+#include "paint_simulation.h"  // NOLINT
+#include "test_util.h"  // NOLINT
+
+namespace {
+
+static const int kColorCount = 4;
+static const float kPaintDistance = 2.0f;
+
+// Chunks in the drawing of the benchmark.
+static const int kLargeChunkCount = 10000;
+
+// The files are written next to the test, in the build directory.
+static const char kPath[] = "drawing_store_test.bin";
+static const char kOtherPath[] = "drawing_store_test_other.bin";
+
+static std::vector<StrokeChunk> PaintChunks() {
+  std::vector<PaintInput> inputs;
+  paint_script::AppendCircle(0.0, 0.0, 0.3, 1.0, 400, &inputs);
+  paint_script::AppendCircle(0.2, -0.1, 0.05, 1.0, 60, &inputs);
+  paint_script::AppendCircle(0.0, 0.1, 0.2, 5.0, 2000, &inputs);
+  PaintSimulation simulation(kColorCount, kPaintDistance);
+  std::vector<DrawingEdit> edits;
+  for (const PaintInput& input : inputs) {
+    simulation.Update(input);
+    simulation.TakeEdits(&edits);
+  }
+  std::vector<StrokeChunk> chunks;
+  for (const DrawingEdit& edit : edits) {
+    if (!edit.is_command) chunks.push_back(edit.chunk);
+  }
+  // Spread the chunks over the colors, which the strokes above do not.
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    chunks[i].color = static_cast<int>(i) % kColorCount;
+  }
+  return chunks;
+}
+
+static bool IsAligned(const void* pointer) {
+  return reinterpret_cast<uintptr_t>(pointer) % kDrawingFileAlignment == 0;
+}
+
+static bool SameChunk(const DrawingStore::Chunk& chunk,
+                      const StrokeChunk& expected) {
+  return chunk.color == expected.color &&
+         chunk.vertex_count == static_cast<int>(expected.vertices.size()) &&
+         chunk.index_count == static_cast<int>(expected.indices.size()) &&
+         memcmp(chunk.vertices, expected.vertices.data(),
+                expected.vertices.size() * sizeof(PaintVertex)) == 0 &&
+         memcmp(chunk.indices, expected.indices.data(),
+                expected.indices.size() * sizeof(GLushort)) == 0;
+}
+
+// Saves a drawing with a released chunk, in a different order from the
+// one the chunks were added in, and loads it back.
+static void TestRoundTrip(const std::vector<StrokeChunk>& chunks) {
+  DrawingStore store;
+  for (const StrokeChunk& chunk : chunks) store.Add(chunk);
+  EXPECT(store.size() == static_cast<int>(chunks.size()));
+  store.Release(1);
+  EXPECT(store.IsReleased(1) && !store.IsReleased(0));
+  std::vector<int> saved;
+  for (int i = store.size() - 1; i >= 0; --i) {
+    if (!store.IsReleased(i)) saved.push_back(i);
+  }
+  if (!EXPECT(store.Save(kPath, saved))) return;
+  EXPECT(access((std::string(kPath) + ".tmp").c_str(), F_OK) != 0);
+
+  DrawingStore loaded;
+  if (!EXPECT(loaded.Load(kPath))) return;
+  if (!EXPECT(loaded.size() == static_cast<int>(saved.size()))) return;
+  for (int i = 0; i < loaded.size(); ++i) {
+    const DrawingStore::Chunk& chunk = loaded.chunk(i);
+    EXPECT(SameChunk(chunk, chunks[saved[i]]));
+    EXPECT(IsAligned(chunk.vertices) && IsAligned(chunk.indices));
+  }
+
+  // Saving over the file the store mapped leaves the mapping as it was.
+  DrawingStore other;
+  other.Add(chunks[0]);
+  EXPECT(other.Save(kPath, std::vector<int>(1, 0)));
+  bool intact = true;
+  for (int i = 0; i < loaded.size(); ++i) {
+    intact = intact && SameChunk(loaded.chunk(i), chunks[saved[i]]);
+  }
+  EXPECT(intact);
+  // And the saved chunks of a loaded store can be saved again.
+  std::vector<int> all;
+  for (int i = 0; i < loaded.size(); ++i) all.push_back(i);
+  EXPECT(loaded.Save(kOtherPath, all));
+  DrawingStore reloaded;
+  EXPECT(reloaded.Load(kOtherPath) && reloaded.size() == loaded.size());
+
+  // Chunks added after loading sit after the loaded ones.
+  loaded.Add(chunks[2]);
+  EXPECT(loaded.size() == static_cast<int>(saved.size()) + 1 &&
+         SameChunk(loaded.chunk(loaded.size() - 1), chunks[2]));
+  loaded.Clear();
+  EXPECT(loaded.size() == 0);
+}
+
+// Writes |size| bytes of |data| to |path|.
+static void WriteFile(const char* path, const void* data, size_t size) {
+  FILE* file = fopen(path, "wb");
+  if (!file) return;
+  fwrite(data, 1, size, file);
+  fclose(file);
+}
+
+static std::vector<uint8_t> ReadFile(const char* path) {
+  std::vector<uint8_t> contents;
+  FILE* file = fopen(path, "rb");
+  if (!file) return contents;
+  fseek(file, 0, SEEK_END);
+  contents.resize(ftell(file));
+  fseek(file, 0, SEEK_SET);
+  if (fread(contents.data(), 1, contents.size(), file) != contents.size()) {
+    contents.clear();
+  }
+  fclose(file);
+  return contents;
+}
+
+// Checks that missing, truncated and corrupt files are rejected, leaving
+// the store empty.
+static void TestInvalidFiles(const std::vector<StrokeChunk>& chunks) {
+  DrawingStore store;
+  store.Add(chunks[0]);
+  EXPECT(!store.Load("drawing_store_test_missing.bin") && store.size() == 0);
+
+  store.Add(chunks[0]);
+  store.Add(chunks[1]);
+  if (!EXPECT(store.Save(kPath, {0, 1}))) return;
+  const std::vector<uint8_t> contents = ReadFile(kPath);
+  if (!EXPECT(contents.size() > sizeof(DrawingFileHeader) +
+                                    2 * sizeof(DrawingFileChunk))) {
+    return;
+  }
+
+  DrawingStore loaded;
+  // Shorter than a header.
+  WriteFile(kOtherPath, contents.data(), sizeof(DrawingFileHeader) - 1);
+  EXPECT(!loaded.Load(kOtherPath) && loaded.size() == 0);
+  // Cut in the middle of the table.
+  WriteFile(kOtherPath, contents.data(),
+            sizeof(DrawingFileHeader) + sizeof(DrawingFileChunk));
+  EXPECT(!loaded.Load(kOtherPath) && loaded.size() == 0);
+  // Cut in the middle of the last block.
+  WriteFile(kOtherPath, contents.data(), contents.size() - 1);
+  EXPECT(!loaded.Load(kOtherPath) && loaded.size() == 0);
+
+  std::vector<uint8_t> corrupt = contents;
+  DrawingFileHeader* header =
+      reinterpret_cast<DrawingFileHeader*>(corrupt.data());
+  header->magic = 0;
+  WriteFile(kOtherPath, corrupt.data(), corrupt.size());
+  EXPECT(!loaded.Load(kOtherPath) && loaded.size() == 0);
+  corrupt = contents;
+  header = reinterpret_cast<DrawingFileHeader*>(corrupt.data());
+  ++header->version;
+  WriteFile(kOtherPath, corrupt.data(), corrupt.size());
+  EXPECT(!loaded.Load(kOtherPath) && loaded.size() == 0);
+
+  corrupt = contents;
+  DrawingFileChunk* table = reinterpret_cast<DrawingFileChunk*>(
+      corrupt.data() + sizeof(DrawingFileHeader));
+  table[1].vertex_offset += 1;
+  WriteFile(kOtherPath, corrupt.data(), corrupt.size());
+  EXPECT(!loaded.Load(kOtherPath) && loaded.size() == 0);
+  corrupt = contents;
+  table = reinterpret_cast<DrawingFileChunk*>(corrupt.data() +
+                                              sizeof(DrawingFileHeader));
+  table[0].index_count = 0x10000000;
+  WriteFile(kOtherPath, corrupt.data(), corrupt.size());
+  EXPECT(!loaded.Load(kOtherPath) && loaded.size() == 0);
+
+  // An index past the vertices of its chunk, which the GPU would read past.
+  corrupt = contents;
+  table = reinterpret_cast<DrawingFileChunk*>(corrupt.data() +
+                                              sizeof(DrawingFileHeader));
+  if (EXPECT(table[1].index_count > 0)) {
+    GLushort* indices =
+        reinterpret_cast<GLushort*>(corrupt.data() + table[1].index_offset);
+    indices[table[1].index_count - 1] =
+        static_cast<GLushort>(table[1].vertex_count);
+    WriteFile(kOtherPath, corrupt.data(), corrupt.size());
+    EXPECT(!loaded.Load(kOtherPath) && loaded.size() == 0);
+    // The last vertex is fine.
+    indices[table[1].index_count - 1] =
+        static_cast<GLushort>(table[1].vertex_count - 1);
+    WriteFile(kOtherPath, corrupt.data(), corrupt.size());
+    EXPECT(loaded.Load(kOtherPath) && loaded.size() == 2);
+  }
+
+  // The original still loads.
+  EXPECT(loaded.Load(kPath) && loaded.size() == 2);
+}
+
+// Times saving and loading a drawing of kLargeChunkCount chunks.
+static void Benchmark(const std::vector<StrokeChunk>& chunks) {
+  DrawingStore store;
+  std::vector<int> indices;
+  for (int i = 0; i < kLargeChunkCount; ++i) {
+    store.Add(chunks[i % chunks.size()]);
+    indices.push_back(i);
+  }
+  const int kIterations = 10;
+  const double save_ns = test_util::NanosPerIteration(
+      kIterations, [&](int) { store.Save(kPath, indices); });
+  DrawingStore loaded;
+  volatile int sink = 0;
+  const double load_ns = test_util::NanosPerIteration(kIterations, [&](int) {
+    loaded.Load(kPath);
+    sink = sink + loaded.size();
+  });
+  size_t file_size = 0;
+  const double read_ns = test_util::NanosPerIteration(kIterations, [&](int) {
+    file_size = ReadFile(kPath).size();
+  });
+  EXPECT(loaded.size() == kLargeChunkCount);
+  printf("%d chunks, %.1f MB: saved in %.2f ms, loaded in %.2f ms, read "
+         "into memory in %.2f ms\n",
+         kLargeChunkCount, file_size / 1e6, save_ns / 1e6, load_ns / 1e6,
+         read_ns / 1e6);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::vector<StrokeChunk> chunks = PaintChunks();
+  if (!EXPECT(chunks.size() > 4)) return test_util::Finish();
+  TestRoundTrip(chunks);
+  TestInvalidFiles(chunks);
+  Benchmark(chunks);
+  unlink(kPath);
+  unlink(kOtherPath);
+  return test_util::Finish();
+}
@@ -0,0 +1,252 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Tests the GL state cache of the samples (gl_state_cache.h): through a
+// table of entry points that records the calls, that it issues exactly the
+// calls that change state, and counts them; and through the host GL, that
+// its counters match the calls the GL sees.
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "gl_state_cache.h"  // NOLINT
+#include "host_runtime.h"  // NOLINT
+#include "test_util.h"  // NOLINT
+
+namespace {
+
+// The calls issued through RecordingFunctions(), by name.
+std::vector<std::string>& Calls() {
+  static std::vector<std::string>* calls = new std::vector<std::string>;
+  return *calls;
+}
+
+void GL_APIENTRY RecordUseProgram(GLuint program) {
+  Calls().push_back("UseProgram");
+}
+void GL_APIENTRY RecordBindBuffer(GLenum target, GLuint buffer) {
+  Calls().push_back("BindBuffer");
+}
+void GL_APIENTRY RecordActiveTexture(GLenum texture) {
+  Calls().push_back("ActiveTexture");
+}
+void GL_APIENTRY RecordBindTexture(GLenum target, GLuint texture) {
+  Calls().push_back("BindTexture");
+}
+void GL_APIENTRY RecordEnableVertexAttribArray(GLuint index) {
+  Calls().push_back("EnableVertexAttribArray");
+}
+void GL_APIENTRY RecordDisableVertexAttribArray(GLuint index) {
+  Calls().push_back("DisableVertexAttribArray");
+}
+void GL_APIENTRY RecordEnable(GLenum cap) { Calls().push_back("Enable"); }
+void GL_APIENTRY RecordDisable(GLenum cap) { Calls().push_back("Disable"); }
+void GL_APIENTRY RecordBlendFunc(GLenum sfactor, GLenum dfactor) {
+  Calls().push_back("BlendFunc");
+}
+void GL_APIENTRY RecordGenVertexArrays(GLsizei n, GLuint* arrays) {
+  Calls().push_back("GenVertexArrays");
+  static GLuint next_array = 1;
+  for (GLsizei i = 0; i < n; ++i) arrays[i] = next_array++;
+}
+void GL_APIENTRY RecordBindVertexArray(GLuint array) {
+  Calls().push_back("BindVertexArray");
+}
+void GL_APIENTRY RecordDeleteVertexArrays(GLsizei n, const GLuint* arrays) {
+  Calls().push_back("DeleteVertexArrays");
+}
+void GL_APIENTRY RecordVertexAttribDivisor(GLuint index, GLuint divisor) {
+  Calls().push_back("VertexAttribDivisor");
+}
+void GL_APIENTRY RecordDrawArraysInstanced(GLenum mode, GLint first,
+                                           GLsizei count, GLsizei instances) {
+  Calls().push_back("DrawArraysInstanced");
+}
+
+gl_state::GlFunctions RecordingFunctions() {
+  gl_state::GlFunctions gl;
+  gl.UseProgram = RecordUseProgram;
+  gl.BindBuffer = RecordBindBuffer;
+  gl.ActiveTexture = RecordActiveTexture;
+  gl.BindTexture = RecordBindTexture;
+  gl.EnableVertexAttribArray = RecordEnableVertexAttribArray;
+  gl.DisableVertexAttribArray = RecordDisableVertexAttribArray;
+  gl.Enable = RecordEnable;
+  gl.Disable = RecordDisable;
+  gl.BlendFunc = RecordBlendFunc;
+  gl.GenVertexArrays = RecordGenVertexArrays;
+  gl.BindVertexArray = RecordBindVertexArray;
+  gl.DeleteVertexArrays = RecordDeleteVertexArrays;
+  gl.VertexAttribDivisor = RecordVertexAttribDivisor;
+  gl.DrawArraysInstanced = RecordDrawArraysInstanced;
+  return gl;
+}
+
+// Returns the calls recorded since the last call, and checks that the cache
+// counted them.
+std::vector<std::string> TakeCalls(gl_state::StateCache* cache) {
+  std::vector<std::string> calls;
+  calls.swap(Calls());
+  EXPECT(cache->issued_calls() == static_cast<int>(calls.size()));
+  cache->ResetCounters();
+  return calls;
+}
+
+typedef std::vector<std::string> CallList;
+
+void TestProgramAndBuffers() {
+  gl_state::StateCache cache;
+  cache.Initialize(RecordingFunctions());
+  cache.UseProgram(1);
+  cache.UseProgram(1);
+  cache.BindBuffer(GL_ARRAY_BUFFER, 2);
+  cache.BindBuffer(GL_ARRAY_BUFFER, 2);
+  cache.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 2);
+  EXPECT(cache.elided_calls() == 2);
+  EXPECT((TakeCalls(&cache) ==
+          CallList{"UseProgram", "BindBuffer", "BindBuffer"}));
+
+  // Everything is issued again after Invalidate(), once.
+  cache.Invalidate();
+  cache.UseProgram(1);
+  cache.UseProgram(1);
+  cache.BlendFunc(GL_ONE, GL_ZERO);
+  cache.BlendFunc(GL_ONE, GL_ZERO);
+  cache.BlendFunc(GL_ONE, GL_ONE);
+  EXPECT((TakeCalls(&cache) ==
+          CallList{"UseProgram", "BlendFunc", "BlendFunc"}));
+}
+
+void TestTextures() {
+  gl_state::StateCache cache;
+  cache.Initialize(RecordingFunctions());
+  cache.BindTexture2D(GL_TEXTURE0, 5);
+  cache.BindTexture2D(GL_TEXTURE0, 5);
+  cache.BindTexture2D(GL_TEXTURE1, 5);
+  // Unit 0 still has texture 5, but must be made active again.
+  cache.BindTexture2D(GL_TEXTURE0, 5);
+  EXPECT((TakeCalls(&cache) ==
+          CallList{"ActiveTexture", "BindTexture", "ActiveTexture",
+                   "BindTexture", "ActiveTexture"}));
+  // Units past the tracked ones are always bound.
+  const GLenum untracked =
+      GL_TEXTURE0 + gl_state::StateCache::kMaxTextureUnits;
+  cache.BindTexture2D(untracked, 5);
+  cache.BindTexture2D(untracked, 5);
+  EXPECT((TakeCalls(&cache) ==
+          CallList{"ActiveTexture", "BindTexture", "BindTexture"}));
+}
+
+void TestCapabilitiesAndAttributes() {
+  gl_state::StateCache cache;
+  cache.Initialize(RecordingFunctions());
+  cache.SetCapability(GL_BLEND, true);
+  cache.SetCapability(GL_BLEND, true);
+  cache.SetCapability(GL_BLEND, false);
+  // Capabilities that are not tracked are always set.
+  cache.SetCapability(GL_DITHER, false);
+  cache.SetCapability(GL_DITHER, false);
+  EXPECT((TakeCalls(&cache) ==
+          CallList{"Enable", "Disable", "Disable", "Disable"}));
+
+  // The first mask sets every attribute; then only the changes are issued.
+  cache.SetVertexAttribArrays(0x3);
+  EXPECT(TakeCalls(&cache).size() ==
+         static_cast<size_t>(gl_state::StateCache::kMaxVertexAttribs));
+  cache.SetVertexAttribArrays(0x5);
+  EXPECT((TakeCalls(&cache) ==
+          CallList{"DisableVertexAttribArray", "EnableVertexAttribArray"}));
+  cache.SetVertexAttribArrays(0x5);
+  EXPECT(TakeCalls(&cache).empty());
+}
+
+void TestVertexArrays() {
+  gl_state::StateCache cache;
+  cache.Initialize(RecordingFunctions());
+  EXPECT(cache.vertex_arrays_supported());
+  const GLuint first = cache.CreateVertexArray();
+  const GLuint second = cache.CreateVertexArray();
+  cache.BindVertexArray(first);
+  cache.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 7);
+  cache.SetVertexAttribArrays(0x1);
+  TakeCalls(&cache);
+  // The element buffer and the attributes belong to the vertex array, so
+  // they are set again after switching arrays, but the array buffer is not.
+  cache.BindBuffer(GL_ARRAY_BUFFER, 8);
+  cache.BindVertexArray(second);
+  cache.BindVertexArray(second);
+  cache.BindBuffer(GL_ARRAY_BUFFER, 8);
+  cache.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 7);
+  EXPECT((TakeCalls(&cache) ==
+          CallList{"BindBuffer", "BindVertexArray", "BindBuffer"}));
+  cache.SetVertexAttribArrays(0x1);
+  EXPECT(TakeCalls(&cache).size() ==
+         static_cast<size_t>(gl_state::StateCache::kMaxVertexAttribs));
+  // Deleting the bound array binds array 0.
+  cache.DeleteVertexArray(second);
+  cache.BindVertexArray(0);
+  cache.BindVertexArray(first);
+  EXPECT((TakeCalls(&cache) ==
+          CallList{"DeleteVertexArrays", "BindVertexArray"}));
+}
+
+// The counters match what the GL sees, and a frame's worth of repeated
+// state costs nothing after the first draw.
+void TestAgainstHostGl() {
+  host_runtime::ViewerConfig config = host_runtime::DefaultViewerConfig();
+  config.gl_es3 = false;
+  host_runtime::SetViewerConfig(config);
+  gl_state::StateCache es2_cache;
+  es2_cache.Initialize(gl_state::LoadGlFunctions());
+  EXPECT(!es2_cache.vertex_arrays_supported());
+
+  config.gl_es3 = true;
+  host_runtime::SetViewerConfig(config);
+  gl_state::StateCache cache;
+  cache.Initialize(gl_state::LoadGlFunctions());
+  EXPECT(cache.vertex_arrays_supported());
+  cache.ResetCounters();
+  host_runtime::ResetStats();
+  static const int kDrawCount = 1000;
+  for (int i = 0; i < kDrawCount; ++i) {
+    cache.UseProgram(1);
+    cache.BindBuffer(GL_ARRAY_BUFFER, 2);
+    cache.BindTexture2D(GL_TEXTURE0, 3);
+    cache.SetVertexAttribArrays(0x7);
+    cache.SetCapability(GL_BLEND, true);
+    cache.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  }
+  EXPECT(host_runtime::GetStats().gl_calls == cache.issued_calls());
+  printf("%d draws of the same state: %d GL calls issued, %d elided\n",
+         kDrawCount, cache.issued_calls(), cache.elided_calls());
+  EXPECT(cache.issued_calls() ==
+         6 + gl_state::StateCache::kMaxVertexAttribs);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  host_runtime::SetLogEnabled(false);
+  TestProgramAndBuffers();
+  TestTextures();
+  TestCapabilitiesAndAttributes();
+  TestVertexArrays();
+  TestAgainstHostGl();
+  return test_util::Finish();
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Checks that the matrices the samples upload come out of
+// simd_math::MatrixMulToGL() and MatrixPairMulToGL() in the column-major
+// layout glUniformMatrix4fv() expects, and compares the per-frame matrix
+// work of a scene of thousands of objects done the way the samples used to,
+// multiplying row-major and transposing into a new array per draw, with
+// producing the GL layout in one pass.
+
+#include <stdio.h>
+
+#include <array>
+#include <random>
+#include <vector>
+
+#include "simd_math.h"  // NOLINT
+#include "test_util.h"  // NOLINT
+
+namespace {
+
+static const int kObjectCount = 5000;
+static const int kFrameCount = 200;
+
+// Scalar row-major product and transpose, as the samples had them.
+static gvr::Mat4f RowMajorMul(const gvr::Mat4f& m1, const gvr::Mat4f& m2) {
+  gvr::Mat4f result;
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      result.m[i][j] = 0.0f;
+      for (int k = 0; k < 4; ++k) {
+        result.m[i][j] += m1.m[i][k] * m2.m[k][j];
+      }
+    }
+  }
+  return result;
+}
+
+static std::array<float, 16> RowMajorToGLArray(const gvr::Mat4f& matrix) {
+  std::array<float, 16> result;
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      result[j * 4 + i] = matrix.m[i][j];
+    }
+  }
+  return result;
+}
+
+static gvr::Mat4f RandomMatrix(std::mt19937* random) {
+  std::uniform_real_distribution<float> value(-2.0f, 2.0f);
+  gvr::Mat4f matrix;
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) matrix.m[i][j] = value(*random);
+  }
+  return matrix;
+}
+
+static bool SameLayout(const float* gl, const gvr::Mat4f& row_major) {
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      const float diff = gl[4 * j + i] - row_major.m[i][j];
+      if (diff > 1e-4f || diff < -1e-4f) return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::mt19937 random(2);
+  gvr::Mat4f view_projection[2] = {RandomMatrix(&random),
+                                   RandomMatrix(&random)};
+  std::vector<gvr::Mat4f> models(kObjectCount);
+  for (gvr::Mat4f& model : models) model = RandomMatrix(&random);
+
+  // Layout: element (row i, column j) of the product is at 4 j + i.
+  const simd_math::GLMat4 mvp =
+      simd_math::MatrixMulToGL(view_projection[0], models[0]);
+  EXPECT(SameLayout(mvp.data(), RowMajorMul(view_projection[0], models[0])));
+  const gvr::Mat4f pair_models[2] = {models[1], models[2]};
+  float pair[32];
+  simd_math::MatrixPairMulToGL(view_projection, pair_models, pair);
+  EXPECT(SameLayout(pair, RowMajorMul(view_projection[0], models[1])));
+  EXPECT(SameLayout(pair + 16, RowMajorMul(view_projection[1], models[2])));
+
+  // A frame computes the pair of matrices of every object, for multiview.
+  volatile float sink = 0.0f;
+  const double before_nanos =
+      test_util::NanosPerIteration(kFrameCount, [&](int frame) {
+        for (const gvr::Mat4f& model : models) {
+          for (int eye = 0; eye < 2; ++eye) {
+            const std::array<float, 16> uniform =
+                RowMajorToGLArray(RowMajorMul(view_projection[eye], model));
+            sink = uniform[frame & 15];
+          }
+        }
+      });
+  std::vector<float> uniforms(32 * kObjectCount);
+  const double after_nanos =
+      test_util::NanosPerIteration(kFrameCount, [&](int frame) {
+        for (int i = 0; i < kObjectCount; ++i) {
+          const gvr::Mat4f pair_model[2] = {models[i], models[i]};
+          simd_math::MatrixPairMulToGL(view_projection, pair_model,
+                                       &uniforms[32 * i]);
+        }
+        sink = uniforms[frame & 31];
+      });
+  (void)sink;
+  printf("%d objects: multiply and transpose=%.1fus per frame, "
+         "column-major in one pass=%.1fus per frame\n",
+         kObjectCount, before_nanos / 1000.0, after_nanos / 1000.0);
+  return test_util::Finish();
+}
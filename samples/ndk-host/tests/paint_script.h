@@ -0,0 +1,85 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef NDK_HOST_TESTS_PAINT_SCRIPT_H_  // NOLINT
+#define NDK_HOST_TESTS_PAINT_SCRIPT_H_
+
+#include <math.h>
+
+#include <vector>
+
+#include "paint_simulation.h"  // NOLINT
+
+// Controller input for the tests that drive the controller paint sample's
+// PaintSimulation directly, one controller sample at a time.
+namespace paint_script {
+
+// A controller pointing |yaw| radians to the left and |pitch| radians up,
+// with nothing pressed.
+inline PaintInput Pointing(double yaw, double pitch) {
+  // Yaw about the vertical axis, then pitch about the horizontal one.
+  const float cy = static_cast<float>(cos(yaw / 2));
+  const float sy = static_cast<float>(sin(yaw / 2));
+  const float cp = static_cast<float>(cos(pitch / 2));
+  const float sp = static_cast<float>(sin(pitch / 2));
+  PaintInput input = PaintInput();
+  input.orientation.qx = cy * sp;
+  input.orientation.qy = sy * cp;
+  input.orientation.qz = -sy * sp;
+  input.orientation.qw = cy * cp;
+  input.touch_pos.x = 0.5f;
+  input.touch_pos.y = 0.5f;
+  return input;
+}
+
+// Appends the samples of a brush stroke along a circle of |radius| radians
+// around the given direction, |turns| times around, in |sample_count|
+// samples: the touchpad is clicked on the first one and let go after the
+// last one.
+inline void AppendCircle(double yaw, double pitch, double radius,
+                         double turns, int sample_count,
+                         std::vector<PaintInput>* inputs) {
+  for (int i = 0; i <= sample_count; ++i) {
+    const double angle = 2.0 * M_PI * turns * i / sample_count;
+    PaintInput input = Pointing(yaw + radius * cos(angle),
+                                pitch + radius * sin(angle));
+    input.is_touching = i < sample_count;
+    input.touch_down = input.click_button_down = i == 0;
+    input.touch_up = input.click_button_up = i == sample_count;
+    inputs->push_back(input);
+  }
+}
+
+// Appends a press of the app button that issues |command|: alone, it
+// clears; while touching the left of the touchpad, it undoes, and the right,
+// it redoes.
+inline void AppendAppButton(DrawingCommand command,
+                            std::vector<PaintInput>* inputs) {
+  const bool touching = command != kClearCommand;
+  PaintInput input = Pointing(0.0, 0.0);
+  input.app_button_down = true;
+  input.is_touching = input.touch_down = touching;
+  input.touch_pos.x = command == kRedoCommand ? 1.0f : 0.0f;
+  inputs->push_back(input);
+  input.app_button_down = input.is_touching = input.touch_down = false;
+  input.touch_up = touching;
+  inputs->push_back(input);
+}
+
+}  // namespace paint_script
+
+#endif  // NDK_HOST_TESTS_PAINT_SCRIPT_H_  // NOLINT
@@ -0,0 +1,314 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Checks the vector paths of simd_math.h, single and batched, against the
+// scalar loops the samples shipped with, on random matrices, and times the
+// two.
+
+#include <math.h>
+#include <stdio.h>
+
+#include <random>
+
+#include "simd_math.h"  // NOLINT
+#include "test_util.h"  // NOLINT
+
+namespace {
+
+// Largest difference allowed between the vector and scalar results, relative
+// to the magnitude of the inputs. The compiler may contract the scalar loops
+// into fused multiply-adds, which round differently.
+static const float kTolerance = 1e-5f;
+
+static const int kCaseCount = 1000;
+static const int kBenchmarkIterations = 2000000;
+
+static gvr::Mat4f ScalarMatrixMul(const gvr::Mat4f& m1, const gvr::Mat4f& m2) {
+  gvr::Mat4f result;
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      result.m[i][j] = 0.0f;
+      for (int k = 0; k < 4; ++k) {
+        result.m[i][j] += m1.m[i][k] * m2.m[k][j];
+      }
+    }
+  }
+  return result;
+}
+
+static simd_math::Vec4 ScalarMatrixVectorMul(const gvr::Mat4f& matrix,
+                                             const simd_math::Vec4& vec) {
+  simd_math::Vec4 result;
+  for (int i = 0; i < 4; ++i) {
+    result[i] = 0.0f;
+    for (int k = 0; k < 4; ++k) {
+      result[i] += matrix.m[i][k] * vec[k];
+    }
+  }
+  return result;
+}
+
+static gvr::Mat4f RandomMatrix(std::mt19937* random) {
+  std::uniform_real_distribution<float> value(-10.0f, 10.0f);
+  gvr::Mat4f matrix;
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) matrix.m[i][j] = value(*random);
+  }
+  return matrix;
+}
+
+static bool Near(float a, float b) {
+  // The products sum four terms of up to 100 each.
+  return fabs(a - b) <= kTolerance * 400.0f;
+}
+
+static void CheckMatrixMul(std::mt19937* random) {
+  for (int n = 0; n < kCaseCount; ++n) {
+    const gvr::Mat4f a = RandomMatrix(random);
+    const gvr::Mat4f b = RandomMatrix(random);
+    const gvr::Mat4f expected = ScalarMatrixMul(a, b);
+    const gvr::Mat4f product = simd_math::MatrixMul(a, b);
+    const simd_math::GLMat4 gl = simd_math::MatrixMulToGL(a, b);
+    bool same = true;
+    bool same_gl = true;
+    for (int i = 0; i < 4; ++i) {
+      for (int j = 0; j < 4; ++j) {
+        same = same && Near(product.m[i][j], expected.m[i][j]);
+        // GL matrices are column-major.
+        same_gl = same_gl && Near(gl[4 * j + i], expected.m[i][j]);
+      }
+    }
+    if (!EXPECT(same) || !EXPECT(same_gl)) return;
+  }
+}
+
+static void CheckMatrixPairMulToGL(std::mt19937* random) {
+  const gvr::Mat4f m1[2] = {RandomMatrix(random), RandomMatrix(random)};
+  const gvr::Mat4f m2[2] = {RandomMatrix(random), RandomMatrix(random)};
+  float out[32];
+  simd_math::MatrixPairMulToGL(m1, m2, out);
+  bool same = true;
+  for (int eye = 0; eye < 2; ++eye) {
+    const gvr::Mat4f expected = ScalarMatrixMul(m1[eye], m2[eye]);
+    for (int i = 0; i < 4; ++i) {
+      for (int j = 0; j < 4; ++j) {
+        same = same && Near(out[16 * eye + 4 * j + i], expected.m[i][j]);
+      }
+    }
+  }
+  EXPECT(same);
+}
+
+// Checks the batch products, with the result overwriting the batch too.
+static void CheckMatrixMulBatch(std::mt19937* random) {
+  static const int kBatchSize = 5;
+  for (int n = 0; n < kCaseCount / kBatchSize; ++n) {
+    gvr::Mat4f lhs[kBatchSize];
+    for (gvr::Mat4f& matrix : lhs) matrix = RandomMatrix(random);
+    const gvr::Mat4f rhs = RandomMatrix(random);
+    gvr::Mat4f out[kBatchSize];
+    float gl[16 * kBatchSize];
+    simd_math::MatrixMulBatch(lhs, rhs, out, kBatchSize);
+    simd_math::MatrixMulBatchToGL(lhs, rhs, gl, kBatchSize);
+    bool same = true;
+    bool same_gl = true;
+    for (int m = 0; m < kBatchSize; ++m) {
+      const gvr::Mat4f expected = ScalarMatrixMul(lhs[m], rhs);
+      for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+          same = same && Near(out[m].m[i][j], expected.m[i][j]);
+          same_gl = same_gl && Near(gl[16 * m + 4 * j + i], expected.m[i][j]);
+        }
+      }
+    }
+    simd_math::MatrixMulBatch(lhs, rhs, lhs, kBatchSize);
+    bool same_in_place = true;
+    for (int m = 0; m < kBatchSize; ++m) {
+      for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+          same_in_place = same_in_place && lhs[m].m[i][j] == out[m].m[i][j];
+        }
+      }
+    }
+    if (!EXPECT(same) || !EXPECT(same_gl) || !EXPECT(same_in_place)) return;
+  }
+  // An empty batch writes nothing.
+  float untouched = 1.0f;
+  simd_math::MatrixMulBatchToGL(nullptr, RandomMatrix(random), &untouched, 0);
+  EXPECT(untouched == 1.0f);
+}
+
+static void CheckTransformPoints(std::mt19937* random) {
+  static const int kPointCount = 7;
+  std::uniform_real_distribution<float> value(-10.0f, 10.0f);
+  for (int n = 0; n < kCaseCount / kPointCount; ++n) {
+    const gvr::Mat4f matrix = RandomMatrix(random);
+    simd_math::Vec4 points[kPointCount];
+    for (simd_math::Vec4& point : points) {
+      point = {{value(*random), value(*random), value(*random),
+                value(*random)}};
+    }
+    simd_math::Vec4 out[kPointCount];
+    simd_math::TransformPoints(matrix, points, out, kPointCount);
+    bool same = true;
+    for (int m = 0; m < kPointCount; ++m) {
+      const simd_math::Vec4 expected =
+          ScalarMatrixVectorMul(matrix, points[m]);
+      for (int i = 0; i < 4; ++i) same = same && Near(out[m][i], expected[i]);
+    }
+    simd_math::TransformPoints(matrix, points, points, kPointCount);
+    bool same_in_place = true;
+    for (int m = 0; m < kPointCount; ++m) {
+      same_in_place = same_in_place && points[m] == out[m];
+    }
+    if (!EXPECT(same) || !EXPECT(same_in_place)) return;
+  }
+}
+
+static void CheckMatrixVectorMul(std::mt19937* random) {
+  std::uniform_real_distribution<float> value(-10.0f, 10.0f);
+  for (int n = 0; n < kCaseCount; ++n) {
+    const gvr::Mat4f matrix = RandomMatrix(random);
+    const simd_math::Vec4 vec = {
+        {value(*random), value(*random), value(*random), value(*random)}};
+    const simd_math::Vec4 expected = ScalarMatrixVectorMul(matrix, vec);
+    const simd_math::Vec4 result = simd_math::MatrixVectorMul(matrix, vec);
+    bool same = true;
+    for (int i = 0; i < 4; ++i) same = same && Near(result[i], expected[i]);
+    if (!EXPECT(same)) return;
+  }
+}
+
+static void CheckMatrixToGL(std::mt19937* random) {
+  const gvr::Mat4f matrix = RandomMatrix(random);
+  const simd_math::GLMat4 gl = simd_math::MatrixToGL(matrix);
+  bool transposed = true;
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      transposed = transposed && gl[4 * j + i] == matrix.m[i][j];
+    }
+  }
+  EXPECT(transposed);
+}
+
+static void CheckQuatToMatrix(std::mt19937* random) {
+  std::normal_distribution<float> value;
+  for (int n = 0; n < kCaseCount; ++n) {
+    gvr::Quatf quat = {value(*random), value(*random), value(*random),
+                       value(*random)};
+    const float norm = sqrt(quat.qx * quat.qx + quat.qy * quat.qy +
+                            quat.qz * quat.qz + quat.qw * quat.qw);
+    quat.qx /= norm;
+    quat.qy /= norm;
+    quat.qz /= norm;
+    quat.qw /= norm;
+    // A unit quaternion makes a rotation: R R^T = I.
+    const gvr::Mat4f rotation = simd_math::QuatToMatrix(quat);
+    bool orthonormal = true;
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        float dot = 0.0f;
+        for (int k = 0; k < 3; ++k) {
+          dot += rotation.m[i][k] * rotation.m[j][k];
+        }
+        orthonormal = orthonormal && fabs(dot - (i == j ? 1.0f : 0.0f)) < 1e-5f;
+      }
+    }
+    if (!EXPECT(orthonormal)) return;
+  }
+}
+
+static void CheckPerspective() {
+  const gvr::Rectf fov = {40.0f, 50.0f, 45.0f, 35.0f};
+  const float z_near = 0.1f;
+  const float z_far = 100.0f;
+  EXPECT(simd_math::IsValidFrustum(fov, z_near, z_far));
+  EXPECT(!simd_math::IsValidFrustum(fov, z_far, z_near));
+  EXPECT(!simd_math::IsValidFrustum(fov, 0.0f, z_far));
+  const gvr::Rectf empty = {-10.0f, 10.0f, 45.0f, 35.0f};
+  EXPECT(!simd_math::IsValidFrustum(empty, z_near, z_far));
+
+  // The corners of the frustum go to the corners of the clip volume.
+  const gvr::Mat4f projection =
+      simd_math::PerspectiveMatrixFromView(fov, z_near, z_far);
+  const float left = -tan(fov.left * M_PI / 180.0f) * z_near;
+  const float top = tan(fov.top * M_PI / 180.0f) * z_near;
+  simd_math::Vec4 corner = simd_math::MatrixVectorMul(
+      projection, {{left, top, -z_near, 1.0f}});
+  EXPECT(fabs(corner[0] / corner[3] + 1.0f) < 1e-5f);
+  EXPECT(fabs(corner[1] / corner[3] - 1.0f) < 1e-5f);
+  EXPECT(fabs(corner[2] / corner[3] + 1.0f) < 1e-5f);
+  corner = simd_math::MatrixVectorMul(projection, {{0.0f, 0.0f, -z_far, 1.0f}});
+  EXPECT(fabs(corner[2] / corner[3] - 1.0f) < 1e-4f);
+}
+
+static void Benchmark(std::mt19937* random) {
+  gvr::Mat4f matrices[16];
+  for (gvr::Mat4f& matrix : matrices) matrix = RandomMatrix(random);
+  volatile float sink = 0.0f;
+  const double scalar_nanos =
+      test_util::NanosPerIteration(kBenchmarkIterations, [&](int i) {
+        sink = ScalarMatrixMul(matrices[i & 15], matrices[(i + 1) & 15])
+                   .m[i & 3][0];
+      });
+  const double simd_nanos =
+      test_util::NanosPerIteration(kBenchmarkIterations, [&](int i) {
+        sink = simd_math::MatrixMul(matrices[i & 15], matrices[(i + 1) & 15])
+                   .m[i & 3][0];
+      });
+  const double gl_nanos =
+      test_util::NanosPerIteration(kBenchmarkIterations, [&](int i) {
+        sink = simd_math::MatrixMulToGL(matrices[i & 15],
+                                        matrices[(i + 1) & 15])[i & 15];
+      });
+  // The MVPs of an object for both eyes, one at a time and as a batch.
+  float gl[32];
+  const double pair_nanos =
+      test_util::NanosPerIteration(kBenchmarkIterations, [&](int i) {
+        const gvr::Mat4f* lhs = &matrices[i & 14];
+        simd_math::MatrixMulToGL(lhs[0], matrices[(i + 5) & 15], gl);
+        simd_math::MatrixMulToGL(lhs[1], matrices[(i + 5) & 15], gl + 16);
+        sink = gl[i & 31];
+      });
+  const double batch_nanos =
+      test_util::NanosPerIteration(kBenchmarkIterations, [&](int i) {
+        simd_math::MatrixMulBatchToGL(&matrices[i & 14],
+                                      matrices[(i + 5) & 15], gl, 2);
+        sink = gl[i & 31];
+      });
+  (void)sink;
+  printf("MatrixMul: scalar=%.2fns simd=%.2fns; MatrixMulToGL=%.2fns\n",
+         scalar_nanos, simd_nanos, gl_nanos);
+  printf("Two MVPs: MatrixMulToGL twice=%.2fns MatrixMulBatchToGL=%.2fns\n",
+         pair_nanos, batch_nanos);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::mt19937 random(1);
+  CheckMatrixMul(&random);
+  CheckMatrixPairMulToGL(&random);
+  CheckMatrixMulBatch(&random);
+  CheckMatrixVectorMul(&random);
+  CheckTransformPoints(&random);
+  CheckMatrixToGL(&random);
+  CheckQuatToMatrix(&random);
+  CheckPerspective();
+  Benchmark(&random);
+  return test_util::Finish();
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Checks the lock-free queue the samples hand input and events to the
+// rendering thread with (spsc_ring.h): that it is first in, first out, holds
+// exactly its capacity, and wraps around; then has a producer and a
+// consumer thread pass a million values through a small ring, as fast as
+// they can and with one side stalling now and then, and checks that each
+// arrives once, in order and whole. Prints the time per value. Meant to be
+// run under ThreadSanitizer too:
+//
+//   cmake -S samples/ndk-host -B tsan -DCMAKE_CXX_FLAGS=-fsanitize=thread
+//   cmake --build tsan --target spsc_ring_test && tsan/spsc_ring_test
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>  // NOLINT
+#include <thread>  // NOLINT
+
+#include "spsc_ring.h"  // NOLINT
+#include "test_util.h"  // NOLINT
+
+namespace {
+
+// A value spanning several words, so that a torn copy shows.
+struct Value {
+  uint64_t sequence;
+  uint64_t check[3];
+};
+
+static Value MakeValue(uint64_t sequence) {
+  Value value;
+  value.sequence = sequence;
+  for (int i = 0; i < 3; ++i) {
+    value.check[i] = sequence * 0x9e3779b97f4a7c15ull + i;
+  }
+  return value;
+}
+
+static bool IsValue(const Value& value, uint64_t sequence) {
+  const Value expected = MakeValue(sequence);
+  return value.sequence == expected.sequence &&
+         value.check[0] == expected.check[0] &&
+         value.check[1] == expected.check[1] &&
+         value.check[2] == expected.check[2];
+}
+
+static void TestSingleThread() {
+  spsc::Ring<Value> ring(8);
+  EXPECT(ring.capacity() == 8);
+  Value value;
+  EXPECT(!ring.TryPop(&value));
+  // Fill and drain a few times, so the indices wrap around the slots.
+  uint64_t pushed = 0;
+  uint64_t popped = 0;
+  bool in_order = true;
+  for (int round = 0; round < 5; ++round) {
+    while (ring.TryPush(MakeValue(pushed))) ++pushed;
+    EXPECT(pushed - popped == 8);
+    for (int i = 0; i < 5 && ring.TryPop(&value); ++i) {
+      in_order = in_order && IsValue(value, popped++);
+    }
+  }
+  while (ring.TryPop(&value)) in_order = in_order && IsValue(value, popped++);
+  EXPECT(in_order);
+  EXPECT(pushed == popped && pushed == 8 + 4 * 5);
+  EXPECT(!ring.TryPop(&value));
+}
+
+// Passes |count| values from a producer thread to this one through a ring
+// of |capacity|. Every |stall_period| values, a side sleeps for a moment:
+// the producer if |stall_producer|, the consumer otherwise. Returns the
+// time per value, in nanoseconds.
+static double Stress(size_t capacity, uint64_t count, uint64_t stall_period,
+                     bool stall_producer) {
+  spsc::Ring<Value> ring(capacity);
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  std::thread producer([&ring, count, stall_period, stall_producer] {
+    for (uint64_t i = 0; i < count; ++i) {
+      while (!ring.TryPush(MakeValue(i))) std::this_thread::yield();
+      if (stall_producer && stall_period > 0 && i % stall_period == 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+    }
+  });
+  bool in_order = true;
+  Value value;
+  for (uint64_t i = 0; i < count; ++i) {
+    while (!ring.TryPop(&value)) std::this_thread::yield();
+    in_order = in_order && IsValue(value, i);
+    if (!stall_producer && stall_period > 0 && i % stall_period == 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+  producer.join();
+  const double ns = std::chrono::duration<double, std::nano>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+  EXPECT(in_order);
+  EXPECT(!ring.TryPop(&value));
+  return ns / count;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  TestSingleThread();
+  const double free_running_ns = Stress(64, 1000000, 0, false);
+  const double tiny_ring_ns = Stress(2, 200000, 0, false);
+  Stress(64, 200000, 10000, true);
+  Stress(64, 200000, 10000, false);
+  printf("%.0f ns per value through 64 slots, %.0f ns through 2\n",
+         free_running_ns, tiny_ring_ns);
+  return test_util::Finish();
+}
@@ -0,0 +1,297 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Tests the rings the controller paint sample streams the stroke being
+// painted through (streaming_vbo.h), against the host GL, which keeps the
+// contents of buffers: each sync uploads only what was appended, ranges
+// follow each other with their indices rebased, and a range that does not
+// fit orphans the buffers and starts over at their beginning. Then streams
+// a long stroke a few vertices per frame and prints the bytes uploaded per
+// frame.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "host_runtime.h"  // NOLINT
+#include "paint_simulation.h"  // NOLINT
+#include "streaming_vbo.h"  // NOLINT
+#include "test_util.h"  // NOLINT
+
+namespace {
+
+// A small ring, so that tests fill it in a few ranges.
+static const int kVertexCapacity = 32;
+static const int kIndexCapacity = 3 * kVertexCapacity;
+
+// The ring size of the sample, and a stroke painted over many frames, for
+// the benchmark.
+static const int kSampleVertexCapacity = 4096;
+static const int kSampleIndexCapacity = 3 * kSampleVertexCapacity;
+static const int kStrokeVertexCount = 3000;
+static const int kVerticesPerFrame = 4;
+
+// The geometry of a stroke as the paint simulation keeps it: a strip of
+// quads whose vertices are numbered by their x coordinate.
+struct TestGeometry {
+  std::vector<PaintVertex> vertices;
+  std::vector<GLushort> indices;
+
+  // Appends a quad, or the first two vertices of the strip.
+  void Extend(int first_number) {
+    const int count = static_cast<int>(vertices.size());
+    for (int i = 0; i < 2; ++i) {
+      PaintVertex vertex = {static_cast<float>(first_number + count + i),
+                            0.0f, 0.0f, 0, 0, {0, 0}};
+      vertices.push_back(vertex);
+    }
+    if (count == 0) return;
+    const GLushort quad[] = {
+        static_cast<GLushort>(count - 2), static_cast<GLushort>(count - 1),
+        static_cast<GLushort>(count), static_cast<GLushort>(count - 1),
+        static_cast<GLushort>(count + 1), static_cast<GLushort>(count)};
+    indices.insert(indices.end(), quad, quad + 6);
+  }
+};
+
+static void Sync(StreamingVbo* vbo, const TestGeometry& geometry) {
+  vbo->Sync(geometry.vertices.data(),
+            static_cast<int>(geometry.vertices.size()),
+            geometry.indices.data(),
+            static_cast<int>(geometry.indices.size()));
+}
+
+// Returns the bytes a sync of |vertex_count| vertices and |index_count|
+// indices uploads.
+static int64_t SyncBytes(int vertex_count, int index_count) {
+  return vertex_count * sizeof(PaintVertex) + index_count * sizeof(GLushort);
+}
+
+// Returns whether the current range of |vbo| holds |geometry|, its indices
+// rebased to the first of its vertices.
+static bool RangeHolds(const StreamingVbo& vbo, const TestGeometry& geometry) {
+  const std::vector<uint8_t> vertices =
+      host_runtime::GetBufferContents(vbo.vbo());
+  const std::vector<uint8_t> indices =
+      host_runtime::GetBufferContents(vbo.ibo());
+  if (vbo.index_count() != static_cast<int>(geometry.indices.size())) {
+    return false;
+  }
+  const size_t index_offset = vbo.first_index() * sizeof(GLushort);
+  if (indices.size() < index_offset + vbo.index_count() * sizeof(GLushort)) {
+    return false;
+  }
+  for (int i = 0; i < vbo.index_count(); ++i) {
+    GLushort index;
+    memcpy(&index, &indices[index_offset + i * sizeof(GLushort)],
+           sizeof(index));
+    // The index must point at the vertex it was given for.
+    const size_t vertex_offset = index * sizeof(PaintVertex);
+    if (vertices.size() < vertex_offset + sizeof(PaintVertex)) return false;
+    PaintVertex vertex;
+    memcpy(&vertex, &vertices[vertex_offset], sizeof(vertex));
+    if (vertex.x != geometry.vertices[geometry.indices[i]].x) return false;
+  }
+  return true;
+}
+
+static void TestAppend() {
+  StreamingVbo vbo;
+  vbo.Initialize(kVertexCapacity, sizeof(PaintVertex), kIndexCapacity);
+  EXPECT(vbo.index_count() == 0 && vbo.uploaded_bytes() == 0);
+  TestGeometry geometry;
+  int64_t uploaded_bytes = 0;
+  for (int quad = 0; quad < 4; ++quad) {
+    geometry.Extend(0);
+    host_runtime::ResetStats();
+    Sync(&vbo, geometry);
+    // Only the new vertices and indices are sent.
+    const int64_t expected = SyncBytes(2, quad == 0 ? 0 : 6);
+    EXPECT(host_runtime::GetStats().uploaded_bytes == expected);
+    uploaded_bytes += expected;
+    EXPECT(RangeHolds(vbo, geometry));
+    EXPECT(vbo.first_index() == 0);
+  }
+  EXPECT(vbo.uploaded_bytes() == uploaded_bytes);
+
+  // Nothing new, nothing sent.
+  host_runtime::ResetStats();
+  Sync(&vbo, geometry);
+  EXPECT(host_runtime::GetStats().uploaded_bytes == 0);
+  EXPECT(host_runtime::GetStats().gl_calls == 0);
+  vbo.Destroy();
+}
+
+static void TestRanges() {
+  StreamingVbo vbo;
+  vbo.Initialize(kVertexCapacity, sizeof(PaintVertex), kIndexCapacity);
+  const GLuint first_vbo = vbo.vbo();
+  TestGeometry first;
+  for (int quad = 0; quad < 5; ++quad) first.Extend(0);
+  Sync(&vbo, first);
+
+  // The next range goes after the first, which stays as it was, and its
+  // indices are rebased to where its vertices went.
+  vbo.StartRange();
+  TestGeometry second;
+  for (int quad = 0; quad < 3; ++quad) second.Extend(100);
+  Sync(&vbo, second);
+  EXPECT(vbo.first_index() == static_cast<int>(first.indices.size()));
+  EXPECT(RangeHolds(vbo, second));
+  EXPECT(vbo.vbo() == first_vbo);
+  const std::vector<uint8_t> vertices = host_runtime::GetBufferContents(
+      vbo.vbo());
+  PaintVertex vertex;
+  memcpy(&vertex, &vertices[0], sizeof(vertex));
+  EXPECT(vertex.x == 0.0f);
+  vbo.Destroy();
+}
+
+static void TestOrphan() {
+  StreamingVbo vbo;
+  vbo.Initialize(kVertexCapacity, sizeof(PaintVertex), kIndexCapacity);
+  const GLuint first_vbo = vbo.vbo();
+  TestGeometry first;
+  for (int quad = 0; quad < 10; ++quad) first.Extend(0);
+  Sync(&vbo, first);
+  vbo.StartRange();
+
+  // The next range fits at first, then outgrows what is left of the ring.
+  TestGeometry second;
+  int64_t uploaded_bytes = 0;
+  for (int quad = 0; quad < 8; ++quad) {
+    second.Extend(100);
+    const int vertex_start = static_cast<int>(first.vertices.size());
+    const bool fits = vertex_start + second.vertices.size() <=
+                      static_cast<size_t>(kVertexCapacity);
+    const bool was_wrapped = vbo.first_index() == 0;
+    host_runtime::ResetStats();
+    Sync(&vbo, second);
+    uploaded_bytes += host_runtime::GetStats().uploaded_bytes;
+    EXPECT(RangeHolds(vbo, second));
+    if (fits) {
+      EXPECT(vbo.first_index() == static_cast<int>(first.indices.size()));
+    } else {
+      EXPECT(vbo.first_index() == 0);
+      if (!was_wrapped) {
+        // The buffers were re-specified, so the first range is gone, and
+        // the whole second range was sent again at their start.
+        EXPECT(host_runtime::GetStats().uploaded_bytes ==
+               SyncBytes(static_cast<int>(second.vertices.size()),
+                         static_cast<int>(second.indices.size())));
+        const std::vector<uint8_t> vertices =
+            host_runtime::GetBufferContents(vbo.vbo());
+        PaintVertex vertex;
+        memcpy(&vertex, &vertices[second.vertices.size() *
+                                  sizeof(PaintVertex)],
+               sizeof(vertex));
+        EXPECT(vertex.x == 0.0f && vertices.size() ==
+               kVertexCapacity * sizeof(PaintVertex));
+      }
+    }
+  }
+  EXPECT(vbo.first_index() == 0);
+  // Orphaning keeps the buffer names.
+  EXPECT(vbo.vbo() == first_vbo);
+  EXPECT(uploaded_bytes > SyncBytes(static_cast<int>(second.vertices.size()),
+                                    static_cast<int>(second.indices.size())));
+  vbo.Destroy();
+}
+
+static void TestLifetime() {
+  const int buffers_before = host_runtime::GetLiveBufferCount();
+  StreamingVbo vbo;
+  vbo.Initialize(kVertexCapacity, sizeof(PaintVertex), kIndexCapacity);
+  EXPECT(host_runtime::GetLiveBufferCount() == buffers_before + 2);
+  TestGeometry geometry;
+  geometry.Extend(0);
+  geometry.Extend(0);
+  Sync(&vbo, geometry);
+  EXPECT(vbo.uploaded_bytes() > 0);
+
+  // Initializing again replaces the buffers and starts the count over.
+  vbo.Initialize(kVertexCapacity, sizeof(PaintVertex), kIndexCapacity);
+  EXPECT(host_runtime::GetLiveBufferCount() == buffers_before + 2);
+  EXPECT(vbo.uploaded_bytes() == 0 && vbo.index_count() == 0);
+  vbo.Destroy();
+  EXPECT(host_runtime::GetLiveBufferCount() == buffers_before);
+  EXPECT(vbo.vbo() == 0 && vbo.ibo() == 0);
+  vbo.Destroy();
+  EXPECT(host_runtime::GetLiveBufferCount() == buffers_before);
+
+  // Abandoned buffers are left alone, as they belong to a lost context.
+  vbo.Initialize(kVertexCapacity, sizeof(PaintVertex), kIndexCapacity);
+  GLuint abandoned[] = {vbo.vbo(), vbo.ibo()};
+  vbo.Abandon();
+  EXPECT(vbo.vbo() == 0 && vbo.ibo() == 0);
+  vbo.Initialize(kVertexCapacity, sizeof(PaintVertex), kIndexCapacity);
+  EXPECT(host_runtime::GetLiveBufferCount() == buffers_before + 4);
+  EXPECT(vbo.vbo() != abandoned[0]);
+  vbo.Destroy();
+  EXPECT(!host_runtime::GetBufferContents(abandoned[0]).empty());
+  glDeleteBuffers(2, abandoned);
+  EXPECT(host_runtime::GetLiveBufferCount() == buffers_before);
+}
+
+// Streams a stroke a few vertices per frame, as it is painted, and prints
+// the bytes uploaded per frame.
+static void BenchmarkStroke() {
+  StreamingVbo vbo;
+  vbo.Initialize(kSampleVertexCapacity, sizeof(PaintVertex),
+                 kSampleIndexCapacity);
+  TestGeometry geometry;
+  int frames = 0;
+  int64_t max_frame_bytes = 0;
+  host_runtime::ResetStats();
+  while (static_cast<int>(geometry.vertices.size()) < kStrokeVertexCount) {
+    for (int i = 0; i < kVerticesPerFrame / 2; ++i) geometry.Extend(0);
+    const int64_t bytes_before = host_runtime::GetStats().uploaded_bytes;
+    Sync(&vbo, geometry);
+    max_frame_bytes = std::max(
+        max_frame_bytes, host_runtime::GetStats().uploaded_bytes -
+                             bytes_before);
+    ++frames;
+  }
+  // Each vertex and index crosses once.
+  EXPECT(vbo.uploaded_bytes() ==
+         SyncBytes(static_cast<int>(geometry.vertices.size()),
+                   static_cast<int>(geometry.indices.size())));
+  EXPECT(max_frame_bytes == SyncBytes(kVerticesPerFrame,
+                                      3 * kVerticesPerFrame));
+  printf("a stroke of %d vertices over %d frames: %.0f bytes uploaded per "
+         "frame instead of %.0f if it were sent whole\n",
+         static_cast<int>(geometry.vertices.size()), frames,
+         static_cast<double>(vbo.uploaded_bytes()) / frames,
+         static_cast<double>(SyncBytes(
+             static_cast<int>(geometry.vertices.size()),
+             static_cast<int>(geometry.indices.size()))) / 2);
+  vbo.Destroy();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  host_runtime::SetLogEnabled(false);
+  TestAppend();
+  TestRanges();
+  TestOrphan();
+  TestLifetime();
+  BenchmarkStroke();
+  return test_util::Finish();
+}
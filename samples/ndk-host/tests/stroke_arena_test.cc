@@ -0,0 +1,261 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Tests the page allocator and the per-color vertex buffer arenas the
+// controller paint sample keeps committed strokes in (stroke_arena.h),
+// against the host GL, which keeps the contents of buffers: chunks are
+// packed into pages, their indices rebased, and pages deleted once released
+// or compacted. Then fills an arena the way a long painting session does
+// and prints the draw calls it takes.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "host_runtime.h"  // NOLINT
+#include "paint_simulation.h"  // NOLINT
+#include "stroke_arena.h"  // NOLINT
+#include "test_util.h"  // NOLINT
+
+namespace {
+
+// A small page, so that tests fill it in a few chunks.
+static const int kPageCapacity = 64;
+static const int kChunkVertexCount = 20;
+
+// The page size and chunk size of the sample, for the benchmark.
+static const int kSamplePageCapacity = 16384;
+static const int kSampleChunkVertexCount = 50;
+static const int kSampleColorCount = 4;
+static const int kSessionChunkCount = 10000;
+
+// A strip of quads, as the paint simulation makes, whose vertices are
+// numbered by their x coordinate.
+struct TestChunk {
+  std::vector<PaintVertex> vertices;
+  std::vector<GLushort> indices;
+};
+
+static TestChunk MakeChunk(int first_number, int vertex_count) {
+  TestChunk chunk;
+  for (int i = 0; i < vertex_count; ++i) {
+    PaintVertex vertex = {static_cast<float>(first_number + i), 0.0f, 0.0f,
+                          0, 0, {0, 0}};
+    chunk.vertices.push_back(vertex);
+  }
+  for (int i = 0; i + 3 < vertex_count; i += 2) {
+    const GLushort quad[] = {
+        static_cast<GLushort>(i), static_cast<GLushort>(i + 1),
+        static_cast<GLushort>(i + 2), static_cast<GLushort>(i + 1),
+        static_cast<GLushort>(i + 3), static_cast<GLushort>(i + 2)};
+    chunk.indices.insert(chunk.indices.end(), quad, quad + 6);
+  }
+  return chunk;
+}
+
+static int AddChunk(StrokeArena* arena, int owner, int color,
+                    const TestChunk& chunk) {
+  return arena->AddChunk(owner, color, chunk.vertices.data(),
+                         static_cast<int>(chunk.vertices.size()),
+                         chunk.indices.data(),
+                         static_cast<int>(chunk.indices.size()));
+}
+
+// Returns whether the page of |chunk| holds its vertices, and its indices
+// rebased to the first of them.
+static bool PageHoldsChunk(const StrokeArena& arena, int chunk,
+                           const TestChunk& data) {
+  const StrokeArena::Chunk& info = arena.chunks()[chunk];
+  const std::vector<uint8_t> vertices = host_runtime::GetBufferContents(
+      arena.page_vbo(info.color, info.page));
+  const std::vector<uint8_t> indices = host_runtime::GetBufferContents(
+      arena.page_ibo(info.color, info.page));
+  const size_t vertex_offset = info.first_vertex * sizeof(PaintVertex);
+  const size_t index_offset = info.first_index * sizeof(GLushort);
+  if (vertices.size() < vertex_offset + info.vertex_count * sizeof(PaintVertex)
+      || indices.size() < index_offset + info.index_count * sizeof(GLushort)) {
+    return false;
+  }
+  if (memcmp(&vertices[vertex_offset], data.vertices.data(),
+             data.vertices.size() * sizeof(PaintVertex)) != 0) {
+    return false;
+  }
+  for (int i = 0; i < info.index_count; ++i) {
+    GLushort index;
+    memcpy(&index, &indices[index_offset + i * sizeof(GLushort)],
+           sizeof(index));
+    if (index != data.indices[i] + info.first_vertex) return false;
+  }
+  return true;
+}
+
+static void TestPageAllocator() {
+  PageAllocator allocator(100, 300);
+  PageAllocator::Allocation a = allocator.Allocate(40, 60);
+  EXPECT(a.page == 0 && a.first_vertex == 0 && a.first_index == 0);
+  a = allocator.Allocate(40, 60);
+  EXPECT(a.page == 0 && a.first_vertex == 40 && a.first_index == 60);
+  // Not enough vertices left.
+  a = allocator.Allocate(40, 60);
+  EXPECT(a.page == 1 && a.first_vertex == 0 && a.first_index == 0);
+  // Not enough indices left.
+  a = allocator.Allocate(10, 250);
+  EXPECT(a.page == 2);
+  EXPECT(allocator.page_count() == 3);
+  EXPECT(allocator.vertices_used(0) == 80 && allocator.indices_used(0) == 120);
+  allocator.Clear();
+  EXPECT(allocator.page_count() == 0);
+}
+
+static void TestPacking() {
+  const int buffers_before = host_runtime::GetLiveBufferCount();
+  StrokeArena arena(2, kPageCapacity, sizeof(PaintVertex));
+  std::vector<TestChunk> data;
+  std::vector<int> chunks;
+  for (int i = 0; i < 4; ++i) {
+    data.push_back(MakeChunk(100 * i, kChunkVertexCount));
+    chunks.push_back(AddChunk(&arena, i, i % 2, data.back()));
+  }
+  // Each color gets its own page, and chunks of a color follow each other.
+  EXPECT(arena.page_count(0) == 1 && arena.page_count(1) == 1);
+  const StrokeArena::Chunk& first = arena.chunks()[chunks[0]];
+  const StrokeArena::Chunk& third = arena.chunks()[chunks[2]];
+  EXPECT(third.page == first.page);
+  EXPECT(third.first_vertex == first.first_vertex + first.vertex_count);
+  EXPECT(third.first_index == first.first_index + first.index_count);
+  EXPECT(arena.page_index_count(0, 0) == first.index_count + third.index_count);
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    EXPECT(arena.chunks()[chunks[i]].owner == static_cast<int>(i));
+    EXPECT(PageHoldsChunk(arena, chunks[i], data[i]));
+  }
+  EXPECT(arena.allocated_vertex_count() == 2 * kPageCapacity);
+  arena.Clear();
+  EXPECT(host_runtime::GetLiveBufferCount() == buffers_before);
+  EXPECT(arena.chunks().empty() && arena.allocated_vertex_count() == 0);
+}
+
+static void TestRelease() {
+  const int buffers_before = host_runtime::GetLiveBufferCount();
+  StrokeArena arena(1, kPageCapacity, sizeof(PaintVertex));
+  const TestChunk data = MakeChunk(0, kChunkVertexCount);
+  // Three chunks fill the first page, the fourth opens the second.
+  std::vector<int> chunks;
+  for (int i = 0; i < 4; ++i) chunks.push_back(AddChunk(&arena, i, 0, data));
+  EXPECT(arena.page_count(0) == 2 && arena.chunks()[chunks[3]].page == 1);
+  const GLuint first_vbo = arena.page_vbo(0, 0);
+
+  // The full page goes with its last chunk.
+  arena.ReleaseChunk(chunks[0]);
+  arena.ReleaseChunk(chunks[1]);
+  EXPECT(arena.page_vbo(0, 0) == first_vbo);
+  arena.ReleaseChunk(chunks[2]);
+  EXPECT(arena.page_vbo(0, 0) == 0 && arena.page_ibo(0, 0) == 0);
+  EXPECT(host_runtime::GetBufferContents(first_vbo).empty());
+  EXPECT(arena.allocated_vertex_count() == kPageCapacity);
+  std::vector<GLuint> deleted;
+  arena.TakeDeletedVbos(&deleted);
+  EXPECT(deleted.size() == 1 && deleted[0] == first_vbo);
+  deleted.clear();
+  arena.TakeDeletedVbos(&deleted);
+  EXPECT(deleted.empty());
+
+  // The page chunks are still added to stays, even if empty, until a chunk
+  // does not fit in it.
+  arena.ReleaseChunk(chunks[3]);
+  EXPECT(arena.page_vbo(0, 1) != 0);
+  AddChunk(&arena, 4, 0, MakeChunk(0, kPageCapacity - kChunkVertexCount / 2));
+  EXPECT(arena.page_count(0) == 3);
+  EXPECT(arena.page_vbo(0, 1) == 0 && arena.page_vbo(0, 2) != 0);
+  arena.Clear();
+  EXPECT(host_runtime::GetLiveBufferCount() == buffers_before);
+}
+
+static void TestCompaction() {
+  StrokeArena arena(1, kPageCapacity, sizeof(PaintVertex));
+  std::vector<TestChunk> data;
+  std::vector<int> chunks;
+  for (int i = 0; i < 4; ++i) {
+    data.push_back(MakeChunk(100 * i, kChunkVertexCount));
+    chunks.push_back(AddChunk(&arena, i, 0, data.back()));
+  }
+  // One of three chunks left is not sparse enough to be worth moving; the
+  // page being filled never is.
+  arena.ReleaseChunk(chunks[0]);
+  EXPECT(arena.FindSparsePage(0) == -1);
+  arena.ReleaseChunk(chunks[1]);
+  EXPECT(arena.FindSparsePage(0) == 0);
+
+  // Moving what is left deletes the page.
+  std::vector<int> left;
+  arena.GetPageChunks(0, 0, &left);
+  EXPECT(left.size() == 1 && left[0] == chunks[2]);
+  for (int chunk : left) {
+    const int owner = arena.chunks()[chunk].owner;
+    const int moved = AddChunk(&arena, owner, 0, data[owner]);
+    EXPECT(PageHoldsChunk(arena, moved, data[owner]));
+    arena.ReleaseChunk(chunk);
+  }
+  EXPECT(arena.page_vbo(0, 0) == 0);
+  EXPECT(arena.FindSparsePage(0) == -1);
+  EXPECT(PageHoldsChunk(arena, chunks[3], data[3]));
+  arena.Clear();
+}
+
+// Commits the chunks of a long session, in colors taken in turns of a few
+// strokes, and prints the pages, which are the draw calls of each eye when
+// the whole drawing is visible.
+static void BenchmarkSession() {
+  StrokeArena arena(kSampleColorCount, kSamplePageCapacity,
+                    sizeof(PaintVertex));
+  const TestChunk data = MakeChunk(0, kSampleChunkVertexCount);
+  host_runtime::ResetStats();
+  const double nanos =
+      test_util::NanosPerIteration(kSessionChunkCount, [&](int i) {
+        AddChunk(&arena, i, (i / 20) % kSampleColorCount, data);
+      });
+  int pages = 0;
+  for (int color = 0; color < kSampleColorCount; ++color) {
+    pages += arena.page_count(color);
+  }
+  // Chunks are never split across pages, which wastes the end of each.
+  const int vertices = kSessionChunkCount * kSampleChunkVertexCount;
+  const int chunks_per_page = kSamplePageCapacity / kSampleChunkVertexCount;
+  const int max_pages =
+      kSampleColorCount *
+      (kSessionChunkCount / kSampleColorCount / chunks_per_page + 1);
+  EXPECT(pages <= max_pages);
+  printf("%d chunks, %d vertices: %d pages, so %d draw calls per eye "
+         "instead of %d; %.2fus and %.1f GL calls per chunk\n",
+         kSessionChunkCount, vertices, pages, pages, kSessionChunkCount,
+         nanos / 1000.0,
+         static_cast<double>(host_runtime::GetStats().gl_calls) /
+             kSessionChunkCount);
+  arena.Clear();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  host_runtime::SetLogEnabled(false);
+  TestPageAllocator();
+  TestPacking();
+  TestRelease();
+  TestCompaction();
+  BenchmarkSession();
+  return test_util::Finish();
+}
@@ -0,0 +1,225 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Checks the centreline the controller paint sample extrudes brush strokes
+// along (stroke_builder.h), with the sample's settings, on circles of a few
+// sizes and on a straight line, sampled as the sample samples the cursor
+// and as sparsely as a fast motion is: that the direction turns and the
+// segments grow no more than allowed, that the provisional points reach
+// the last sample, and, when the curve is sampled densely, that the
+// segments stay within the tolerance of it. A fast motion gives the spline
+// too few samples to follow tight curves. Prints the vertices per meter of
+// stroke and the largest error, against the straight quads every 4 cm the
+// sample used to extrude, and the time each sample takes.
+
+#include <math.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "stroke_builder.h"  // NOLINT
+#include "test_util.h"  // NOLINT
+
+namespace {
+
+typedef std::array<float, 3> Vec3;
+
+// The settings of PaintSimulation, at its paint distance.
+static const float kPaintDistance = 2.0f;
+static const float kTolerance = 0.001f * kPaintDistance;
+static const float kMaxSegmentLength = 0.2f;
+static const float kMaxTurn = 0.26f;
+static const float kSampleSpacing = 0.015f;
+
+// Spacing of the samples of a fast motion: a hand moving at 3 m/s, seen by
+// a 60 Hz frame loop.
+static const float kFastSampleSpacing = 0.05f;
+
+// Length of the segments the sample used to extrude, each one a quad of two
+// new vertices.
+static const float kOldSegmentLength = 0.04f;
+
+// A curve in the plane at the paint distance, by arc length, and the
+// distance of a point from it.
+struct Curve {
+  const char* name;
+  float length;
+  std::function<Vec3(float s)> point;
+  std::function<float(const Vec3& p)> distance;
+  // Largest distance between the curve and a chord of kOldSegmentLength.
+  float old_error;
+};
+
+static Curve Circle(const char* name, float radius, float turns) {
+  Curve curve;
+  curve.name = name;
+  curve.length = static_cast<float>(2 * M_PI * radius * turns);
+  curve.point = [radius](float s) {
+    const float angle = s / radius;
+    return Vec3{radius * cosf(angle), radius * sinf(angle), -kPaintDistance};
+  };
+  curve.distance = [radius](const Vec3& p) {
+    const float in_plane = hypotf(p[0], p[1]) - radius;
+    return hypotf(in_plane, p[2] + kPaintDistance);
+  };
+  const float half_chord = 0.5f * kOldSegmentLength;
+  curve.old_error =
+      radius - sqrtf(std::max(0.0f, radius * radius - half_chord * half_chord));
+  return curve;
+}
+
+static Curve Line(float length) {
+  Curve curve;
+  curve.name = "line";
+  curve.length = length;
+  curve.point = [](float s) {
+    return Vec3{s * 0.8f, s * 0.6f, -kPaintDistance};
+  };
+  curve.distance = [](const Vec3& p) {
+    // Distance from the line through the origin along (0.8, 0.6) in the
+    // plane.
+    return hypotf(0.6f * p[0] - 0.8f * p[1], p[2] + kPaintDistance);
+  };
+  curve.old_error = 0.0f;
+  return curve;
+}
+
+static float Distance(const Vec3& a, const Vec3& b) {
+  return sqrtf((a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1]) +
+               (a[2] - b[2]) * (a[2] - b[2]));
+}
+
+static float Dot(const Vec3& a, const Vec3& b) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Returns the samples of |curve|, |spacing| apart along it, ending at its
+// end.
+static std::vector<Vec3> Sample(const Curve& curve, float spacing) {
+  std::vector<Vec3> samples;
+  const int count = static_cast<int>(ceilf(curve.length / spacing));
+  for (int i = 0; i <= count; ++i) {
+    samples.push_back(curve.point(std::min(curve.length, i * spacing)));
+  }
+  return samples;
+}
+
+struct Result {
+  int point_count;
+  float max_error;
+};
+
+// Points checked along each segment of the centreline, ends excluded.
+static const int kSegmentChecks = 8;
+
+// Builds the stroke of |samples| along |curve| and checks it. Its error is
+// the largest distance from the curve of the segments between its points.
+static Result Build(const Curve& curve, const std::vector<Vec3>& samples,
+                    bool check_error) {
+  StrokeBuilder builder(kTolerance, kMaxSegmentLength, kMaxTurn);
+  std::vector<StrokePoint> points;
+  std::vector<StrokePoint> provisional;
+  bool provisional_reaches_sample = true;
+  builder.Begin(samples[0]);
+  for (size_t i = 1; i < samples.size(); ++i) {
+    builder.AddSample(samples[i], &points);
+    provisional.clear();
+    builder.GetProvisionalPoints(&provisional);
+    provisional_reaches_sample =
+        provisional_reaches_sample && !provisional.empty() &&
+        Distance(provisional.back().position, samples[i]) < 1e-4f;
+  }
+  builder.End(&points);
+  EXPECT(provisional_reaches_sample);
+
+  Result result = {static_cast<int>(points.size()), 0.0f};
+  if (!EXPECT(points.size() >= 2)) return result;
+  EXPECT(Distance(points.front().position, samples.front()) < 1e-4f &&
+         Distance(points.back().position, samples.back()) < 1e-4f);
+  bool tangents_are_unit = true;
+  bool segments_are_short = true;
+  bool turns_are_small = true;
+  // The merging stage may bend the centreline by a little more than the
+  // subdivision does.
+  const float min_turn_cosine = cosf(kMaxTurn * 1.1f);
+  for (size_t i = 0; i < points.size(); ++i) {
+    result.max_error =
+        std::max(result.max_error, curve.distance(points[i].position));
+    for (int k = 1; i > 0 && k <= kSegmentChecks; ++k) {
+      const float t = static_cast<float>(k) / (kSegmentChecks + 1);
+      Vec3 p;
+      for (int c = 0; c < 3; ++c) {
+        p[c] = (1 - t) * points[i - 1].position[c] + t * points[i].position[c];
+      }
+      result.max_error = std::max(result.max_error, curve.distance(p));
+    }
+    tangents_are_unit = tangents_are_unit &&
+                        fabsf(Dot(points[i].tangent, points[i].tangent) - 1) <
+                            1e-3f;
+    if (i == 0) continue;
+    segments_are_short =
+        segments_are_short &&
+        Distance(points[i - 1].position, points[i].position) <=
+            kMaxSegmentLength * 1.001f;
+    turns_are_small = turns_are_small &&
+                      Dot(points[i - 1].tangent, points[i].tangent) >=
+                          min_turn_cosine;
+  }
+  EXPECT(tangents_are_unit);
+  EXPECT(segments_are_short);
+  EXPECT(turns_are_small);
+  if (check_error) EXPECT(result.max_error <= kTolerance);
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const Curve curves[] = {
+      Circle("tight circle", 0.05f, 1.0f), Circle("circle", 0.5f, 1.0f),
+      Circle("wide circle", 2.0f, 0.25f), Line(2.0f),
+  };
+  for (const Curve& curve : curves) {
+    const Result result = Build(curve, Sample(curve, kSampleSpacing), true);
+    const Result fast =
+        Build(curve, Sample(curve, kFastSampleSpacing), false);
+    printf("%s: %.0f vertices/m with %.2f mm error, %.0f with %.2f mm when "
+           "fast; the old quads took %.0f with %.2f mm\n",
+           curve.name, 2 * result.point_count / curve.length,
+           1000 * result.max_error, 2 * fast.point_count / curve.length,
+           1000 * fast.max_error, 2 / kOldSegmentLength,
+           1000 * curve.old_error);
+  }
+
+  // A long stroke going around in circles, one sample at a time.
+  const Curve circle = Circle("circle", 0.5f, 50.0f);
+  const std::vector<Vec3> samples = Sample(circle, kSampleSpacing);
+  StrokeBuilder builder(kTolerance, kMaxSegmentLength, kMaxTurn);
+  std::vector<StrokePoint> points;
+  builder.Begin(samples[0]);
+  volatile int sink = 0;
+  const int sample_count = static_cast<int>(samples.size()) - 1;
+  const double ns = test_util::NanosPerIteration(sample_count, [&](int i) {
+    points.clear();
+    builder.AddSample(samples[i + 1], &points);
+    sink = sink + static_cast<int>(points.size());
+  });
+  printf("%.2f us per sample\n", ns / 1000.0);
+  return test_util::Finish();
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Checks that the indexed stroke geometry of the controller paint sample
+// draws the same triangles as the six vertices per segment it used to emit:
+// for the edges (top, bottom) at two consecutive points of a stroke, the
+// triangles (start top, start bottom, end top) and (start bottom, end
+// bottom, end top), with texture coordinate S going from 0 to 1 along the
+// segment and T from 0 at the top to 1 at the bottom. Prints the vertices
+// and bytes saved.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "paint_script.h"  // NOLINT
+#include "paint_simulation.h"  // NOLINT
+#include "test_util.h"  // NOLINT
+
+namespace {
+
+static const int kColorCount = 4;
+static const float kPaintDistance = 2.0f;
+
+// Size of the vertices the sample used to emit: a position and two float
+// texture coordinates.
+static const int kOldVertexSize = 5 * sizeof(float);
+
+static bool SamePosition(const PaintVertex& a, const PaintVertex& b) {
+  return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+// Checks the triangles of |chunk| against those of the old layout, built
+// from its edges. Returns the number of segments.
+static int CheckChunk(const StrokeChunk& chunk) {
+  const std::vector<PaintVertex>& vertices = chunk.vertices;
+  const std::vector<GLushort>& indices = chunk.indices;
+  if (!EXPECT(vertices.size() % 2 == 0 && vertices.size() >= 4)) return 0;
+  const int segment_count = static_cast<int>(vertices.size()) / 2 - 1;
+  if (!EXPECT(static_cast<int>(indices.size()) == 6 * segment_count)) {
+    return 0;
+  }
+  bool same = true;
+  for (int i = 0; i < segment_count && same; ++i) {
+    const PaintVertex& start_top = vertices[2 * i];
+    const PaintVertex& start_bottom = vertices[2 * i + 1];
+    const PaintVertex& end_top = vertices[2 * i + 2];
+    const PaintVertex& end_bottom = vertices[2 * i + 3];
+    const PaintVertex* expected[6] = {&start_top, &start_bottom, &end_top,
+                                      &start_bottom, &end_bottom, &end_top};
+    for (int k = 0; k < 6; ++k) {
+      if (indices[6 * i + k] >= vertices.size()) {
+        same = false;
+        break;
+      }
+      const PaintVertex& vertex = vertices[indices[6 * i + k]];
+      same = same && SamePosition(vertex, *expected[k]) &&
+             vertex.t == expected[k]->t;
+    }
+    // The shader only uses the fractional part of S, which interpolates
+    // from 0 to 1 across the segment when S counts up by one.
+    same = same && start_top.t == 0 && start_bottom.t == 1 &&
+           end_top.s == start_top.s + 1 && start_bottom.s == start_top.s &&
+           end_bottom.s == end_top.s;
+  }
+  EXPECT(same);
+  return segment_count;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<PaintInput> inputs;
+  // Slow and fast circles, tight and wide, and a stroke that goes around
+  // several times so it is committed in many chunks.
+  paint_script::AppendCircle(0.0, 0.0, 0.3, 1.0, 400, &inputs);
+  paint_script::AppendCircle(0.2, -0.1, 0.05, 1.0, 60, &inputs);
+  paint_script::AppendCircle(-0.3, 0.2, 0.5, 0.5, 40, &inputs);
+  paint_script::AppendCircle(0.0, 0.1, 0.2, 5.0, 2000, &inputs);
+
+  PaintSimulation simulation(kColorCount, kPaintDistance);
+  std::vector<DrawingEdit> edits;
+  for (const PaintInput& input : inputs) {
+    simulation.Update(input);
+    simulation.TakeEdits(&edits);
+  }
+
+  int chunk_count = 0;
+  int segment_count = 0;
+  int vertex_count = 0;
+  int index_count = 0;
+  const StrokeChunk* previous = nullptr;
+  for (const DrawingEdit& edit : edits) {
+    if (!EXPECT(!edit.is_command)) continue;
+    const StrokeChunk& chunk = edit.chunk;
+    segment_count += CheckChunk(chunk);
+    // A chunk continues the previous one of its stroke from its last edge,
+    // so the stroke has no gaps.
+    if (previous && previous->stroke == chunk.stroke) {
+      const PaintVertex* last = &previous->vertices.back() - 1;
+      EXPECT(SamePosition(chunk.vertices[0], last[0]) &&
+             SamePosition(chunk.vertices[1], last[1]));
+    }
+    previous = &chunk;
+    ++chunk_count;
+    vertex_count += static_cast<int>(chunk.vertices.size());
+    index_count += static_cast<int>(chunk.indices.size());
+  }
+  EXPECT(chunk_count > 4);
+
+  const int old_bytes = 6 * segment_count * kOldVertexSize;
+  const int new_bytes = vertex_count * static_cast<int>(sizeof(PaintVertex)) +
+                        index_count * static_cast<int>(sizeof(GLushort));
+  printf("%d chunks, %d segments: %d vertices instead of %d, %d bytes with "
+         "indices instead of %d\n",
+         chunk_count, segment_count, vertex_count, 6 * segment_count,
+         new_bytes, old_bytes);
+  return test_util::Finish();
+}
@@ -0,0 +1,429 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Checks the undo history of the controller paint sample (stroke_history.h):
+// the chunks visible after undo, redo and clear, which chunks are released
+// and when, that the memory budget forgets the strokes that could be redone
+// before the oldest undo steps, and that PaintSimulation reports strokes
+// and commands in the order they happened. Then runs a long session with a
+// small budget, releasing chunks from a StrokeArena the way the sample
+// does, and prints the GPU pages it keeps.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "host_runtime.h"  // NOLINT
+#include "paint_script.h"  // NOLINT
+#include "paint_simulation.h"  // NOLINT
+#include "stroke_arena.h"  // NOLINT
+#include "stroke_history.h"  // NOLINT
+#include "test_util.h"  // NOLINT
+
+namespace {
+
+// Large enough that the history never forgets anything in the tests that
+// do not look at the budget.
+static const size_t kLargeBudget = 1 << 30;
+
+// Size of every chunk in the budget tests. It dwarfs the size of a command.
+static const size_t kChunkBytes = 1000;
+
+// The session: strokes of a few chunks, with undos and redos, and a clear
+// now and then, at the page size of the sample.
+static const int kSessionStrokeCount = 5000;
+static const int kSessionColorCount = 4;
+static const int kSessionPageCapacity = 16384;
+static const int kSessionChunkVertexCount = 50;
+static const size_t kSessionBudget = 256 * 1024;
+
+static std::vector<int> Visible(const StrokeHistory& history) {
+  std::vector<int> ids;
+  history.GetVisibleChunks(&ids);
+  return ids;
+}
+
+// Returns the chunks released since the last call, in increasing order.
+static std::vector<int> Released(StrokeHistory* history) {
+  std::vector<int> ids;
+  history->TakeReleasedChunks(&ids);
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+// Adds a stroke of |chunk_count| chunks, starting with chunk |*next_id|.
+static void AddStroke(StrokeHistory* history, int stroke, int chunk_count,
+                      int* next_id) {
+  for (int i = 0; i < chunk_count; ++i) {
+    history->AddChunk((*next_id)++, stroke, kChunkBytes);
+  }
+}
+
+static void TestUndoRedo() {
+  StrokeHistory history(kLargeBudget);
+  int next_id = 0;
+  EXPECT(!history.Undo() && !history.Redo());
+  AddStroke(&history, 0, 2, &next_id);
+  AddStroke(&history, 1, 1, &next_id);
+  AddStroke(&history, 2, 2, &next_id);
+  EXPECT(Visible(history) == std::vector<int>({0, 1, 2, 3, 4}));
+  EXPECT(history.undo_count() == 3 && history.redo_count() == 0);
+  EXPECT(history.retained_bytes() < kChunkBytes);
+
+  int version = history.version();
+  EXPECT(history.Undo());
+  EXPECT(Visible(history) == std::vector<int>({0, 1, 2}));
+  EXPECT(!history.IsVisible(3) && history.IsVisible(2));
+  EXPECT(history.version() != version);
+  EXPECT(history.retained_bytes() >= 2 * kChunkBytes);
+  EXPECT(history.Redo());
+  EXPECT(Visible(history) == std::vector<int>({0, 1, 2, 3, 4}));
+  EXPECT(!history.Redo());
+
+  // A chunk of the stroke that was redone starts a new stroke rather than
+  // extending it, so it is undone on its own.
+  history.AddChunk(next_id++, 2, kChunkBytes);
+  EXPECT(history.undo_count() == 4);
+  EXPECT(history.Undo());
+  EXPECT(Visible(history) == std::vector<int>({0, 1, 2, 3, 4}));
+
+  // Nothing is released while it can be redone; painting forgets what could
+  // be redone, and releases it.
+  EXPECT(history.Undo() && history.Undo());
+  EXPECT(Visible(history) == std::vector<int>({0, 1}));
+  EXPECT(Released(&history).empty());
+  AddStroke(&history, 3, 1, &next_id);
+  EXPECT(Visible(history) == std::vector<int>({0, 1, 6}));
+  EXPECT(Released(&history) == std::vector<int>({2, 3, 4, 5}));
+  EXPECT(history.redo_count() == 0 && !history.Redo());
+  EXPECT(history.Undo() && history.Undo());
+  EXPECT(Visible(history).empty() && !history.Undo());
+}
+
+static void TestClear() {
+  StrokeHistory history(kLargeBudget);
+  int next_id = 0;
+  AddStroke(&history, 0, 2, &next_id);
+  AddStroke(&history, 1, 1, &next_id);
+  history.Clear();
+  EXPECT(Visible(history).empty());
+  // Clearing an empty drawing is not a step.
+  const int undo_count = history.undo_count();
+  history.Clear();
+  EXPECT(history.undo_count() == undo_count);
+
+  AddStroke(&history, 2, 1, &next_id);
+  EXPECT(Visible(history) == std::vector<int>({3}));
+  EXPECT(history.Undo());
+  EXPECT(Visible(history).empty());
+  EXPECT(history.Undo());
+  EXPECT(Visible(history) == std::vector<int>({0, 1, 2}));
+  EXPECT(history.Redo() && history.Redo());
+  EXPECT(Visible(history) == std::vector<int>({3}));
+  EXPECT(Released(&history).empty());
+
+  // A drawing that was loaded cannot be undone, but can be cleared.
+  history.Reset(std::vector<size_t>(3, kChunkBytes));
+  EXPECT(Visible(history) == std::vector<int>({0, 1, 2}));
+  EXPECT(!history.Undo() && history.undo_count() == 0);
+  EXPECT(history.retained_bytes() == 0);
+  history.Clear();
+  EXPECT(history.retained_bytes() >= 3 * kChunkBytes);
+  EXPECT(Visible(history).empty() && history.Undo());
+  EXPECT(history.retained_bytes() < kChunkBytes);
+  EXPECT(Visible(history) == std::vector<int>({0, 1, 2}));
+}
+
+static void TestBudget() {
+  // Room for two hidden chunks and the commands.
+  StrokeHistory history(2 * kChunkBytes + kChunkBytes / 2);
+  int next_id = 0;
+  for (int stroke = 0; stroke < 5; ++stroke) {
+    AddStroke(&history, stroke, 1, &next_id);
+  }
+  EXPECT(history.Undo() && history.Undo());
+  EXPECT(Released(&history).empty());
+  EXPECT(history.undo_count() == 3 && history.redo_count() == 2);
+  // Hiding a third chunk forgets the newest stroke that could be redone,
+  // and keeps every undo step.
+  EXPECT(history.Undo());
+  EXPECT(history.undo_count() == 2 && history.redo_count() == 2);
+  EXPECT(Released(&history) == std::vector<int>({4}));
+  EXPECT(history.retained_bytes() <= history.memory_budget());
+  EXPECT(history.Redo() && history.Redo() && !history.Redo());
+  EXPECT(Visible(history) == std::vector<int>({0, 1, 2, 3}));
+
+}
+
+static void TestBudgetForgetsOldestSteps() {
+  StrokeHistory history(2 * kChunkBytes + kChunkBytes / 2);
+  int next_id = 0;
+  AddStroke(&history, 0, 1, &next_id);
+  AddStroke(&history, 1, 1, &next_id);
+  history.Clear();
+  EXPECT(Released(&history).empty());
+  AddStroke(&history, 2, 1, &next_id);
+  // Once nothing can be redone, the oldest steps are forgotten. Forgetting
+  // strokes frees nothing, but forgetting the first clear releases what it
+  // hid.
+  history.Clear();
+  EXPECT(history.retained_bytes() <= history.memory_budget());
+  EXPECT(Released(&history) == std::vector<int>({0, 1}));
+  EXPECT(history.undo_count() == 2);
+  EXPECT(history.Undo());
+  EXPECT(Visible(history) == std::vector<int>({2}));
+  EXPECT(history.Undo() && !history.Undo());
+  EXPECT(Visible(history).empty());
+  EXPECT(history.Redo() && history.Redo());
+
+  // Lowering the budget forgets history right away: here, the clear that
+  // hid the last chunk.
+  history.set_memory_budget(kChunkBytes / 2);
+  EXPECT(history.retained_bytes() <= history.memory_budget());
+  EXPECT(Released(&history) == std::vector<int>({2}));
+  EXPECT(Visible(history).empty() && !history.Undo());
+}
+
+// Checks that strokes and commands come out of PaintSimulation in the order
+// of the samples, even when they are taken once for many samples, as they
+// are when the controller is sampled faster than frames are drawn.
+static void TestEditOrder() {
+  std::vector<PaintInput> inputs;
+  paint_script::AppendCircle(0.0, 0.0, 0.2, 1.0, 100, &inputs);
+  paint_script::AppendAppButton(kUndoCommand, &inputs);
+  paint_script::AppendCircle(0.1, 0.0, 0.2, 1.0, 100, &inputs);
+  paint_script::AppendAppButton(kUndoCommand, &inputs);
+  paint_script::AppendAppButton(kRedoCommand, &inputs);
+  paint_script::AppendCircle(0.2, 0.0, 0.2, 1.0, 100, &inputs);
+  PaintSimulation simulation(4, 2.0f);
+  for (const PaintInput& input : inputs) simulation.Update(input);
+  std::vector<DrawingEdit> edits;
+  simulation.TakeEdits(&edits);
+
+  // Strokes are numbered 0, 1, 2 in the edits, which go: chunks of stroke
+  // 0, undo, chunks of stroke 1, undo, redo, chunks of stroke 2.
+  std::vector<int> sequence;
+  for (const DrawingEdit& edit : edits) {
+    const int item = edit.is_command ? -1 - edit.command : edit.chunk.stroke;
+    if (sequence.empty() || sequence.back() != item || edit.is_command) {
+      sequence.push_back(item);
+    }
+  }
+  if (!EXPECT(sequence.size() == 6)) return;
+  const int first_stroke = sequence[0];
+  EXPECT(sequence == std::vector<int>({first_stroke, -1 - kUndoCommand,
+                                       first_stroke + 1, -1 - kUndoCommand,
+                                       -1 - kRedoCommand, first_stroke + 2}));
+
+  // Applied in that order, the first stroke stays undone, and the undo of
+  // the second stroke is redone.
+  StrokeHistory history(kLargeBudget);
+  int next_id = 0;
+  std::vector<int> stroke_of_chunk;
+  for (const DrawingEdit& edit : edits) {
+    if (!edit.is_command) {
+      stroke_of_chunk.push_back(edit.chunk.stroke);
+      history.AddChunk(next_id++, edit.chunk.stroke, kChunkBytes);
+    } else if (edit.command == kUndoCommand) {
+      history.Undo();
+    } else if (edit.command == kRedoCommand) {
+      history.Redo();
+    }
+  }
+  bool visible_strokes_match = true;
+  for (int id = 0; id < next_id; ++id) {
+    visible_strokes_match =
+        visible_strokes_match &&
+        history.IsVisible(id) == (stroke_of_chunk[id] != first_stroke);
+  }
+  EXPECT(visible_strokes_match);
+
+  // The app button alone clears.
+  inputs.clear();
+  paint_script::AppendAppButton(kClearCommand, &inputs);
+  for (const PaintInput& input : inputs) simulation.Update(input);
+  edits.clear();
+  simulation.TakeEdits(&edits);
+  EXPECT(edits.size() == 1 && edits[0].is_command &&
+         edits[0].command == kClearCommand);
+}
+
+// A chunk of |vertex_count| vertices for the arena, whose contents do not
+// matter.
+struct ArenaChunk {
+  std::vector<PaintVertex> vertices;
+  std::vector<GLushort> indices;
+};
+
+static ArenaChunk MakeArenaChunk(int vertex_count) {
+  ArenaChunk chunk;
+  chunk.vertices.resize(vertex_count, PaintVertex());
+  for (int i = 0; i + 3 < vertex_count; i += 2) {
+    const GLushort quad[] = {
+        static_cast<GLushort>(i), static_cast<GLushort>(i + 1),
+        static_cast<GLushort>(i + 2), static_cast<GLushort>(i + 1),
+        static_cast<GLushort>(i + 3), static_cast<GLushort>(i + 2)};
+    chunk.indices.insert(chunk.indices.end(), quad, quad + 6);
+  }
+  return chunk;
+}
+
+// Paints, undoes, redoes and clears for kSessionStrokeCount strokes with a
+// small budget, and releases the chunks the history lets go of from a
+// StrokeArena, moving the chunks of sparse pages as the sample does. Checks
+// that the arena holds no more pages than the visible drawing and the
+// budget need.
+static void TestSessionReclaimsPages() {
+  srand(1);
+  const ArenaChunk chunk = MakeArenaChunk(kSessionChunkVertexCount);
+  const size_t chunk_bytes = chunk.vertices.size() * sizeof(PaintVertex) +
+                             chunk.indices.size() * sizeof(GLushort);
+  // What the history holds per step, measured on one that has nothing
+  // hidden.
+  StrokeHistory one_step(kSessionBudget);
+  one_step.AddChunk(0, 0, chunk_bytes);
+  const size_t command_bytes = one_step.retained_bytes();
+  EXPECT(command_bytes > 0 && command_bytes < chunk_bytes);
+  StrokeHistory history(kSessionBudget);
+  StrokeArena arena(kSessionColorCount, kSessionPageCapacity,
+                    sizeof(PaintVertex));
+  // Index in the arena of each chunk of the history, or -1.
+  std::vector<int> arena_chunks;
+  std::vector<int> released;
+  std::vector<int> moved;
+  std::vector<GLuint> deleted_vbos;
+  const int initial_buffer_count = host_runtime::GetLiveBufferCount();
+  int max_buffer_count = 0;
+  bool budget_kept = true;
+  bool retained_bytes_match = true;
+  for (int stroke = 0; stroke < kSessionStrokeCount; ++stroke) {
+    const int color = rand() % kSessionColorCount;
+    const int chunk_count = 1 + rand() % 4;
+    for (int i = 0; i < chunk_count; ++i) {
+      const int id = static_cast<int>(arena_chunks.size());
+      history.AddChunk(id, stroke, chunk_bytes);
+      arena_chunks.push_back(arena.AddChunk(
+          id, color, chunk.vertices.data(),
+          static_cast<int>(chunk.vertices.size()), chunk.indices.data(),
+          static_cast<int>(chunk.indices.size())));
+    }
+    const int action = rand() % 10;
+    if (action < 3) {
+      history.Undo();
+    } else if (action < 4) {
+      history.Undo();
+      history.Undo();
+      history.Redo();
+    } else if (action == 4 && rand() % 20 == 0) {
+      history.Clear();
+    }
+    budget_kept = budget_kept &&
+                  history.retained_bytes() <= history.memory_budget();
+
+    released.clear();
+    history.TakeReleasedChunks(&released);
+    for (int id : released) {
+      arena.ReleaseChunk(arena_chunks[id]);
+      arena_chunks[id] = -1;
+    }
+    // The history keeps its size up to date as it goes: it is that of the
+    // hidden chunks it holds on to and of its steps.
+    size_t hidden_bytes = 0;
+    for (int id = 0; id < static_cast<int>(arena_chunks.size()); ++id) {
+      if (arena_chunks[id] >= 0 && !history.IsVisible(id)) {
+        hidden_bytes += chunk_bytes;
+      }
+    }
+    const size_t step_count = history.undo_count() + history.redo_count();
+    retained_bytes_match =
+        retained_bytes_match && history.retained_bytes() >= hidden_bytes &&
+        history.retained_bytes() - hidden_bytes == step_count * command_bytes;
+    // One sparse page is moved per frame; a frame per stroke is plenty.
+    for (int page_color = 0; page_color < kSessionColorCount; ++page_color) {
+      const int page = arena.FindSparsePage(page_color);
+      if (page < 0) continue;
+      moved.clear();
+      arena.GetPageChunks(page_color, page, &moved);
+      for (int old_chunk : moved) {
+        const int id = arena.chunks()[old_chunk].owner;
+        arena_chunks[id] = arena.AddChunk(
+            id, page_color, chunk.vertices.data(),
+            static_cast<int>(chunk.vertices.size()), chunk.indices.data(),
+            static_cast<int>(chunk.indices.size()));
+        arena.ReleaseChunk(old_chunk);
+      }
+      break;
+    }
+    arena.TakeDeletedVbos(&deleted_vbos);
+    max_buffer_count =
+        std::max(max_buffer_count,
+                 host_runtime::GetLiveBufferCount() - initial_buffer_count);
+  }
+  EXPECT(budget_kept);
+  EXPECT(retained_bytes_match);
+
+  // The chunks kept on the GPU are exactly the visible ones and those the
+  // history holds on to.
+  int kept_count = 0;
+  bool released_match = true;
+  for (int id = 0; id < static_cast<int>(arena_chunks.size()); ++id) {
+    if (arena_chunks[id] >= 0) ++kept_count;
+    released_match = released_match && (arena_chunks[id] >= 0 ||
+                                        !history.IsVisible(id));
+  }
+  EXPECT(released_match);
+  const int visible_count = static_cast<int>(Visible(history).size());
+  EXPECT(kept_count - visible_count <=
+         static_cast<int>(kSessionBudget / chunk_bytes));
+
+  // Each color needs at most twice the pages its kept vertices fill, since
+  // pages with less than half of their vertices alive are compacted, plus
+  // the page it is filling. Each page has a vertex and an index buffer.
+  const int kept_pages =
+      (kept_count * kSessionChunkVertexCount) / kSessionPageCapacity;
+  const int page_bound = 2 * kept_pages + 2 * kSessionColorCount;
+  int live_pages = 0;
+  int opened_pages = 0;
+  for (int color = 0; color < kSessionColorCount; ++color) {
+    opened_pages += arena.page_count(color);
+    for (int page = 0; page < arena.page_count(color); ++page) {
+      if (arena.page_vbo(color, page) != 0) ++live_pages;
+    }
+  }
+  EXPECT(live_pages <= page_bound);
+  EXPECT(max_buffer_count <= 2 * page_bound + 2);
+  printf("%d strokes, %d chunks: %d kept (%d visible), %d of %d pages "
+         "live, at most %d buffers\n",
+         kSessionStrokeCount, static_cast<int>(arena_chunks.size()),
+         kept_count, visible_count, live_pages, opened_pages,
+         max_buffer_count);
+  arena.Clear();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  TestUndoRedo();
+  TestClear();
+  TestBudget();
+  TestBudgetForgetsOldestSteps();
+  TestEditOrder();
+  TestSessionReclaimsPages();
+  return test_util::Finish();
+}
@@ -0,0 +1,230 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Checks the levels of detail the controller paint sample simplifies its
+// committed strokes into: that SimplifyStroke() keeps the ends of a chunk
+// and strays from its centreline by no more than the tolerance, and that
+// StrokeSimplifier produces the same levels on its worker thread. Prints
+// the vertices left at each tolerance, for strokes painted at the sample's
+// paint distance, and the distance from which the sample draws them.
+
+#include <math.h>
+#include <stdio.h>
+
+#include <chrono>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "paint_script.h"  // NOLINT
+#include "paint_simulation.h"  // NOLINT
+#include "stroke_simplifier.h"  // NOLINT
+#include "test_util.h"  // NOLINT
+
+namespace {
+
+static const int kColorCount = 4;
+static const float kPaintDistance = 2.0f;
+
+// The sample's kMaxStrokeLodError: a level is drawn from the distance at
+// which its tolerance covers this angle.
+static const float kMaxLodError = 0.0025f;
+
+// Tolerances to measure, in meters. The sample's levels are among them.
+static const float kTolerances[] = {0.0025f, 0.00375f, 0.005f, 0.01f,
+                                    0.015f, 0.02f, 0.04f};
+
+// The sample's levels, past the full detail.
+static const std::vector<float> kSampleTolerances = {0.00375f, 0.015f};
+
+static std::array<float, 3> Centre(const StrokeChunk& chunk, int point) {
+  const PaintVertex& top = chunk.vertices[2 * point];
+  const PaintVertex& bottom = chunk.vertices[2 * point + 1];
+  return {0.5f * (top.x + bottom.x), 0.5f * (top.y + bottom.y),
+          0.5f * (top.z + bottom.z)};
+}
+
+static float DistanceToSegment(const std::array<float, 3>& p,
+                               const std::array<float, 3>& a,
+                               const std::array<float, 3>& b) {
+  float ab2 = 0.0f, dot = 0.0f;
+  for (int k = 0; k < 3; ++k) {
+    ab2 += (b[k] - a[k]) * (b[k] - a[k]);
+    dot += (b[k] - a[k]) * (p[k] - a[k]);
+  }
+  float t = ab2 > 0.0f ? dot / ab2 : 0.0f;
+  t = t < 0.0f ? 0.0f : t > 1.0f ? 1.0f : t;
+  float distance2 = 0.0f;
+  for (int k = 0; k < 3; ++k) {
+    const float d = p[k] - a[k] - t * (b[k] - a[k]);
+    distance2 += d * d;
+  }
+  return sqrtf(distance2);
+}
+
+static bool SameVertex(const PaintVertex& a, const PaintVertex& b) {
+  return a.x == b.x && a.y == b.y && a.z == b.z && a.s == b.s && a.t == b.t;
+}
+
+// Checks that |simplified| is |chunk| with some of its cross sections
+// removed, keeping the ends, that the removed centreline points are within
+// |tolerance| of the simplified centreline, and that it is a valid strip.
+static void CheckSimplified(const StrokeChunk& chunk,
+                            const StrokeChunk& simplified, float tolerance) {
+  const int point_count = static_cast<int>(chunk.vertices.size()) / 2;
+  const int kept_count = static_cast<int>(simplified.vertices.size()) / 2;
+  if (!EXPECT(kept_count >= 2 && kept_count < point_count)) return;
+  EXPECT(simplified.color == chunk.color);
+  EXPECT(static_cast<int>(simplified.indices.size()) == 6 * (kept_count - 1));
+  for (GLushort index : simplified.indices) {
+    EXPECT(index < simplified.vertices.size());
+  }
+  // Match each kept cross section to the original it came from.
+  bool matched = true;
+  bool within_tolerance = true;
+  int previous_kept = 0;
+  int point = 0;
+  for (int kept = 0; kept < kept_count && matched; ++kept) {
+    while (point < point_count &&
+           !(SameVertex(chunk.vertices[2 * point],
+                        simplified.vertices[2 * kept]) &&
+             SameVertex(chunk.vertices[2 * point + 1],
+                        simplified.vertices[2 * kept + 1]))) {
+      ++point;
+    }
+    matched = point < point_count && (kept > 0 || point == 0);
+    if (!matched) break;
+    for (int i = previous_kept + 1; i < point; ++i) {
+      within_tolerance =
+          within_tolerance &&
+          DistanceToSegment(Centre(chunk, i), Centre(chunk, previous_kept),
+                            Centre(chunk, point)) <= tolerance * 1.0001f;
+    }
+    previous_kept = point++;
+  }
+  EXPECT(matched && previous_kept == point_count - 1);
+  EXPECT(within_tolerance);
+}
+
+// Paints the strokes the measurements are made on and returns their chunks.
+static std::vector<StrokeChunk> PaintStrokes() {
+  std::vector<PaintInput> inputs;
+  // Wide and tight circles, drawn slowly and quickly, and a spiral of many
+  // turns, at the rate of the controller.
+  paint_script::AppendCircle(0.0, 0.0, 0.3, 1.0, 400, &inputs);
+  paint_script::AppendCircle(0.2, -0.1, 0.05, 1.0, 60, &inputs);
+  paint_script::AppendCircle(-0.3, 0.2, 0.5, 0.5, 40, &inputs);
+  paint_script::AppendCircle(0.0, 0.1, 0.2, 5.0, 2000, &inputs);
+  paint_script::AppendCircle(0.4, 0.0, 0.1, 3.0, 300, &inputs);
+  PaintSimulation simulation(kColorCount, kPaintDistance);
+  std::vector<DrawingEdit> edits;
+  for (const PaintInput& input : inputs) {
+    simulation.Update(input);
+    simulation.TakeEdits(&edits);
+  }
+  std::vector<StrokeChunk> chunks;
+  for (const DrawingEdit& edit : edits) {
+    if (!edit.is_command) chunks.push_back(edit.chunk);
+  }
+  return chunks;
+}
+
+// Checks that the worker thread produces what SimplifyStroke() does, at
+// each level, and skips the levels that would not remove vertices.
+static void TestSimplifier(const std::vector<StrokeChunk>& chunks) {
+  StrokeSimplifier simplifier(kSampleTolerances);
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    const StrokeChunk& chunk = chunks[i];
+    simplifier.Enqueue(static_cast<int>(i), chunk.color, chunk.vertices.data(),
+                       static_cast<int>(chunk.vertices.size()),
+                       chunk.indices.data(),
+                       static_cast<int>(chunk.indices.size()));
+  }
+  // The expected levels: each one simplifies the original chunk, and is
+  // only produced if it has fewer vertices than the previous level.
+  std::vector<std::vector<int>> expected_sizes(chunks.size());
+  int expected_count = 0;
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    size_t previous_size = chunks[i].vertices.size();
+    for (float tolerance : kSampleTolerances) {
+      StrokeChunk simplified;
+      const bool produced =
+          SimplifyStroke(chunks[i], tolerance, &simplified) &&
+          simplified.vertices.size() < previous_size;
+      expected_sizes[i].push_back(
+          produced ? static_cast<int>(simplified.vertices.size()) : -1);
+      if (produced) {
+        previous_size = simplified.vertices.size();
+        ++expected_count;
+      }
+    }
+  }
+
+  std::vector<SimplifiedChunk> results;
+  const std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (static_cast<int>(results.size()) < expected_count &&
+         std::chrono::steady_clock::now() < deadline) {
+    simplifier.TakeResults(&results);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  if (!EXPECT(static_cast<int>(results.size()) == expected_count)) return;
+  for (const SimplifiedChunk& result : results) {
+    if (!EXPECT(result.id >= 0 &&
+                result.id < static_cast<int>(chunks.size()) &&
+                result.level >= 1 &&
+                result.level <= static_cast<int>(kSampleTolerances.size()))) {
+      continue;
+    }
+    EXPECT(expected_sizes[result.id][result.level - 1] ==
+           static_cast<int>(result.chunk.vertices.size()));
+    CheckSimplified(chunks[result.id], result.chunk,
+                    kSampleTolerances[result.level - 1]);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::vector<StrokeChunk> chunks = PaintStrokes();
+  EXPECT(chunks.size() > 4);
+  int vertex_count = 0;
+  for (const StrokeChunk& chunk : chunks) {
+    vertex_count += static_cast<int>(chunk.vertices.size());
+  }
+  printf("%d chunks painted at %.1f m: %d vertices\n",
+         static_cast<int>(chunks.size()), kPaintDistance, vertex_count);
+
+  for (float tolerance : kTolerances) {
+    int simplified_count = 0;
+    for (const StrokeChunk& chunk : chunks) {
+      StrokeChunk simplified;
+      if (SimplifyStroke(chunk, tolerance, &simplified)) {
+        EXPECT(simplified.stroke == chunk.stroke);
+        CheckSimplified(chunk, simplified, tolerance);
+        simplified_count += static_cast<int>(simplified.vertices.size());
+      } else {
+        simplified_count += static_cast<int>(chunk.vertices.size());
+      }
+    }
+    printf("tolerance %.2f mm: %d vertices (%.0f%%), drawn from %.1f m\n",
+           1000.0f * tolerance, simplified_count,
+           100.0f * simplified_count / vertex_count, tolerance / kMaxLodError);
+  }
+
+  TestSimplifier(chunks);
+  return test_util::Finish();
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef NDK_HOST_TESTS_TEST_UTIL_H_  // NOLINT
+#define NDK_HOST_TESTS_TEST_UTIL_H_
+
+#include <stdio.h>
+
+#include <chrono>  // NOLINT
+
+// What the host tests share: checks that record failures and let the test
+// go on, so one run reports every broken case, and a timer for the
+// benchmarks some of them print. Each test is a program that exits with 1
+// if a check failed, which is what ctest looks at.
+namespace test_util {
+
+inline int& FailureCount() {
+  static int failures = 0;
+  return failures;
+}
+
+// Prints |what| and counts a failure unless |condition| holds. Returns
+// |condition|, so callers can skip checks that would only fail as a
+// consequence.
+inline bool Check(bool condition, const char* what, const char* file,
+                  int line) {
+  if (!condition) {
+    printf("%s:%d: check failed: %s\n", file, line, what);
+    ++FailureCount();
+  }
+  return condition;
+}
+
+// Prints PASSED or FAILED, and returns the exit code of the test.
+inline int Finish() {
+  printf(FailureCount() == 0 ? "PASSED\n" : "FAILED\n");
+  return FailureCount() == 0 ? 0 : 1;
+}
+
+// Runs |body| |iterations| times and returns the mean time it took, in
+// nanoseconds. Results the body computes should go to a volatile sink, so
+// that the compiler keeps the work.
+template <typename Body>
+double NanosPerIteration(int iterations, Body body) {
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) body(i);
+  const std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / iterations;
+}
+
+}  // namespace test_util
+
+#define EXPECT(condition) \
+  ::test_util::Check((condition), #condition, __FILE__, __LINE__)
+
+#endif  // NDK_HOST_TESTS_TEST_UTIL_H_  // NOLINT
@@ -0,0 +1,254 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Checks the frame tracing of the samples (trace.h): that nothing is
+// allocated or recorded while tracing is disabled, that TRACE_ZONE and
+// TRACE_ZONE_BEGIN/END record each zone once, on the thread that ran it,
+// that a full buffer drops and counts what no longer fits, and that
+// WriteChromeTrace writes every event in the Chrome trace event format.
+// Prints the cost of a zone, disabled and enabled.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <chrono>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "test_util.h"  // NOLINT
+#include "trace.h"  // NOLINT
+
+namespace {
+
+static const char kPath[] = "trace_test.json";
+
+static size_t BufferCount() {
+  trace::internal::Registry& registry = trace::internal::GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  return registry.buffers.size();
+}
+
+// Returns a copy of the events of the buffer named |name|, or of the
+// calling thread's if |name| is null.
+static std::vector<trace::Event> Events(const char* name) {
+  const trace::internal::ThreadBuffer* buffer =
+      name ? nullptr : trace::internal::GetThreadBuffer();
+  trace::internal::Registry& registry = trace::internal::GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (const trace::internal::ThreadBuffer* candidate : registry.buffers) {
+    if (name && candidate->name == name) buffer = candidate;
+  }
+  std::vector<trace::Event> events;
+  if (!buffer) return events;
+  const size_t count = buffer->count.load(std::memory_order_acquire);
+  events.assign(buffer->events.get(), buffer->events.get() + count);
+  return events;
+}
+
+static std::string ReadFile(const char* path) {
+  std::string contents;
+  FILE* file = fopen(path, "r");
+  if (!file) return contents;
+  char chunk[4096];
+  size_t size;
+  while ((size = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    contents.append(chunk, size);
+  }
+  fclose(file);
+  return contents;
+}
+
+static size_t CountOccurrences(const std::string& text, const char* what) {
+  size_t count = 0;
+  for (size_t at = text.find(what); at != std::string::npos;
+       at = text.find(what, at + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+static void SleepMillis(int millis) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(millis));
+}
+
+// While tracing is disabled, zones and tracks neither record nor register
+// a buffer.
+static void TestDisabled() {
+  EXPECT(!trace::IsEnabled());
+  {
+    TRACE_ZONE("Disabled");
+    TRACE_ZONE_BEGIN(zone, "DisabledBegin");
+    TRACE_ZONE_END(zone);
+  }
+  std::thread([] { TRACE_ZONE("DisabledThread"); }).join();
+  trace::Track track("DisabledTrack");
+  track.AddEvent("Disabled", 0, 1);
+  EXPECT(BufferCount() == 0);
+  EXPECT(trace::DroppedEventCount() == 0);
+}
+
+static void TestZones() {
+  trace::SetEnabled(true);
+  const int64_t start = trace::NowNanos();
+  {
+    TRACE_ZONE("Scoped");
+    SleepMillis(2);
+  }
+  {
+    TRACE_ZONE_BEGIN(zone, "Explicit");
+    SleepMillis(1);
+    TRACE_ZONE_END(zone);
+    // Ending the zone early is what records it, not the end of the scope.
+    SleepMillis(5);
+  }
+  {
+    // A zone opened while tracing is disabled stays unrecorded, and one
+    // opened while it is enabled is recorded even once it is not.
+    trace::SetEnabled(false);
+    TRACE_ZONE_BEGIN(opened_disabled, "OpenedDisabled");
+    trace::SetEnabled(true);
+    TRACE_ZONE_BEGIN(opened_enabled, "OpenedEnabled");
+    trace::SetEnabled(false);
+    TRACE_ZONE_END(opened_disabled);
+    TRACE_ZONE_END(opened_enabled);
+    trace::SetEnabled(true);
+  }
+  const int64_t end = trace::NowNanos();
+  EXPECT(BufferCount() == 1);
+
+  const std::vector<trace::Event> events = Events(nullptr);
+  if (!EXPECT(events.size() == 3)) return;
+  EXPECT(strcmp(events[0].name, "Scoped") == 0);
+  EXPECT(events[0].duration_nanos >= 2000000);
+  EXPECT(strcmp(events[1].name, "Explicit") == 0);
+  EXPECT(events[1].duration_nanos >= 1000000);
+  EXPECT(events[1].duration_nanos < 5000000);
+  EXPECT(strcmp(events[2].name, "OpenedEnabled") == 0);
+  for (size_t i = 0; i < events.size(); ++i) {
+    EXPECT(events[i].begin_nanos >= start);
+    EXPECT(events[i].begin_nanos + events[i].duration_nanos <= end);
+    if (i > 0) {
+      EXPECT(events[i].begin_nanos >= events[i - 1].begin_nanos +
+                                          events[i - 1].duration_nanos);
+    }
+  }
+}
+
+// Each thread records into a buffer of its own, registered with its first
+// zone; tracks get one with their first event.
+static void TestThreadsAndTracks() {
+  const size_t buffers = BufferCount();
+  std::thread([] {
+    trace::SetThreadName("Worker");
+    TRACE_ZONE("WorkerZone");
+  }).join();
+  std::thread([] {}).join();
+  EXPECT(BufferCount() == buffers + 1);
+  const std::vector<trace::Event> worker_events = Events("Worker");
+  EXPECT(worker_events.size() == 1 &&
+         strcmp(worker_events[0].name, "WorkerZone") == 0);
+
+  trace::Track track("Gpu");
+  EXPECT(BufferCount() == buffers + 1);
+  track.AddEvent("DrawFrame", 1234567, 2000500);
+  track.AddEvent("Present", 3500000, 250);
+  EXPECT(BufferCount() == buffers + 2);
+  const std::vector<trace::Event> gpu_events = Events("Gpu");
+  if (EXPECT(gpu_events.size() == 2)) {
+    EXPECT(gpu_events[0].begin_nanos == 1234567);
+    EXPECT(gpu_events[0].duration_nanos == 2000500);
+  }
+}
+
+// A full buffer keeps its first kEventsPerThread events and counts the
+// rest as dropped.
+static void TestOverflow() {
+  static const size_t kExtra = 10;
+  std::thread([] {
+    trace::SetThreadName("Overflow");
+    for (size_t i = 0; i < trace::kEventsPerThread + kExtra; ++i) {
+      TRACE_ZONE("Overflow");
+    }
+  }).join();
+  EXPECT(Events("Overflow").size() == trace::kEventsPerThread);
+  EXPECT(trace::DroppedEventCount() == kExtra);
+}
+
+// The export holds one complete event per recorded zone, and one name
+// per named buffer, with times in microseconds.
+static void TestChromeTrace() {
+  if (!EXPECT(trace::WriteChromeTrace(kPath))) return;
+  const std::string json = ReadFile(kPath);
+  static const char kHeader[] = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  EXPECT(json.compare(0, strlen(kHeader), kHeader) == 0);
+  EXPECT(json.size() > 4 && json.compare(json.size() - 4, 4, "\n]}\n") == 0);
+
+  size_t recorded = 0;
+  {
+    trace::internal::Registry& registry = trace::internal::GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (const trace::internal::ThreadBuffer* buffer : registry.buffers) {
+      recorded += buffer->count.load(std::memory_order_acquire);
+    }
+  }
+  EXPECT(CountOccurrences(json, "\"ph\":\"X\"") == recorded);
+  EXPECT(CountOccurrences(json, "\"ph\":\"M\"") == 3);
+  EXPECT(CountOccurrences(json, "\"args\":{\"name\":\"Worker\"}") == 1);
+  EXPECT(CountOccurrences(json, "\"args\":{\"name\":\"Gpu\"}") == 1);
+  EXPECT(CountOccurrences(json, "\"name\":\"Scoped\"") == 1);
+  EXPECT(CountOccurrences(json, "\"name\":\"OpenedDisabled\"") == 0);
+  EXPECT(CountOccurrences(json, "\"ts\":1234.567,\"dur\":2000.500") == 1);
+  EXPECT(CountOccurrences(json, "\"ts\":3500.000,\"dur\":0.250") == 1);
+  // Each event but the first follows a comma.
+  EXPECT(CountOccurrences(json, ",\n{") + 1 ==
+         recorded + CountOccurrences(json, "\"ph\":\"M\""));
+
+  EXPECT(!trace::WriteChromeTrace("trace_test_missing/trace.json"));
+}
+
+// The cost of a zone while tracing is disabled, and of recording one, on
+// a thread of its own so the buffer has room for every iteration.
+static void Benchmark() {
+  static const int kIterations = 60000;
+  trace::SetEnabled(false);
+  const double disabled_nanos =
+      test_util::NanosPerIteration(kIterations, [](int) { TRACE_ZONE("B"); });
+  trace::SetEnabled(true);
+  double enabled_nanos = 0.0;
+  std::thread([&enabled_nanos] {
+    enabled_nanos = test_util::NanosPerIteration(
+        kIterations, [](int) { TRACE_ZONE("B"); });
+  }).join();
+  printf("zone: %.1f ns disabled, %.1f ns enabled\n", disabled_nanos,
+         enabled_nanos);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  TestDisabled();
+  TestZones();
+  TestThreadsAndTracks();
+  TestOverflow();
+  TestChromeTrace();
+  Benchmark();
+  unlink(kPath);
+  return test_util::Finish();
+}
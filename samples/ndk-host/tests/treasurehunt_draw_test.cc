@@ -0,0 +1,173 @@
+/*
+ * Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Runs the treasure hunt sample on the host runtime, with and without
+// vertex array objects and multiview and with foveation, and checks that
+// it draws only from buffers: none of its draw calls reads vertices or
+// indices from client memory. Prints what was uploaded when setting up the
+// scene and afterwards, which is only the cube positions that changed.
+// Then checks that 10000 cubes take one instanced draw call per eye with
+// ES 3.0, one for both eyes with multiview, and a draw call per batch of
+// cubes with ES 2.0.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+#include <utility>
+
+#include "host_runtime.h"  // NOLINT
+#include "test_util.h"  // NOLINT
+#include "treasure_hunt_renderer.h"  // NOLINT
+#include "vr/gvr/capi/include/gvr.h"
+#include "vr/gvr/capi/include/gvr_audio.h"
+
+namespace {
+
+static const int kCubeCount = 100;
+static const int kFrameCount = 120;
+// Frames after which the scene is uploaded and the render targets sized.
+static const int kWarmupFrameCount = 10;
+static const int kTriggerPeriod = 30;
+
+// The cubes of the draw call count test, and the frames it counts, once the
+// scene is set up.
+static const int kManyCubeCount = 10000;
+static const int kCountedFrameCount = 10;
+// Cubes per draw call with ES 2.0; kCubeBatchSize in the sample.
+static const int kCubeBatchSize = 64;
+
+struct Variant {
+  const char* name;
+  bool gl_es3;
+  bool multiview;
+  bool foveation;
+};
+
+static const Variant kVariants[] = {
+    {"es2", false, false, false},
+    {"es3", true, false, false},
+    {"es3_multiview", true, true, false},
+    {"es3_foveation", true, false, true},
+};
+
+// Simulates the viewer of |variant|.
+static void SetViewer(const Variant& variant) {
+  host_runtime::ViewerConfig config = host_runtime::DefaultViewerConfig();
+  config.gl_es3 = variant.gl_es3;
+  config.multiview = variant.multiview;
+  host_runtime::SetViewerConfig(config);
+  host_runtime::SetHeadPoseScript(host_runtime::LookAroundScript(0.5f, 4.0f));
+}
+
+static std::unique_ptr<TreasureHuntRenderer> CreateRenderer(
+    const Variant& variant, gvr::GvrApi* gvr_api, int cube_count) {
+  std::unique_ptr<gvr::AudioApi> audio_api(new gvr::AudioApi);
+  audio_api->Init(GVR_AUDIO_RENDERING_BINAURAL_HIGH_QUALITY);
+  foveation::Config foveation_config;
+  foveation_config.enabled = variant.foveation;
+  return std::unique_ptr<TreasureHuntRenderer>(new TreasureHuntRenderer(
+      gvr_api->cobj(), std::move(audio_api), cube_count, "",
+      foveation_config));
+}
+
+static void RunVariant(const Variant& variant) {
+  SetViewer(variant);
+  std::unique_ptr<gvr::GvrApi> gvr_api = gvr::GvrApi::Create();
+  std::unique_ptr<TreasureHuntRenderer> renderer =
+      CreateRenderer(variant, gvr_api.get(), kCubeCount);
+  host_runtime::ResetStats();
+  renderer->InitializeGl();
+  renderer->OnResume();
+  int64_t warmup_uploaded_bytes = 0;
+  for (int frame = 0; frame < kFrameCount; ++frame) {
+    if (frame == kWarmupFrameCount) {
+      warmup_uploaded_bytes = host_runtime::GetStats().uploaded_bytes;
+    }
+    if (frame % kTriggerPeriod == 0) renderer->OnTriggerEvent();
+    renderer->DrawFrame();
+  }
+  renderer->OnPause();
+  renderer.reset();
+
+  const host_runtime::Stats stats = host_runtime::GetStats();
+  printf("%s: %lld draw calls, %lld from client memory, %lld bytes uploaded "
+         "at setup, %lld after\n",
+         variant.name, static_cast<long long>(stats.draw_calls),  // NOLINT
+         static_cast<long long>(stats.client_array_draw_calls),  // NOLINT
+         static_cast<long long>(warmup_uploaded_bytes),  // NOLINT
+         static_cast<long long>(stats.uploaded_bytes -  // NOLINT
+                                warmup_uploaded_bytes));
+  EXPECT(stats.draw_calls >= kFrameCount);
+  EXPECT(stats.client_array_draw_calls == 0);
+}
+
+// Returns the draw calls of kCountedFrameCount frames of |variant| with
+// |cube_count| cubes, once the scene is set up.
+static int64_t CountDrawCalls(const Variant& variant, int cube_count) {
+  SetViewer(variant);
+  std::unique_ptr<gvr::GvrApi> gvr_api = gvr::GvrApi::Create();
+  std::unique_ptr<TreasureHuntRenderer> renderer =
+      CreateRenderer(variant, gvr_api.get(), cube_count);
+  renderer->InitializeGl();
+  renderer->OnResume();
+  for (int frame = 0; frame < kWarmupFrameCount; ++frame) {
+    renderer->DrawFrame();
+  }
+  host_runtime::ResetStats();
+  for (int frame = 0; frame < kCountedFrameCount; ++frame) {
+    renderer->DrawFrame();
+  }
+  const int64_t draw_calls = host_runtime::GetStats().draw_calls;
+  renderer->OnPause();
+  return draw_calls;
+}
+
+// Checks the draw calls the cubes take in each view of |variant|: the
+// frames of kManyCubeCount cubes take as many more draw calls than those of
+// a single cube, which takes one per view, as the extra cubes need.
+static void CheckCubeDrawCalls(const Variant& variant) {
+  const int64_t single_cube_draw_calls = CountDrawCalls(variant, 1);
+  const int64_t many_cube_draw_calls = CountDrawCalls(variant, kManyCubeCount);
+  const int view_count = variant.multiview ? 1 : 2;
+  const int64_t extra_draw_calls =
+      many_cube_draw_calls - single_cube_draw_calls;
+  const int64_t views = kCountedFrameCount * view_count;
+  if (!EXPECT(extra_draw_calls % views == 0)) return;
+  const int64_t cube_draw_calls = 1 + extra_draw_calls / views;
+  const int64_t expected_draw_calls =
+      variant.gl_es3 ? 1 : (kManyCubeCount + kCubeBatchSize - 1) /
+                               kCubeBatchSize;
+  printf("%s: %d cubes in %lld draw call%s %s\n", variant.name,
+         kManyCubeCount,
+         static_cast<long long>(cube_draw_calls),  // NOLINT
+         cube_draw_calls == 1 ? "" : "s",
+         variant.multiview ? "for both eyes" : "per eye");
+  EXPECT(cube_draw_calls == expected_draw_calls);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  host_runtime::SetLogEnabled(false);
+  for (const Variant& variant : kVariants) RunVariant(variant);
+  for (const Variant& variant : kVariants) {
+    // Foveation draws the scene twice per eye.
+    if (!variant.foveation) CheckCubeDrawCalls(variant);
+  }
+  return test_util::Finish();
+}
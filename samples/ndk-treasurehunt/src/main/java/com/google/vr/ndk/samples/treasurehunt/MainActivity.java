@@ -25,6 +25,7 @@ import android.view.MotionEvent;
 import android.view.View;
 import com.google.vr.ndk.base.AndroidCompat;
 import com.google.vr.ndk.base.GvrLayout;
+import java.io.File;
 import javax.microedition.khronos.egl.EGLConfig;
 import javax.microedition.khronos.opengles.GL10;
 
@@ -48,6 +49,21 @@ public class MainActivity extends Activity {
     System.loadLibrary("treasurehunt_jni");
   }
 
+  // Intent extra setting the number of cubes in the scene. Scenes with many cubes are used as
+  // stress tests, e.g. "adb shell am start --ei cube_count 10000 <component>".
+  private static final String EXTRA_CUBE_COUNT = "cube_count";
+
+  // Intent extra that turns on frame tracing, e.g. "adb shell am start --ez trace true
+  // <component>". The trace is written to TRACE_FILE_NAME, in the app's private storage, every
+  // time the app pauses, and opens in chrome://tracing or the Perfetto UI.
+  private static final String EXTRA_TRACE = "trace";
+  private static final String TRACE_FILE_NAME = "trace.json";
+
+  // Intent extra that turns on fixed foveated rendering, e.g. "adb shell am start --ez foveation
+  // true <component>": the periphery of each eye is rendered at a lower resolution than its
+  // center.
+  private static final String EXTRA_FOVEATION = "foveation";
+
   // Opaque native pointer to the native TreasureHuntRenderer instance.
   private long nativeTreasureHuntRenderer;
 
@@ -55,7 +71,8 @@ public class MainActivity extends Activity {
   private GLSurfaceView surfaceView;
 
   // Note that pause and resume signals to the native renderer are performed on the GL thread,
-  // ensuring thread-safety.
+  // ensuring thread-safety. Pausing cannot wait for the next frame like trigger events do, since
+  // the GL thread stops drawing frames once paused.
   private final Runnable pauseNativeRunnable =
       new Runnable() {
         @Override
@@ -96,7 +113,12 @@ public class MainActivity extends Activity {
         nativeCreateRenderer(
             getClass().getClassLoader(),
             this.getApplicationContext(),
-            gvrLayout.getGvrApi().getNativeGvrContext());
+            gvrLayout.getGvrApi().getNativeGvrContext(),
+            Math.max(1, getIntent().getIntExtra(EXTRA_CUBE_COUNT, 1)),
+            getIntent().getBooleanExtra(EXTRA_TRACE, false)
+                ? new File(getFilesDir(), TRACE_FILE_NAME).getAbsolutePath()
+                : null,
+            getIntent().getBooleanExtra(EXTRA_FOVEATION, false));
 
     // Add the GLSurfaceView to the GvrLayout.
     surfaceView = new GLSurfaceView(this);
@@ -125,13 +147,8 @@ public class MainActivity extends Activity {
             if (event.getAction() == MotionEvent.ACTION_DOWN) {
               // Give user feedback and signal a trigger event.
               ((Vibrator) getSystemService(Context.VIBRATOR_SERVICE)).vibrate(50);
-              surfaceView.queueEvent(
-                  new Runnable() {
-                    @Override
-                    public void run() {
-                      nativeOnTriggerEvent(nativeTreasureHuntRenderer);
-                    }
-                  });
+              // The renderer queues the event for the next frame itself, without locking.
+              nativeOnTriggerEvent(nativeTreasureHuntRenderer);
               return true;
             }
             return false;
@@ -218,7 +235,12 @@ public class MainActivity extends Activity {
   }
 
   private native long nativeCreateRenderer(
-      ClassLoader appClassLoader, Context context, long nativeGvrContext);
+      ClassLoader appClassLoader,
+      Context context,
+      long nativeGvrContext,
+      int cubeCount,
+      String tracePath,
+      boolean foveation);
   private native void nativeDestroyRenderer(long nativeTreasureHuntRenderer);
   private native void nativeInitializeGl(long nativeTreasureHuntRenderer);
   private native long nativeDrawFrame(long nativeTreasureHuntRenderer);
@@ -0,0 +1,66 @@
+/* Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "cube_field.h"  // NOLINT
+
+#include <cmath>
+
+CubeField::CubeField(int count)
+    : count_(count), data_(kComponentCount * count, 0.0f), generation_(0) {}
+
+void CubeField::Set(int cube, const std::array<float, 3>& position,
+                    float yaw) {
+  data_[kX * count_ + cube] = position[0];
+  data_[kY * count_ + cube] = position[1];
+  data_[kZ * count_ + cube] = position[2];
+  data_[kYaw * count_ + cube] = yaw;
+  ++generation_;
+}
+
+int CubeField::FindClosestInAngle(const gvr::Mat4f& head_from_start,
+                                  const std::array<float, 3>& direction,
+                                  float max_angle) const {
+  const float direction_norm =
+      std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] +
+                direction[2] * direction[2]);
+  if (direction_norm == 0.0f) return -1;
+  const float* xs = &data_[kX * count_];
+  const float* ys = &data_[kY * count_];
+  const float* zs = &data_[kZ * count_];
+  const float (*m)[4] = head_from_start.m;
+
+  // Rather than computing each angle, compare the cosines, which decrease
+  // with the angle.
+  float best_cosine = std::cos(max_angle);
+  int best_cube = -1;
+  for (int i = 0; i < count_; ++i) {
+    // The cube's center in head space.
+    const float cx = m[0][0] * xs[i] + m[0][1] * ys[i] + m[0][2] * zs[i] +
+                     m[0][3];
+    const float cy = m[1][0] * xs[i] + m[1][1] * ys[i] + m[1][2] * zs[i] +
+                     m[1][3];
+    const float cz = m[2][0] * xs[i] + m[2][1] * ys[i] + m[2][2] * zs[i] +
+                     m[2][3];
+    const float norm = std::sqrt(cx * cx + cy * cy + cz * cz) * direction_norm;
+    if (norm == 0.0f) continue;
+    const float cosine =
+        (cx * direction[0] + cy * direction[1] + cz * direction[2]) / norm;
+    if (cosine > best_cosine) {
+      best_cosine = cosine;
+      best_cube = i;
+    }
+  }
+  return best_cube;
+}
@@ -0,0 +1,91 @@
+/* Copyright 2017 Google Inc. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TREASUREHUNT_APP_SRC_MAIN_JNI_CUBE_FIELD_H_  // NOLINT
+#define TREASUREHUNT_APP_SRC_MAIN_JNI_CUBE_FIELD_H_  // NOLINT
+
+#include <array>
+#include <vector>
+
+#include "vr/gvr/capi/include/gvr_types.h"
+
+/**
+ * The transforms of the target cubes, stored as a structure of arrays: the
+ * X coordinates of all the cubes, then all the Y coordinates, then Z, then
+ * yaw. Each cube is tilted by 45 degrees around the X axis, turned by its yaw
+ * around the Y axis, and then moved to its position.
+ *
+ * The layout is also the layout of the instance buffer the cubes are drawn
+ * from, so the whole field can be uploaded as is.
+ */
+class CubeField {
+ public:
+  enum Component { kX, kY, kZ, kYaw, kComponentCount };
+
+  /**
+   * Creates |count| cubes, all at the origin.
+   *
+   * @param count The number of cubes, at least 1.
+   */
+  explicit CubeField(int count);
+
+  int size() const { return count_; }
+
+  float x(int cube) const { return data_[kX * count_ + cube]; }
+  float y(int cube) const { return data_[kY * count_ + cube]; }
+  float z(int cube) const { return data_[kZ * count_ + cube]; }
+  float yaw(int cube) const { return data_[kYaw * count_ + cube]; }
+
+  /**
+   * Moves a cube.
+   *
+   * @param cube The index of the cube.
+   * @param position Its new position, in start space.
+   * @param yaw Its new angle around the Y axis, in radians.
+   */
+  void Set(int cube, const std::array<float, 3>& position, float yaw);
+
+  /**
+   * @return All the components, kComponentCount * size() floats.
+   */
+  const float* data() const { return data_.data(); }
+
+  /**
+   * @return A number that changes whenever a cube moves.
+   */
+  int generation() const { return generation_; }
+
+  /**
+   * Finds the cube whose center is closest in angle to a direction.
+   *
+   * @param head_from_start The head pose.
+   * @param direction The direction, in head space.
+   * @param max_angle The largest angle, in radians, at which a cube is found.
+   * @return The index of the cube, or -1 if no cube is within |max_angle|.
+   */
+  int FindClosestInAngle(const gvr::Mat4f& head_from_start,
+                         const std::array<float, 3>& direction,
+                         float max_angle) const;
+
+ private:
+  const int count_;
+  std::vector<float> data_;
+  int generation_;
+
+  CubeField(const CubeField& other) = delete;
+  CubeField& operator=(const CubeField& other) = delete;
+};
+
+#endif  // TREASUREHUNT_APP_SRC_MAIN_JNI_CUBE_FIELD_H_  // NOLINT
@@ -17,6 +17,7 @@
 #include <jni.h>
 
 #include <memory>
+#include <string>
 
 #include "treasure_hunt_renderer.h"  // NOLINT
 #include "vr/gvr/capi/include/gvr.h"
@@ -41,14 +42,24 @@ extern "C" {
 
 JNI_METHOD(jlong, nativeCreateRenderer)
 (JNIEnv *env, jclass clazz, jobject class_loader, jobject android_context,
- jlong native_gvr_api) {
+ jlong native_gvr_api, jint cube_count, jstring trace_path,
+ jboolean foveation) {
   std::unique_ptr<gvr::AudioApi> audio_context(new gvr::AudioApi);
   audio_context->Init(env, android_context, class_loader,
                       GVR_AUDIO_RENDERING_BINAURAL_HIGH_QUALITY);
 
-  return jptr(
-      new TreasureHuntRenderer(reinterpret_cast<gvr_context *>(native_gvr_api),
-                               std::move(audio_context)));
+  std::string trace_path_string;
+  if (trace_path) {
+    const char *path = env->GetStringUTFChars(trace_path, nullptr);
+    trace_path_string = path;
+    env->ReleaseStringUTFChars(trace_path, path);
+  }
+  foveation::Config foveation_config;
+  foveation_config.enabled = foveation;
+  return jptr(new TreasureHuntRenderer(
+      reinterpret_cast<gvr_context *>(native_gvr_api),
+      std::move(audio_context), cube_count, trace_path_string,
+      foveation_config));
 }
 
 JNI_METHOD(void, nativeDestroyRenderer)
@@ -19,9 +19,12 @@
 #include <android/log.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <algorithm>
 #include <cmath>
 #include <random>
 
+#include "gl_state_cache.h"  // NOLINT
+#include "simd_math.h"  // NOLINT
 #include "vr/gvr/capi/include/gvr_version.h"
 
 #define LOG_TAG "TreasureHuntCPP"
@@ -50,7 +53,26 @@ static const float kDefaultFloorHeight = -2.0f;
 
 static const int kCoordsPerVertex = 3;
 
-static const uint64_t kPredictionTimeWithoutVsyncNanos = 50000000;
+// Layout of the static scene VBO. The cube comes first, with the position,
+// normal and color of each vertex interleaved, followed by the floor and
+// reticle positions.
+static const int kCubeVertexCount = 36;
+static const int kFloorVertexCount = 24;
+static const int kReticleVertexCount = 6;
+static const int kCubeStride = 3 * kCoordsPerVertex * sizeof(float);
+static const int kCubeNormalOffset = kCoordsPerVertex * sizeof(float);
+static const int kCubeColorOffset = 2 * kCoordsPerVertex * sizeof(float);
+static const int kFloorOffset = kCubeVertexCount * kCubeStride;
+static const int kReticleOffset =
+    kFloorOffset + kFloorVertexCount * kCoordsPerVertex * sizeof(float);
+
+// Number of cubes drawn per draw call without instancing. This must match the
+// size of u_Instances in the ES 2.0 cube shader.
+static const int kCubeBatchSize = 64;
+// Layout of the cube batch VBO: the interleaved cube vertex, followed by the
+// index of its copy of the cube.
+static const int kBatchedCubeStride = kCubeStride + sizeof(float);
+static const int kBatchedCubeIndexOffset = kCubeStride;
 
 // Angle threshold for determining whether the controller is pointing at the
 // object.
@@ -60,30 +82,37 @@ static const float kAngleLimit = 0.2f;
 static const char* kObjectSoundFile = "cube_sound.wav";
 static const char* kSuccessSoundFile = "success.wav";
 
-// Convert a GVR matrix to an array of floats suitable for passing to OpenGL.
-static std::array<float, 16> MatrixToGLArray(const gvr::Mat4f& matrix) {
-  // Note that this performs a *transpose* to a column-major matrix array, as
-  // expected by GL.
-  std::array<float, 16> result;
-  for (int i = 0; i < 4; ++i) {
-    for (int j = 0; j < 4; ++j) {
-      result[j * 4 + i] = matrix.m[i][j];
-    }
-  }
-  return result;
-}
-
-// Flatten a pair of mat4's into an array of 32 floats, useful when feeding
-// uniform values to OpenGL for multiview.
-static std::array<float, 32> MatrixPairToGLArray(const gvr::Mat4f matrix[]) {
-  std::array<float, 32> result;
-  for (int i = 0; i < 4; ++i) {
-    for (int j = 0; j < 4; ++j) {
-      result[j * 4 + i] = matrix[0].m[i][j];
-      result[16 + j * 4 + i] = matrix[1].m[i][j];
-    }
-  }
-  return result;
+// Number of events that can be posted between two frames. Only a burst of
+// touches faster than the frame rate could fill it.
+static const size_t kEventQueueCapacity = 64;
+
+// Bounds of the scale of each dimension the views are rendered at, relative
+// to the maximum effective render target size. Because we are using 2X MSAA,
+// we can render to half as many pixels and achieve similar quality, so the
+// largest scale is sqrt(2)/2 ~= 7/10ths. Under load it goes down from there.
+static const float kMaxRenderScale = 0.7f;
+static const float kMinRenderScale = 0.5f;
+
+// Frame time the render scale is adjusted to stay under. Frames come at
+// 60 Hz, and GVR's distortion pass needs the rest of the frame.
+static const int64_t kTargetFrameNanos = 12000000;
+
+// Swap chain buffers. The inset buffer only exists with foveation.
+static const int kSceneBufferIndex = 0;
+static const int kReticleBufferIndex = 1;
+static const int kInsetBufferIndex = 2;
+
+// Identity matrix, in column-major order.
+static const simd_math::GLMat4 kIdentityGLMatrix = {{1.f, 0.f, 0.f, 0.f,
+                                                     0.f, 1.f, 0.f, 0.f,
+                                                     0.f, 0.f, 1.f, 0.f,
+                                                     0.f, 0.f, 0.f, 1.f}};
+
+// Returns the bit for the given attribute location in the masks handed to
+// gl_state::StateCache::SetVertexAttribArrays(), or 0 for inactive
+// attributes.
+static uint32_t AttribBit(int location) {
+  return location >= 0 ? 1u << location : 0;
 }
 
 // Flatten a pair of vec3's into an array of 6 floats, useful when feeding
@@ -98,75 +127,18 @@ static std::array<float, 6> VectorPairToGLArray(
   return result;
 }
 
-// Multiply a vector by a matrix.
-static std::array<float, 4> MatrixVectorMul(const gvr::Mat4f& matrix,
-                                            const std::array<float, 4>& vec) {
-  std::array<float, 4> result;
-  for (int i = 0; i < 4; ++i) {
-    result[i] = 0;
-    for (int k = 0; k < 4; ++k) {
-      result[i] += matrix.m[i][k] * vec[k];
-    }
-  }
-  return result;
-}
-
-// Multiply two matrices.
-static gvr::Mat4f MatrixMul(const gvr::Mat4f& matrix1,
-                            const gvr::Mat4f& matrix2) {
-  gvr::Mat4f result;
-  for (int i = 0; i < 4; ++i) {
-    for (int j = 0; j < 4; ++j) {
-      result.m[i][j] = 0.0f;
-      for (int k = 0; k < 4; ++k) {
-        result.m[i][j] += matrix1.m[i][k] * matrix2.m[k][j];
-      }
-    }
-  }
-  return result;
-}
+using simd_math::MatrixMul;
+using simd_math::MatrixMulBatch;
+using simd_math::MatrixMulBatchToGL;
+using simd_math::MatrixToGL;
+using simd_math::MatrixVectorMul;
+using simd_math::PerspectiveMatrixFromView;
 
 // Drop the last element of a vector.
 static std::array<float, 3> Vec4ToVec3(const std::array<float, 4>& vec) {
   return {vec[0], vec[1], vec[2]};
 }
 
-// Given a field of view in degrees, compute the corresponding projection
-// matrix.
-static gvr::Mat4f PerspectiveMatrixFromView(const gvr::Rectf& fov, float z_near,
-                                            float z_far) {
-  gvr::Mat4f result;
-  const float x_left = -std::tan(fov.left * M_PI / 180.0f) * z_near;
-  const float x_right = std::tan(fov.right * M_PI / 180.0f) * z_near;
-  const float y_bottom = -std::tan(fov.bottom * M_PI / 180.0f) * z_near;
-  const float y_top = std::tan(fov.top * M_PI / 180.0f) * z_near;
-  const float zero = 0.0f;
-
-  assert(x_left < x_right && y_bottom < y_top && z_near < z_far &&
-         z_near > zero && z_far > zero);
-  const float X = (2 * z_near) / (x_right - x_left);
-  const float Y = (2 * z_near) / (y_top - y_bottom);
-  const float A = (x_right + x_left) / (x_right - x_left);
-  const float B = (y_top + y_bottom) / (y_top - y_bottom);
-  const float C = (z_near + z_far) / (z_near - z_far);
-  const float D = (2 * z_near * z_far) / (z_near - z_far);
-
-  for (int i = 0; i < 4; ++i) {
-    for (int j = 0; j < 4; ++j) {
-      result.m[i][j] = 0.0f;
-    }
-  }
-  result.m[0][0] = X;
-  result.m[0][2] = A;
-  result.m[1][1] = Y;
-  result.m[1][2] = B;
-  result.m[2][2] = C;
-  result.m[2][3] = D;
-  result.m[3][2] = -1;
-
-  return result;
-}
-
 // Multiplies both X coordinates of the rectangle by the given width and both Y
 // coordinates by the given height.
 static gvr::Rectf ModulateRect(const gvr::Rectf& rect, float width,
@@ -189,6 +161,18 @@ static gvr::Recti CalculatePixelSpaceRect(const gvr::Sizei& texture_size,
   return result;
 }
 
+// Returns the number of pixels of |rect| outside of the hidden area, which
+// covers |hidden_fraction| of it.
+static int64_t VisiblePixelCount(const gvr::Recti& rect,
+                                 float hidden_fraction) {
+  const int64_t pixel_count = foveation::PixelCount(rect);
+  return pixel_count - static_cast<int64_t>(pixel_count * hidden_fraction);
+}
+
+static bool SameSize(const gvr::Sizei& a, const gvr::Sizei& b) {
+  return a.width == b.width && a.height == b.height;
+}
+
 // Generate a random floating point number between 0 and 1.
 static float RandomUniformFloat() {
   static std::random_device random_device;
@@ -206,84 +190,73 @@ static void CheckGLError(const char* label) {
   }
 }
 
-// Computes a texture size that has approximately half as many pixels. This is
-// equivalent to scaling each dimension by approximately sqrt(2)/2.
-static gvr::Sizei HalfPixelCount(const gvr::Sizei& in) {
-  // Scale each dimension by sqrt(2)/2 ~= 7/10ths.
-  gvr::Sizei out;
-  out.width = (7 * in.width) / 10;
-  out.height = (7 * in.height) / 10;
-  return out;
-}
-
-// Convert the quaternion describing the controller's orientation to a
-// rotation matrix.
-static gvr::Mat4f ControllerQuatToMatrix(const gvr::ControllerQuat& quat) {
-  gvr::Mat4f result;
-  const float x = quat.qx;
-  const float x2 = quat.qx * quat.qx;
-  const float y = quat.qy;
-  const float y2 = quat.qy * quat.qy;
-  const float z = quat.qz;
-  const float z2 = quat.qz * quat.qz;
-  const float w = quat.qw;
-  const float xy = quat.qx * quat.qy;
-  const float xz = quat.qx * quat.qz;
-  const float xw = quat.qx * quat.qw;
-  const float yz = quat.qy * quat.qz;
-  const float yw = quat.qy * quat.qw;
-  const float zw = quat.qz * quat.qw;
-
-  const float m11 = 1.0f - 2.0f * y2 - 2.0f * z2;
-  const float m12 = 2.0f * (xy - zw);
-  const float m13 = 2.0f * (xz + yw);
-  const float m21 = 2.0f * (xy + zw);
-  const float m22 = 1.0f - 2.0f * x2 - 2.0f * z2;
-  const float m23 = 2.0f * (yz - xw);
-  const float m31 = 2.0f * (xz - yw);
-  const float m32 = 2.0f * (yz + xw);
-  const float m33 = 1.0f - 2.0f * x2 - 2.0f * y2;
-
-  return {{{m11, m12, m13, 0.0f},
-           {m21, m22, m23, 0.0f},
-           {m31, m32, m33, 0.0f},
-           {0.0f, 0.0f, 0.0f, 1.0f}}};
-}
-
-static inline float VectorNorm(const std::array<float, 4>& vect) {
-  return std::sqrt(vect[0] * vect[0] + vect[1] * vect[1] + vect[2] * vect[2]);
-}
-
-static float VectorInnerProduct(const std::array<float, 4>& vect1,
-                                const std::array<float, 4>& vect2) {
-  float product = 0;
-  for (int i = 0; i < 3; i++) {
-    product += vect1[i] * vect2[i];
-  }
-  return product;
+static dynamic_resolution::ScaleControllerOptions RenderScaleOptions() {
+  dynamic_resolution::ScaleControllerOptions options;
+  options.min_scale = kMinRenderScale;
+  options.max_scale = kMaxRenderScale;
+  options.target_nanos = kTargetFrameNanos;
+  return options;
 }
+
 }  // anonymous namespace
 
 TreasureHuntRenderer::TreasureHuntRenderer(
-    gvr_context* gvr_context, std::unique_ptr<gvr::AudioApi> gvr_audio_api)
+    gvr_context* gvr_context, std::unique_ptr<gvr::AudioApi> gvr_audio_api,
+    int cube_count, const std::string& trace_path,
+    const foveation::Config& foveation)
     : gvr_api_(gvr::GvrApi::WrapNonOwned(gvr_context)),
       gvr_audio_api_(std::move(gvr_audio_api)),
+      pose_predictor_([this](int64_t time) {
+        gvr::ClockTimePoint time_point;
+        time_point.monotonic_system_time_nanos = time;
+        return gvr_api_->GetHeadSpaceFromStartSpaceTransform(time_point);
+      }),
       viewport_left_(gvr_api_->CreateBufferViewport()),
       viewport_right_(gvr_api_->CreateBufferViewport()),
-      floor_vertices_(world_layout_data_.floor_coords.data()),
-      cube_vertices_(world_layout_data_.cube_coords.data()),
-      cube_colors_(world_layout_data_.cube_colors.data()),
+      foveation_(foveation),
+      inset_viewport_left_(gvr_api_->CreateBufferViewport()),
+      inset_viewport_right_(gvr_api_->CreateBufferViewport()),
       cube_found_colors_(world_layout_data_.cube_found_color.data()),
-      cube_normals_(world_layout_data_.cube_normals.data()),
-      reticle_vertices_(world_layout_data_.reticle_coords.data()),
+      scene_vbo_(0),
+      scene_vertex_arrays_(),
+      cube_field_(cube_count),
+      cube_instancing_(false),
+      cube_instance_vbo_(0),
+      cube_batch_vbo_(0),
+      cube_instance_generation_(-1),
+      pointed_cube_(-1),
+      hidden_area_stale_(true),
       reticle_render_size_{128, 128},
       light_pos_world_space_({0.0f, 2.0f, 0.0f, 1.0f}),
-      object_distance_(kMinCubeDistance),
+      resolution_(RenderScaleOptions()),
+      shaded_pixel_count_(0),
+      unfoveated_pixel_count_(0),
       audio_source_id_(-1),
       success_source_id_(-1),
+      loaded_audio_source_id_(-1),
+      events_(kEventQueueCapacity),
       gvr_controller_api_(nullptr),
-      gvr_viewer_type_(gvr_api_->GetViewerType()) {
+      gvr_viewer_type_(gvr_api_->GetViewerType()),
+      gpu_timer_("GPU"),
+      trace_path_(trace_path) {
   ResumeControllerApiAsNeeded();
+  gpu_timer_.set_frame_listener(
+      [this](int64_t gpu_nanos) { UpdateRenderScale(gpu_nanos); });
+  if (!trace_path_.empty()) {
+    trace::SetEnabled(true);
+    LOGD("Tracing frames to %s.", trace_path_.c_str());
+  }
+  if (foveation_.enabled) {
+    LOGD("Foveated rendering: %.0f degree insets, periphery at %.2f.",
+         foveation_.inset_half_angle_degrees, foveation_.periphery_scale);
+  }
+
+  // The first cube appears directly in front of the user. Any others are
+  // scattered around.
+  for (int i = 0; i < cube_field_.size(); ++i) {
+    cube_field_.Set(i, {0.0f, 0.0f, -kMinCubeDistance}, 0.0f);
+    if (i > 0) MoveCube(i, 2.0f * M_PI * RandomUniformFloat());
+  }
 
   LOGD("Built with GVR version: %s", GVR_SDK_VERSION_STRING);
   if (gvr_viewer_type_ == GVR_VIEWER_TYPE_CARDBOARD) {
@@ -304,23 +277,45 @@ TreasureHuntRenderer::~TreasureHuntRenderer() {
 
 void TreasureHuntRenderer::InitializeGl() {
   gvr_api_->InitializeGl();
+  gl_state_.Initialize(gl_state::LoadGlFunctions());
+  gpu_timer_.Initialize();
+  resolution_.Reset();
+  LOGD(gpu_timer_.supported() ? "Scaling the resolution by GPU time."
+                              : "Scaling the resolution by CPU time.");
+  if (!trace_path_.empty()) {
+    trace::SetThreadName("Render");
+    LOGD(gpu_timer_.supported() ? "Timing the GPU." : "Not timing the GPU.");
+  }
   multiview_enabled_ = gvr_api_->IsFeatureSupported(GVR_FEATURE_MULTIVIEW);
   LOGD(multiview_enabled_ ? "Using multiview." : "Not using multiview.");
 
+  // The cubes are drawn instanced whenever the context is ES 3.0, which
+  // multiview implies.
+  cube_instancing_ = gl_state_.vertex_arrays_supported();
+  CHECK(!multiview_enabled_ || cube_instancing_);
+  LOGD(cube_instancing_ ? "Drawing the cubes instanced."
+                        : "Drawing the cubes in batches.");
+
   int index = multiview_enabled_ ? 1 : 0;
+  // The cube program has a third variant, instanced without multiview. Its
+  // fragment shader is the ES 3.0 one whenever it is instanced.
+  const int cube_index = multiview_enabled_ ? 1 : cube_instancing_ ? 2 : 0;
+  const int cube_vertex_shader =
+      LoadGLShader(GL_VERTEX_SHADER, &kCubeVertexShaders[cube_index]);
   const int vertex_shader =
       LoadGLShader(GL_VERTEX_SHADER, &kDiffuseLightingVertexShaders[index]);
   const int grid_shader =
       LoadGLShader(GL_FRAGMENT_SHADER, &kGridFragmentShaders[index]);
-  const int pass_through_shader =
-      LoadGLShader(GL_FRAGMENT_SHADER, &kPassthroughFragmentShaders[index]);
+  const int pass_through_shader = LoadGLShader(
+      GL_FRAGMENT_SHADER, &kPassthroughFragmentShaders[cube_instancing_ ? 1
+                                                                        : 0]);
   const int reticle_vertex_shader =
       LoadGLShader(GL_VERTEX_SHADER, &kReticleVertexShaders[index]);
   const int reticle_fragment_shader =
       LoadGLShader(GL_FRAGMENT_SHADER, &kReticleFragmentShaders[index]);
 
   cube_program_ = glCreateProgram();
-  glAttachShader(cube_program_, vertex_shader);
+  glAttachShader(cube_program_, cube_vertex_shader);
   glAttachShader(cube_program_, pass_through_shader);
   glLinkProgram(cube_program_);
   glUseProgram(cube_program_);
@@ -328,12 +323,24 @@ void TreasureHuntRenderer::InitializeGl() {
   cube_position_param_ = glGetAttribLocation(cube_program_, "a_Position");
   cube_normal_param_ = glGetAttribLocation(cube_program_, "a_Normal");
   cube_color_param_ = glGetAttribLocation(cube_program_, "a_Color");
+  cube_instance_index_param_ =
+      glGetAttribLocation(cube_program_, "a_InstanceIndex");
+  static const char* kCubeInstanceAttribs[CubeField::kComponentCount] = {
+      "a_InstanceX", "a_InstanceY", "a_InstanceZ", "a_InstanceYaw"};
+  for (int i = 0; i < CubeField::kComponentCount; ++i) {
+    cube_instance_params_[i] =
+        glGetAttribLocation(cube_program_, kCubeInstanceAttribs[i]);
+  }
 
-  cube_model_param_ = glGetUniformLocation(cube_program_, "u_Model");
-  cube_modelview_param_ = glGetUniformLocation(cube_program_, "u_MVMatrix");
-  cube_modelview_projection_param_ =
-      glGetUniformLocation(cube_program_, "u_MVP");
+  cube_view_param_ = glGetUniformLocation(cube_program_, "u_View");
+  cube_view_projection_param_ = glGetUniformLocation(cube_program_, "u_VP");
   cube_light_pos_param_ = glGetUniformLocation(cube_program_, "u_LightPos");
+  cube_instances_param_ = glGetUniformLocation(cube_program_, "u_Instances");
+  cube_pointed_instance_param_ =
+      glGetUniformLocation(cube_program_, "u_PointedInstance");
+  cube_found_color_param_ =
+      glGetUniformLocation(cube_program_, "u_FoundColor");
+  glUniform3fv(cube_found_color_param_, 1, cube_found_colors_);
 
   CheckGLError("Cube program params");
 
@@ -371,53 +378,41 @@ void TreasureHuntRenderer::InitializeGl() {
 
   CheckGLError("Reticle program params");
 
-  // Object first appears directly in front of user.
-  model_cube_ = {{{1.0f, 0.0f, 0.0f, 0.0f},
-                  {0.0f, 0.707f, -0.707f, 0.0f},
-                  {0.0f, 0.707f, 0.707f, -object_distance_},
-                  {0.0f, 0.0f, 0.0f, 1.0f}}};
+  CreateSceneGeometry();
+  CHECK(hidden_area_.Initialize(&gl_state_, multiview_enabled_));
+  hidden_area_stale_ = true;
+
   const float rs = 0.04f;  // Reticle scale.
   model_reticle_ = {{{rs, 0.0f, 0.0f, 0.0f},
                      {0.0f, rs, 0.0f, 0.0f},
                      {0.0f, 0.0f, rs, -kReticleDistance},
                      {0.0f, 0.0f, 0.0f, 1.0f}}};
 
-  // Because we are using 2X MSAA, we can render to half as many pixels and
-  // achieve similar quality.
-  render_size_ =
-      HalfPixelCount(gvr_api_->GetMaximumEffectiveRenderTargetSize());
+  viewport_list_.reset(
+      new gvr::BufferViewportList(gvr_api_->CreateEmptyBufferViewportList()));
+  viewport_list_->SetToRecommendedBufferViewports();
+  GetSceneBufferSizes(&render_size_, &inset_render_size_);
   std::vector<gvr::BufferSpec> specs;
 
-  specs.push_back(gvr_api_->CreateBufferSpec());
-  specs[0].SetColorFormat(GVR_COLOR_FORMAT_RGBA_8888);
-  specs[0].SetDepthStencilFormat(GVR_DEPTH_STENCIL_FORMAT_DEPTH_16);
-  specs[0].SetSamples(2);
-
-  // With multiview, the distortion buffer is a texture array with two layers
-  // whose width is half the display width.
-  if (multiview_enabled_) {
-    gvr::Sizei half_size = { render_size_.width / 2, render_size_.height };
-    specs[0].SetMultiviewLayers(2);
-    specs[0].SetSize(half_size);
-  } else {
-    specs[0].SetSize(render_size_);
-  }
+  specs.push_back(CreateSceneBufferSpec(render_size_));
 
   specs.push_back(gvr_api_->CreateBufferSpec());
-  specs[1].SetSize(reticle_render_size_);
-  specs[1].SetColorFormat(GVR_COLOR_FORMAT_RGBA_8888);
-  specs[1].SetDepthStencilFormat(GVR_DEPTH_STENCIL_FORMAT_NONE);
-  specs[1].SetSamples(1);
+  specs[kReticleBufferIndex].SetSize(reticle_render_size_);
+  specs[kReticleBufferIndex].SetColorFormat(GVR_COLOR_FORMAT_RGBA_8888);
+  specs[kReticleBufferIndex].SetDepthStencilFormat(
+      GVR_DEPTH_STENCIL_FORMAT_NONE);
+  specs[kReticleBufferIndex].SetSamples(1);
+
+  if (foveation_.enabled) {
+    specs.push_back(CreateSceneBufferSpec(inset_render_size_));
+  }
   swapchain_.reset(new gvr::SwapChain(gvr_api_->CreateSwapChain(specs)));
 
-  viewport_list_.reset(
-      new gvr::BufferViewportList(gvr_api_->CreateEmptyBufferViewportList()));
-
   // Initialize audio engine and preload sample in a separate thread to avoid
   // any delay during construction and app initialization. Only do this once.
   if (!audio_initialization_thread_.joinable()) {
     audio_initialization_thread_ =
-        std::thread(&TreasureHuntRenderer::LoadAndPlayCubeSound, this);
+        std::thread(&TreasureHuntRenderer::LoadCubeSound, this);
   }
 }
 
@@ -463,7 +458,7 @@ void TreasureHuntRenderer::ProcessControllerInput() {
   // Trigger click event if app/click button is clicked.
   if (gvr_controller_state_.GetButtonDown(GVR_CONTROLLER_BUTTON_APP) ||
       gvr_controller_state_.GetButtonDown(GVR_CONTROLLER_BUTTON_CLICK)) {
-    OnTriggerEvent();
+    HandleTriggerEvent();
   }
 }
 
@@ -471,7 +466,7 @@ void TreasureHuntRenderer::UpdateReticlePosition() {
   if (gvr_viewer_type_ == GVR_VIEWER_TYPE_DAYDREAM) {
     ProcessControllerInput();
     gvr::Mat4f controller_matrix =
-        ControllerQuatToMatrix(gvr_controller_state_.GetOrientation());
+        simd_math::QuatToMatrix(gvr_controller_state_.GetOrientation());
     modelview_reticle_ =
         MatrixMul(head_view_, MatrixMul(controller_matrix, model_reticle_));
   } else {
@@ -480,28 +475,47 @@ void TreasureHuntRenderer::UpdateReticlePosition() {
 }
 
 void TreasureHuntRenderer::DrawFrame() {
+  TRACE_ZONE("DrawFrame");
+  const int64_t frame_start = trace::NowNanos();
+  gpu_timer_.Collect();
+  HandleEvents();
+  // The inset buffer is sized from the recommended fields of view.
+  viewport_list_->SetToRecommendedBufferViewports();
   PrepareFramebuffer();
+  if (hidden_area_stale_) UpdateHiddenArea();
+  TRACE_ZONE_BEGIN(acquire_zone, "AcquireFrame");
   gvr::Frame frame = swapchain_->AcquireFrame();
+  TRACE_ZONE_END(acquire_zone);
+  // GVR's distortion pass in the previous frame changed GL state behind the
+  // cache's back.
+  gl_state_.Invalidate();
 
   // A client app does its rendering here.
-  gvr::ClockTimePoint target_time = gvr::GvrApi::GetTimePointNow();
-  target_time.monotonic_system_time_nanos += kPredictionTimeWithoutVsyncNanos;
   gvr::BufferViewport* viewport[2] = {
     &viewport_left_,
     &viewport_right_,
   };
-  head_view_ = gvr_api_->GetHeadSpaceFromStartSpaceTransform(target_time);
-  viewport_list_->SetToRecommendedBufferViewports();
+  gvr::BufferViewport* inset_viewport[2] = {
+    &inset_viewport_left_,
+    &inset_viewport_right_,
+  };
+  TRACE_ZONE_BEGIN(update_zone, "UpdateFrame");
+  head_view_ = pose_predictor_.BeginFrame(
+      gvr::GvrApi::GetTimePointNow().monotonic_system_time_nanos);
 
   gvr::BufferViewport reticle_viewport = gvr_api_->CreateBufferViewport();
-  reticle_viewport.SetSourceBufferIndex(1);
+  reticle_viewport.SetSourceBufferIndex(kReticleBufferIndex);
   if (gvr_viewer_type_ == GVR_VIEWER_TYPE_CARDBOARD) {
     // Do not reproject the reticle if it's head-locked.
     reticle_viewport.SetReprojection(GVR_REPROJECTION_NONE);
   }
   const gvr_rectf fullscreen = { 0, 1, 0, 1 };
   reticle_viewport.SetSourceUv(fullscreen);
+  // The views are rendered into the corner of each scene buffer that the
+  // current render scale covers, and GVR only samples that corner.
+  const float render_scale = resolution_.scale();
   UpdateReticlePosition();
+  pointed_cube_ = FindPointedCube();
 
   gvr::Value floor_height;
   // This may change when the floor height changes so it's computed every frame.
@@ -513,97 +527,278 @@ void TreasureHuntRenderer::DrawFrame() {
                    {0.0f, 1.0f, 0.0f, ground_y},
                    {0.0f, 0.0f, 1.0f, 0.0f},
                    {0.0f, 0.0f, 0.0f, 1.0f}}};
-
-  gvr::Mat4f eye_views[2];
+  model_floor_gl_ = MatrixToGL(model_floor_);
+
+  // The first two viewports are for the 3D scene (one for each eye). With
+  // foveation, they show its periphery, and the next two its insets, which
+  // GVR draws over it. The last two viewports are for the reticle (one for
+  // each eye).
+  const int scene_pass_count = foveation_.enabled ? 2 : 1;
+  const gvr::Mat4f eye_from_head[2] = {
+      gvr_api_->GetEyeFromHeadMatrix(GVR_LEFT_EYE),
+      gvr_api_->GetEyeFromHeadMatrix(GVR_RIGHT_EYE)};
+  MatrixMulBatch(eye_from_head, head_view_, eye_view_matrices_, 2);
+  gvr::Mat4f modelview_floor[2];
+  MatrixMulBatch(eye_view_matrices_, model_floor_, modelview_floor, 2);
   for (int eye = 0; eye < 2; ++eye) {
-    const gvr::Eye gvr_eye = eye == 0 ? GVR_LEFT_EYE : GVR_RIGHT_EYE;
-    const gvr::Mat4f eye_from_head = gvr_api_->GetEyeFromHeadMatrix(gvr_eye);
-    eye_views[eye] = MatrixMul(eye_from_head, head_view_);
-
     viewport_list_->GetBufferViewport(eye, viewport[eye]);
+    if (foveation_.enabled) {
+      // The inset buffer is laid out like the scene buffer, so the inset
+      // starts from the same viewport.
+      viewport_list_->GetBufferViewport(eye, inset_viewport[eye]);
+      inset_viewport[eye]->SetSourceBufferIndex(kInsetBufferIndex);
+      inset_viewport[eye]->SetSourceFov(foveation::InsetFov(
+          viewport[eye]->GetSourceFov(), foveation_.inset_half_angle_degrees));
+    }
 
-    if (multiview_enabled_) {
-      viewport[eye]->SetSourceUv(fullscreen);
-      viewport[eye]->SetSourceLayer(eye);
-      viewport_list_->SetBufferViewport(eye, *viewport[eye]);
+    for (int pass = 0; pass < scene_pass_count; ++pass) {
+      gvr::BufferViewport* scene_viewport =
+          pass == 0 ? viewport[eye] : inset_viewport[eye];
+      if (multiview_enabled_) {
+        scene_viewport->SetSourceUv(fullscreen);
+        scene_viewport->SetSourceLayer(eye);
+      }
+      scene_viewport->SetSourceUv(dynamic_resolution::ScaleUv(
+          scene_viewport->GetSourceUv(), render_scale, kMaxRenderScale));
+      viewport_list_->SetBufferViewport(2 * pass + eye, *scene_viewport);
     }
 
-    reticle_viewport.SetTransform(MatrixMul(eye_from_head, modelview_reticle_));
+    MatrixToGL(eye_view_matrices_[eye], &eye_view_[16 * eye]);
+    MatrixToGL(modelview_floor[eye], &modelview_floor_[16 * eye]);
+    light_pos_eye_space_[eye] = Vec4ToVec3(
+        MatrixVectorMul(eye_view_matrices_[eye], light_pos_world_space_));
+  }
+  UpdateProjections(viewport);
+  // Viewports can only be appended to the list, so the reticle ones are
+  // set once all those of the scene are.
+  for (int eye = 0; eye < 2; ++eye) {
+    const gvr::Eye gvr_eye = eye == 0 ? GVR_LEFT_EYE : GVR_RIGHT_EYE;
+    reticle_viewport.SetTransform(
+        MatrixMul(eye_from_head[eye], modelview_reticle_));
     reticle_viewport.SetTargetEye(gvr_eye);
-    // The first two viewports are for the 3D scene (one for each eye), the
-    // latter two viewports are for the reticle (one for each eye).
-    viewport_list_->SetBufferViewport(2 + eye, reticle_viewport);
-
-    modelview_cube_[eye] = MatrixMul(eye_views[eye], model_cube_);
-    modelview_floor_[eye] = MatrixMul(eye_views[eye], model_floor_);
-    const gvr_rectf fov = viewport[eye]->GetSourceFov();
-    const gvr::Mat4f perspective =
-        PerspectiveMatrixFromView(fov, kZNear, kZFar);
-    modelview_projection_cube_[eye] =
-        MatrixMul(perspective, modelview_cube_[eye]);
-    modelview_projection_floor_[eye] =
-        MatrixMul(perspective, modelview_floor_[eye]);
-    light_pos_eye_space_[eye] =
-        Vec4ToVec3(MatrixVectorMul(eye_views[eye], light_pos_world_space_));
-  }
-
-  glEnable(GL_DEPTH_TEST);
-  glEnable(GL_CULL_FACE);
-  glDisable(GL_SCISSOR_TEST);
-  glDisable(GL_BLEND);
+    viewport_list_->SetBufferViewport(2 * scene_pass_count + eye,
+                                      reticle_viewport);
+  }
+
+  gl_state_.SetCapability(GL_DEPTH_TEST, true);
+  gl_state_.SetCapability(GL_CULL_FACE, true);
+  gl_state_.SetCapability(GL_SCISSOR_TEST, false);
+  gl_state_.SetCapability(GL_BLEND, false);
+  UpdateCubeInstances();
+  TRACE_ZONE_END(update_zone);
 
   // Draw the world.
-  frame.BindBuffer(0);
+  frame.BindBuffer(kSceneBufferIndex);
   glClearColor(0.1f, 0.1f, 0.1f, 0.5f);  // Dark background so text shows up.
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-  if (multiview_enabled_) {
-    DrawWorld(kMultiview);
-  } else {
-    DrawWorld(kLeftView);
-    DrawWorld(kRightView);
-  }
+  const int64_t masked_pixel_count = foveation_.enabled ? MaskInsets() : 0;
+  DrawViews(render_size_, viewport, true);
   frame.Unbind();
+  int64_t shaded_pixel_count = -masked_pixel_count;
+  for (int eye = 0; eye < 2; ++eye) {
+    shaded_pixel_count += VisiblePixelCount(
+        ViewRect(render_size_, *viewport[eye]),
+        hidden_area_.hidden_fraction(eye));
+  }
+
+  // Draw the insets of the world at full resolution, over the same
+  // background.
+  int64_t unfoveated_pixel_count = shaded_pixel_count;
+  if (foveation_.enabled) {
+    TRACE_ZONE("DrawInsets");
+    UpdateProjections(inset_viewport);
+    frame.BindBuffer(kInsetBufferIndex);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    DrawViews(inset_render_size_, inset_viewport, false);
+    frame.Unbind();
+    for (int eye = 0; eye < 2; ++eye) {
+      shaded_pixel_count += foveation::PixelCount(
+          ViewRect(inset_render_size_, *inset_viewport[eye]));
+    }
+    const gvr::Sizei unfoveated_size = dynamic_resolution::ScaleSize(
+        gvr_api_->GetMaximumEffectiveRenderTargetSize(), render_scale);
+    const gvr::Recti unfoveated_view_rect = {0, unfoveated_size.width / 2, 0,
+                                             unfoveated_size.height};
+    unfoveated_pixel_count = 0;
+    for (int eye = 0; eye < 2; ++eye) {
+      unfoveated_pixel_count += VisiblePixelCount(
+          unfoveated_view_rect, hidden_area_.hidden_fraction(eye));
+    }
+  }
+  if (shaded_pixel_count != shaded_pixel_count_) {
+    LOGD("Shading %lld pixels per frame, %d%% of the unfoveated count.",
+         static_cast<long long>(shaded_pixel_count),  // NOLINT
+         static_cast<int>(100 * shaded_pixel_count /
+                          std::max<int64_t>(1, unfoveated_pixel_count)));
+  }
+  shaded_pixel_count_ = shaded_pixel_count;
+  unfoveated_pixel_count_ = unfoveated_pixel_count;
 
   // Draw the reticle on a separate layer.
-  frame.BindBuffer(1);
+  frame.BindBuffer(kReticleBufferIndex);
   glClearColor(0.0f, 0.0f, 0.0f, 0.0f);  // Transparent background.
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  gpu_timer_.Begin("DrawReticle");
   DrawReticle();
+  gpu_timer_.End();
+  // Leave the default vertex array and buffer bindings for GVR.
+  if (gl_state_.vertex_arrays_supported()) {
+    gl_state_.BindVertexArray(0);
+  } else {
+    gl_state_.SetVertexAttribArrays(0);
+  }
+  gl_state_.BindBuffer(GL_ARRAY_BUFFER, 0);
   frame.Unbind();
 
   // Submit frame.
-  frame.Submit(*viewport_list_, head_view_);
+  {
+    TRACE_ZONE("Submit");
+    frame.Submit(*viewport_list_, head_view_);
+  }
+  pose_predictor_.EndFrame(
+      gvr::GvrApi::GetTimePointNow().monotonic_system_time_nanos);
+  if (!gpu_timer_.supported()) {
+    UpdateRenderScale(trace::NowNanos() - frame_start);
+  }
 
   CheckGLError("onDrawFrame");
 
   // Update audio head rotation in audio API.
+  TRACE_ZONE("AudioUpdate");
   gvr_audio_api_->SetHeadPose(head_view_);
   gvr_audio_api_->Update();
 }
 
 void TreasureHuntRenderer::PrepareFramebuffer() {
-  // Because we are using 2X MSAA, we can render to half as many pixels and
-  // achieve similar quality.
-  const gvr::Sizei recommended_size =
-      HalfPixelCount(gvr_api_->GetMaximumEffectiveRenderTargetSize());
-  if (render_size_.width != recommended_size.width ||
-      render_size_.height != recommended_size.height) {
-    // We need to resize the framebuffer. Note that multiview uses two texture
-    // layers, each with half the render width.
-    gvr::Sizei framebuffer_size = recommended_size;
-    if (multiview_enabled_) {
-      framebuffer_size.width /= 2;
-    }
-    swapchain_->ResizeBuffer(0, framebuffer_size);
+  // The framebuffers are only resized when the recommended size or fields of
+  // view change: the render scale does not resize them.
+  gvr::Sizei recommended_size;
+  gvr::Sizei recommended_inset_size;
+  GetSceneBufferSizes(&recommended_size, &recommended_inset_size);
+  if (!SameSize(render_size_, recommended_size)) {
+    ResizeSceneBuffer(kSceneBufferIndex, recommended_size);
     render_size_ = recommended_size;
   }
+  if (foveation_.enabled &&
+      !SameSize(inset_render_size_, recommended_inset_size)) {
+    ResizeSceneBuffer(kInsetBufferIndex, recommended_inset_size);
+    inset_render_size_ = recommended_inset_size;
+  }
+}
+
+void TreasureHuntRenderer::GetSceneBufferSizes(
+    gvr::Sizei* render_size, gvr::Sizei* inset_render_size) {
+  const gvr::Sizei full_size = dynamic_resolution::ScaleSize(
+      gvr_api_->GetMaximumEffectiveRenderTargetSize(), kMaxRenderScale);
+  *render_size = full_size;
+  *inset_render_size = {0, 0};
+  if (!foveation_.enabled) return;
+  *render_size = dynamic_resolution::ScaleSize(full_size,
+                                               foveation_.periphery_scale);
+  // The insets have the pixel density of the full size views, and are laid
+  // out side by side like them, in as much room as the larger one needs.
+  // inset_viewport_left_ is overwritten when the frame is drawn anyway.
+  const gvr::Sizei eye_size = {full_size.width / 2, full_size.height};
+  for (int eye = 0; eye < 2; ++eye) {
+    viewport_list_->GetBufferViewport(eye, &inset_viewport_left_);
+    const gvr::Rectf eye_fov = inset_viewport_left_.GetSourceFov();
+    const gvr::Sizei inset_size = foveation::InsetSize(
+        eye_size, eye_fov,
+        foveation::InsetFov(eye_fov, foveation_.inset_half_angle_degrees));
+    inset_render_size->width =
+        std::max(inset_render_size->width, 2 * inset_size.width);
+    inset_render_size->height =
+        std::max(inset_render_size->height, inset_size.height);
+  }
+}
+
+gvr::BufferSpec TreasureHuntRenderer::CreateSceneBufferSpec(
+    const gvr::Sizei& size) {
+  gvr::BufferSpec spec = gvr_api_->CreateBufferSpec();
+  spec.SetColorFormat(GVR_COLOR_FORMAT_RGBA_8888);
+  spec.SetDepthStencilFormat(GVR_DEPTH_STENCIL_FORMAT_DEPTH_16);
+  spec.SetSamples(2);
+
+  // With multiview, the distortion buffer is a texture array with two layers
+  // whose width is half the display width.
+  if (multiview_enabled_) {
+    gvr::Sizei half_size = { size.width / 2, size.height };
+    spec.SetMultiviewLayers(2);
+    spec.SetSize(half_size);
+  } else {
+    spec.SetSize(size);
+  }
+  return spec;
+}
+
+void TreasureHuntRenderer::ResizeSceneBuffer(int index,
+                                             const gvr::Sizei& size) {
+  // Note that multiview uses two texture layers, each with half the render
+  // width.
+  gvr::Sizei framebuffer_size = size;
+  if (multiview_enabled_) {
+    framebuffer_size.width /= 2;
+  }
+  swapchain_->ResizeBuffer(index, framebuffer_size);
+}
+
+void TreasureHuntRenderer::UpdateHiddenArea() {
+  gvr::GvrApi* gvr_api = gvr_api_.get();
+  hidden_area_.Update(
+      [gvr_api](const gvr::Vec2f& screen_uv) {
+        return gvr_api->ComputeDistortedPoint(GVR_LEFT_EYE, screen_uv);
+      },
+      [gvr_api](const gvr::Vec2f& screen_uv) {
+        return gvr_api->ComputeDistortedPoint(GVR_RIGHT_EYE, screen_uv);
+      });
+  hidden_area_stale_ = false;
+  LOGD("The lenses hide %.1f%% of the left view and %.1f%% of the right one.",
+       100.0f * hidden_area_.hidden_fraction(0),
+       100.0f * hidden_area_.hidden_fraction(1));
+}
+
+void TreasureHuntRenderer::UpdateRenderScale(int64_t frame_nanos) {
+  if (resolution_.AddFrameTime(frame_nanos)) {
+    LOGD("Rendering at %.2f of the maximum render target size.",
+         resolution_.scale());
+  }
 }
 
 void TreasureHuntRenderer::OnTriggerEvent() {
-  if (IsPointingAtObject()) {
+  if (!events_.TryPush(kTriggerEvent)) {
+    LOGW("Event queue full, dropping a trigger event.");
+  }
+}
+
+void TreasureHuntRenderer::HandleEvents() {
+  Event event;
+  while (events_.TryPop(&event)) {
+    switch (event) {
+      case kTriggerEvent:
+        HandleTriggerEvent();
+        break;
+    }
+  }
+
+  if (audio_source_id_ < 0) {
+    const gvr::AudioSourceId loaded = loaded_audio_source_id_.load();
+    if (loaded >= 0) {
+      // Set sound object to current cube position, and trigger its playback.
+      audio_source_id_ = loaded;
+      gvr_audio_api_->SetSoundObjectPosition(
+          audio_source_id_, cube_field_.x(0), cube_field_.y(0),
+          cube_field_.z(0));
+      gvr_audio_api_->PlaySound(audio_source_id_, true /* looped playback */);
+    }
+  }
+}
+
+void TreasureHuntRenderer::HandleTriggerEvent() {
+  const int cube = FindPointedCube();
+  if (cube >= 0) {
     success_source_id_ = gvr_audio_api_->CreateStereoSound(kSuccessSoundFile);
     gvr_audio_api_->PlaySound(success_source_id_, false /* looping disabled */);
-    HideObject();
+    HideCube(cube);
   }
 }
 
@@ -611,11 +806,22 @@ void TreasureHuntRenderer::OnPause() {
   gvr_api_->PauseTracking();
   gvr_audio_api_->Pause();
   if (gvr_controller_api_) gvr_controller_api_->Pause();
+  // The whole trace so far is written every time, since the app may not come
+  // back.
+  if (!trace_path_.empty()) {
+    if (trace::WriteChromeTrace(trace_path_)) {
+      LOGD("Wrote the trace to %s (%d events dropped).", trace_path_.c_str(),
+           static_cast<int>(trace::DroppedEventCount()));
+    } else {
+      LOGE("Failed to write the trace to %s.", trace_path_.c_str());
+    }
+  }
 }
 
 void TreasureHuntRenderer::OnResume() {
   gvr_api_->ResumeTracking();
   gvr_api_->RefreshViewerProfile();
+  hidden_area_stale_ = true;
   gvr_audio_api_->Resume();
   gvr_viewer_type_ = gvr_api_->GetViewerType();
   ResumeControllerApiAsNeeded();
@@ -646,199 +852,385 @@ int TreasureHuntRenderer::LoadGLShader(int type, const char** shadercode) {
   return shader;
 }
 
+void TreasureHuntRenderer::CreateSceneGeometry() {
+  // Interleave the cube's positions, normals and colors, then append the
+  // floor and reticle positions.
+  std::vector<float> data;
+  data.reserve(kReticleOffset / sizeof(float) +
+               world_layout_data_.reticle_coords.size());
+  for (int i = 0; i < kCubeVertexCount * kCoordsPerVertex;
+       i += kCoordsPerVertex) {
+    const float* attribs[] = {
+        &world_layout_data_.cube_coords[i],
+        &world_layout_data_.cube_normals[i],
+        &world_layout_data_.cube_colors[i],
+    };
+    for (const float* attrib : attribs) {
+      data.insert(data.end(), attrib, attrib + kCoordsPerVertex);
+    }
+  }
+  data.insert(data.end(), world_layout_data_.floor_coords.begin(),
+              world_layout_data_.floor_coords.end());
+  data.insert(data.end(), world_layout_data_.reticle_coords.begin(),
+              world_layout_data_.reticle_coords.end());
+
+  glGenBuffers(1, &scene_vbo_);
+  gl_state_.BindBuffer(GL_ARRAY_BUFFER, scene_vbo_);
+  glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), data.data(),
+               GL_STATIC_DRAW);
+
+  if (cube_instancing_) {
+    // The instance data is uploaded by UpdateCubeInstances().
+    glGenBuffers(1, &cube_instance_vbo_);
+    gl_state_.BindBuffer(GL_ARRAY_BUFFER, cube_instance_vbo_);
+    glBufferData(GL_ARRAY_BUFFER, CubeField::kComponentCount *
+                     cube_field_.size() * sizeof(float),
+                 nullptr, GL_DYNAMIC_DRAW);
+  } else {
+    // Repeat the interleaved cube vertices at the start of |data|, appending
+    // the index of the copy to each vertex.
+    const int floats_per_vertex = kCubeStride / sizeof(float);
+    std::vector<float> batch;
+    batch.reserve(kCubeBatchSize * kCubeVertexCount * kBatchedCubeStride /
+                  sizeof(float));
+    for (int copy = 0; copy < kCubeBatchSize; ++copy) {
+      for (int i = 0; i < kCubeVertexCount; ++i) {
+        const float* vertex = &data[i * floats_per_vertex];
+        batch.insert(batch.end(), vertex, vertex + floats_per_vertex);
+        batch.push_back(copy);
+      }
+    }
+    glGenBuffers(1, &cube_batch_vbo_);
+    gl_state_.BindBuffer(GL_ARRAY_BUFFER, cube_batch_vbo_);
+    glBufferData(GL_ARRAY_BUFFER, batch.size() * sizeof(float), batch.data(),
+                 GL_STATIC_DRAW);
+  }
+  cube_instance_generation_ = -1;
+
+  // With vertex array objects, each object's attribute setup is recorded
+  // once here and drawing only binds it.
+  if (gl_state_.vertex_arrays_supported()) {
+    for (int object = 0; object < kSceneObjectCount; ++object) {
+      scene_vertex_arrays_[object] = gl_state_.CreateVertexArray();
+      gl_state_.BindVertexArray(scene_vertex_arrays_[object]);
+      SetSceneAttribPointers(static_cast<SceneObject>(object));
+    }
+    gl_state_.BindVertexArray(0);
+  }
+  gl_state_.BindBuffer(GL_ARRAY_BUFFER, 0);
+  CheckGLError("Scene geometry");
+}
+
+void TreasureHuntRenderer::BindSceneGeometry(SceneObject object) {
+  if (gl_state_.vertex_arrays_supported()) {
+    gl_state_.BindVertexArray(scene_vertex_arrays_[object]);
+  } else {
+    SetSceneAttribPointers(object);
+  }
+}
+
+void TreasureHuntRenderer::SetSceneAttribPointers(SceneObject object) {
+  switch (object) {
+    case kCube: {
+      const bool batched = !cube_instancing_;
+      const int stride = batched ? kBatchedCubeStride : kCubeStride;
+      gl_state_.BindBuffer(GL_ARRAY_BUFFER,
+                           batched ? cube_batch_vbo_ : scene_vbo_);
+      glVertexAttribPointer(cube_position_param_, kCoordsPerVertex, GL_FLOAT,
+                            false, stride, nullptr);
+      glVertexAttribPointer(cube_normal_param_, kCoordsPerVertex, GL_FLOAT,
+                            false, stride,
+                            reinterpret_cast<const GLvoid*>(kCubeNormalOffset));
+      glVertexAttribPointer(cube_color_param_, kCoordsPerVertex, GL_FLOAT,
+                            false, stride,
+                            reinterpret_cast<const GLvoid*>(kCubeColorOffset));
+      uint32_t attrib_mask = AttribBit(cube_position_param_) |
+                             AttribBit(cube_normal_param_) |
+                             AttribBit(cube_color_param_);
+      if (batched) {
+        glVertexAttribPointer(
+            cube_instance_index_param_, 1, GL_FLOAT, false, stride,
+            reinterpret_cast<const GLvoid*>(kBatchedCubeIndexOffset));
+        attrib_mask |= AttribBit(cube_instance_index_param_);
+      } else {
+        // Each component of the instance data is a separate array; see
+        // CubeField.
+        gl_state_.BindBuffer(GL_ARRAY_BUFFER, cube_instance_vbo_);
+        for (int i = 0; i < CubeField::kComponentCount; ++i) {
+          glVertexAttribPointer(cube_instance_params_[i], 1, GL_FLOAT, false,
+                                0, reinterpret_cast<const GLvoid*>(
+                                       i * cube_field_.size() * sizeof(float)));
+          gl_state_.VertexAttribDivisor(cube_instance_params_[i], 1);
+          attrib_mask |= AttribBit(cube_instance_params_[i]);
+        }
+      }
+      gl_state_.SetVertexAttribArrays(attrib_mask);
+      break;
+    }
+    case kFloor:
+      gl_state_.BindBuffer(GL_ARRAY_BUFFER, scene_vbo_);
+      glVertexAttribPointer(floor_position_param_, kCoordsPerVertex, GL_FLOAT,
+                            false, 0,
+                            reinterpret_cast<const GLvoid*>(kFloorOffset));
+      gl_state_.SetVertexAttribArrays(AttribBit(floor_position_param_));
+      break;
+    case kReticle:
+      gl_state_.BindBuffer(GL_ARRAY_BUFFER, scene_vbo_);
+      glVertexAttribPointer(reticle_position_param_, kCoordsPerVertex,
+                            GL_FLOAT, false, 0,
+                            reinterpret_cast<const GLvoid*>(kReticleOffset));
+      gl_state_.SetVertexAttribArrays(AttribBit(reticle_position_param_));
+      break;
+    default:
+      break;
+  }
+}
+
+void TreasureHuntRenderer::UpdateCubeInstances() {
+  if (cube_instance_generation_ == cube_field_.generation()) return;
+  const int count = cube_field_.size();
+  if (cube_instancing_) {
+    gl_state_.BindBuffer(GL_ARRAY_BUFFER, cube_instance_vbo_);
+    glBufferSubData(GL_ARRAY_BUFFER, 0,
+                    CubeField::kComponentCount * count * sizeof(float),
+                    cube_field_.data());
+  } else {
+    cube_instance_uniforms_.resize(4 * count);
+    for (int i = 0; i < count; ++i) {
+      cube_instance_uniforms_[4 * i] = cube_field_.x(i);
+      cube_instance_uniforms_[4 * i + 1] = cube_field_.y(i);
+      cube_instance_uniforms_[4 * i + 2] = cube_field_.z(i);
+      cube_instance_uniforms_[4 * i + 3] = cube_field_.yaw(i);
+    }
+  }
+  cube_instance_generation_ = cube_field_.generation();
+}
+
+void TreasureHuntRenderer::UpdateProjections(
+    gvr::BufferViewport* const viewports[2]) {
+  gvr::Mat4f view_projections[2];
+  for (int eye = 0; eye < 2; ++eye) {
+    const gvr::Mat4f perspective = PerspectiveMatrixFromView(
+        viewports[eye]->GetSourceFov(), kZNear, kZFar);
+    view_projections[eye] = MatrixMul(perspective, eye_view_matrices_[eye]);
+    MatrixToGL(view_projections[eye], &view_projection_[16 * eye]);
+  }
+  MatrixMulBatchToGL(view_projections, model_floor_,
+                     modelview_projection_floor_.data(), 2);
+}
+
+gvr::Recti TreasureHuntRenderer::ViewRect(
+    const gvr::Sizei& buffer_size, const gvr::BufferViewport& viewport) const {
+  if (multiview_enabled_) {
+    const gvr::Sizei layer_size = {buffer_size.width / 2, buffer_size.height};
+    return CalculatePixelSpaceRect(layer_size, viewport.GetSourceUv());
+  }
+  return CalculatePixelSpaceRect(buffer_size, viewport.GetSourceUv());
+}
+
+int64_t TreasureHuntRenderer::MaskInsets() {
+  const gvr::BufferViewport* viewports[2] = {&viewport_left_,
+                                             &viewport_right_};
+  const gvr::BufferViewport* inset_viewports[2] = {&inset_viewport_left_,
+                                                   &inset_viewport_right_};
+  gvr::Recti masks[2];
+  for (int eye = 0; eye < 2; ++eye) {
+    masks[eye] = foveation::MaskRect(
+        ViewRect(render_size_, *viewports[eye]),
+        foveation::InsetUv(viewports[eye]->GetSourceFov(),
+                           inset_viewports[eye]->GetSourceFov()));
+  }
+  // With multiview, the scissor applies to both layers, so only the part
+  // both insets hide is masked.
+  int mask_count = 2;
+  int64_t layer_count = 1;
+  if (multiview_enabled_) {
+    masks[0] = foveation::IntersectRects(masks[0], masks[1]);
+    mask_count = 1;
+    layer_count = 2;
+  }
+
+  // Fragments only pass the depth test in front of the near plane.
+  int64_t masked_pixel_count = 0;
+  gl_state_.SetCapability(GL_SCISSOR_TEST, true);
+  glClearDepthf(0.0f);
+  for (int i = 0; i < mask_count; ++i) {
+    glScissor(masks[i].left, masks[i].bottom, masks[i].right - masks[i].left,
+              masks[i].top - masks[i].bottom);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    masked_pixel_count += layer_count * foveation::PixelCount(masks[i]);
+  }
+  glClearDepthf(1.0f);
+  gl_state_.SetCapability(GL_SCISSOR_TEST, false);
+  return masked_pixel_count;
+}
+
+void TreasureHuntRenderer::DrawViews(
+    const gvr::Sizei& buffer_size, gvr::BufferViewport* const viewports[2],
+    bool mask_hidden_area) {
+  if (multiview_enabled_) {
+    DrawWorld(kMultiview, buffer_size, *viewports[0], mask_hidden_area);
+  } else {
+    DrawWorld(kLeftView, buffer_size, *viewports[0], mask_hidden_area);
+    DrawWorld(kRightView, buffer_size, *viewports[1], mask_hidden_area);
+  }
+}
+
 /**
  * Draws a frame for a particular view.
  *
  * @param view The view to render: left, right, or both (multiview).
+ * @param buffer_size The size of the buffer, with the views side by side.
+ * @param viewport The viewport of the view, or of the left view with
+ *     multiview.
+ * @param mask_hidden_area Whether to mask out the parts of the view the
+ *     lenses hide first.
  */
-void TreasureHuntRenderer::DrawWorld(ViewType view) {
-  if (view == kMultiview) {
-    glViewport(0, 0, render_size_.width / 2, render_size_.height);
-  } else {
-    const gvr::BufferViewport& viewport =
-        view == kLeftView ? viewport_left_ : viewport_right_;
-    const gvr::Recti pixel_rect =
-        CalculatePixelSpaceRect(render_size_, viewport.GetSourceUv());
-    glViewport(pixel_rect.left, pixel_rect.bottom,
-               pixel_rect.right - pixel_rect.left,
-               pixel_rect.top - pixel_rect.bottom);
+void TreasureHuntRenderer::DrawWorld(ViewType view,
+                                     const gvr::Sizei& buffer_size,
+                                     const gvr::BufferViewport& viewport,
+                                     bool mask_hidden_area) {
+  static const char* kZoneNames[] = {"DrawLeftEye", "DrawRightEye",
+                                     "DrawMultiview"};
+  TRACE_ZONE(kZoneNames[view]);
+  gpu_timer_.Begin(kZoneNames[view]);
+  // With multiview, both layers are drawn to the same rectangle.
+  const gvr::Recti pixel_rect = ViewRect(buffer_size, viewport);
+  glViewport(pixel_rect.left, pixel_rect.bottom,
+             pixel_rect.right - pixel_rect.left,
+             pixel_rect.top - pixel_rect.bottom);
+  if (mask_hidden_area) {
+    hidden_area_.Draw(view == kRightView ? 1 : 0);
   }
   DrawCube(view);
   DrawFloor(view);
+  gpu_timer_.End();
 }
 
 void TreasureHuntRenderer::DrawCube(ViewType view) {
-  glUseProgram(cube_program_);
+  gl_state_.UseProgram(cube_program_);
 
   if (view == kMultiview) {
     glUniform3fv(cube_light_pos_param_, 2,
                  VectorPairToGLArray(light_pos_eye_space_).data());
-    glUniformMatrix4fv(cube_modelview_param_, 2, GL_FALSE,
-                       MatrixPairToGLArray(modelview_cube_).data());
-    glUniformMatrix4fv(cube_modelview_projection_param_, 2, GL_FALSE,
-                       MatrixPairToGLArray(modelview_projection_cube_).data());
+    glUniformMatrix4fv(cube_view_param_, 2, GL_FALSE, eye_view_.data());
+    glUniformMatrix4fv(cube_view_projection_param_, 2, GL_FALSE,
+                       view_projection_.data());
   } else {
     glUniform3fv(cube_light_pos_param_, 1, light_pos_eye_space_[view].data());
-    glUniformMatrix4fv(cube_modelview_param_, 1, GL_FALSE,
-                       MatrixToGLArray(modelview_cube_[view]).data());
-    glUniformMatrix4fv(
-        cube_modelview_projection_param_, 1, GL_FALSE,
-        MatrixToGLArray(modelview_projection_cube_[view]).data());
-  }
-
-  // Set the Model in the shader, used to calculate lighting
-  glUniformMatrix4fv(cube_model_param_, 1, GL_FALSE,
-                     MatrixToGLArray(model_cube_).data());
-
-  // Set the position of the cube
-  glVertexAttribPointer(cube_position_param_, kCoordsPerVertex, GL_FLOAT, false,
-                        0, cube_vertices_);
-  glEnableVertexAttribArray(cube_position_param_);
-
-  // Set the normal positions of the cube, again for shading
-  glVertexAttribPointer(cube_normal_param_, 3, GL_FLOAT, false, 0,
-                        cube_normals_);
-  glEnableVertexAttribArray(cube_normal_param_);
-
-  // Set vertex colors
-  if (IsPointingAtObject()) {
-    const float* found_color = world_layout_data_.cube_found_color.data();
-    glVertexAttrib4f(cube_color_param_, found_color[0], found_color[1],
-                     found_color[2], 1.0f);
-    glDisableVertexAttribArray(cube_color_param_);
-  } else {
-    glVertexAttribPointer(cube_color_param_, 3, GL_FLOAT, false, 0,
-                          cube_colors_);
-    glEnableVertexAttribArray(cube_color_param_);
+    glUniformMatrix4fv(cube_view_param_, 1, GL_FALSE,
+                       eye_view_.data() + 16 * view);
+    glUniformMatrix4fv(cube_view_projection_param_, 1, GL_FALSE,
+                       view_projection_.data() + 16 * view);
   }
 
-  glDrawArrays(GL_TRIANGLES, 0, 36);
+  BindSceneGeometry(kCube);
 
-  glDisableVertexAttribArray(cube_position_param_);
-  glDisableVertexAttribArray(cube_normal_param_);
-  glDisableVertexAttribArray(cube_color_param_);
+  // The cube being pointed at is drawn with the found color instead of its
+  // per-vertex colors.
+  const int count = cube_field_.size();
+  if (cube_instancing_) {
+    glUniform1i(cube_pointed_instance_param_, pointed_cube_);
+    gl_state_.DrawArraysInstanced(GL_TRIANGLES, 0, kCubeVertexCount, count);
+  } else {
+    for (int first = 0; first < count; first += kCubeBatchSize) {
+      const int batch_size = std::min(kCubeBatchSize, count - first);
+      glUniform4fv(cube_instances_param_, batch_size,
+                   &cube_instance_uniforms_[4 * first]);
+      glUniform1f(cube_pointed_instance_param_,
+                  static_cast<float>(pointed_cube_ - first));
+      glDrawArrays(GL_TRIANGLES, 0, batch_size * kCubeVertexCount);
+    }
+  }
 
   CheckGLError("Drawing cube");
 }
 
 void TreasureHuntRenderer::DrawFloor(ViewType view) {
-  glUseProgram(floor_program_);
+  gl_state_.UseProgram(floor_program_);
 
   if (view == kMultiview) {
     glUniform3fv(floor_light_pos_param_, 2,
                  VectorPairToGLArray(light_pos_eye_space_).data());
     glUniformMatrix4fv(floor_modelview_param_, 2, GL_FALSE,
-                       MatrixPairToGLArray(modelview_floor_).data());
+                       modelview_floor_.data());
     glUniformMatrix4fv(floor_modelview_projection_param_, 2, GL_FALSE,
-                       MatrixPairToGLArray(modelview_projection_floor_).data());
+                       modelview_projection_floor_.data());
   } else {
     glUniform3fv(floor_light_pos_param_, 1, light_pos_eye_space_[view].data());
     glUniformMatrix4fv(floor_modelview_param_, 1, GL_FALSE,
-                       MatrixToGLArray(modelview_floor_[view]).data());
-    glUniformMatrix4fv(
-        floor_modelview_projection_param_, 1, GL_FALSE,
-        MatrixToGLArray(modelview_projection_floor_[view]).data());
+                       modelview_floor_.data() + 16 * view);
+    glUniformMatrix4fv(floor_modelview_projection_param_, 1, GL_FALSE,
+                       modelview_projection_floor_.data() + 16 * view);
   }
 
   glUniformMatrix4fv(floor_model_param_, 1, GL_FALSE,
-                     MatrixToGLArray(model_floor_).data());
-  glVertexAttribPointer(floor_position_param_, kCoordsPerVertex, GL_FLOAT,
-                        false, 0, floor_vertices_);
+                     model_floor_gl_.data());
   glVertexAttrib3f(floor_normal_param_, 0.0f, 1.0f, 0.0f);
   glVertexAttrib4f(floor_color_param_, 0.0f, 0.3398f, 0.9023f, 1.0f);
 
-  glEnableVertexAttribArray(floor_position_param_);
-  glDrawArrays(GL_TRIANGLES, 0, 24);
-  glDisableVertexAttribArray(floor_position_param_);
+  BindSceneGeometry(kFloor);
+  glDrawArrays(GL_TRIANGLES, 0, kFloorVertexCount);
 
   CheckGLError("Drawing floor");
 }
 
 void TreasureHuntRenderer::DrawReticle() {
   glViewport(0, 0, reticle_render_size_.width, reticle_render_size_.height);
-  glUseProgram(reticle_program_);
-  const gvr::Mat4f uniform_matrix = {{{1.f, 0.f, 0.f, 0.f},
-                                      {0.f, 1.f, 0.f, 0.f},
-                                      {0.f, 0.f, 1.f, 0.f},
-                                      {0.f, 0.f, 0.f, 1.f}}};
+  gl_state_.UseProgram(reticle_program_);
   glUniformMatrix4fv(reticle_modelview_projection_param_, 1, GL_FALSE,
-                     MatrixToGLArray(uniform_matrix).data());
-  glVertexAttribPointer(reticle_position_param_, kCoordsPerVertex, GL_FLOAT,
-                        false, 0, reticle_vertices_);
-  glEnableVertexAttribArray(reticle_position_param_);
-  glDrawArrays(GL_TRIANGLES, 0, 6);
-  glDisableVertexAttribArray(reticle_position_param_);
+                     kIdentityGLMatrix.data());
+  BindSceneGeometry(kReticle);
+  glDrawArrays(GL_TRIANGLES, 0, kReticleVertexCount);
 
   CheckGLError("Drawing reticle");
 }
 
-void TreasureHuntRenderer::HideObject() {
-  std::array<float, 4> cube_position = {
-      model_cube_.m[0][3], model_cube_.m[1][3], model_cube_.m[2][3], 1.f};
+void TreasureHuntRenderer::HideCube(int cube) {
+  MoveCube(cube, M_PI * (RandomUniformFloat() + 0.5f));
 
-  // First rotate in XZ plane, between pi/2 and 3pi/2 radians away, apply this
-  // to model_cube_ to keep the front face of the cube towards the user.
-  float angle_xz = M_PI * (RandomUniformFloat() + 0.5f);
-  gvr::Mat4f rotation_matrix = {{{cosf(angle_xz), 0.f, -sinf(angle_xz), 0.f},
-                                 {0.f, 1.f, 0.f, 0.f},
-                                 {sinf(angle_xz), 0.f, cosf(angle_xz), 0.f},
-                                 {0.f, 0.f, 0.f, 1.f}}};
-  cube_position = MatrixVectorMul(rotation_matrix, cube_position);
-  model_cube_ = MatrixMul(rotation_matrix, model_cube_);
+  if (cube == 0 && audio_source_id_ >= 0) {
+    gvr_audio_api_->SetSoundObjectPosition(audio_source_id_, cube_field_.x(0),
+                                           cube_field_.y(0), cube_field_.z(0));
+  }
+}
+
+void TreasureHuntRenderer::MoveCube(int cube, float angle_xz) {
+  // First rotate in XZ plane, and turn the cube by the same angle to keep its
+  // front face towards the user.
+  const float cos_xz = cosf(angle_xz);
+  const float sin_xz = sinf(angle_xz);
+  const float x = cos_xz * cube_field_.x(cube) - sin_xz * cube_field_.z(cube);
+  const float z = sin_xz * cube_field_.x(cube) + cos_xz * cube_field_.z(cube);
 
   // Pick a new distance for the cube, and apply that scale to the position.
-  const float old_object_distance = object_distance_;
-  object_distance_ =
+  const float old_object_distance = std::sqrt(x * x + z * z);
+  const float object_distance =
       RandomUniformFloat() * (kMaxCubeDistance - kMinCubeDistance) +
       kMinCubeDistance;
-  const float scale = object_distance_ / old_object_distance;
-  cube_position[0] *= scale;
-  cube_position[1] *= scale;
-  cube_position[2] *= scale;
-
-  // Choose a random yaw for the cube between 0 and pi/4.
-  const float yaw = M_PI * (RandomUniformFloat()) / 4.0f;
-  cube_position[1] = tanf(yaw) * object_distance_;
+  const float scale = object_distance / old_object_distance;
 
-  model_cube_.m[0][3] = cube_position[0];
-  model_cube_.m[1][3] = cube_position[1];
-  model_cube_.m[2][3] = cube_position[2];
+  // Choose a random pitch for the cube between 0 and pi/4.
+  const float pitch = M_PI * (RandomUniformFloat()) / 4.0f;
 
-  if (audio_source_id_ >= 0) {
-    gvr_audio_api_->SetSoundObjectPosition(audio_source_id_, cube_position[0],
-                                           cube_position[1], cube_position[2]);
-  }
+  cube_field_.Set(cube, {x * scale, tanf(pitch) * object_distance, z * scale},
+                  cube_field_.yaw(cube) + angle_xz);
 }
 
-bool TreasureHuntRenderer::IsPointingAtObject() {
-  // Compute vectors pointing towards the reticle and towards the cube in head
-  // space.
-  gvr::Mat4f head_from_reticle = modelview_reticle_;
-  gvr::Mat4f head_from_cube = MatrixMul(head_view_, model_cube_);
+int TreasureHuntRenderer::FindPointedCube() {
+  // Compute the vector pointing towards the reticle in head space.
   const std::array<float, 4> reticle_vector =
-      MatrixVectorMul(head_from_reticle, {0.f, 0.f, 0.f, 1.f});
-  const std::array<float, 4> cube_vector =
-      MatrixVectorMul(head_from_cube, {0.f, 0.f, 0.f, 1.f});
-
-  // Compute the angle between the vector towards the reticle and the vector
-  // towards the cube by computing the arc cosine of their normalized dot
-  // product.
-  float angle = std::acos(std::max(-1.f, std::min(1.f,
-      VectorInnerProduct(reticle_vector, cube_vector) /
-      VectorNorm(reticle_vector) / VectorNorm(cube_vector))));
-  return angle < kAngleLimit;
+      MatrixVectorMul(modelview_reticle_, {0.f, 0.f, 0.f, 1.f});
+  return cube_field_.FindClosestInAngle(head_view_, Vec4ToVec3(reticle_vector),
+                                        kAngleLimit);
 }
 
-void TreasureHuntRenderer::LoadAndPlayCubeSound() {
+void TreasureHuntRenderer::LoadCubeSound() {
   // Preload sound files.
   gvr_audio_api_->PreloadSoundfile(kObjectSoundFile);
   gvr_audio_api_->PreloadSoundfile(kSuccessSoundFile);
-  // Create sound file handler from preloaded sound file.
-  audio_source_id_ = gvr_audio_api_->CreateSoundObject(kObjectSoundFile);
-  // Set sound object to current cube position.
-  gvr_audio_api_->SetSoundObjectPosition(audio_source_id_, model_cube_.m[0][3],
-                                         model_cube_.m[1][3],
-                                         model_cube_.m[2][3]);
-  // Trigger sound object playback.
-  gvr_audio_api_->PlaySound(audio_source_id_, true /* looped playback */);
+  // Create sound file handler from preloaded sound file. The cube may be
+  // moving, so the rendering thread places it and starts the playback.
+  loaded_audio_source_id_ =
+      gvr_audio_api_->CreateSoundObject(kObjectSoundFile);
 }
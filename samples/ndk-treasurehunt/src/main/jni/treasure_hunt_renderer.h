@@ -20,11 +20,23 @@
 #include <GLES2/gl2.h>
 #include <jni.h>
 
+#include <array>
+#include <atomic>
 #include <memory>
 #include <string>
 #include <thread>  // NOLINT
 #include <vector>
 
+#include "cube_field.h"  // NOLINT
+#include "dynamic_resolution.h"  // NOLINT
+#include "foveation.h"  // NOLINT
+#include "gl_state_cache.h"  // NOLINT
+#include "gpu_timer.h"  // NOLINT
+#include "hidden_area.h"  // NOLINT
+#include "pose_prediction.h"  // NOLINT
+#include "simd_math.h"  // NOLINT
+#include "spsc_ring.h"  // NOLINT
+#include "trace.h"  // NOLINT
 #include "vr/gvr/capi/include/gvr.h"
 #include "vr/gvr/capi/include/gvr_audio.h"
 #include "vr/gvr/capi/include/gvr_controller.h"
@@ -38,9 +50,17 @@ class TreasureHuntRenderer {
    *
    * @param gvr_api The (non-owned) gvr_context.
    * @param gvr_audio_api The (owned) gvr::AudioApi context.
+   * @param cube_count The number of cubes to hide in the scene. More than one
+   *     turns the scene into a stress test.
+   * @param trace_path The file a trace of the frames is written to on pause,
+   *     or empty not to trace.
+   * @param foveation Whether and how to render the periphery of the views at
+   *     a lower resolution.
    */
   TreasureHuntRenderer(gvr_context* gvr_context,
-                       std::unique_ptr<gvr::AudioApi> gvr_audio_api);
+                       std::unique_ptr<gvr::AudioApi> gvr_audio_api,
+                       int cube_count, const std::string& trace_path,
+                       const foveation::Config& foveation);
 
   /**
    * Destructor.
@@ -59,21 +79,56 @@ class TreasureHuntRenderer {
   void DrawFrame();
 
   /**
-   * Hide the cube if it's being targeted.
+   * Hide the targeted cube, if any, at the start of the next frame. This may
+   * be called from any one thread other than the rendering thread, such as
+   * the UI thread; it never blocks.
    */
   void OnTriggerEvent();
 
   /**
-   * Pause head tracking.
+   * Pause head tracking, and write the trace if tracing. This should be called
+   * on the rendering thread, since no frame may be drawn after it.
    */
   void OnPause();
 
   /**
-   * Resume head tracking, refreshing viewer parameters if necessary.
+   * Resume head tracking, refreshing viewer parameters if necessary. This
+   * should be called on the rendering thread.
    */
   void OnResume();
 
+  /**
+   * The number of pixels of the scene the last frame shaded, in all its
+   * buffers but that of the reticle.
+   */
+  int64_t shaded_pixel_count() const { return shaded_pixel_count_; }
+
+  /**
+   * The number of pixels of the scene the last frame would have shaded
+   * without foveation, at the same render scale.
+   */
+  int64_t unfoveated_pixel_count() const { return unfoveated_pixel_count_; }
+
  private:
+  /**
+   * Events posted by other threads, which are handled on the rendering
+   * thread at the start of the next frame.
+   */
+  enum Event {
+    kTriggerEvent,
+  };
+
+  /**
+   * Handles the events posted since the last frame, and starts the cube
+   * sound once it is loaded.
+   */
+  void HandleEvents();
+
+  /**
+   * Hide the targeted cube, if any. Runs on the rendering thread.
+   */
+  void HandleTriggerEvent();
+
   int CreateTexture(int width, int height, int textureFormat, int textureType);
 
   /*
@@ -81,6 +136,46 @@ class TreasureHuntRenderer {
    */
   void PrepareFramebuffer();
 
+  /**
+   * Computes the sizes of the scene buffers at the largest render scale,
+   * from the recommended buffer viewports.
+   *
+   * @param render_size Receives the size of the buffer of the whole views.
+   * @param inset_render_size Receives the size of the buffer of the insets,
+   *     which is only used with foveation.
+   */
+  void GetSceneBufferSizes(gvr::Sizei* render_size,
+                           gvr::Sizei* inset_render_size);
+
+  /**
+   * Creates the spec of a buffer the scene is drawn into.
+   *
+   * @param size The size of the buffer, with the views side by side.
+   * @return The buffer spec.
+   */
+  gvr::BufferSpec CreateSceneBufferSpec(const gvr::Sizei& size);
+
+  /**
+   * Resizes a buffer the scene is drawn into.
+   *
+   * @param index The index of the buffer in the swap chain.
+   * @param size The new size of the buffer, with the views side by side.
+   */
+  void ResizeSceneBuffer(int index, const gvr::Sizei& size);
+
+  /**
+   * Rebuilds the hidden area mask from the distortion of the current viewer.
+   */
+  void UpdateHiddenArea();
+
+  /**
+   * Feeds the time the last frame took to resolution_.
+   *
+   * @param frame_nanos The GPU time of the frame, or its CPU time where the
+   *     GPU cannot be timed.
+   */
+  void UpdateRenderScale(int64_t frame_nanos);
+
   /**
    * Converts a raw text file, saved as a resource, into an OpenGL ES shader.
    *
@@ -96,12 +191,98 @@ class TreasureHuntRenderer {
     kMultiview
   };
 
+  /**
+   * The objects stored in the static scene VBO. The cubes are also sourced
+   * from the cube instance or batch VBO.
+   */
+  enum SceneObject {
+    kCube,
+    kFloor,
+    kReticle,
+    kSceneObjectCount
+  };
+
+  /**
+   * Uploads the cube, floor and reticle geometry into VBOs, and records
+   * their attribute setup in vertex array objects when supported.
+   */
+  void CreateSceneGeometry();
+
+  /**
+   * Refreshes the cube instance data the GPU draws from if any cube moved:
+   * the instance VBO with multiview, or the batch uniforms otherwise.
+   */
+  void UpdateCubeInstances();
+
+  /**
+   * Makes the given object's geometry the source of the vertex attributes of
+   * its program.
+   *
+   * @param object The object about to be drawn.
+   */
+  void BindSceneGeometry(SceneObject object);
+
+  /**
+   * Points the vertex attributes of the given object's program into the
+   * scene VBO and enables them. With vertex array objects, this is recorded
+   * into the currently bound one.
+   *
+   * @param object The object whose attributes to set up.
+   */
+  void SetSceneAttribPointers(SceneObject object);
+
+  /**
+   * Computes view_projection_ and modelview_projection_floor_ for the fields
+   * of view of the given viewports.
+   *
+   * @param viewports The viewports of the left and right views.
+   */
+  void UpdateProjections(gvr::BufferViewport* const viewports[2]);
+
+  /**
+   * Returns the pixels a view is rendered to in a scene buffer: in its
+   * layer with multiview, or in the whole buffer otherwise.
+   *
+   * @param buffer_size The size of the buffer, with the views side by side.
+   * @param viewport The viewport of the view.
+   * @return The rectangle of the view in pixels.
+   */
+  gvr::Recti ViewRect(const gvr::Sizei& buffer_size,
+                      const gvr::BufferViewport& viewport) const;
+
+  /**
+   * Clears the depth of the parts of the views in the bound buffer that the
+   * insets hide to the near plane, so that drawing the world shades none of
+   * them.
+   *
+   * @return The number of pixels masked.
+   */
+  int64_t MaskInsets();
+
+  /**
+   * Draws all world-space objects into the bound buffer, for both views.
+   *
+   * @param buffer_size The size of the buffer, with the views side by side.
+   * @param viewports The viewports of the left and right views.
+   * @param mask_hidden_area Whether to mask out the parts of the views the
+   *     lenses hide first. The viewports must cover the whole field of view.
+   */
+  void DrawViews(const gvr::Sizei& buffer_size,
+                 gvr::BufferViewport* const viewports[2],
+                 bool mask_hidden_area);
+
   /**
    * Draws all world-space objects for the given view type.
    *
    * @param view Specifies which view we are rendering.
+   * @param buffer_size The size of the buffer, with the views side by side.
+   * @param viewport The viewport of the view, or of the left view with
+   *     multiview.
+   * @param mask_hidden_area Whether to mask out the parts of the view the
+   *     lenses hide first.
    */
-  void DrawWorld(ViewType view);
+  void DrawWorld(ViewType view, const gvr::Sizei& buffer_size,
+                 const gvr::BufferViewport& viewport, bool mask_hidden_area);
 
   /**
    * Draws the reticle. The reticle is positioned using viewport parameters,
@@ -110,10 +291,11 @@ class TreasureHuntRenderer {
   void DrawReticle();
 
   /**
-   * Draw the cube.
+   * Draw the cubes.
    *
    * We've set all of our transformation matrices. Now we simply pass them
-   * into the shader.
+   * into the shader. The cubes are drawn with one instanced draw call with
+   * multiview, and in batches of kCubeBatchSize cubes otherwise.
    *
    * @param view Specifies which eye we are rendering: left, right, or both.
    */
@@ -131,12 +313,23 @@ class TreasureHuntRenderer {
   void DrawFloor(ViewType view);
 
   /**
-   * Find a new random position for the object.
+   * Find a new random position for a cube.
    *
    * We'll rotate it around the Y-axis so it's out of sight, and then up or
    * down by a little bit.
+   *
+   * @param cube The index of the cube.
    */
-  void HideObject();
+  void HideCube(int cube);
+
+  /**
+   * Rotate a cube around the user along the Y-axis, then pick a new random
+   * distance and height for it.
+   *
+   * @param cube The index of the cube.
+   * @param angle_xz The angle to rotate it by, in radians.
+   */
+  void MoveCube(int cube, float angle_xz);
 
   /**
    * Update the position of the reticle based on controller data.
@@ -146,20 +339,22 @@ class TreasureHuntRenderer {
   void UpdateReticlePosition();
 
   /**
-   * Check if user is pointing or looking at the object by calculating whether
-   * the angle between the user's gaze or controller orientation and the vector
-   * pointing towards the object is lower than some threshold.
+   * Find the cube the user is pointing or looking at: the cube for which the
+   * angle between the user's gaze or controller orientation and the vector
+   * pointing towards the cube is the lowest, if it is lower than some
+   * threshold.
    *
-   * @return true if the user is pointing at the object.
+   * @return The index of the cube, or -1 if the user is not pointing at any.
    */
-  bool IsPointingAtObject();
+  int FindPointedCube();
 
   /**
-   * Preloads the cube sound sample and starts the spatialized playback at the
-   * current cube location. This method is executed from a separate thread to
-   * avoid any delay during construction and app initialization.
+   * Preloads the sound samples and creates the cube sound object, whose
+   * playback the rendering thread starts at the current cube location. This
+   * method is executed from a separate thread to avoid any delay during
+   * construction and app initialization.
    */
-  void LoadAndPlayCubeSound();
+  void LoadCubeSound();
 
   /**
    * Process the controller input.
@@ -182,21 +377,58 @@ class TreasureHuntRenderer {
 
   std::unique_ptr<gvr::GvrApi> gvr_api_;
   std::unique_ptr<gvr::AudioApi> gvr_audio_api_;
+  // Predicts the head pose for when each frame will be displayed, from the
+  // measured frame timings.
+  pose_prediction::PosePredictor pose_predictor_;
   std::unique_ptr<gvr::BufferViewportList> viewport_list_;
   std::unique_ptr<gvr::SwapChain> swapchain_;
   gvr::BufferViewport viewport_left_;
   gvr::BufferViewport viewport_right_;
 
+  // With foveation, the views are rendered at a lower resolution, and the
+  // part of them around the optical axis again at full resolution into the
+  // inset buffer, which these viewports show.
+  const foveation::Config foveation_;
+  gvr::BufferViewport inset_viewport_left_;
+  gvr::BufferViewport inset_viewport_right_;
+
   std::vector<float> lightpos_;
 
   WorldLayoutData world_layout_data_;
 
-  const float* floor_vertices_;
-  const float* cube_vertices_;
-  const float* cube_colors_;
   const float* cube_found_colors_;
-  const float* cube_normals_;
-  const float* reticle_vertices_;
+
+  // Static scene geometry; see CreateSceneGeometry(). The vertex arrays are
+  // only created when supported.
+  GLuint scene_vbo_;
+  std::array<GLuint, kSceneObjectCount> scene_vertex_arrays_;
+
+  // The cubes. With ES 3.0, they are drawn instanced from an instance VBO
+  // holding a copy of cube_field_, in one draw call per view, or one for both
+  // with multiview. With ES 2.0, the cube geometry is repeated
+  // kCubeBatchSize times in the batch VBO, and each batch is placed by an
+  // array of uniforms taken from cube_instance_uniforms_, which holds the
+  // position and yaw of each cube.
+  CubeField cube_field_;
+  bool cube_instancing_;
+  GLuint cube_instance_vbo_;
+  GLuint cube_batch_vbo_;
+  std::vector<float> cube_instance_uniforms_;
+  // The cube_field_ generation the GPU copy was last refreshed from.
+  int cube_instance_generation_;
+  // The cube being pointed at this frame, or -1.
+  int pointed_cube_;
+
+  /**
+   * GL state shadowed to skip redundant calls. It is invalidated at the start
+   * of every frame.
+   */
+  gl_state::StateCache gl_state_;
+
+  // Keeps the parts of the scene buffer that the lenses hide from being
+  // shaded. It is rebuilt when the viewer profile may have changed.
+  hidden_area::Mask hidden_area_;
+  bool hidden_area_stale_;
 
   int cube_program_;
   int floor_program_;
@@ -205,10 +437,14 @@ class TreasureHuntRenderer {
   int cube_position_param_;
   int cube_normal_param_;
   int cube_color_param_;
-  int cube_model_param_;
-  int cube_modelview_param_;
-  int cube_modelview_projection_param_;
+  int cube_instance_index_param_;
+  std::array<int, CubeField::kComponentCount> cube_instance_params_;
+  int cube_view_param_;
+  int cube_view_projection_param_;
   int cube_light_pos_param_;
+  int cube_instances_param_;
+  int cube_pointed_instance_param_;
+  int cube_found_color_param_;
 
   int floor_position_param_;
   int floor_normal_param_;
@@ -226,26 +462,43 @@ class TreasureHuntRenderer {
   const std::array<float, 4> light_pos_world_space_;
 
   gvr::Mat4f head_view_;
-  gvr::Mat4f model_cube_;
   gvr::Mat4f camera_;
   gvr::Mat4f view_;
   gvr::Mat4f model_floor_;
+  // Column-major copy of model_floor_, refreshed once per frame for the
+  // u_Model uniform.
+  simd_math::GLMat4 model_floor_gl_;
   gvr::Mat4f model_reticle_;
   gvr::Mat4f modelview_reticle_;
+  // Sizes of the scene framebuffer and of the inset buffer, allocated for
+  // the largest render scale.
   gvr::Sizei render_size_;
+  gvr::Sizei inset_render_size_;
+
+  // Picks the scale the views are rendered at from the frame times.
+  dynamic_resolution::ScaleController resolution_;
+
+  // Pixels of the scene shaded in the last frame, and how many it would
+  // have been without foveation.
+  int64_t shaded_pixel_count_;
+  int64_t unfoveated_pixel_count_;
+
+  // The view matrix of each eye, from which the matrices below are computed.
+  gvr::Mat4f eye_view_matrices_[2];
 
   // View-dependent values.  These are stored in length two arrays to allow
   // syncing with uniforms consumed by the multiview vertex shader.  For
   // simplicity, we stash valid values in both elements (left, right) of these
-  // arrays even when multiview is disabled.
+  // arrays even when multiview is disabled. The matrices are stored
+  // pre-transposed to column-major order, left eye first, so they can be
+  // handed to glUniformMatrix4fv() as-is.
   std::array<float, 3> light_pos_eye_space_[2];
-  gvr::Mat4f modelview_projection_cube_[2];
-  gvr::Mat4f modelview_projection_floor_[2];
-  gvr::Mat4f modelview_cube_[2];
-  gvr::Mat4f modelview_floor_[2];
+  std::array<float, 32> eye_view_;
+  std::array<float, 32> view_projection_;
+  std::array<float, 32> modelview_projection_floor_;
+  std::array<float, 32> modelview_floor_;
 
   int score_;
-  float object_distance_;
   float reticle_distance_;
   bool multiview_enabled_;
 
@@ -255,6 +508,14 @@ class TreasureHuntRenderer {
 
   std::thread audio_initialization_thread_;
 
+  // The cube sound object, set by the audio initialization thread once it is
+  // created. The rendering thread takes it from there into audio_source_id_.
+  std::atomic<gvr::AudioSourceId> loaded_audio_source_id_;
+
+  // Events posted by OnTriggerEvent(), drained by the rendering thread. It is
+  // lock-free, so neither the posting thread nor the frame ever wait.
+  spsc::Ring<Event> events_;
+
   // Controller API entry point.
   std::unique_ptr<gvr::ControllerApi> gvr_controller_api_;
 
@@ -262,6 +523,13 @@ class TreasureHuntRenderer {
   gvr::ControllerState gvr_controller_state_;
 
   gvr::ViewerType gvr_viewer_type_;
+
+  // Times the drawing of the views and of the reticle on the GPU, for the
+  // trace and for resolution_.
+  trace::GpuTimer gpu_timer_;
+
+  // The file the trace is written to on pause, or empty if not tracing.
+  std::string trace_path_;
 };
 
 #endif  // TREASUREHUNT_APP_SRC_MAIN_JNI_TREASUREHUNTRENDERER_H_  // NOLINT
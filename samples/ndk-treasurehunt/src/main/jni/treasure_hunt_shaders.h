@@ -16,9 +16,10 @@
 #ifndef TREASUREHUNT_APP_SRC_MAIN_JNI_TREASUREHUNTSHADERS_H_  // NOLINT
 #define TREASUREHUNT_APP_SRC_MAIN_JNI_TREASUREHUNTSHADERS_H_  // NOLINT
 
-// Each shader has two variants: a single-eye ES 2.0 variant, and a multiview
-// ES 3.0 variant.  The multiview vertex shaders use transforms defined by
-// arrays of mat4 uniforms, using gl_ViewID_OVR to determine the array index.
+// Each shader has two variants, and the cube shader a third (see below): a
+// single-eye ES 2.0 variant, and a multiview ES 3.0 variant.  The multiview
+// vertex shaders use transforms defined by arrays of mat4 uniforms, using
+// gl_ViewID_OVR to determine the array index.
 
 static const char* kDiffuseLightingVertexShaders[] = {
     R"glsl(
@@ -75,6 +76,134 @@ static const char* kDiffuseLightingVertexShaders[] = {
     })glsl"
 };
 
+// The cube shaders draw many cubes at once, placing each one from its
+// instance data: its position and its yaw (see cube_field.h). The ES 2.0
+// variant draws a batch of copies of the cube, each vertex of which holds the
+// index of its copy into the u_Instances array. The batch size must match
+// kCubeBatchSize. The ES 3.0 variants use instanced drawing instead: the
+// multiview one, and a third, single-view one for ES 3.0 without multiview.
+static const char* kCubeVertexShaders[] = {
+    R"glsl(
+    uniform mat4 u_View;
+    uniform mat4 u_VP;
+    uniform vec3 u_LightPos;
+    uniform vec4 u_Instances[64];
+    uniform float u_PointedInstance;
+    uniform vec3 u_FoundColor;
+    attribute vec4 a_Position;
+    attribute vec4 a_Color;
+    attribute vec3 a_Normal;
+    attribute float a_InstanceIndex;
+    varying vec4 v_Color;
+
+    vec3 CubeToWorld(vec3 v, float yaw) {
+      v = vec3(v.x, 0.7071 * (v.y - v.z), 0.7071 * (v.y + v.z));
+      float c = cos(yaw);
+      float s = sin(yaw);
+      return vec3(c * v.x - s * v.z, v.y, s * v.x + c * v.z);
+    }
+
+    void main() {
+      vec4 instance = u_Instances[int(a_InstanceIndex)];
+      vec4 position =
+          vec4(CubeToWorld(a_Position.xyz, instance.w) + instance.xyz, 1.0);
+      vec3 normal = CubeToWorld(a_Normal, instance.w);
+      vec3 modelViewVertex = vec3(u_View * position);
+      vec3 modelViewNormal = vec3(u_View * vec4(normal, 0.0));
+      float distance = length(u_LightPos - modelViewVertex);
+      vec3 lightVector = normalize(u_LightPos - modelViewVertex);
+      float diffuse = max(dot(modelViewNormal, lightVector), 0.5);
+      diffuse = diffuse * (1.0 / (1.0 + (0.00001 * distance * distance)));
+      vec3 color = abs(a_InstanceIndex - u_PointedInstance) < 0.5 ?
+          u_FoundColor : a_Color.rgb;
+      v_Color = vec4(color * diffuse, 1.0);
+      gl_Position = u_VP * position;
+    })glsl",
+
+    R"glsl(#version 300 es
+    #extension GL_OVR_multiview2 : enable
+
+    layout(num_views=2) in;
+
+    uniform mat4 u_View[2];
+    uniform mat4 u_VP[2];
+    uniform vec3 u_LightPos[2];
+    uniform int u_PointedInstance;
+    uniform vec3 u_FoundColor;
+    in vec4 a_Position;
+    in vec4 a_Color;
+    in vec3 a_Normal;
+    in float a_InstanceX;
+    in float a_InstanceY;
+    in float a_InstanceZ;
+    in float a_InstanceYaw;
+    out vec4 v_Color;
+
+    vec3 CubeToWorld(vec3 v, float yaw) {
+      v = vec3(v.x, 0.7071 * (v.y - v.z), 0.7071 * (v.y + v.z));
+      float c = cos(yaw);
+      float s = sin(yaw);
+      return vec3(c * v.x - s * v.z, v.y, s * v.x + c * v.z);
+    }
+
+    void main() {
+      mat4 view = u_View[gl_ViewID_OVR];
+      vec3 lightpos = u_LightPos[gl_ViewID_OVR];
+      vec4 position = vec4(CubeToWorld(a_Position.xyz, a_InstanceYaw) +
+                           vec3(a_InstanceX, a_InstanceY, a_InstanceZ), 1.0);
+      vec3 normal = CubeToWorld(a_Normal, a_InstanceYaw);
+      vec3 modelViewVertex = vec3(view * position);
+      vec3 modelViewNormal = vec3(view * vec4(normal, 0.0));
+      float distance = length(lightpos - modelViewVertex);
+      vec3 lightVector = normalize(lightpos - modelViewVertex);
+      float diffuse = max(dot(modelViewNormal, lightVector), 0.5);
+      diffuse = diffuse * (1.0 / (1.0 + (0.00001 * distance * distance)));
+      vec3 color = gl_InstanceID == u_PointedInstance ?
+          u_FoundColor : a_Color.rgb;
+      v_Color = vec4(color * diffuse, 1.0);
+      gl_Position = u_VP[gl_ViewID_OVR] * position;
+    })glsl",
+
+    R"glsl(#version 300 es
+
+    uniform mat4 u_View;
+    uniform mat4 u_VP;
+    uniform vec3 u_LightPos;
+    uniform int u_PointedInstance;
+    uniform vec3 u_FoundColor;
+    in vec4 a_Position;
+    in vec4 a_Color;
+    in vec3 a_Normal;
+    in float a_InstanceX;
+    in float a_InstanceY;
+    in float a_InstanceZ;
+    in float a_InstanceYaw;
+    out vec4 v_Color;
+
+    vec3 CubeToWorld(vec3 v, float yaw) {
+      v = vec3(v.x, 0.7071 * (v.y - v.z), 0.7071 * (v.y + v.z));
+      float c = cos(yaw);
+      float s = sin(yaw);
+      return vec3(c * v.x - s * v.z, v.y, s * v.x + c * v.z);
+    }
+
+    void main() {
+      vec4 position = vec4(CubeToWorld(a_Position.xyz, a_InstanceYaw) +
+                           vec3(a_InstanceX, a_InstanceY, a_InstanceZ), 1.0);
+      vec3 normal = CubeToWorld(a_Normal, a_InstanceYaw);
+      vec3 modelViewVertex = vec3(u_View * position);
+      vec3 modelViewNormal = vec3(u_View * vec4(normal, 0.0));
+      float distance = length(u_LightPos - modelViewVertex);
+      vec3 lightVector = normalize(u_LightPos - modelViewVertex);
+      float diffuse = max(dot(modelViewNormal, lightVector), 0.5);
+      diffuse = diffuse * (1.0 / (1.0 + (0.00001 * distance * distance)));
+      vec3 color = gl_InstanceID == u_PointedInstance ?
+          u_FoundColor : a_Color.rgb;
+      v_Color = vec4(color * diffuse, 1.0);
+      gl_Position = u_VP * position;
+    })glsl"
+};
+
 static const char* kGridFragmentShaders[] = {
     R"glsl(
     precision mediump float;